@@ -0,0 +1,312 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Scripted motor benchmarks: the same move sequences on every build, driven straight
+// into the driver so no Matter controller is needed. Each run resets the motion bench
+// and reports what it measured over the run.
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <esp_timer.h>
+
+#if CONFIG_ENABLE_CHIP_SHELL
+#include <esp_matter_console.h>
+#endif
+
+#include "app_priv.h"
+#include "bs_log.h"
+
+namespace {
+constexpr uint32_t k_poll_ms = 20;
+constexpr TickType_t k_poll_ticks = pdMS_TO_TICKS(k_poll_ms);
+constexpr uint32_t k_settle_timeout_ms = 120000;
+constexpr uint16_t k_hop_start_percent100ths = 2000;
+constexpr uint16_t k_hop_percent100ths = 200;
+constexpr uint8_t k_hop_count = 10;
+constexpr uint8_t k_retarget_count = 40;
+constexpr TickType_t k_retarget_period_ticks = pdMS_TO_TICKS(50);
+
+const char *const k_script_names[APP_BENCH_COUNT] = {"sweep", "hops", "retarget"};
+
+// Blocks until the blind is at rest, or the timeout. Returns false on timeout.
+bool wait_idle()
+{
+    for (uint32_t waited_ms = 0; waited_ms < k_settle_timeout_ms; waited_ms += k_poll_ms) {
+        app_driver_state_t state = {};
+        if (app_driver_get_state(&state) == ESP_OK && !state.moving) {
+            return true;
+        }
+        vTaskDelay(k_poll_ticks);
+    }
+    return false;
+}
+
+bool go_and_wait(uint16_t endpoint_id, uint16_t percent100ths)
+{
+    app_driver_set_target_percent100ths(endpoint_id, percent100ths);
+    // The step generator picks the target up on its next pass.
+    vTaskDelay(k_poll_ticks);
+    return wait_idle();
+}
+
+// Unmeasured: bring the blind to where the script starts.
+bool prepare(uint16_t endpoint_id, app_bench_script_t script)
+{
+    switch (script) {
+    case APP_BENCH_HOPS:
+        return go_and_wait(endpoint_id, k_hop_start_percent100ths);
+    default:
+        return go_and_wait(endpoint_id, 0);
+    }
+}
+
+bool run_script(uint16_t endpoint_id, app_bench_script_t script)
+{
+    switch (script) {
+    case APP_BENCH_SWEEP:
+        return go_and_wait(endpoint_id, 10000) && go_and_wait(endpoint_id, 0);
+    case APP_BENCH_HOPS:
+        for (uint8_t hop = 1; hop <= k_hop_count; ++hop) {
+            if (!go_and_wait(endpoint_id, static_cast<uint16_t>(k_hop_start_percent100ths + hop * k_hop_percent100ths))) {
+                return false;
+            }
+        }
+        return true;
+    case APP_BENCH_RETARGET: {
+        // A slider being dragged: targets between 20% and 80%, most superseded in flight.
+        uint32_t lcg = 1;
+        for (uint8_t i = 0; i < k_retarget_count; ++i) {
+            lcg = lcg * 1103515245U + 12345U;
+            app_driver_set_target_percent100ths(endpoint_id, static_cast<uint16_t>(2000 + (lcg >> 16) % 6000));
+            vTaskDelay(k_retarget_period_ticks);
+        }
+        return wait_idle();
+    }
+    default:
+        return false;
+    }
+}
+
+#if CONFIG_ENABLE_CHIP_SHELL
+uint16_t s_endpoint_id = 0;
+std::atomic<bool> s_bench_running(false);
+int s_bench_first = 0;
+int s_bench_last = 0;
+
+void log_result(const app_bench_result_t &result)
+{
+    BS_LOG_STATE("motor-bench %s%s: %u ms, %u steps (%u steps/s), jitter %d..%d us (%u late), "
+                 "lock wait avg %u / max %u us, %u reports, command latency max %u us",
+                 result.name, result.completed ? "" : " (timed out)", static_cast<unsigned>(result.duration_ms),
+                 static_cast<unsigned>(result.steps), static_cast<unsigned>(result.steps_per_s),
+                 static_cast<int>(result.jitter_min_us), static_cast<int>(result.jitter_max_us),
+                 static_cast<unsigned>(result.late_steps), static_cast<unsigned>(result.lock_wait_avg_us),
+                 static_cast<unsigned>(result.lock_wait_max_us), static_cast<unsigned>(result.reports),
+                 static_cast<unsigned>(result.command_latency_max_us));
+}
+
+// Runs on its own task so the console stays responsive (and `matter motor-bench state`
+// or a STOP press work) while the blind moves.
+void bench_task(void *arg)
+{
+    (void)arg;
+    for (int script = s_bench_first; script <= s_bench_last; ++script) {
+        app_bench_result_t result = {};
+        esp_err_t err = app_bench_run(s_endpoint_id, static_cast<app_bench_script_t>(script), &result);
+        if (err != ESP_OK) {
+            BS_LOG_WARN("motor-bench %s: not run (%d)", k_script_names[script], err);
+            break;
+        }
+        log_result(result);
+    }
+    s_bench_running.store(false);
+    vTaskDelete(nullptr);
+}
+
+void log_state()
+{
+    app_driver_state_t state = {};
+    if (app_driver_get_state(&state) != ESP_OK) {
+        BS_LOG_WARN("motor-bench: driver not ready");
+        return;
+    }
+    BS_LOG_STATE("Motor: %u.%02u%% (%u / %u steps), target %u.%02u%% (%u steps), %s%s%s",
+                 static_cast<unsigned>(state.current_percent100ths / 100),
+                 static_cast<unsigned>(state.current_percent100ths % 100), static_cast<unsigned>(state.current_steps),
+                 static_cast<unsigned>(state.travel_steps), static_cast<unsigned>(state.target_percent100ths / 100),
+                 static_cast<unsigned>(state.target_percent100ths % 100), static_cast<unsigned>(state.target_steps),
+                 state.moving ? (state.dir > 0 ? "moving down" : "moving up") : "idle",
+                 state.stopped_early ? ", last move stopped early" : "", state.calibrating ? ", calibrating" : "");
+    app_motion_bench_t bench = {};
+    app_driver_get_motion_bench(&bench);
+    BS_LOG_STATE("  since reset: %u steps, %u reports, lock wait max %u us over %u takes",
+                 static_cast<unsigned>(bench.steps), static_cast<unsigned>(bench.reports),
+                 static_cast<unsigned>(bench.lock_wait_max_us), static_cast<unsigned>(bench.lock_takes));
+}
+
+esp_err_t bench_command_handler(int argc, char **argv)
+{
+    if (argc == 0 || strcmp(argv[0], "state") == 0) {
+        log_state();
+        return ESP_OK;
+    }
+    if (strcmp(argv[0], "goto") == 0 && argc >= 2) {
+        long percent = strtol(argv[1], nullptr, 10);
+        if (percent < 0 || percent > 100) {
+            BS_LOG_WARN("motor-bench goto: 0-100");
+            return ESP_ERR_INVALID_ARG;
+        }
+        app_driver_set_target_percent100ths(s_endpoint_id, static_cast<uint16_t>(percent * 100));
+        return ESP_OK;
+    }
+    int first = -1;
+    int last = -1;
+    if (strcmp(argv[0], "all") == 0) {
+        first = 0;
+        last = APP_BENCH_COUNT - 1;
+    }
+    for (int script = 0; script < APP_BENCH_COUNT; ++script) {
+        if (strcmp(argv[0], k_script_names[script]) == 0) {
+            first = last = script;
+        }
+    }
+    if (first < 0) {
+        BS_LOG_WARN("usage: motor-bench [state|goto <percent>|sweep|hops|retarget|all]");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_bench_running.exchange(true)) {
+        BS_LOG_WARN("motor-bench: a run is already in progress");
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_bench_first = first;
+    s_bench_last = last;
+    if (xTaskCreate(bench_task, "motor_bench", 3072, nullptr, 1, nullptr) != pdPASS) {
+        s_bench_running.store(false);
+        BS_LOG_ERROR("motor-bench: failed to start the bench task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t motionbench_command_handler(int argc, char **argv)
+{
+    if (argc >= 1 && strcmp(argv[0], "reset") == 0) {
+        app_driver_reset_motion_bench();
+        BS_LOG_APP("motionbench: counters reset");
+        return ESP_OK;
+    }
+    if (argc >= 1 && strcmp(argv[0], "dump") != 0) {
+        BS_LOG_WARN("usage: motionbench [dump|reset]");
+        return ESP_ERR_INVALID_ARG;
+    }
+    app_motion_bench_t bench = {};
+    app_driver_get_motion_bench(&bench);
+    if (bench.motion_core < 0) {
+        BS_LOG_STATE("Motion bench (driver unpinned):");
+    } else {
+        BS_LOG_STATE("Motion bench (driver pinned to core %d):", static_cast<int>(bench.motion_core));
+    }
+    BS_LOG_STATE("  step jitter: %u intervals, deviation %d..%d us (p-p %d us), %u late >50us",
+                 static_cast<unsigned>(bench.step_intervals), static_cast<int>(bench.step_dev_min_us),
+                 static_cast<int>(bench.step_dev_max_us),
+                 static_cast<int>(bench.step_dev_max_us - bench.step_dev_min_us),
+                 static_cast<unsigned>(bench.step_late));
+    BS_LOG_STATE("  command latency: %u cmds, last %u us, avg %u us, max %u us; reports dropped %u",
+                 static_cast<unsigned>(bench.commands), static_cast<unsigned>(bench.command_latency_last_us),
+                 static_cast<unsigned>(bench.command_latency_avg_us),
+                 static_cast<unsigned>(bench.command_latency_max_us), static_cast<unsigned>(bench.reports_dropped));
+    BS_LOG_STATE("  %u steps, %u reports; state lock: %u takes, wait avg %u us, max %u us",
+                 static_cast<unsigned>(bench.steps), static_cast<unsigned>(bench.reports),
+                 static_cast<unsigned>(bench.lock_takes),
+                 static_cast<unsigned>(bench.lock_takes ? bench.lock_wait_total_us / bench.lock_takes : 0),
+                 static_cast<unsigned>(bench.lock_wait_max_us));
+    app_encoder_stats_t encoder = {};
+    if (app_driver_get_encoder_stats(&encoder) == ESP_OK) {
+        BS_LOG_STATE("  encoder: %u moves, %u drift corrections, %u stalls, max error %u steps; now %d vs %u steps",
+                     static_cast<unsigned>(encoder.moves_checked), static_cast<unsigned>(encoder.drift_corrections),
+                     static_cast<unsigned>(encoder.stalls), static_cast<unsigned>(encoder.max_error_steps),
+                     static_cast<int>(encoder.measured_steps), static_cast<unsigned>(encoder.commanded_steps));
+    }
+    app_lockstep_stats_t lockstep = {};
+    if (app_driver_get_lockstep_stats(&lockstep) == ESP_OK) {
+        BS_LOG_STATE("  lockstep: %u edges, %u misaligned, step error %d; motor B trim %d (target %d)",
+                     static_cast<unsigned>(lockstep.edges), static_cast<unsigned>(lockstep.misaligned_edges),
+                     static_cast<int>(lockstep.step_error), static_cast<int>(lockstep.trim_steps),
+                     static_cast<int>(lockstep.trim_target_steps));
+    }
+    return ESP_OK;
+}
+#endif
+} // namespace
+
+esp_err_t app_bench_run(uint16_t endpoint_id, app_bench_script_t script, app_bench_result_t *result)
+{
+    if (!result || script >= APP_BENCH_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (app_driver_is_calibrating()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *result = {};
+    result->name = k_script_names[script];
+    if (!prepare(endpoint_id, script)) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    app_driver_reset_motion_bench();
+    int64_t start_us = esp_timer_get_time();
+    result->completed = run_script(endpoint_id, script);
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    app_motion_bench_t bench = {};
+    app_driver_get_motion_bench(&bench);
+
+    // The run ends with the idle poll that saw the blind at rest; that is within one
+    // poll period of the last step.
+    result->duration_ms = static_cast<uint32_t>(elapsed_us / 1000);
+    result->steps = bench.steps;
+    result->steps_per_s = elapsed_us > 0 ? static_cast<uint32_t>(static_cast<uint64_t>(bench.steps) * 1000000 /
+                                                                 static_cast<uint64_t>(elapsed_us))
+                                         : 0;
+    result->jitter_min_us = bench.step_dev_min_us;
+    result->jitter_max_us = bench.step_dev_max_us;
+    result->late_steps = bench.step_late;
+    result->lock_wait_avg_us = bench.lock_takes ? bench.lock_wait_total_us / bench.lock_takes : 0;
+    result->lock_wait_max_us = bench.lock_wait_max_us;
+    result->reports = bench.reports;
+    result->command_latency_max_us = bench.command_latency_max_us;
+    return ESP_OK;
+}
+
+esp_err_t app_bench_register_commands(uint16_t endpoint_id)
+{
+#if CONFIG_ENABLE_CHIP_SHELL
+    s_endpoint_id = endpoint_id;
+    static const esp_matter::console::command_t commands[] = {
+        {
+            .name = "motor-bench",
+            .description = "Scripted motor runs and per-run figures, or move / show state. "
+                           "Usage: matter motor-bench [state|goto <percent>|sweep|hops|retarget|all]",
+            .handler = bench_command_handler,
+        },
+        {
+            .name = "motionbench",
+            .description = "Step jitter and command latency. Usage: matter motionbench [dump|reset]",
+            .handler = motionbench_command_handler,
+        },
+    };
+    return esp_matter::console::add_commands(commands, sizeof(commands) / sizeof(commands[0]));
+#else
+    (void)endpoint_id;
+    return ESP_OK;
+#endif
+}
@@ -8,30 +8,61 @@
 
 #include <atomic>
 #include <cstdlib>
+#include <cstring>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 
 #include <driver/gpio.h>
+#if CONFIG_BS_ENCODER
+#include <driver/pulse_cnt.h>
+#endif
+#if CONFIG_BS_DUAL_MOTOR
+#include <driver/dedic_gpio.h>
+#endif
+#if CONFIG_BS_MOTOR_DC
+#include <driver/ledc.h>
+#endif
+#if CONFIG_BS_STATUS_LED_WS2812
 #include <driver/rmt.h>
+#endif
 #include <esp_adc/adc_cali.h>
 #include <esp_adc/adc_cali_scheme.h>
 #include <esp_adc/adc_oneshot.h>
+#include <esp_attr.h>
+#include <esp_cpu.h>
 #include <esp_rom_sys.h>
+#if CONFIG_BS_POWER_SAVE
+#include <esp_sleep.h>
+#endif
 #include <esp_timer.h>
-#include <led_strip.h>
 #include <nvs_flash.h>
 #include <nvs.h>
 
 #include <app/clusters/window-covering-server/window-covering-server.h>
 #include <esp_matter.h>
 #include <esp_matter_attribute_utils.h>
+#if CONFIG_ENABLE_CHIP_SHELL
+#include <esp_matter_console.h>
+#endif
 #include <platform/CHIPDeviceLayer.h>
 
 #include "app_priv.h"
+#include "bs_command_queue.h"
+#include "bs_encoder.h"
+#include "bs_homing.h"
+#include "bs_load_detect.h"
 #include "bs_log.h"
+#include "bs_motion_profile.h"
+#include "bs_motor_backend.h"
+#include "bs_move_log.h"
+#include "bs_params.h"
 #include "bs_pins.h"
+#include "bs_speed_tune.h"
+#include "bs_spsc_ring.h"
+#include "bs_sync_move.h"
+#include "bs_undervoltage.h"
 
 using namespace chip::app::Clusters;
 using namespace esp_matter;
@@ -39,14 +70,28 @@ using namespace esp_matter;
 namespace {
 constexpr uint16_t k_percent_100ths_max = 10000;
 constexpr uint16_t k_max_steps = 5000;
-constexpr uint16_t k_step_pulse_us = 10;
+// Conservative step profile for the heaviest blind; calibration can tune a faster one.
+// These and the reporting/yield/battery timings are defaults: see TUNABLE PARAMETERS.
 constexpr uint16_t k_step_delay_us = 2000;
 constexpr uint16_t k_step_delay_start_us = 4500;
 constexpr uint16_t k_step_ramp_steps = 250;
-constexpr TickType_t k_update_period_ticks = pdMS_TO_TICKS(100);
-constexpr TickType_t k_report_min_interval_ticks = pdMS_TO_TICKS(200);
+constexpr uint16_t k_update_period_ms = 100;
+constexpr uint16_t k_report_min_interval_ms = 200;
 constexpr uint16_t k_report_every_steps = 50;
 constexpr uint16_t k_yield_every_steps = 200;
+constexpr uint16_t k_sync_catch_up_div = 32; // synchronized moves regain yield time at <= 1/32 of a step
+constexpr uint16_t k_halt_poll_slice_us = 50;
+constexpr size_t k_command_queue_depth = 16;
+constexpr size_t k_report_ring_depth = 8;
+constexpr int32_t k_step_late_us = 50;
+#if CONFIG_BS_POWER_SAVE
+// Every wake source (commands, STOP ISR, calibration) notifies the stepper, and the
+// button/LED/update tasks block while idle, so the SoC can light-sleep between moves.
+constexpr TickType_t k_stepper_idle_ticks = portMAX_DELAY;
+constexpr TickType_t k_calib_idle_poll_ticks = pdMS_TO_TICKS(1000);
+#else
+constexpr TickType_t k_stepper_idle_ticks = pdMS_TO_TICKS(10);
+#endif
 
 // === CALIBRATION HARDWARE ===
 constexpr gpio_num_t k_btn_up = GPIO_NUM_1;
@@ -56,6 +101,53 @@ constexpr gpio_num_t k_led_calib = GPIO_NUM_7;
 constexpr uint8_t k_ws2812_boot_brightness = 96;
 constexpr uint16_t k_led_task_period_ms = 50;
 constexpr uint16_t k_led_quick_blink_period_ms = 120;
+constexpr uint8_t k_ws2812_clk_div = 2;  // 40 MHz RMT tick = 25 ns
+constexpr uint8_t k_ws2812_bits = 24;
+constexpr uint32_t k_ws2812_t0h_ns = 350;
+constexpr uint32_t k_ws2812_t0l_ns = 800;
+constexpr uint32_t k_ws2812_t1h_ns = 700;
+constexpr uint32_t k_ws2812_t1l_ns = 600;
+
+// === ENCODER ===
+#if CONFIG_BS_ENCODER
+constexpr int k_encoder_pcnt_limit = 30000; // watch points; the driver accumulates across them
+constexpr uint32_t k_encoder_glitch_ns = 1000;
+constexpr uint16_t k_encoder_check_every_steps = 50;
+constexpr uint8_t k_encoder_max_corrections = 2;
+constexpr bs_encoder_config_t k_encoder_config = {
+    CONFIG_BS_ENCODER_COUNTS_PER_REV,
+    CONFIG_BS_ENCODER_STEPS_PER_REV,
+    CONFIG_BS_ENCODER_TOLERANCE_STEPS,
+    50, // stall: under half the commanded travel
+    k_encoder_check_every_steps,
+};
+#endif
+
+// WindowCovering SafetyStatus bits.
+constexpr uint16_t k_safety_position_failure = 0x0008;
+constexpr uint16_t k_safety_obstacle_detected = 0x0020;
+constexpr uint16_t k_safety_motor_jammed = 0x0100;
+
+// === TASK STACKS (bytes) ===
+constexpr uint32_t k_led_task_stack = 3072;
+constexpr uint32_t k_button_task_stack = 4096;
+constexpr uint32_t k_stepper_task_stack = 4096;
+constexpr uint32_t k_update_task_stack = 4096;
+constexpr uint32_t k_battery_task_stack = 3072;
+
+// === CORE AFFINITY ===
+// With CONFIG_BS_MOTION_CORE_PINNED every driver task lives on the motion core and
+// the step generator outranks anything unpinned, so the CHIP/Wi-Fi/lwIP tasks on the
+// other core never preempt a move. Matter reaches the motion core only through the
+// lock-free command queue, and position reports come back through an SPSC ring.
+#if CONFIG_BS_MOTION_CORE_PINNED
+constexpr BaseType_t k_driver_core = CONFIG_BS_MOTION_CORE;
+constexpr UBaseType_t k_stepper_priority = CONFIG_BS_MOTION_PRIORITY;
+#else
+constexpr BaseType_t k_driver_core = tskNO_AFFINITY;
+constexpr UBaseType_t k_stepper_priority = 2;
+#endif
+constexpr UBaseType_t k_battery_task_priority = 1;
 
 // === CALIBRATION CONFIG ===
 constexpr uint32_t k_btn_debounce_ms = 50;
@@ -63,6 +155,114 @@ constexpr uint32_t k_btn_hold_ms = 2000;
 constexpr uint32_t k_double_press_ms = 1000;
 constexpr uint32_t k_calib_timeout_ms = 300000;  // 5 minutes
 constexpr uint16_t k_min_travel_steps = 100;
+constexpr uint16_t k_max_travel_steps = 20000;
+
+// === AUTOMATIC HOMING ===
+// Fast seek to the end stop, back off, then re-approach at a crawl. The top is found
+// by the end-stop switch when one is fitted, otherwise (and the bottom always) by an
+// encoder stall. Without either input calibration falls back to STOP-marked limits.
+constexpr bs_homing_config_t k_homing_config = {
+    200,                // back off the limit this far before the slow approach
+    k_max_travel_steps, // a fast seek longer than any valid travel found nothing
+    400,                // slow approach: the back-off plus two encoder stall windows
+};
+constexpr uint16_t k_home_slow_delay_us = 6000;
+#if CONFIG_BS_HOME_SWITCH || CONFIG_BS_ENCODER
+constexpr bool k_home_seek_available = true;
+#else
+constexpr bool k_home_seek_available = false;
+#endif
+#if CONFIG_BS_ENCODER
+constexpr bool k_bottom_seek_available = true;
+#else
+constexpr bool k_bottom_seek_available = false;
+#endif
+
+// === SPEED AUTO-TUNE ===
+// Runs after the bottom is set, on encoder builds: test moves of up to k_tune_leg_steps
+// out and back, each trial faster than the last, until the encoder sees lost steps.
+constexpr bs_speed_tune_config_t k_tune_config = {
+    {k_step_delay_us, k_step_delay_start_us, k_step_ramp_steps},
+    400, // fastest cruise delay tried
+    25,  // shortest ramp tried
+    10,  // each trial 10% faster
+    20,  // result 20% slower than the fastest good trial
+};
+constexpr uint16_t k_tune_leg_steps = 600;
+
+// === MOTION PROFILES ===
+// Indexed by app_motion_profile_t and scaled from the calibrated step profile: fast runs
+// it as is, quiet and night trade speed for noise. Microsteps only reach the motor with
+// CONFIG_BS_MICROSTEP_SELECT; otherwise the MS pins are strapped and timing alone changes.
+constexpr bs_motion_profile_t k_motion_profiles[APP_MOTION_PROFILE_COUNT] = {
+    {"fast", 100, 100, 1},
+    {"quiet", 50, 200, 8},
+    {"night", 25, 400, 16},
+};
+
+#if CONFIG_BS_DUAL_MOTOR
+// === DUAL-MOTOR LOCKSTEP ===
+// Bit 0 of each dedicated-GPIO bundle is motor A, bit 1 motor B.
+constexpr uint32_t k_lockstep_both = 0x3;
+constexpr uint32_t k_lockstep_motor2 = 0x2;
+#if CONFIG_BS_MOTOR2_DIR_INVERT
+constexpr uint32_t k_motor2_dir_invert = 1;
+#else
+constexpr uint32_t k_motor2_dir_invert = 0;
+#endif
+#endif
+
+// === MOTOR BACKEND ===
+// The motor the step generator drives (bs_motor_backend.h), picked at build time. The
+// Io functions are defined with the step generator's helpers below.
+#if CONFIG_BS_MOTOR_DC
+// Phase/enable H-bridge (DRV8876-style): PWM on EN, direction on PH, nSLEEP low puts
+// the outputs to sleep and lets the shaft coast. A hall sensor edge is a step.
+struct dc_io {
+    static void lock();
+    static void unlock();
+    static bool halt_requested();
+    static void set_power(bool powered);
+    static void drive(int8_t dir, uint16_t duty_permille);
+    static uint32_t hall_edges();
+    static uint64_t now_us();
+    static void delay_us(uint32_t us);
+    static void delay_or_halt_us(uint32_t us);
+};
+using motor_backend_t = bs_dc_backend<dc_io>;
+#if CONFIG_BS_DC_HALL
+constexpr bool k_dc_hall = true;
+#else
+constexpr bool k_dc_hall = false;
+#endif
+constexpr bs_dc_config_t k_dc_config = {
+    CONFIG_BS_DC_FULL_SPEED_STEP_US,
+    150,    // duty a tubular motor needs to turn at all
+    200000, // no hall edge for 200 ms (plus 4 step delays) while driven: stalled
+    30000,  // no hall edge for 30 ms: stopped
+    k_dc_hall,
+};
+constexpr ledc_mode_t k_dc_pwm_mode = LEDC_LOW_SPEED_MODE;
+constexpr ledc_timer_t k_dc_pwm_timer = LEDC_TIMER_0;
+constexpr ledc_channel_t k_dc_pwm_channel = LEDC_CHANNEL_0;
+constexpr ledc_timer_bit_t k_dc_pwm_bits = LEDC_TIMER_10_BIT;
+constexpr uint32_t k_dc_pwm_hz = 20000; // above hearing
+#else
+// A4988 STEP/DIR/EN, or two of them in lockstep (CONFIG_BS_DUAL_MOTOR).
+struct stepper_io {
+    static void lock();
+    static void unlock();
+    static bool halt_requested();
+    static void set_enable(bool enabled);
+    static void set_dir(int8_t dir);
+    static void set_step(uint32_t level);
+    static void on_edge(int8_t dir);
+    static void delay_us(uint32_t us);
+    static void delay_or_halt_us(uint32_t us);
+};
+using motor_backend_t = bs_stepper_backend<stepper_io>;
+#endif
+constexpr uint16_t k_step_pulse_us = motor_backend_t::k_pulse_us;
 
 // === BATTERY ADC CONFIG ===
 constexpr gpio_num_t k_battery_adc_gpio = GPIO_NUM_0;
@@ -71,12 +271,67 @@ constexpr adc_channel_t k_battery_adc_channel = ADC_CHANNEL_0;
 constexpr adc_atten_t k_battery_adc_atten = ADC_ATTEN_DB_12;
 constexpr adc_bitwidth_t k_battery_adc_width = ADC_BITWIDTH_12;
 constexpr uint8_t k_battery_samples_per_read = 16;
-constexpr TickType_t k_battery_sample_period_ticks = pdMS_TO_TICKS(5000);
+constexpr uint16_t k_battery_sample_period_ms = 5000;
 constexpr uint32_t k_battery_empty_mv = 9000;
 constexpr uint32_t k_battery_full_mv = 12600;
 constexpr uint32_t k_battery_max_valid_mv = 14000;
 constexpr uint32_t k_battery_divider_numerator = 110;
 constexpr uint32_t k_battery_divider_denominator = 10;
+constexpr uint32_t k_battery_absent_mv = 3000; // a bench supply without the pack on the divider reads about 0
+
+// === READINGS WHILE STEPPING ===
+// A short battery (and motor current) reading every millisecond of stepping, taken
+// inside the step delays.
+constexpr int64_t k_motion_adc_period_us = 1000;
+constexpr uint32_t k_motion_adc_read_budget_us = 250; // delay left to take the readings in
+constexpr TickType_t k_motion_adc_wait_ticks = 0;     // ADC busy with the battery task: skip the round
+
+// === UNDERVOLTAGE CUTOFF ===
+// 8.8 V leaves the A4988 (8 V minimum) and the 3.3 V regulator some margin on a 3S pack.
+constexpr uint16_t k_undervoltage_cutoff_mv = 8800;
+constexpr uint8_t k_undervoltage_samples_per_read = 4;
+constexpr bs_undervoltage_config_t k_undervoltage_config = {
+    k_undervoltage_cutoff_mv,
+    800, // release at 9.6 V at rest
+    3,   // under the cutoff for ~3 ms: a motor start dip is shorter
+    2,   // two battery task readings
+};
+
+// === MOTOR CURRENT SENSE ===
+// Shunt amplifier on the motor supply, on a second channel of the battery's ADC unit.
+#if CONFIG_BS_CURRENT_SENSE
+constexpr adc_channel_t k_current_adc_channel = static_cast<adc_channel_t>(CONFIG_BS_CURRENT_SENSE_ADC_CHANNEL);
+constexpr uint32_t k_current_mv_per_a = CONFIG_BS_CURRENT_SENSE_MV_PER_A;
+#endif
+constexpr uint8_t k_current_samples_per_read = 2;
+constexpr uint16_t k_load_rise_min_ma = 250;
+constexpr uint16_t k_load_end_zone_steps = 100; // a trip this close to the end a move heads for is its end stop
+constexpr bs_load_detect_config_t k_load_detect_config = {
+    150,  // ~150 ms: inrush and the start of the ramp
+    2,    // smoothed over ~4 readings
+    6,    // running current over ~64 readings
+    600,  // 60% over the running current...
+    k_load_rise_min_ma,
+    4,    // ...for ~4 ms
+    2500, // mA, whatever the running current
+};
+
+// === TUNABLE PARAMETERS ===
+// Indexed by app_param_t, defaulting to the constants above. `matter param` and
+// attribute 0xFFF5 override them at runtime; NVS ("params") keeps the overrides. The
+// step profile entries stay within what a saved tuned profile is checked against.
+constexpr bs_param_def_t k_params[APP_PARAM_COUNT] = {
+    {"cruise_us", k_step_delay_us, k_tune_config.min_cruise_delay_us, 20000, "us"},
+    {"start_us", k_step_delay_start_us, k_tune_config.min_cruise_delay_us, 30000, "us"},
+    {"ramp_steps", k_step_ramp_steps, k_tune_config.min_ramp_steps, 2000, "steps"},
+    {"report_steps", k_report_every_steps, 1, 5000, "steps"},
+    {"report_ms", k_report_min_interval_ms, 0, 10000, "ms"},
+    {"update_ms", k_update_period_ms, 20, 1000, "ms"},
+    {"yield_steps", k_yield_every_steps, 50, 2000, "steps"},
+    {"battery_ms", k_battery_sample_period_ms, 1000, 60000, "ms"},
+    {"cutoff_mv", k_undervoltage_cutoff_mv, 6000, 11000, "mV"},
+    {"load_ma", k_load_rise_min_ma, 50, 3000, "mA"},
+};
 
 enum class CalibState : uint8_t {
     IDLE,              // Normal operation
@@ -84,9 +339,21 @@ enum class CalibState : uint8_t {
     MOVING_TO_HOME,    // User pressed UP, moving to home
     HOME_SET,          // Home position saved, ready for bottom
     MOVING_TO_BOTTOM,  // User pressed DOWN, moving to bottom
+    HOMING,            // Automatic seek of the top end stop
+    FINDING_BOTTOM,    // Automatic seek of the bottom end stop
+    TUNING,            // Bottom set, test moves searching for the fastest reliable speed
     COMPLETE           // Bottom set, waiting for exit
 };
 
+// Calibration requests from Matter (attributes 0xFFF1/0xFFF2), applied by the button
+// task as if the matching buttons had been pressed.
+enum class CalibRequest : uint8_t {
+    ENTER = 0x1,
+    EXIT = 0x2,
+    HOME = 0x4,
+    BOTTOM = 0x8
+};
+
 enum class ButtonState : uint8_t {
     RELEASED,
     PRESSED,
@@ -107,6 +374,13 @@ struct motor_state_t {
     uint16_t target_steps;
     int8_t moving_dir;
     bool moving;
+    bool stopped_early; // last move ended by Stop or a hard stop, not at its target; cleared wherever a move starts
+};
+
+struct position_report_t {
+    uint16_t percent100ths;
+    bool moving;
+    int8_t dir;
 };
 
 struct battery_state_t {
@@ -115,26 +389,145 @@ struct battery_state_t {
     bool valid;
 };
 
+// === STATIC KERNEL OBJECTS ===
+// Everything the driver needs is reserved at link time so app_driver_init does not
+// compete with Matter commissioning for heap.
+StaticSemaphore_t s_state_lock_buffer;
+StaticSemaphore_t s_aux_lock_buffer;
+StaticSemaphore_t s_adc_lock_buffer;
+StaticTask_t s_led_task_tcb;
+StaticTask_t s_button_task_tcb;
+StaticTask_t s_stepper_task_tcb;
+StaticTask_t s_update_task_tcb;
+StaticTask_t s_battery_task_tcb;
+StackType_t s_led_task_stack[k_led_task_stack];
+StackType_t s_button_task_stack[k_button_task_stack];
+StackType_t s_stepper_task_stack[k_stepper_task_stack];
+StackType_t s_update_task_stack[k_update_task_stack];
+StackType_t s_battery_task_stack[k_battery_task_stack];
+
 // === SHARED WITH CALIBRATION MODULE ===
 SemaphoreHandle_t s_state_lock = nullptr;
+// LED pattern and battery state. Separate from s_state_lock so Matter-side callers
+// never contend with the step generator for its per-step lock.
+SemaphoreHandle_t s_aux_lock = nullptr;
 motor_state_t s_state = {};
+bs_step_profile_t s_step_profile = k_tune_config.baseline; // written with s_state_lock held
+std::atomic<uint16_t> s_params[APP_PARAM_COUNT] = {}; // app_param_t; read by the driver tasks on every pass
+std::atomic<uint8_t> s_motion_profile(APP_MOTION_PROFILE_FAST); // app_motion_profile_t
+std::atomic<uint16_t> s_sync_travel_ds(0); // group full-travel time in 0.1 s, 0 = not synchronized
+bs_step_profile_t s_sync_profile = {};     // current move's synchronized profile, with s_state_lock held
+uint16_t s_sync_min_delay_us = 0;          // the motion profile's cruise: catching up never goes faster
+int32_t s_sync_start_offset_us = 0;        // initial timing offset of a new plan, taken by the step generator
+bool s_sync_new_plan = false;
+bool s_sync_move = false;
 CalibState s_calib_state = CalibState::IDLE;
+bs_homing s_homing(k_homing_config);
 
 // === MOTOR CONTROL STATE ===
 TaskHandle_t s_stepper_task = nullptr;
 TaskHandle_t s_update_task = nullptr;
 TaskHandle_t s_battery_task = nullptr;
 uint16_t s_endpoint_id = 0;
+#if CONFIG_BS_MOTOR_DC
+motor_backend_t s_motor(k_dc_config); // step generator only; halt_locked() from anywhere
+std::atomic<uint32_t> s_hall_edges(0);
+#else
+motor_backend_t s_motor;
+#endif
 std::atomic<bool> s_report_pending(false);
+bs_command_queue<k_command_queue_depth> s_command_queue;
+bs_spsc_ring<position_report_t, k_report_ring_depth> s_report_ring; // update task -> CHIP thread
+std::atomic<app_driver_activity_cb_t> s_activity_cb(nullptr);
+std::atomic<uint16_t> s_safety_status(0); // SafetyStatus bitmap, published by report_work
+uint16_t s_safety_status_reported = 0;     // CHIP thread only
 battery_state_t s_battery_state = {};
+std::atomic<uint16_t> s_battery_sample_mv(0);     // latest unfiltered battery sample, 0 if invalid
+std::atomic<uint16_t> s_move_battery_min_mv(0);   // lowest sample since the current move began
+std::atomic<uint32_t> s_reports_pushed(0);        // position reports into s_report_ring, ever
+#if CONFIG_BS_MOVE_LOG
+portMUX_TYPE s_move_log_mux = portMUX_INITIALIZER_UNLOCKED;
+bs_move_log<CONFIG_BS_MOVE_LOG_RECORDS> s_move_log;
+#endif
 adc_oneshot_unit_handle_t s_battery_adc_handle = nullptr;
+#if CONFIG_BS_BATTERY_ADC_CALI
 adc_cali_handle_t s_battery_adc_cali_handle = nullptr;
 bool s_battery_adc_cali_enabled = false;
+#endif
+// The battery task and the step generator's readings share the ADC unit;
+// adc_oneshot_read is not safe from two tasks at once.
+SemaphoreHandle_t s_adc_lock = nullptr;
+uint32_t s_motion_adc_wait_us = 0; // step generator only: step delay until the next readings
+bool s_motion_adc_error_logged = false; // step generator only: this move has logged an ADC failure
+#if CONFIG_BS_UNDERVOLTAGE_CUTOFF
+portMUX_TYPE s_undervoltage_mux = portMUX_INITIALIZER_UNLOCKED;
+bs_undervoltage_guard s_undervoltage(k_undervoltage_config);
+std::atomic<bool> s_undervoltage_tripped(false); // mirrors s_undervoltage for lock-free readers
+std::atomic<bool> s_undervoltage_changed(false); // trip or release not yet saved and announced
+#endif
+#if CONFIG_BS_CURRENT_SENSE
+bool s_current_sense_ready = false;
+portMUX_TYPE s_load_mux = portMUX_INITIALIZER_UNLOCKED;
+bs_load_detector s_load(k_load_detect_config);
+std::atomic<bool> s_load_armed(false);        // a move outside calibration is running
+std::atomic<uint8_t> s_load_verdict(0);       // bs_load_verdict_t that halted the motor, not yet acknowledged
+std::atomic<uint16_t> s_motor_current_ma(0);  // latest reading while stepping
+uint32_t s_load_obstructions = 0;             // s_state_lock
+uint32_t s_load_end_stops = 0;                // s_state_lock
+#endif
+std::atomic<app_driver_battery_cb_t> s_battery_cb(nullptr);
+
+// === EMERGENCY STOP ===
+// Shared between the STOP button ISR and the step generator. The spinlock makes
+// "check halt flag + raise STEP" atomic, so a pulse is either fully issued with EN
+// low (and counted) or not issued at all - position stays exact.
+portMUX_TYPE s_step_mux = portMUX_INITIALIZER_UNLOCKED;
+std::atomic<bool> s_halt_request(false);
+int64_t s_halt_request_us = 0;
+uint32_t s_halt_seq = 0;
+uint32_t s_halt_en_cycles = 0;
+app_stop_stats_t s_stop_stats = {};
+
+// === MOTION BENCHMARK ===
+// Written by the step generator, read by the console; s_bench_mux keeps the copy
+// consistent.
+portMUX_TYPE s_bench_mux = portMUX_INITIALIZER_UNLOCKED;
+app_motion_bench_t s_bench = {};
+uint64_t s_bench_latency_sum_us = 0;
+
+#if CONFIG_BS_ENCODER
+// === ENCODER FEEDBACK ===
+// Owned by the step generator; other readers take s_state_lock.
+pcnt_unit_handle_t s_encoder_unit = nullptr;
+bs_encoder_reconciler s_encoder(k_encoder_config);
+uint8_t s_encoder_corrections = 0;
+uint16_t s_encoder_since_check = 0;
+#endif
+
+#if CONFIG_BS_DUAL_MOTOR
+// === DUAL-MOTOR LOCKSTEP ===
+// The bundles are written by the step generator only (the STOP ISR touches EN alone).
+// Alignment counters come from reading the outputs back under s_step_mux.
+dedic_gpio_bundle_handle_t s_step_bundle = nullptr;
+dedic_gpio_bundle_handle_t s_dir_bundle = nullptr;
+std::atomic<int16_t> s_motor2_trim_target(0); // motor B offset from motor A asked for, in steps
+std::atomic<int16_t> s_motor2_trim(0);        // offset stepped out so far; step generator writes
+int16_t s_motor2_trim_saved = 0;              // step generator only
+app_lockstep_stats_t s_lockstep = {};         // with s_step_mux held
+int32_t s_lockstep_net_a = 0;
+int32_t s_lockstep_net_b = 0;
+#endif
 
 // === CALIBRATION STATE ===
 TaskHandle_t s_button_task = nullptr;
 TaskHandle_t s_led_task = nullptr;
-led_strip_t *s_led_strip = nullptr;
+bool s_ws2812_ready = false;
+#if CONFIG_BS_STATUS_LED_WS2812
+rmt_channel_t s_ws2812_channel = RMT_CHANNEL_0;
+rmt_item32_t s_ws2812_bit0 = {};
+rmt_item32_t s_ws2812_bit1 = {};
+rmt_item32_t s_ws2812_items[k_ws2812_bits];
+#endif
 button_data_t s_btn_up_data = {};
 button_data_t s_btn_stop_data = {};
 button_data_t s_btn_down_data = {};
@@ -143,6 +536,34 @@ int64_t s_calib_last_activity_us = 0;
 uint16_t s_home_steps = 0;
 uint16_t s_bottom_steps = 5000;
 bool s_matter_blocked = false;
+std::atomic<uint8_t> s_calib_requests(0); // CalibRequest bits
+#if CONFIG_BS_ENCODER
+bs_speed_tuner s_tuner(k_tune_config); // restarted from speed_tune_config() by each tune
+bs_step_profile_t s_profile_before_tune = {};
+uint8_t s_tune_leg = 0;          // legs of the current trial started so far (out, back)
+uint16_t s_tune_origin = 0;
+bool s_tune_leg_running = false;
+uint32_t s_tune_leg_check = 0;   // encoder checks seen when the leg started
+bool s_tune_lost = false;        // set by the step generator when a leg lost position
+#endif
+
+uint16_t param(app_param_t id)
+{
+    return s_params[id].load();
+}
+
+// The untuned step profile: where calibration starts and what an uncalibrated blind runs.
+bs_step_profile_t baseline_step_profile()
+{
+    return {param(APP_PARAM_CRUISE_US), param(APP_PARAM_START_US), param(APP_PARAM_RAMP_STEPS)};
+}
+
+bs_speed_tune_config_t speed_tune_config()
+{
+    bs_speed_tune_config_t config = k_tune_config;
+    config.baseline = baseline_step_profile();
+    return config;
+}
 
 // === LED CONTROL ===
 std::atomic<uint8_t> s_led_blink_count(0);
@@ -154,13 +575,38 @@ app_led_pattern_t s_status_after_blink = {255, 128, 0, APP_LED_BLINK, 600};
 bool s_restore_status_after_blink = false;
 uint8_t s_quick_blink_count = 0;
 
+// === HEAP GUARD ===
+std::atomic<bool> s_heap_guard_armed(false);
+// Per task: an NVS write on one task must not hide the step generator's allocations.
+thread_local uint8_t s_heap_guard_exempt = 0;
+
+// NVS persistence is the one sanctioned heap user on driver tasks after init.
+struct heap_guard_exemption_t {
+    heap_guard_exemption_t() { s_heap_guard_exempt++; }
+    ~heap_guard_exemption_t() { s_heap_guard_exempt--; }
+};
+
+#if CONFIG_BS_STATUS_LED_WS2812
+uint16_t ws2812_ticks(uint32_t counter_clk_hz, uint32_t ns)
+{
+    return static_cast<uint16_t>((static_cast<uint64_t>(counter_clk_hz) * ns) / 1000000000ULL);
+}
+#endif
+
 void set_calib_led_rgb(uint8_t red, uint8_t green, uint8_t blue)
 {
-    if (s_led_strip) {
-        s_led_strip->set_pixel(s_led_strip, 0, red, green, blue);
-        s_led_strip->refresh(s_led_strip, 100);
+#if CONFIG_BS_STATUS_LED_WS2812
+    if (s_ws2812_ready) {
+        // Single pixel, GRB order, MSB first, encoded into a static RMT buffer.
+        uint32_t grb = (static_cast<uint32_t>(green) << 16) | (static_cast<uint32_t>(red) << 8) | blue;
+        for (uint8_t bit = 0; bit < k_ws2812_bits; ++bit) {
+            bool one = (grb >> (k_ws2812_bits - 1 - bit)) & 0x1;
+            s_ws2812_items[bit] = one ? s_ws2812_bit1 : s_ws2812_bit0;
+        }
+        rmt_write_items(s_ws2812_channel, s_ws2812_items, k_ws2812_bits, true);
         return;
     }
+#endif
 
     gpio_set_level(k_led_calib, (red || green || blue) ? 1 : 0);
 }
@@ -174,161 +620,1547 @@ void set_calib_led(bool enabled)
     }
 }
 
-static inline uint16_t step_delay_for_ramp(uint16_t ramp_progress)
+// Called with s_step_mux held (ISR or task). Cuts motor power (stepper EN high, DC
+// bridge asleep) before anything else and records how many CPU cycles that took from entry.
+static inline void IRAM_ATTR halt_driver_locked()
 {
-    if (k_step_delay_start_us <= k_step_delay_us || k_step_ramp_steps == 0 || ramp_progress >= k_step_ramp_steps) {
-        return k_step_delay_us;
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+    motor_backend_t::halt_locked();
+    uint32_t en_cycles = esp_cpu_get_cycle_count() - start_cycles;
+    if (!s_halt_request.load(std::memory_order_relaxed)) {
+        s_halt_request_us = esp_timer_get_time();
+        s_halt_en_cycles = en_cycles;
+        s_halt_seq = s_command_queue.last_seq();
+        s_halt_request.store(true, std::memory_order_release);
     }
+}
+
+void IRAM_ATTR stop_button_isr(void *arg)
+{
+    (void)arg;
+    portENTER_CRITICAL_ISR(&s_step_mux);
+    halt_driver_locked();
+    portEXIT_CRITICAL_ISR(&s_step_mux);
+    // The 20 ms button poll records the same edge later; replay treats the repeat as a no-op.
+    app_trace_record(bs_trace_event_t::k_button, 1, BS_TRACE_BUTTON_STOP);
 
-    uint32_t delta = static_cast<uint32_t>(k_step_delay_start_us - k_step_delay_us);
-    uint32_t reduced = (delta * ramp_progress) / k_step_ramp_steps;
-    return static_cast<uint16_t>(k_step_delay_start_us - reduced);
+    BaseType_t woken = pdFALSE;
+    if (s_stepper_task) {
+        vTaskNotifyGiveFromISR(s_stepper_task, &woken);
+    }
+#if CONFIG_BS_POWER_SAVE
+    // Level-triggered while armed as a wake source; the button task re-arms it on release.
+    gpio_intr_disable(k_btn_stop);
+    if (s_button_task) {
+        vTaskNotifyGiveFromISR(s_button_task, &woken);
+    }
+#endif
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
 }
 
-static inline void step_once(uint16_t step_delay_us)
+#if CONFIG_BS_POWER_SAVE
+// UP/DOWN only wake the button task; it debounces and handles the press as usual.
+void IRAM_ATTR button_wake_isr(void *arg)
 {
-    gpio_set_level(BS_PIN_STEP, 1);
-    esp_rom_delay_us(k_step_pulse_us);
-    gpio_set_level(BS_PIN_STEP, 0);
-    esp_rom_delay_us(step_delay_us);
+    gpio_intr_disable(static_cast<gpio_num_t>(reinterpret_cast<uintptr_t>(arg)));
+    BaseType_t woken = pdFALSE;
+    if (s_button_task) {
+        vTaskNotifyGiveFromISR(s_button_task, &woken);
+    }
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
 }
+#endif
 
-uint16_t clamp_percent100ths(uint16_t value)
+void halt_driver()
 {
-    return value > k_percent_100ths_max ? k_percent_100ths_max : value;
+    portENTER_CRITICAL(&s_step_mux);
+    halt_driver_locked();
+    portEXIT_CRITICAL(&s_step_mux);
 }
 
-uint16_t steps_from_percent100ths(uint16_t percent100ths)
+// A failed reading is logged every time without a latch, else only while the latch is clear.
+bool adc_error_to_log(bool *error_latch)
 {
-    uint16_t max = (s_bottom_steps > 0) ? s_bottom_steps : k_max_steps;
-    uint32_t scaled = static_cast<uint32_t>(percent100ths) * max + (k_percent_100ths_max / 2);
-    return static_cast<uint16_t>(scaled / k_percent_100ths_max);
+    if (!error_latch) {
+        return true;
+    }
+    bool first = !*error_latch;
+    *error_latch = true;
+    return first;
 }
 
-uint16_t percent100ths_from_steps(uint16_t steps)
+// Average of `samples` conversions on `channel`, in mV at the pin. False if the ADC is
+// not ready, still held by the other reader after `wait`, or fails; see adc_error_to_log.
+bool read_adc_pin_mv(adc_channel_t channel, uint8_t samples, TickType_t wait, int &pin_mv_out, bool *error_latch)
 {
-    uint16_t max = (s_bottom_steps > 0) ? s_bottom_steps : k_max_steps;
-    uint32_t scaled = static_cast<uint32_t>(steps) * k_percent_100ths_max + (max / 2);
-    return static_cast<uint16_t>(scaled / max);
+    if (!s_battery_adc_handle || !s_adc_lock || xSemaphoreTake(s_adc_lock, wait) != pdTRUE) {
+        return false;
+    }
+
+    int raw = 0;
+    uint32_t raw_sum = 0;
+    for (uint8_t i = 0; i < samples; ++i) {
+        esp_err_t err = adc_oneshot_read(s_battery_adc_handle, channel, &raw);
+        if (err != ESP_OK) {
+            xSemaphoreGive(s_adc_lock);
+            if (adc_error_to_log(error_latch)) {
+                BS_LOG_ERROR("ADC channel %u read failed: %d", static_cast<unsigned>(channel), err);
+            }
+            return false;
+        }
+        raw_sum += static_cast<uint32_t>(raw);
+    }
+    xSemaphoreGive(s_adc_lock);
+
+    int avg_raw = static_cast<int>(raw_sum / samples);
+    int pin_mv = 0;
+#if CONFIG_BS_BATTERY_ADC_CALI
+    // Both channels share the attenuation, so the battery channel's scheme serves them.
+    if (s_battery_adc_cali_enabled) {
+        esp_err_t err = adc_cali_raw_to_voltage(s_battery_adc_cali_handle, avg_raw, &pin_mv);
+        if (err != ESP_OK) {
+            if (adc_error_to_log(error_latch)) {
+                BS_LOG_ERROR("ADC calibration convert failed: %d", err);
+            }
+            return false;
+        }
+    } else {
+        pin_mv = (avg_raw * 3300) / 4095;
+    }
+#else
+    pin_mv = (avg_raw * 3300) / 4095;
+#endif
+    pin_mv_out = pin_mv;
+    return true;
 }
 
-void apply_wc_update(uint16_t endpoint_id, uint16_t current_percent100ths, bool moving, int8_t moving_dir)
+// Battery voltage from `samples` conversions; false as read_adc_pin_mv, or out of range.
+bool read_battery_voltage_mv(uint8_t samples, TickType_t wait, uint32_t &battery_mv_out, bool *error_latch)
 {
-    esp_matter_attr_val_t val = esp_matter_nullable_uint16(current_percent100ths);
-    attribute::update(endpoint_id, WindowCovering::Id, WindowCovering::Attributes::CurrentPositionLiftPercent100ths::Id, &val);
+    int pin_mv = 0;
+    if (!read_adc_pin_mv(k_battery_adc_channel, samples, wait, pin_mv, error_latch)) {
+        return false;
+    }
 
-    using chip::app::Clusters::WindowCovering::OperationalState;
-    OperationalState state = OperationalState::Stall;
-    if (moving) {
-        state = (moving_dir > 0) ? OperationalState::MovingUpOrOpen : OperationalState::MovingDownOrClose;
+    uint32_t batt_mv = (static_cast<uint32_t>(pin_mv) * k_battery_divider_numerator + (k_battery_divider_denominator / 2)) /
+                       k_battery_divider_denominator;
+    if (batt_mv > k_battery_max_valid_mv) {
+        if (adc_error_to_log(error_latch)) {
+            BS_LOG_ERROR("Battery ADC out of range: %u mV", static_cast<unsigned>(batt_mv));
+        }
+        return false;
     }
-    chip::app::Clusters::WindowCovering::OperationalStateSet(endpoint_id, WindowCovering::OperationalStatus::kLift, state);
+
+    battery_mv_out = batt_mv;
+    return true;
 }
 
-void report_work(intptr_t arg)
+#if CONFIG_BS_UNDERVOLTAGE_CUTOFF
+// Step generator, from motion_adc_check_us. A trip cuts the driver as the STOP button
+// does; the update task saves and announces it once the step generator has stopped.
+void undervoltage_sample()
 {
-    (void)arg;
-    if (!s_state_lock) {
-        s_report_pending.store(false);
+    uint32_t mv = 0;
+    // While the battery task holds the ADC this round is skipped; the detector sees the
+    // next one a millisecond later.
+    if (!read_battery_voltage_mv(k_undervoltage_samples_per_read, k_motion_adc_wait_ticks, mv,
+                                 &s_motion_adc_error_logged)) {
         return;
     }
+    uint16_t reading = mv < k_battery_absent_mv ? 0 : static_cast<uint16_t>(mv);
+    uint16_t cutoff_mv = param(APP_PARAM_CUTOFF_MV);
+    portENTER_CRITICAL(&s_undervoltage_mux);
+    if (s_undervoltage.cutoff_mv() != cutoff_mv) {
+        s_undervoltage.set_cutoff_mv(cutoff_mv);
+    }
+    bool tripped = s_undervoltage.sample(reading);
+    portEXIT_CRITICAL(&s_undervoltage_mux);
+    if (tripped) {
+        halt_driver();
+        s_undervoltage_tripped.store(true);
+        s_undervoltage_changed.store(true);
+    }
+}
+#else
+void undervoltage_sample()
+{
+}
+#endif
 
-    if (xSemaphoreTake(s_state_lock, 0) != pdTRUE) {
-        s_report_pending.store(false);
+#if CONFIG_BS_CURRENT_SENSE
+// Step generator, from motion_adc_check_us. A load trip cuts the driver as the STOP
+// button does; load_trip_locked sorts out what the motor ran into once it has stopped.
+void load_sample()
+{
+    int pin_mv = 0;
+    if (!s_current_sense_ready ||
+        !read_adc_pin_mv(k_current_adc_channel, k_current_samples_per_read, k_motion_adc_wait_ticks, pin_mv,
+                         &s_motion_adc_error_logged)) {
+        return;
+    }
+    uint32_t ma = static_cast<uint32_t>(pin_mv) * 1000 / k_current_mv_per_a;
+    uint16_t reading = ma > UINT16_MAX ? UINT16_MAX : static_cast<uint16_t>(ma);
+    s_motor_current_ma.store(reading);
+    if (!s_load_armed.load()) {
         return;
     }
+    uint16_t rise_min_ma = param(APP_PARAM_LOAD_MA);
+    portENTER_CRITICAL(&s_load_mux);
+    if (s_load.rise_min_ma() != rise_min_ma) {
+        s_load.set_rise_min_ma(rise_min_ma);
+    }
+    bs_load_verdict_t verdict = s_load.sample(reading);
+    portEXIT_CRITICAL(&s_load_mux);
+    if (verdict != bs_load_verdict_t::k_ok) {
+        s_load_verdict.store(static_cast<uint8_t>(verdict));
+        halt_driver();
+    }
+}
+#else
+void load_sample()
+{
+}
+#endif
 
-    motor_state_t state = s_state;
-    xSemaphoreGive(s_state_lock);
+#if CONFIG_BS_UNDERVOLTAGE_CUTOFF || CONFIG_BS_CURRENT_SENSE
+// Step generator, from its step delays: `elapsed_us` more of them have passed and
+// `left_us` are still to go. One round of readings per k_motion_adc_period_us, whatever
+// the step rate, put off to a delay with room for it. Returns the time it took.
+uint32_t motion_adc_check_us(uint32_t elapsed_us, uint32_t left_us)
+{
+    if (elapsed_us < s_motion_adc_wait_us) {
+        s_motion_adc_wait_us -= elapsed_us;
+        return 0;
+    }
+    s_motion_adc_wait_us = 0;
+    if (left_us < k_motion_adc_read_budget_us) {
+        return 0;
+    }
+    s_motion_adc_wait_us = k_motion_adc_period_us;
+    int64_t start_us = esp_timer_get_time();
+    undervoltage_sample();
+    load_sample();
+    return static_cast<uint32_t>(esp_timer_get_time() - start_us);
+}
+#else
+uint32_t motion_adc_check_us(uint32_t elapsed_us, uint32_t left_us)
+{
+    (void)elapsed_us;
+    (void)left_us;
+    return 0;
+}
+#endif
 
-    apply_wc_update(s_endpoint_id, state.current_percent100ths, state.moving, state.moving_dir);
-    s_report_pending.store(false);
+// Busy-wait like esp_rom_delay_us, but give up early once a halt is requested. The
+// battery and current readings are taken inside the wait, so they do not stretch it.
+static inline void delay_or_halt_us(uint32_t delay_us)
+{
+    while (delay_us > 0 && !s_halt_request.load(std::memory_order_acquire)) {
+        uint32_t slice = delay_us > k_halt_poll_slice_us ? k_halt_poll_slice_us : delay_us;
+        esp_rom_delay_us(slice);
+        delay_us -= slice;
+        uint32_t check_us = motion_adc_check_us(slice, delay_us);
+        delay_us = check_us < delay_us ? delay_us - check_us : 0;
+    }
 }
 
-void stepper_task(void *arg)
+#if CONFIG_BS_MOTOR_DC
+// === DC MOTOR (step generator side) ===
+void IRAM_ATTR hall_isr(void *arg)
 {
     (void)arg;
-    uint16_t since_yield = 0;
-    uint16_t ramp_progress = 0;
-    int8_t last_dir = 0;
-    while (true) {
-        if (!s_state_lock) {
-            vTaskDelay(10 / portTICK_PERIOD_MS);
-            continue;
-        }
+    s_hall_edges.fetch_add(1, std::memory_order_relaxed);
+}
 
-        if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE) {
-            vTaskDelay(10 / portTICK_PERIOD_MS);
-            continue;
-        }
+inline void dc_io::lock()
+{
+    portENTER_CRITICAL(&s_step_mux);
+}
 
-        bool moving = s_state.moving;
-        int8_t dir = s_state.moving_dir;
-        uint16_t target_steps = s_state.target_steps;
-        uint16_t current_steps = s_state.current_steps;
-        xSemaphoreGive(s_state_lock);
+inline void dc_io::unlock()
+{
+    portEXIT_CRITICAL(&s_step_mux);
+}
 
-        if (!moving) {
-            gpio_set_level(BS_PIN_EN, 1);
-            ramp_progress = 0;
-            last_dir = 0;
-            vTaskDelay(10 / portTICK_PERIOD_MS);
-            continue;
-        }
+inline bool dc_io::halt_requested()
+{
+    return s_halt_request.load(std::memory_order_relaxed);
+}
 
-        if (dir != last_dir) {
-            ramp_progress = 0;
-            last_dir = dir;
-        }
+inline void IRAM_ATTR dc_io::set_power(bool powered)
+{
+    gpio_set_level(BS_PIN_DC_SLEEP, powered ? 1 : 0);
+}
 
-        gpio_set_level(BS_PIN_EN, 0);
-        gpio_set_level(BS_PIN_DIR, (dir > 0) ? 1 : 0);
-        step_once(step_delay_for_ramp(ramp_progress));
-        if (ramp_progress < k_step_ramp_steps) {
-            ramp_progress++;
-        }
+// Duty 0 is a brake: both low-side switches on while the bridge is awake.
+inline void dc_io::drive(int8_t dir, uint16_t duty_permille)
+{
+    gpio_set_level(BS_PIN_DC_PHASE, (dir > 0) ? 1 : 0);
+    uint32_t duty = (static_cast<uint32_t>(duty_permille) * ((1U << k_dc_pwm_bits) - 1)) / 1000;
+    ledc_set_duty(k_dc_pwm_mode, k_dc_pwm_channel, duty);
+    ledc_update_duty(k_dc_pwm_mode, k_dc_pwm_channel);
+}
 
-        if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE) {
-            vTaskDelay(10 / portTICK_PERIOD_MS);
-            continue;
-        }
+inline uint32_t dc_io::hall_edges()
+{
+    return s_hall_edges.load(std::memory_order_relaxed);
+}
 
-        if (dir > 0) {
-            // Moving DOWN (increasing steps)
-            // During calibration to bottom, count from 0 up to 20000 max
-            if (s_calib_state == CalibState::MOVING_TO_BOTTOM) {
-                if (current_steps < 65535) {  // Prevent uint16_t overflow
-                    current_steps++;
-                } else {
-                    // Reached maximum possible steps - stop here
-                    BS_LOG_ERROR("⚠️  Reached maximum steps (65535) during calibration!");
-                    s_state.moving = false;
-                    s_state.moving_dir = 0;
-                }
-            }
-            // Normal operation - respect bottom limit
-            else if (current_steps < s_bottom_steps) {
-                current_steps++;
-            }
-        } else {
-            // Moving UP (decreasing steps)
-            // During calibration to home: DON'T change counter, only motor moves!
-            // Counter will be reset to 0 when user presses STOP
-            if (s_calib_state == CalibState::MOVING_TO_HOME) {
-                // Motor moves but counter stays unchanged - STOP defines the zero point
-            }
-            // Normal operation - respect home limit (0)
-            else if (current_steps > 0) {
-                current_steps--;
-            }
-        }
+inline uint64_t dc_io::now_us()
+{
+    return static_cast<uint64_t>(esp_timer_get_time());
+}
 
-        s_state.current_steps = current_steps;
-        s_state.current_percent100ths = percent100ths_from_steps(current_steps);
+inline void dc_io::delay_us(uint32_t us)
+{
+    esp_rom_delay_us(us);
+}
+
+inline void dc_io::delay_or_halt_us(uint32_t us)
+{
+    ::delay_or_halt_us(us);
+}
+#else
+// DIR and STEP for the motor, or for both motors in lockstep: then each write is one
+// dedicated-GPIO store, so motor B's edge never trails motor A's.
+static inline void set_dir_pins(int8_t dir)
+{
+#if CONFIG_BS_DUAL_MOTOR
+    uint32_t down = dir > 0 ? 1 : 0;
+    dedic_gpio_bundle_write(s_dir_bundle, k_lockstep_both, down | ((down ^ k_motor2_dir_invert) << 1));
+#else
+    gpio_set_level(BS_PIN_DIR, (dir > 0) ? 1 : 0);
+#endif
+}
+
+static inline void set_step_pins(uint32_t level)
+{
+#if CONFIG_BS_DUAL_MOTOR
+    dedic_gpio_bundle_write(s_step_bundle, k_lockstep_both, level ? k_lockstep_both : 0);
+#else
+    gpio_set_level(BS_PIN_STEP, level);
+#endif
+}
+
+#if CONFIG_BS_DUAL_MOTOR
+// Caller holds s_step_mux, right after the rising edge of a step (its first pulse)
+// was written to the motors in `expected`. Counts what the outputs actually show.
+static inline void lockstep_record_edge(int8_t dir, uint32_t expected)
+{
+    uint32_t out = dedic_gpio_bundle_read_out(s_step_bundle) & k_lockstep_both;
+    if (out & 0x1) {
+        s_lockstep_net_a += dir;
+    }
+    if (out & k_lockstep_motor2) {
+        s_lockstep_net_b += dir;
+    }
+    if (expected == k_lockstep_both) {
+        s_lockstep.edges++;
+        if (out != k_lockstep_both) {
+            s_lockstep.misaligned_edges++;
+        }
+    }
+}
+#endif
+
+inline void stepper_io::lock()
+{
+    portENTER_CRITICAL(&s_step_mux);
+}
+
+inline void stepper_io::unlock()
+{
+    portEXIT_CRITICAL(&s_step_mux);
+}
+
+inline bool stepper_io::halt_requested()
+{
+    return s_halt_request.load(std::memory_order_relaxed);
+}
+
+inline void IRAM_ATTR stepper_io::set_enable(bool enabled)
+{
+    gpio_set_level(BS_PIN_EN, enabled ? 0 : 1);
+}
+
+inline void stepper_io::set_dir(int8_t dir)
+{
+    set_dir_pins(dir);
+}
+
+inline void stepper_io::set_step(uint32_t level)
+{
+    set_step_pins(level);
+}
+
+inline void stepper_io::on_edge(int8_t dir)
+{
+#if CONFIG_BS_DUAL_MOTOR
+    lockstep_record_edge(dir, k_lockstep_both);
+#else
+    (void)dir;
+#endif
+}
+
+inline void stepper_io::delay_us(uint32_t us)
+{
+    esp_rom_delay_us(us);
+}
+
+inline void stepper_io::delay_or_halt_us(uint32_t us)
+{
+    ::delay_or_halt_us(us);
+}
+#endif // CONFIG_BS_MOTOR_DC
+
+#if CONFIG_BS_MICROSTEP_SELECT
+// A4988 MS1/MS2/MS3. Only called between steps, so the translator is on a full step.
+void set_microstep_pins(uint8_t microsteps)
+{
+    gpio_set_level(BS_PIN_MS1, (microsteps == 2 || microsteps >= 8) ? 1 : 0);
+    gpio_set_level(BS_PIN_MS2, microsteps >= 4 ? 1 : 0);
+    gpio_set_level(BS_PIN_MS3, microsteps >= 16 ? 1 : 0);
+}
+#endif
+
+// Step generator side of an emergency stop: freeze the target at the exact step
+// count reached, publish latency stats and re-arm. Caller holds s_state_lock.
+void acknowledge_halt_locked()
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_step_mux);
+    int64_t requested_us = s_halt_request_us;
+    uint32_t en_cycles = s_halt_en_cycles;
+    uint32_t halt_seq = s_halt_seq;
+    s_halt_request.store(false, std::memory_order_release);
+    portEXIT_CRITICAL(&s_step_mux);
+
+    // Targets submitted before the stop must not restart the motor afterwards.
+    s_command_queue.cancel_through(halt_seq);
+
+    bool was_moving = s_state.moving;
+    s_state.moving = false;
+    s_state.moving_dir = 0;
+    s_state.stopped_early = true;
+#if CONFIG_BS_DUAL_MOTOR
+    s_motor2_trim_target.store(s_motor2_trim.load()); // a stop also ends a trim in progress
+#endif
+    s_state.target_steps = s_state.current_steps;
+    s_state.target_percent100ths = s_state.current_percent100ths;
+
+    uint32_t ticks_per_us = esp_rom_get_cpu_ticks_per_us();
+    uint32_t en_ns = ticks_per_us ? (en_cycles * 1000U) / ticks_per_us : 0;
+    uint32_t halt_us = static_cast<uint32_t>(now - requested_us);
+    s_stop_stats.count++;
+    s_stop_stats.last_en_latency_ns = en_ns;
+    s_stop_stats.last_halt_latency_us = halt_us;
+    if (en_ns > s_stop_stats.max_en_latency_ns) {
+        s_stop_stats.max_en_latency_ns = en_ns;
+    }
+    if (halt_us > s_stop_stats.max_halt_latency_us) {
+        s_stop_stats.max_halt_latency_us = halt_us;
+    }
+
+    app_trace_record(bs_trace_event_t::k_hard_stop, s_state.current_percent100ths, 0);
+    if (was_moving) {
+        BS_LOG_STATE("Hard stop at %u steps: EN high in %uns, step generator halted in %uus",
+                     static_cast<unsigned>(s_state.current_steps), static_cast<unsigned>(en_ns),
+                     static_cast<unsigned>(halt_us));
+    }
+}
+
+uint16_t clamp_percent100ths(uint16_t value)
+{
+    return value > k_percent_100ths_max ? k_percent_100ths_max : value;
+}
+
+uint16_t steps_from_percent100ths(uint16_t percent100ths)
+{
+    uint16_t max = (s_bottom_steps > 0) ? s_bottom_steps : k_max_steps;
+    uint32_t scaled = static_cast<uint32_t>(percent100ths) * max + (k_percent_100ths_max / 2);
+    return static_cast<uint16_t>(scaled / k_percent_100ths_max);
+}
+
+uint16_t percent100ths_from_steps(uint16_t steps)
+{
+    uint16_t max = (s_bottom_steps > 0) ? s_bottom_steps : k_max_steps;
+    uint32_t scaled = static_cast<uint32_t>(steps) * k_percent_100ths_max + (max / 2);
+    return static_cast<uint16_t>(scaled / max);
+}
+
+void apply_wc_update(uint16_t endpoint_id, uint16_t current_percent100ths, bool moving, int8_t moving_dir)
+{
+    esp_matter_attr_val_t val = esp_matter_nullable_uint16(current_percent100ths);
+    attribute::update(endpoint_id, WindowCovering::Id, WindowCovering::Attributes::CurrentPositionLiftPercent100ths::Id, &val);
+
+    using chip::app::Clusters::WindowCovering::OperationalState;
+    OperationalState state = OperationalState::Stall;
+    if (moving) {
+        state = (moving_dir > 0) ? OperationalState::MovingUpOrOpen : OperationalState::MovingDownOrClose;
+    }
+    chip::app::Clusters::WindowCovering::OperationalStateSet(endpoint_id, WindowCovering::OperationalStatus::kLift, state);
+}
+
+uint8_t motion_microsteps(app_motion_profile_t profile)
+{
+#if CONFIG_BS_MICROSTEP_SELECT
+    return k_motion_profiles[profile].microsteps;
+#else
+    (void)profile;
+    return 1;
+#endif
+}
+
+// === SYNCHRONIZED GROUP MOVES ===
+// Caller holds s_state_lock, before the new target is applied. A synchronized move
+// takes its share of the group's full-travel time: the active motion profile, slowed
+// down until its steps last exactly that long. A timed move (a scene recall's
+// transition time) is planned the same way for the time it asks for, group or not.
+// The step generator's periodic yields are not planned for; it wins their time back
+// on the following steps, and spreads what rounding the cruise delay left over
+// across them too.
+void plan_sync_move_locked(uint16_t target_percent100ths, uint32_t steps, uint32_t transition_ms)
+{
+    uint16_t travel_ds = s_sync_travel_ds.load(std::memory_order_relaxed);
+    s_sync_move = (travel_ds != 0 || transition_ms != 0) && steps != 0 && s_calib_state == CalibState::IDLE;
+    if (!s_sync_move) {
+        return;
+    }
+
+    app_motion_profile_t motion = static_cast<app_motion_profile_t>(s_motion_profile.load(std::memory_order_relaxed));
+    bs_step_profile_t fastest = bs_motion_profile_apply(k_motion_profiles[motion], s_step_profile);
+    uint64_t move_us = transition_ms != 0
+                           ? static_cast<uint64_t>(transition_ms) * 1000
+                           : bs_sync_move_time_us(static_cast<uint32_t>(travel_ds) * 100,
+                                                  s_state.current_percent100ths, target_percent100ths);
+    bs_sync_plan_t plan = bs_sync_plan(fastest, motion_microsteps(motion), k_step_pulse_us, steps, move_us);
+    s_sync_profile = plan.profile;
+    s_sync_min_delay_us = fastest.cruise_delay_us;
+    s_sync_start_offset_us = -static_cast<int32_t>(plan.spare_us);
+    s_sync_new_plan = true;
+    if (!plan.on_time) {
+        BS_LOG_WARN("%s move of %u steps takes %u ms, %u ms asked for", transition_ms != 0 ? "Timed" : "Synchronized",
+                    static_cast<unsigned>(steps), static_cast<unsigned>(plan.duration_us / 1000),
+                    static_cast<unsigned>(move_us / 1000));
+    }
+}
+
+// Step generator side, on cruise steps. `offset_us` > 0 is yield time to win back: the
+// step is shortened by at most 1/k_sync_catch_up_div, so the speed creeps up instead of
+// jumping, and never below `min_delay_us`. < 0 is rounding left over by the plan: the
+// step is lengthened by 1 us.
+uint16_t sync_adjust_delay(uint16_t step_delay_us, uint16_t min_delay_us, int32_t *offset_us)
+{
+    if (*offset_us < 0) {
+        (*offset_us)++;
+        return static_cast<uint16_t>(step_delay_us + 1);
+    }
+    if (*offset_us == 0 || step_delay_us <= min_delay_us) {
+        return step_delay_us;
+    }
+    uint32_t take = step_delay_us / k_sync_catch_up_div;
+    uint32_t spare = step_delay_us - min_delay_us;
+    take = take < spare ? take : spare;
+    take = take < static_cast<uint32_t>(*offset_us) ? take : static_cast<uint32_t>(*offset_us);
+    *offset_us -= static_cast<int32_t>(take);
+    return static_cast<uint16_t>(step_delay_us - take);
+}
+
+void apply_target_locked(uint16_t target_percent100ths, uint32_t seq, uint32_t transition_ms)
+{
+    uint16_t target = clamp_percent100ths(target_percent100ths);
+    uint16_t target_steps = steps_from_percent100ths(target);
+    s_state.target_percent100ths = target;
+    s_state.target_steps = target_steps;
+    s_state.stopped_early = false;
+
+    int32_t diff = static_cast<int32_t>(target_steps) - static_cast<int32_t>(s_state.current_steps);
+    plan_sync_move_locked(target, static_cast<uint32_t>(std::abs(diff)), transition_ms);
+    if (diff == 0) {
+        s_state.moving = false;
+        s_state.moving_dir = 0;
+    } else {
+        s_state.moving = true;
+        s_state.moving_dir = (diff > 0) ? 1 : -1;
+    }
+
+    if (transition_ms != 0) {
+        BS_LOG_STATE("Target set -> %u.%02u%% (%u steps, seq %u) in %u ms",
+                     static_cast<unsigned>(target / 100), static_cast<unsigned>(target % 100),
+                     static_cast<unsigned>(target_steps), static_cast<unsigned>(seq),
+                     static_cast<unsigned>(transition_ms));
+    } else {
+        BS_LOG_STATE("Target set -> %u.%02u%% (%u steps, seq %u)",
+                     static_cast<unsigned>(target / 100), static_cast<unsigned>(target % 100),
+                     static_cast<unsigned>(target_steps), static_cast<unsigned>(seq));
+    }
+}
+
+void bench_record_step(int64_t interval_us, uint16_t step_delay_us, uint8_t microsteps)
+{
+    int32_t nominal_us = k_step_pulse_us * microsteps + step_delay_us;
+    int32_t dev = static_cast<int32_t>(interval_us) - nominal_us;
+    portENTER_CRITICAL(&s_bench_mux);
+    if (s_bench.step_intervals == 0 || dev < s_bench.step_dev_min_us) {
+        s_bench.step_dev_min_us = dev;
+    }
+    if (s_bench.step_intervals == 0 || dev > s_bench.step_dev_max_us) {
+        s_bench.step_dev_max_us = dev;
+    }
+    if (dev > k_step_late_us) {
+        s_bench.step_late++;
+    }
+    s_bench.step_intervals++;
+    portEXIT_CRITICAL(&s_bench_mux);
+}
+
+// Step generator only: s_state_lock wait of the move in progress, for the move log.
+uint32_t s_move_lock_wait_us = 0;
+
+// Every s_state_lock take by the step generator; `stepped` after a step went out.
+void bench_record_lock_wait(int64_t wait_us, bool stepped)
+{
+    uint32_t wait = static_cast<uint32_t>(wait_us);
+    s_move_lock_wait_us += wait;
+    portENTER_CRITICAL(&s_bench_mux);
+    s_bench.lock_takes++;
+    s_bench.lock_wait_total_us += wait;
+    if (wait > s_bench.lock_wait_max_us) {
+        s_bench.lock_wait_max_us = wait;
+    }
+    if (stepped) {
+        s_bench.steps++;
+    }
+    portEXIT_CRITICAL(&s_bench_mux);
+}
+
+// Step generator's per-step lock take, timed for the motion bench.
+bool take_state_lock_for_step(bool stepped)
+{
+    int64_t start_us = esp_timer_get_time();
+    if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE) {
+        return false;
+    }
+    bench_record_lock_wait(esp_timer_get_time() - start_us, stepped);
+    return true;
+}
+
+void bench_record_command(uint32_t stamp_us)
+{
+    if (stamp_us == 0) {
+        return;
+    }
+    // Bit 0 only marks the stamp as set; it can put the stamp 1 us in the future.
+    uint32_t latency_us = static_cast<uint32_t>(esp_timer_get_time()) - (stamp_us & ~1U);
+    portENTER_CRITICAL(&s_bench_mux);
+    s_bench.commands++;
+    s_bench.command_latency_last_us = latency_us;
+    if (latency_us > s_bench.command_latency_max_us) {
+        s_bench.command_latency_max_us = latency_us;
+    }
+    s_bench_latency_sum_us += latency_us;
+    portEXIT_CRITICAL(&s_bench_mux);
+}
+
+// Drain the Matter command queue. Caller holds s_state_lock.
+void apply_pending_commands_locked()
+{
+    bs_command_batch_t batch;
+    if (!s_command_queue.take(batch)) {
+        return;
+    }
+
+    if (batch.stop) {
+        s_state.moving = false;
+        s_state.moving_dir = 0;
+        s_state.stopped_early = true;
+        s_state.target_percent100ths = s_state.current_percent100ths;
+        s_state.target_steps = s_state.current_steps;
+        BS_LOG_STATE("Stopped at %u.%02u%% (%u steps, seq %u)",
+                     static_cast<unsigned>(s_state.current_percent100ths / 100),
+                     static_cast<unsigned>(s_state.current_percent100ths % 100),
+                     static_cast<unsigned>(s_state.current_steps), static_cast<unsigned>(batch.stop_seq));
+    }
+    if (batch.has_go_to) {
+        bench_record_command(batch.go_to.stamp_us);
+        apply_target_locked(batch.go_to.target_percent100ths, batch.go_to.seq, batch.go_to.transition_ms);
+    }
+}
+
+void wake_task(TaskHandle_t task)
+{
+    if (task) {
+        xTaskNotifyGive(task);
+    }
+}
+
+void notify_activity(app_activity_t activity)
+{
+    app_driver_activity_cb_t cb = s_activity_cb.load();
+    if (cb) {
+        cb(activity);
+    }
+}
+
+// CHIP thread. Only the newest report matters; clearing the flag before draining
+// means a report pushed meanwhile schedules another pass.
+void report_work(intptr_t arg)
+{
+    (void)arg;
+    s_report_pending.store(false);
+    uint16_t safety_status = s_safety_status.load();
+    if (safety_status != s_safety_status_reported) {
+        esp_matter_attr_val_t val = esp_matter_bitmap16(safety_status);
+        attribute::update(s_endpoint_id, WindowCovering::Id, WindowCovering::Attributes::SafetyStatus::Id, &val);
+        s_safety_status_reported = safety_status;
+    }
+    position_report_t report = {};
+    if (s_report_ring.pop_latest(report)) {
+        uint8_t op_state = report.moving ? (report.dir > 0 ? 1 : 2) : 0; // WindowCovering::OperationalState
+        app_trace_record(bs_trace_event_t::k_report, report.percent100ths, op_state);
+        apply_wc_update(s_endpoint_id, report.percent100ths, report.moving, report.dir);
+    }
+}
+
+#if CONFIG_BS_ENCODER || CONFIG_BS_CURRENT_SENSE || CONFIG_BS_MOTOR_DC
+// Any task. The CHIP thread publishes the new bitmap on its next report pass.
+void set_safety_status(uint16_t set_bits, uint16_t clear_bits)
+{
+    uint16_t status = s_safety_status.load();
+    uint16_t updated = 0;
+    do {
+        updated = static_cast<uint16_t>((status & ~clear_bits) | set_bits);
+    } while (updated != status && !s_safety_status.compare_exchange_weak(status, updated));
+    if (updated != status && !s_report_pending.exchange(true)) {
+        if (chip::DeviceLayer::PlatformMgr().ScheduleWork(report_work, 0) != CHIP_NO_ERROR) {
+            s_report_pending.store(false);
+        }
+    }
+}
+#endif
+
+// === ENCODER FEEDBACK ===
+#if CONFIG_BS_ENCODER
+esp_err_t init_encoder()
+{
+    pcnt_unit_config_t unit_config = {};
+    unit_config.low_limit = -k_encoder_pcnt_limit;
+    unit_config.high_limit = k_encoder_pcnt_limit;
+    unit_config.flags.accum_count = 1;
+    esp_err_t err = pcnt_new_unit(&unit_config, &s_encoder_unit);
+    if (err != ESP_OK) {
+        BS_LOG_ERROR("Failed to create encoder PCNT unit: %d", err);
+        return err;
+    }
+
+    pcnt_glitch_filter_config_t filter_config = {};
+    filter_config.max_glitch_ns = k_encoder_glitch_ns;
+    pcnt_unit_set_glitch_filter(s_encoder_unit, &filter_config);
+
+    // x4 quadrature decoding: each channel counts both edges of one phase, with the
+    // other phase's level giving the direction.
+    pcnt_chan_config_t chan_a_config = {};
+    chan_a_config.edge_gpio_num = BS_PIN_ENC_A;
+    chan_a_config.level_gpio_num = BS_PIN_ENC_B;
+    pcnt_chan_config_t chan_b_config = {};
+    chan_b_config.edge_gpio_num = BS_PIN_ENC_B;
+    chan_b_config.level_gpio_num = BS_PIN_ENC_A;
+    pcnt_channel_handle_t chan_a = nullptr;
+    pcnt_channel_handle_t chan_b = nullptr;
+    err = pcnt_new_channel(s_encoder_unit, &chan_a_config, &chan_a);
+    if (err == ESP_OK) {
+        err = pcnt_new_channel(s_encoder_unit, &chan_b_config, &chan_b);
+    }
+    if (err != ESP_OK) {
+        BS_LOG_ERROR("Failed to create encoder PCNT channels: %d", err);
+        return err;
+    }
+    pcnt_channel_set_edge_action(chan_a, PCNT_CHANNEL_EDGE_ACTION_DECREASE, PCNT_CHANNEL_EDGE_ACTION_INCREASE);
+    pcnt_channel_set_level_action(chan_a, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+    pcnt_channel_set_edge_action(chan_b, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE);
+    pcnt_channel_set_level_action(chan_b, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+    pcnt_unit_add_watch_point(s_encoder_unit, -k_encoder_pcnt_limit);
+    pcnt_unit_add_watch_point(s_encoder_unit, k_encoder_pcnt_limit);
+
+    err = pcnt_unit_enable(s_encoder_unit);
+    if (err == ESP_OK) {
+        err = pcnt_unit_clear_count(s_encoder_unit);
+    }
+    if (err == ESP_OK) {
+        err = pcnt_unit_start(s_encoder_unit);
+    }
+    if (err != ESP_OK) {
+        BS_LOG_ERROR("Failed to start encoder PCNT unit: %d", err);
+        return err;
+    }
+    // The driver boots at step 0; so does the encoder.
+    s_encoder.rebase(0, 0);
+    BS_LOG_MOTOR("Encoder: A=GPIO%u B=GPIO%u, %u counts / %u steps per rev, tolerance %u steps",
+                 static_cast<unsigned>(BS_PIN_ENC_A), static_cast<unsigned>(BS_PIN_ENC_B),
+                 static_cast<unsigned>(k_encoder_config.counts_per_rev),
+                 static_cast<unsigned>(k_encoder_config.steps_per_rev),
+                 static_cast<unsigned>(k_encoder_config.tolerance_steps));
+    return ESP_OK;
+}
+
+int32_t encoder_count()
+{
+    int count = 0;
+    pcnt_unit_get_count(s_encoder_unit, &count);
+    return count;
+}
+
+void encoder_begin_move(uint16_t steps)
+{
+    s_encoder_since_check = 0;
+    s_encoder.begin_move(encoder_count(), steps);
+}
+
+// Step generator, s_state_lock held. A jammed motor is caught every few dozen steps
+// instead of at the end of a long move.
+bool encoder_stalled_locked(uint16_t steps)
+{
+    if (s_calib_state != CalibState::IDLE || ++s_encoder_since_check < k_encoder_check_every_steps) {
+        return false;
+    }
+    s_encoder_since_check = 0;
+    return s_encoder.stalled(encoder_count(), steps);
+}
+
+// Homing, s_state_lock held. Each window of steps is judged on its own, so the stall
+// at the end stop is not diluted by the travel of a long seek before it.
+bool encoder_window_stalled_locked(int32_t commanded_steps)
+{
+    if (++s_encoder_since_check < k_encoder_check_every_steps) {
+        return false;
+    }
+    s_encoder_since_check = 0;
+    int32_t count = encoder_count();
+    bool stalled = s_encoder.stalled(count, commanded_steps);
+    s_encoder.begin_move(count, commanded_steps);
+    return stalled;
+}
+
+void encoder_begin_window_locked(int32_t commanded_steps)
+{
+    s_encoder_since_check = 0;
+    s_encoder.begin_move(encoder_count(), commanded_steps);
+}
+
+int32_t encoder_measured_steps()
+{
+    return s_encoder.steps_from_count(encoder_count());
+}
+
+// Step generator, after every move. Returns true when it started a correction move.
+bool encoder_verify_move()
+{
+    int32_t count = encoder_count();
+    if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE) {
+        return false;
+    }
+    uint16_t steps = s_state.current_steps;
+    if (s_calib_state != CalibState::IDLE && s_calib_state != CalibState::TUNING) {
+        // Calibration defines the step frame; the encoder follows it.
+        s_encoder.rebase(count, steps);
+        xSemaphoreGive(s_state_lock);
+        return false;
+    }
+
+    bs_encoder_check_t check = s_encoder.check(count, steps);
+    if (s_calib_state == CalibState::TUNING) {
+        // A lost test move is the answer the tuner is looking for, not a fault.
+        if (check.verdict != bs_encoder_verdict_t::k_ok) {
+            s_tune_lost = true;
+            s_state.current_steps = static_cast<uint16_t>(check.measured_steps < 0 ? 0 : check.measured_steps);
+            s_state.current_percent100ths = percent100ths_from_steps(s_state.current_steps);
+            s_state.target_steps = s_state.current_steps;
+            s_state.target_percent100ths = s_state.current_percent100ths;
+        }
+        xSemaphoreGive(s_state_lock);
+        return false;
+    }
+    if (check.verdict == bs_encoder_verdict_t::k_ok) {
+        s_encoder_corrections = 0;
+        xSemaphoreGive(s_state_lock);
+        set_safety_status(0, k_safety_motor_jammed | k_safety_position_failure);
+        return false;
+    }
+
+    int32_t max_steps = (s_bottom_steps > 0) ? s_bottom_steps : k_max_steps;
+    int32_t measured = check.measured_steps < 0 ? 0 : check.measured_steps;
+    measured = measured > max_steps ? max_steps : measured;
+    s_state.current_steps = static_cast<uint16_t>(measured);
+    s_state.current_percent100ths = percent100ths_from_steps(s_state.current_steps);
+
+    bool retry = check.verdict == bs_encoder_verdict_t::k_drift && !s_state.stopped_early &&
+                 s_state.target_steps != s_state.current_steps && s_encoder_corrections < k_encoder_max_corrections;
+    if (retry) {
+        s_encoder_corrections++;
+        s_state.moving = true;
+        s_state.moving_dir = (s_state.target_steps > s_state.current_steps) ? 1 : -1;
+        s_encoder.begin_move(count, measured);
+    } else {
+        s_state.target_steps = s_state.current_steps;
+        s_state.target_percent100ths = s_state.current_percent100ths;
+    }
+    uint8_t corrections = s_encoder_corrections;
+    if (!retry) {
+        s_encoder_corrections = 0;
+    }
+    xSemaphoreGive(s_state_lock);
+
+    if (check.verdict == bs_encoder_verdict_t::k_stall) {
+        set_safety_status(k_safety_motor_jammed, 0);
+        BS_LOG_ERROR("Motor stalled: encoder at %d steps, step count %u; holding at the measured position",
+                     static_cast<int>(check.measured_steps), static_cast<unsigned>(steps));
+    } else if (retry) {
+        BS_LOG_WARN("Encoder drift %d steps at %u; correcting (attempt %u)", static_cast<int>(check.error_steps),
+                    static_cast<unsigned>(steps), static_cast<unsigned>(corrections));
+    } else if (corrections >= k_encoder_max_corrections) {
+        set_safety_status(k_safety_position_failure, 0);
+        BS_LOG_ERROR("Encoder drift %d steps persists after %u corrections", static_cast<int>(check.error_steps),
+                     static_cast<unsigned>(corrections));
+    } else {
+        BS_LOG_WARN("Encoder drift %d steps after a stop; position corrected", static_cast<int>(check.error_steps));
+    }
+    return retry;
+}
+#else
+esp_err_t init_encoder()
+{
+    return ESP_OK;
+}
+
+void encoder_begin_move(uint16_t steps)
+{
+    (void)steps;
+}
+
+bool encoder_stalled_locked(uint16_t steps)
+{
+    (void)steps;
+    return false;
+}
+
+bool encoder_window_stalled_locked(int32_t commanded_steps)
+{
+    (void)commanded_steps;
+    return false;
+}
+
+void encoder_begin_window_locked(int32_t commanded_steps)
+{
+    (void)commanded_steps;
+}
+
+bool encoder_verify_move()
+{
+    return false;
+}
+#endif // CONFIG_BS_ENCODER
+
+// === LOAD DETECTION (step generator side) ===
+#if CONFIG_BS_CURRENT_SENSE
+// A move starts or turns round: blank, then learn its running current. Calibration
+// runs into the end stops on purpose and is left alone.
+void load_begin_move(bool calibrating)
+{
+    portENTER_CRITICAL(&s_load_mux);
+    s_load.begin_move();
+    portEXIT_CRITICAL(&s_load_mux);
+    s_load_verdict.store(0);
+    s_load_armed.store(!calibrating);
+}
+
+// The blind is at rest. A move that got where it was going clears ObstacleDetected.
+void load_end_move(bool stopped_early)
+{
+    s_load_armed.store(false);
+    if (!stopped_early) {
+        set_safety_status(0, k_safety_obstacle_detected);
+    }
+}
+
+// s_state_lock held, right after acknowledging a halt; `dir` is where the move was
+// heading. A load trip close to the end the move was heading for is that end stop: at the
+// top it is step 0 again, as re-homing would make it, and the move counts as complete;
+// at the bottom the blind stays where it stopped. Anywhere else it is an obstruction, reported as ObstacleDetected
+// (OperationalStatus already went to Stall with the halt) until a move completes.
+void load_trip_locked(int8_t dir)
+{
+    bs_load_verdict_t verdict = static_cast<bs_load_verdict_t>(s_load_verdict.exchange(0));
+    if (verdict == bs_load_verdict_t::k_ok) {
+        return;
+    }
+    portENTER_CRITICAL(&s_load_mux);
+    uint16_t trip_ma = s_load.trip_ma();
+    uint16_t baseline_ma = s_load.trip_baseline_ma();
+    portEXIT_CRITICAL(&s_load_mux);
+    uint16_t steps = s_state.current_steps;
+
+    if (dir < 0 && steps <= k_load_end_zone_steps) {
+        s_state.current_steps = 0;
+        s_state.current_percent100ths = 0;
+        s_state.target_steps = 0;
+        s_state.target_percent100ths = 0;
+        s_state.stopped_early = false; // it got where it was going
+#if CONFIG_BS_ENCODER
+        s_encoder.rebase(encoder_count(), 0);
+#endif
+        s_load_end_stops++;
+        BS_LOG_STATE("Top end stop at %u steps (%u mA, running %u mA): step 0 set there",
+                     static_cast<unsigned>(steps), static_cast<unsigned>(trip_ma), static_cast<unsigned>(baseline_ma));
+        return;
+    }
+    if (dir > 0 && steps + k_load_end_zone_steps >= s_bottom_steps) {
+        // Still stopped early: the encoder must not re-run the move into the stop.
+        s_load_end_stops++;
+        BS_LOG_STATE("Bottom end stop at %u steps, %u short of the calibrated bottom (%u mA, running %u mA)",
+                     static_cast<unsigned>(steps), static_cast<unsigned>(s_bottom_steps - steps),
+                     static_cast<unsigned>(trip_ma), static_cast<unsigned>(baseline_ma));
+        return;
+    }
+    s_load_obstructions++;
+    set_safety_status(k_safety_obstacle_detected, 0);
+    BS_LOG_ERROR("Obstruction at %u steps: motor drew %u mA, running %u mA%s; stopped",
+                 static_cast<unsigned>(steps), static_cast<unsigned>(trip_ma), static_cast<unsigned>(baseline_ma),
+                 verdict == bs_load_verdict_t::k_overload ? " (over the limit)" : "");
+}
+#else
+void load_begin_move(bool calibrating)
+{
+    (void)calibrating;
+}
+
+void load_end_move(bool stopped_early)
+{
+    (void)stopped_early;
+}
+
+void load_trip_locked(int8_t dir)
+{
+    (void)dir;
+}
+#endif // CONFIG_BS_CURRENT_SENSE
+
+// === AUTOMATIC HOMING (step generator side) ===
+// While homing the step count stays put; commanded positions are the count plus the
+// homer's signed travel.
+bs_step_profile_t homing_profile_locked()
+{
+    if (s_homing.fast()) {
+        return s_step_profile;
+    }
+    return {k_home_slow_delay_us, k_home_slow_delay_us, 0};
+}
+
+#if CONFIG_BS_DUAL_MOTOR
+// === DUAL-MOTOR LOCKSTEP (step generator side) ===
+esp_err_t init_lockstep()
+{
+    const int step_gpios[] = {BS_PIN_STEP, BS_PIN_STEP2};
+    const int dir_gpios[] = {BS_PIN_DIR, BS_PIN_DIR2};
+    dedic_gpio_bundle_config_t step_config = {};
+    step_config.gpio_array = step_gpios;
+    step_config.array_size = 2;
+    step_config.flags.out_en = 1;
+    dedic_gpio_bundle_config_t dir_config = step_config;
+    dir_config.gpio_array = dir_gpios;
+    esp_err_t err = dedic_gpio_new_bundle(&step_config, &s_step_bundle);
+    if (err == ESP_OK) {
+        err = dedic_gpio_new_bundle(&dir_config, &s_dir_bundle);
+    }
+    if (err != ESP_OK) {
+        BS_LOG_ERROR("Failed to create lockstep GPIO bundles: %d", err);
+        return err;
+    }
+    set_step_pins(0);
+    set_dir_pins(1);
+
+    nvs_handle_t handle;
+    if (nvs_open("lockstep", NVS_READONLY, &handle) == ESP_OK) {
+        uint16_t trim = 0;
+        nvs_get_u16(handle, "trim", &trim);
+        nvs_close(handle);
+        // Already stepped out before the last power-off: nothing to move now.
+        s_motor2_trim.store(static_cast<int16_t>(trim));
+        s_motor2_trim_target.store(static_cast<int16_t>(trim));
+        s_motor2_trim_saved = static_cast<int16_t>(trim);
+        s_lockstep_net_b = static_cast<int16_t>(trim);
+    }
+    BS_LOG_MOTOR("Lockstep: motor B STEP=GPIO%u DIR=GPIO%u%s, trim %d steps", static_cast<unsigned>(BS_PIN_STEP2),
+                 static_cast<unsigned>(BS_PIN_DIR2), k_motor2_dir_invert ? " (mirrored)" : "",
+                 static_cast<int>(s_motor2_trim.load()));
+    return ESP_OK;
+}
+
+void save_motor2_trim_to_nvs(int16_t trim)
+{
+    heap_guard_exemption_t exemption;
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open("lockstep", NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        nvs_set_u16(handle, "trim", static_cast<uint16_t>(trim));
+        nvs_commit(handle);
+        nvs_close(handle);
+    } else {
+        BS_LOG_ERROR("Failed to save motor B trim: %d", err);
+    }
+}
+
+// Idle step generator only: one step of motor B alone towards the trim target, at
+// the homing crawl. Returns false when there is nothing to do. A stop cancels the
+// rest (acknowledge_halt_locked); what was stepped out is saved either way.
+bool trim_motor2_step()
+{
+    int16_t trim = s_motor2_trim.load();
+    int16_t target = s_motor2_trim_target.load();
+    if (trim == target) {
+        if (trim != s_motor2_trim_saved) {
+            save_motor2_trim_to_nvs(trim);
+            s_motor2_trim_saved = trim;
+            BS_LOG_STATE("Motor B trim: %d steps", static_cast<int>(trim));
+        }
+        return false;
+    }
+    int8_t dir = target > trim ? 1 : -1;
+    portENTER_CRITICAL(&s_step_mux);
+    if (s_halt_request.load(std::memory_order_relaxed)) {
+        portEXIT_CRITICAL(&s_step_mux);
+        return false;
+    }
+    gpio_set_level(BS_PIN_EN, 0);
+    set_dir_pins(dir);
+    dedic_gpio_bundle_write(s_step_bundle, k_lockstep_both, k_lockstep_motor2);
+    lockstep_record_edge(dir, k_lockstep_motor2);
+    portEXIT_CRITICAL(&s_step_mux);
+
+    esp_rom_delay_us(k_step_pulse_us);
+    set_step_pins(0);
+    s_motor2_trim.store(static_cast<int16_t>(trim + dir));
+    delay_or_halt_us(k_home_slow_delay_us);
+    return true;
+}
+#endif // CONFIG_BS_DUAL_MOTOR
+
+// === MOVE LOG (step generator side) ===
+// One record per motion: from the first step until the blind is at rest again, so
+// retargets and encoder corrections on the way belong to the same move.
+struct move_tracker_t {
+    int64_t start_us;
+    int64_t ramp_end_us; // first cruise step; 0 until then
+    uint32_t reports_at_start;
+    uint16_t start_steps;
+    uint16_t steps;
+    uint16_t min_step_us; // shortest commanded step period
+    uint16_t battery_start_mv;
+    uint8_t profile;
+    uint8_t flags;
+};
+
+void move_log_begin(move_tracker_t &move, uint16_t current_steps)
+{
+    move = {};
+    move.start_us = esp_timer_get_time();
+    move.reports_at_start = s_reports_pushed.load();
+    move.start_steps = current_steps;
+    move.min_step_us = UINT16_MAX;
+    move.battery_start_mv = s_battery_sample_mv.load();
+    move.profile = s_motion_profile.load();
+    s_move_battery_min_mv.store(move.battery_start_mv);
+    s_move_lock_wait_us = 0;
+}
+
+void move_log_step(move_tracker_t &move, uint16_t step_delay_us, uint8_t microsteps, bool cruising, uint8_t flags)
+{
+    uint32_t period_us = step_delay_us + static_cast<uint32_t>(microsteps) * k_step_pulse_us;
+    if (period_us < move.min_step_us) {
+        move.min_step_us = static_cast<uint16_t>(period_us);
+    }
+    if (cruising && move.ramp_end_us == 0) {
+        move.ramp_end_us = esp_timer_get_time();
+    }
+    if (move.steps < UINT16_MAX) {
+        move.steps++;
+    }
+    move.flags |= flags;
+}
+
+// A move record position: "12.34%", or "7200 st" for a calibration move.
+void format_move_position(char *out, size_t size, uint16_t position, bool calibration)
+{
+    if (calibration) {
+        snprintf(out, size, "%u st", static_cast<unsigned>(position));
+    } else {
+        snprintf(out, size, "%u.%02u%%", static_cast<unsigned>(position / 100), static_cast<unsigned>(position % 100));
+    }
+}
+
+void move_log_end(const move_tracker_t &move, uint16_t current_steps, bool stopped_early)
+{
+    int64_t now_us = esp_timer_get_time();
+    bs_move_record_t record = {};
+    record.end_time_s = static_cast<uint32_t>(now_us / 1000000);
+    record.duration_us = static_cast<uint32_t>(now_us - move.start_us);
+    record.ramp_us = static_cast<uint32_t>((move.ramp_end_us ? move.ramp_end_us : now_us) - move.start_us);
+    record.lock_wait_us = s_move_lock_wait_us;
+    // Homing and end-stop seeks end before the new travel is known (and homing does not
+    // count steps), so their positions stay in steps rather than a stale percentage.
+    bool calibration = (move.flags & BS_MOVE_CALIBRATION) != 0;
+    record.start_position = calibration ? move.start_steps : percent100ths_from_steps(move.start_steps);
+    record.end_position = calibration ? current_steps : percent100ths_from_steps(current_steps);
+    record.steps = move.steps;
+    record.peak_steps_per_s = move.min_step_us ? static_cast<uint16_t>(1000000U / move.min_step_us) : 0;
+    record.reports = static_cast<uint16_t>(s_reports_pushed.load() - move.reports_at_start);
+    record.battery_start_mv = move.battery_start_mv;
+    record.battery_min_mv = move.battery_start_mv ? s_move_battery_min_mv.load() : 0;
+    record.profile = move.profile;
+    record.flags = static_cast<uint8_t>(move.flags | (stopped_early ? BS_MOVE_STOPPED_EARLY : 0));
+#if CONFIG_BS_MOVE_LOG
+    portENTER_CRITICAL(&s_move_log_mux);
+    s_move_log.push(record);
+    portEXIT_CRITICAL(&s_move_log_mux);
+#endif
+    char from[12];
+    char to[12];
+    format_move_position(from, sizeof(from), record.start_position, calibration);
+    format_move_position(to, sizeof(to), record.end_position, calibration);
+    BS_LOG_MOTOR("Move %s -> %s: %u steps in %u ms (ramp %u ms), peak %u steps/s, %u reports, "
+                 "battery %u/%u mV%s",
+                 from, to, static_cast<unsigned>(record.steps),
+                 static_cast<unsigned>(record.duration_us / 1000), static_cast<unsigned>(record.ramp_us / 1000),
+                 static_cast<unsigned>(record.peak_steps_per_s), static_cast<unsigned>(record.reports),
+                 static_cast<unsigned>(record.battery_start_mv), static_cast<unsigned>(record.battery_min_mv),
+                 stopped_early ? ", stopped early" : "");
+}
+
+// === MOTION PROFILES (step generator side) ===
+// Caller holds s_state_lock. Read before every step, so a profile switch lands on the
+// next one. Calibration moves (manual seeks, tune trials) run the calibrated profile
+// unscaled, homing picks its own speeds and a synchronized move keeps its plan.
+bs_step_profile_t active_step_profile_locked(uint8_t *microsteps)
+{
+    *microsteps = 1;
+    if (s_homing.active()) {
+        return homing_profile_locked();
+    }
+    if (s_calib_state != CalibState::IDLE) {
+        return s_step_profile;
+    }
+    app_motion_profile_t profile = static_cast<app_motion_profile_t>(s_motion_profile.load(std::memory_order_relaxed));
+    *microsteps = motion_microsteps(profile);
+    if (s_sync_move) {
+        return s_sync_profile;
+    }
+    return bs_motion_profile_apply(k_motion_profiles[profile], s_step_profile);
+}
+
+bool same_step_profile(const bs_step_profile_t &a, const bs_step_profile_t &b)
+{
+    return a.cruise_delay_us == b.cruise_delay_us && a.start_delay_us == b.start_delay_us &&
+           a.ramp_steps == b.ramp_steps;
+}
+
+bool homing_limit_locked(int32_t commanded_steps)
+{
+#if CONFIG_BS_HOME_SWITCH
+    if (s_calib_state == CalibState::HOMING) {
+        return gpio_get_level(BS_PIN_HOME_SWITCH) == 0;
+    }
+#endif
+    return encoder_window_stalled_locked(commanded_steps);
+}
+
+// s_state_lock held, after each homing step. Returns the step count: unchanged while
+// seeking, the end stop's position once it is found.
+uint16_t homing_step_locked(uint16_t current_steps)
+{
+    int32_t commanded = current_steps + s_homing.position() + s_homing.dir();
+    if (!s_homing.on_step(homing_limit_locked(commanded))) {
+        return current_steps;
+    }
+    if (s_homing.active()) {
+        s_state.moving_dir = s_homing.dir();
+        encoder_begin_window_locked(current_steps + s_homing.position());
+        return current_steps;
+    }
+    s_state.moving = false;
+    s_state.moving_dir = 0;
+    if (s_homing.phase() != bs_homing_phase_t::k_done) {
+        return current_steps;
+    }
+
+    int32_t found = 0; // the top is home by definition
+    if (s_calib_state == CalibState::FINDING_BOTTOM) {
+#if CONFIG_BS_ENCODER
+        found = encoder_measured_steps(); // where the shaft stopped, not where the steps said
+#else
+        found = current_steps + s_homing.position();
+#endif
+    }
+    found = found < 0 ? 0 : (found > UINT16_MAX ? UINT16_MAX : found);
+    s_state.target_steps = static_cast<uint16_t>(found);
+    s_state.target_percent100ths = percent100ths_from_steps(s_state.target_steps);
+    return s_state.target_steps;
+}
+
+#if CONFIG_BS_MOTOR_DC
+// === DC MOTOR POSITION ===
+// Steps a DC shaft made past the counted ones: coast after the drive stopped, or
+// before a reversal. s_state_lock held. The position follows them wherever the count
+// moves, and a blind at rest is where it coasted to.
+void apply_coast_locked(int32_t coast)
+{
+    if (s_homing.active() || s_calib_state == CalibState::MOVING_TO_HOME) {
+        return; // the count is not the position yet
+    }
+    int32_t limit = s_calib_state == CalibState::MOVING_TO_BOTTOM ? UINT16_MAX : s_bottom_steps;
+    int32_t steps = s_state.current_steps + coast;
+    steps = steps < 0 ? 0 : (steps > limit ? limit : steps);
+    s_state.current_steps = static_cast<uint16_t>(steps);
+    s_state.current_percent100ths = percent100ths_from_steps(s_state.current_steps);
+    if (!s_state.moving) {
+        s_state.target_steps = s_state.current_steps;
+        s_state.target_percent100ths = s_state.current_percent100ths;
+    }
+}
+
+// The motor backend gave up on a shaft that would not turn: end the move where it
+// is and report the jam, as an encoder stall does.
+void motor_stalled()
+{
+    if (!take_state_lock_for_step(false)) {
+        return;
+    }
+    s_state.moving = false;
+    s_state.moving_dir = 0;
+    s_state.stopped_early = true;
+    s_state.target_steps = s_state.current_steps;
+    s_state.target_percent100ths = s_state.current_percent100ths;
+    uint16_t steps = s_state.current_steps;
+    xSemaphoreGive(s_state_lock);
+    BS_LOG_WARN("Motor stalled at %u steps: no hall edge", static_cast<unsigned>(steps));
+    set_safety_status(k_safety_motor_jammed, 0);
+}
+
+// After every move: one that completes clears a stall's MotorJammed.
+void motor_end_move(bool stopped_early)
+{
+    if (!stopped_early) {
+        set_safety_status(0, k_safety_motor_jammed);
+    }
+}
+#else
+// A stepper makes exactly the steps it is given; the encoder watches for stalls.
+void apply_coast_locked(int32_t coast)
+{
+    (void)coast;
+}
+
+void motor_stalled() {}
+
+void motor_end_move(bool stopped_early)
+{
+    (void)stopped_early;
+}
+#endif // CONFIG_BS_MOTOR_DC
+
+void stepper_task(void *arg)
+{
+    (void)arg;
+    uint16_t since_yield = 0;
+    uint16_t ramp_progress = 0;
+    int8_t last_dir = 0;
+    bs_step_profile_t last_profile = {};
+    uint16_t last_delay_us = 0;
+#if CONFIG_BS_MICROSTEP_SELECT
+    uint8_t pin_microsteps = 0;
+#endif
+    bool was_moving = false;
+    move_tracker_t move = {};
+    int64_t last_edge_us = 0;
+    int32_t sync_offset_us = 0; // synchronized move: yield time to win back (> 0), rounding to add (< 0)
+    while (true) {
+        if (!s_state_lock) {
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+            continue;
+        }
+
+        if (!take_state_lock_for_step(false)) {
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+            continue;
+        }
+
+        if (s_halt_request.load(std::memory_order_acquire)) {
+            int8_t halted_dir = s_state.moving_dir;
+            acknowledge_halt_locked();
+            load_trip_locked(halted_dir);
+        }
+        apply_pending_commands_locked();
+        bool moving = s_state.moving;
+        int8_t dir = s_state.moving_dir;
+        uint16_t target_steps = s_state.target_steps;
+        uint16_t current_steps = s_state.current_steps;
+        bool homing = s_homing.active();
+        uint8_t microsteps = 1;
+        bs_step_profile_t profile = active_step_profile_locked(&microsteps);
+        uint16_t sync_min_delay_us = (s_sync_move && !homing) ? s_sync_min_delay_us : 0;
+        bool calibrating = homing || s_calib_state != CalibState::IDLE;
+        bool stopped_early = s_state.stopped_early;
+        if (s_sync_new_plan) {
+            s_sync_new_plan = false;
+            sync_offset_us = s_sync_start_offset_us;
+        }
+        xSemaphoreGive(s_state_lock);
+
+        if (!moving) {
+#if CONFIG_BS_DUAL_MOTOR
+            if (trim_motor2_step()) {
+                continue; // EN stays low until the trim is stepped out
+            }
+#endif
+            s_motor.idle();
+            int32_t coast = s_motor.take_coast();
+            if (coast != 0 && take_state_lock_for_step(false)) {
+                apply_coast_locked(coast);
+                current_steps = s_state.current_steps;
+                xSemaphoreGive(s_state_lock);
+            }
+            ramp_progress = 0;
+            last_dir = 0;
+            last_edge_us = 0;
+            if (was_moving) {
+                if (encoder_verify_move()) {
+                    continue; // correction move; still the same motion
+                }
+                was_moving = false;
+                load_end_move(stopped_early);
+                motor_end_move(stopped_early);
+                move_log_end(move, current_steps, stopped_early);
+                app_trace_record(bs_trace_event_t::k_motion_stop, percent100ths_from_steps(current_steps), 0);
+                app_power_hold(APP_POWER_LOCK_MOTION, false);
+                wake_task(s_update_task);
+            }
+            // Woken early by app_driver_set_target_percent100ths / app_driver_stop.
+            ulTaskNotifyTake(pdTRUE, k_stepper_idle_ticks);
+            continue;
+        }
+
+        if (!was_moving) {
+            was_moving = true;
+            s_motion_adc_error_logged = false;
+            move_log_begin(move, current_steps);
+            app_trace_record(bs_trace_event_t::k_motion_start, percent100ths_from_steps(current_steps),
+                             dir > 0 ? 1 : 0);
+            app_power_hold(APP_POWER_LOCK_MOTION, true);
+            encoder_begin_move(current_steps);
+            wake_task(s_update_task);
+        }
+
+        if (dir != last_dir) {
+            ramp_progress = 0;
+            last_dir = dir;
+            load_begin_move(calibrating);
+        } else if (!same_step_profile(profile, last_profile)) {
+            // Profile switched mid-move: carry on from the current speed, not a fresh ramp.
+            ramp_progress = bs_ramp_progress_for_delay(profile, last_delay_us);
+        }
+        last_profile = profile;
+#if CONFIG_BS_MICROSTEP_SELECT
+        if (microsteps != pin_microsteps) {
+            set_microstep_pins(microsteps);
+            pin_microsteps = microsteps;
+        }
+#endif
+
+        uint16_t step_delay_us = bs_step_delay_for_ramp(profile, ramp_progress);
+        last_delay_us = step_delay_us;
+        if (sync_min_delay_us != 0 && ramp_progress >= profile.ramp_steps) {
+            step_delay_us = sync_adjust_delay(step_delay_us, sync_min_delay_us, &sync_offset_us);
+        }
+        if (!s_motor.step(dir, step_delay_us, microsteps)) {
+            // Halted before the step started (the next iteration acknowledges it), or
+            // the motor did not turn.
+            last_edge_us = 0;
+            if (s_motor.take_stall()) {
+                motor_stalled();
+            }
+            continue;
+        }
+        int64_t edge_us = esp_timer_get_time();
+        // A stop cuts the trailing delay short; that interval is not jitter either.
+        bool halted = s_halt_request.load(std::memory_order_acquire);
+        if (last_edge_us != 0 && !halted) {
+            bench_record_step(edge_us - last_edge_us, step_delay_us, microsteps);
+        }
+        last_edge_us = halted ? 0 : edge_us;
+        move_log_step(move, step_delay_us, microsteps, ramp_progress >= profile.ramp_steps,
+                      static_cast<uint8_t>((calibrating ? BS_MOVE_CALIBRATION : 0) |
+                                           (sync_min_delay_us != 0 ? BS_MOVE_SYNC : 0)));
+        if (ramp_progress < profile.ramp_steps) {
+            ramp_progress++;
+        }
+
+        if (!take_state_lock_for_step(true)) {
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+            continue;
+        }
+
+        int32_t coast = s_motor.take_coast();
+        if (coast != 0) {
+            apply_coast_locked(coast);
+            current_steps = s_state.current_steps;
+        }
+        if (homing) {
+            current_steps = homing_step_locked(current_steps);
+        } else if (dir > 0) {
+            // Moving DOWN (increasing steps)
+            // During calibration to bottom, count from 0 up to 20000 max
+            if (s_calib_state == CalibState::MOVING_TO_BOTTOM) {
+                if (current_steps < 65535) {  // Prevent uint16_t overflow
+                    current_steps++;
+                } else {
+                    // Reached maximum possible steps - stop here
+                    BS_LOG_ERROR("⚠️  Reached maximum steps (65535) during calibration!");
+                    s_state.moving = false;
+                    s_state.moving_dir = 0;
+                }
+            }
+            // Normal operation - respect bottom limit
+            else if (current_steps < s_bottom_steps) {
+                current_steps++;
+            }
+        } else {
+            // Moving UP (decreasing steps)
+            // During calibration to home: DON'T change counter, only motor moves!
+            // Counter will be reset to 0 when user presses STOP
+            if (s_calib_state == CalibState::MOVING_TO_HOME) {
+                // Motor moves but counter stays unchanged - STOP defines the zero point
+            }
+            // Normal operation - respect home limit (0)
+            else if (current_steps > 0) {
+                current_steps--;
+            }
+        }
+
+        s_state.current_steps = current_steps;
+        s_state.current_percent100ths = percent100ths_from_steps(current_steps);
+        if (encoder_stalled_locked(current_steps)) {
+            s_state.moving = false;
+            s_state.moving_dir = 0;
+            s_state.target_steps = current_steps;
+            s_state.target_percent100ths = s_state.current_percent100ths;
+        }
 
         // During HOME calibration, motor runs until STOP is pressed (ignore target)
         // During BOTTOM calibration, motor runs until STOP is pressed (ignore target)
-        if (s_calib_state != CalibState::MOVING_TO_HOME && 
+        // Homing ends where the end stop is, whatever the target says
+        if (!homing && s_calib_state != CalibState::MOVING_TO_HOME &&
             s_calib_state != CalibState::MOVING_TO_BOTTOM &&
             current_steps == target_steps) {
             s_state.moving = false;
@@ -341,12 +2173,76 @@ void stepper_task(void *arg)
         xSemaphoreGive(s_state_lock);
 
         since_yield++;
-        if (since_yield >= k_yield_every_steps) {
+        if (since_yield >= param(APP_PARAM_YIELD_STEPS)) {
             since_yield = 0;
+            int64_t yield_start_us = esp_timer_get_time();
             vTaskDelay(1);
+            last_edge_us = 0; // the deliberate yield is not jitter
+            if (sync_min_delay_us != 0) {
+                sync_offset_us += static_cast<int32_t>(esp_timer_get_time() - yield_start_us);
+            }
+        }
+    }
+}
+
+void read_state_locked(app_driver_state_t *state)
+{
+    state->current_percent100ths = s_state.current_percent100ths;
+    state->target_percent100ths = s_state.target_percent100ths;
+    state->current_steps = s_state.current_steps;
+    state->target_steps = s_state.target_steps;
+    state->travel_steps = s_bottom_steps;
+    state->dir = s_state.moving_dir;
+    state->moving = s_state.moving;
+    state->stopped_early = s_state.stopped_early;
+    state->calibrating = s_calib_state != CalibState::IDLE;
+}
+
+#if CONFIG_BS_UNDERVOLTAGE_CUTOFF
+// Update task, with the step generator stopped. A trip keeps the position it stopped at
+// for the next boot, in case the pack browns the board out next; the release drops it,
+// since the blind may move again. Then the app gets to flag Power Source.
+void undervoltage_settle(const app_driver_state_t &state)
+{
+    if (state.moving || !s_undervoltage_changed.exchange(false)) {
+        return;
+    }
+    bool tripped = s_undervoltage_tripped.load();
+    {
+        heap_guard_exemption_t exemption;
+        nvs_handle_t handle;
+        if (nvs_open("calibration", NVS_READWRITE, &handle) == ESP_OK) {
+            if (tripped) {
+                nvs_set_u16(handle, "cutoff_steps", state.current_steps);
+            } else {
+                nvs_erase_key(handle, "cutoff_steps");
+            }
+            nvs_commit(handle);
+            nvs_close(handle);
         }
     }
+    if (tripped) {
+        portENTER_CRITICAL(&s_undervoltage_mux);
+        uint16_t trip_mv = s_undervoltage.trip_mv();
+        uint16_t release_mv = s_undervoltage.release_mv();
+        portEXIT_CRITICAL(&s_undervoltage_mux);
+        BS_LOG_WARN("Battery undervoltage cutoff at %u mV: motor stopped at %u steps, moves refused until %u mV at rest",
+                    static_cast<unsigned>(trip_mv), static_cast<unsigned>(state.current_steps),
+                    static_cast<unsigned>(release_mv));
+    } else {
+        BS_LOG_STATE("Battery recovered: undervoltage cutoff released");
+    }
+    app_driver_battery_cb_t cb = s_battery_cb.load();
+    if (cb) {
+        cb(tripped);
+    }
+}
+#else
+void undervoltage_settle(const app_driver_state_t &state)
+{
+    (void)state;
 }
+#endif
 
 void update_task(void *arg)
 {
@@ -355,45 +2251,69 @@ void update_task(void *arg)
     bool last_moving = false;
     int8_t last_dir = 0;
     TickType_t last_report_tick = 0;
+    bool activity_moving = false;
 
     while (true) {
         if (!s_state_lock) {
-            vTaskDelay(k_update_period_ticks);
+            vTaskDelay(pdMS_TO_TICKS(param(APP_PARAM_UPDATE_MS)));
             continue;
         }
 
         if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE) {
-            vTaskDelay(k_update_period_ticks);
+            vTaskDelay(pdMS_TO_TICKS(param(APP_PARAM_UPDATE_MS)));
             continue;
         }
 
-        uint16_t current_steps = s_state.current_steps;
-        bool moving = s_state.moving;
-        int8_t dir = s_state.moving_dir;
+        app_driver_state_t state;
+        read_state_locked(&state);
         xSemaphoreGive(s_state_lock);
+        // Every pass, so a reset mid-move leaves the position it was at in the post-mortem record.
+        app_postmortem_note_motor(&state, s_battery_sample_mv.load());
+        undervoltage_settle(state);
+        uint16_t current_steps = state.current_steps;
+        uint16_t current_percent100ths = state.current_percent100ths;
+        bool moving = state.moving;
+        int8_t dir = state.dir;
+
+        if (moving != activity_moving) {
+            activity_moving = moving;
+            notify_activity(moving ? APP_ACTIVITY_MOTION_START : APP_ACTIVITY_MOTION_STOP);
+        }
 
         bool state_changed = (moving != last_moving) || (dir != last_dir);
         bool steps_changed = (current_steps != last_reported_steps);
         bool moved_enough = steps_changed &&
             (static_cast<uint16_t>(std::abs(static_cast<int>(current_steps) - static_cast<int>(last_reported_steps))) >=
-             k_report_every_steps);
+             param(APP_PARAM_REPORT_STEPS));
         TickType_t now = xTaskGetTickCount();
-        bool time_ok = (now - last_report_tick) >= k_report_min_interval_ticks;
+        bool time_ok = (now - last_report_tick) >= pdMS_TO_TICKS(param(APP_PARAM_REPORT_MS));
         bool should_report = state_changed || (!moving && steps_changed) || (moving && moved_enough && time_ok);
 
-        if (should_report && !s_report_pending.exchange(true)) {
-            CHIP_ERROR err = chip::DeviceLayer::PlatformMgr().ScheduleWork(report_work, 0);
-            if (err == CHIP_NO_ERROR) {
-                last_reported_steps = current_steps;
-                last_report_tick = now;
-                last_moving = moving;
-                last_dir = dir;
-            } else {
+        if (should_report && s_report_ring.push({current_percent100ths, moving, dir})) {
+            portENTER_CRITICAL(&s_bench_mux);
+            s_bench.reports++;
+            portEXIT_CRITICAL(&s_bench_mux);
+            s_reports_pushed.fetch_add(1);
+            last_reported_steps = current_steps;
+            last_report_tick = now;
+            last_moving = moving;
+            last_dir = dir;
+        }
+        // Retried every pass until the CHIP thread accepts the work item.
+        if (!s_report_ring.empty() && !s_report_pending.exchange(true)) {
+            if (chip::DeviceLayer::PlatformMgr().ScheduleWork(report_work, 0) != CHIP_NO_ERROR) {
                 s_report_pending.store(false);
             }
         }
 
-        vTaskDelay(k_update_period_ticks);
+        TickType_t wait_ticks = pdMS_TO_TICKS(param(APP_PARAM_UPDATE_MS));
+#if CONFIG_BS_POWER_SAVE
+        // Settled and reported: nothing to do until the stepper starts or stops a move.
+        if (!moving && !last_moving && current_steps == last_reported_steps && s_report_ring.empty()) {
+            wait_ticks = portMAX_DELAY;
+        }
+#endif
+        ulTaskNotifyTake(pdTRUE, wait_ticks);
     }
 }
 
@@ -409,46 +2329,6 @@ uint8_t battery_percent_from_mv(uint32_t voltage_mv)
     return static_cast<uint8_t>(scaled / (k_battery_full_mv - k_battery_empty_mv));
 }
 
-bool read_battery_voltage_mv(uint32_t &battery_mv_out)
-{
-    if (!s_battery_adc_handle) {
-        return false;
-    }
-
-    int raw = 0;
-    uint32_t raw_sum = 0;
-    for (uint8_t i = 0; i < k_battery_samples_per_read; ++i) {
-        esp_err_t err = adc_oneshot_read(s_battery_adc_handle, k_battery_adc_channel, &raw);
-        if (err != ESP_OK) {
-            BS_LOG_ERROR("Battery ADC read failed: %d", err);
-            return false;
-        }
-        raw_sum += static_cast<uint32_t>(raw);
-    }
-
-    int avg_raw = static_cast<int>(raw_sum / k_battery_samples_per_read);
-    int pin_mv = 0;
-    if (s_battery_adc_cali_enabled) {
-        esp_err_t err = adc_cali_raw_to_voltage(s_battery_adc_cali_handle, avg_raw, &pin_mv);
-        if (err != ESP_OK) {
-            BS_LOG_ERROR("Battery ADC calibration convert failed: %d", err);
-            return false;
-        }
-    } else {
-        pin_mv = (avg_raw * 3300) / 4095;
-    }
-
-    uint32_t batt_mv = (static_cast<uint32_t>(pin_mv) * k_battery_divider_numerator + (k_battery_divider_denominator / 2)) /
-                       k_battery_divider_denominator;
-    if (batt_mv > k_battery_max_valid_mv) {
-        BS_LOG_ERROR("Battery ADC out of range: %u mV", static_cast<unsigned>(batt_mv));
-        return false;
-    }
-
-    battery_mv_out = batt_mv;
-    return true;
-}
-
 esp_err_t init_battery_adc()
 {
     adc_oneshot_unit_init_cfg_t unit_cfg = {};
@@ -469,7 +2349,7 @@ esp_err_t init_battery_adc()
         return err;
     }
 
-#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+#if CONFIG_BS_BATTERY_ADC_CALI && ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
     adc_cali_curve_fitting_config_t cali_cfg = {};
     cali_cfg.unit_id = k_battery_adc_unit;
     cali_cfg.chan = k_battery_adc_channel;
@@ -478,7 +2358,7 @@ esp_err_t init_battery_adc()
     if (adc_cali_create_scheme_curve_fitting(&cali_cfg, &s_battery_adc_cali_handle) == ESP_OK) {
         s_battery_adc_cali_enabled = true;
     }
-#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+#elif CONFIG_BS_BATTERY_ADC_CALI && ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
     adc_cali_line_fitting_config_t cali_cfg = {};
     cali_cfg.unit_id = k_battery_adc_unit;
     cali_cfg.atten = k_battery_adc_atten;
@@ -488,8 +2368,25 @@ esp_err_t init_battery_adc()
     }
 #endif
 
+#if CONFIG_BS_BATTERY_ADC_CALI
+    const char *cali = s_battery_adc_cali_enabled ? "yes" : "no";
+#else
+    const char *cali = "off";
+#endif
     BS_LOG_STATE("Battery ADC ready: GPIO%u ch=%u cali=%s", static_cast<unsigned>(k_battery_adc_gpio),
-                 static_cast<unsigned>(k_battery_adc_channel), s_battery_adc_cali_enabled ? "yes" : "no");
+                 static_cast<unsigned>(k_battery_adc_channel), cali);
+
+#if CONFIG_BS_CURRENT_SENSE
+    // Without it the blind still runs, only without load detection.
+    err = adc_oneshot_config_channel(s_battery_adc_handle, k_current_adc_channel, &chan_cfg);
+    if (err != ESP_OK) {
+        BS_LOG_ERROR("Current sense ADC channel config failed: %d", err);
+    } else {
+        s_current_sense_ready = true;
+        BS_LOG_STATE("Current sense ready: ch=%u, %u mV/A", static_cast<unsigned>(k_current_adc_channel),
+                     static_cast<unsigned>(k_current_mv_per_a));
+    }
+#endif
     return ESP_OK;
 }
 
@@ -498,9 +2395,40 @@ void battery_task(void *arg)
     (void)arg;
     while (true) {
         uint32_t measured_mv = 0;
-        bool valid_read = read_battery_voltage_mv(measured_mv);
+        app_power_hold(APP_POWER_LOCK_ADC, true);
+        // The step generator only try-takes the ADC, so nothing lends this task its
+        // priority: preempted halfway, it would keep the ADC and the motion readings
+        // away for the rest of the move. It reads above the step generator instead.
+        vTaskPrioritySet(nullptr, k_stepper_priority + 1);
+        bool valid_read = read_battery_voltage_mv(k_battery_samples_per_read, portMAX_DELAY, measured_mv, nullptr);
+        vTaskPrioritySet(nullptr, k_battery_task_priority);
+        app_power_hold(APP_POWER_LOCK_ADC, false);
+#if CONFIG_BS_UNDERVOLTAGE_CUTOFF
+        // Moves are refused while tripped, so these readings are at rest.
+        if (valid_read && s_undervoltage_tripped.load()) {
+            portENTER_CRITICAL(&s_undervoltage_mux);
+            bool released = s_undervoltage.rest_sample(static_cast<uint16_t>(measured_mv));
+            portEXIT_CRITICAL(&s_undervoltage_mux);
+            if (released) {
+                s_undervoltage_tripped.store(false);
+                s_undervoltage_changed.store(true);
+                wake_task(s_update_task);
+            }
+        }
+#endif
+
+        if (valid_read) {
+            // Unfiltered, so the move log sees the sag while the motor pulls current.
+            uint16_t sample = static_cast<uint16_t>(measured_mv > UINT16_MAX ? UINT16_MAX : measured_mv);
+            s_battery_sample_mv.store(sample);
+            uint16_t low = s_move_battery_min_mv.load();
+            while (low != 0 && sample < low && !s_move_battery_min_mv.compare_exchange_weak(low, sample)) {
+            }
+        } else {
+            s_battery_sample_mv.store(0);
+        }
 
-        if (xSemaphoreTake(s_state_lock, portMAX_DELAY) == pdTRUE) {
+        if (xSemaphoreTake(s_aux_lock, portMAX_DELAY) == pdTRUE) {
             if (valid_read) {
                 if (s_battery_state.valid) {
                     measured_mv = (s_battery_state.voltage_mv * 3 + measured_mv) / 4;
@@ -511,10 +2439,10 @@ void battery_task(void *arg)
             } else {
                 s_battery_state.valid = false;
             }
-            xSemaphoreGive(s_state_lock);
+            xSemaphoreGive(s_aux_lock);
         }
 
-        vTaskDelay(k_battery_sample_period_ticks);
+        vTaskDelay(pdMS_TO_TICKS(param(APP_PARAM_BATTERY_MS)));
     }
 }
 
@@ -528,10 +2456,10 @@ void led_task(void *arg)
         app_led_pattern_t status = {};
         uint8_t quick_count = 0;
 
-        if (xSemaphoreTake(s_state_lock, portMAX_DELAY) == pdTRUE) {
+        if (xSemaphoreTake(s_aux_lock, portMAX_DELAY) == pdTRUE) {
             status = s_status_led;
             quick_count = s_quick_blink_count;
-            xSemaphoreGive(s_state_lock);
+            xSemaphoreGive(s_aux_lock);
         }
 
         uint16_t period_ms = status.period_ms > 0 ? status.period_ms : 600;
@@ -549,7 +2477,7 @@ void led_task(void *arg)
             last_toggle = now;
 
             if (quick_count > 0 && phase_on) {
-                if (xSemaphoreTake(s_state_lock, portMAX_DELAY) == pdTRUE) {
+                if (xSemaphoreTake(s_aux_lock, portMAX_DELAY) == pdTRUE) {
                     if (s_quick_blink_count > 0) {
                         s_quick_blink_count--;
                     }
@@ -557,7 +2485,7 @@ void led_task(void *arg)
                         s_status_led = s_status_after_blink;
                         s_restore_status_after_blink = false;
                     }
-                    xSemaphoreGive(s_state_lock);
+                    xSemaphoreGive(s_aux_lock);
                 }
             }
         }
@@ -573,6 +2501,14 @@ void led_task(void *arg)
             set_calib_led_rgb(status.red, status.green, status.blue);
         }
 
+        app_power_hold(APP_POWER_LOCK_LED, blink_mode);
+#if CONFIG_BS_POWER_SAVE
+        if (!blink_mode) {
+            // Solid colour is latched; sleep until the pattern changes.
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+#endif
         vTaskDelay(pdMS_TO_TICKS(k_led_task_period_ms));
     }
 }
@@ -583,10 +2519,11 @@ void set_led_blink(uint8_t count, uint16_t period_ms)
     s_led_continuous.store(false);
     s_led_blink_count.store(0);
     s_led_blink_period_ms.store(0);
-    if (xSemaphoreTake(s_state_lock, portMAX_DELAY) == pdTRUE) {
+    if (xSemaphoreTake(s_aux_lock, portMAX_DELAY) == pdTRUE) {
         s_quick_blink_count = count;
-        xSemaphoreGive(s_state_lock);
+        xSemaphoreGive(s_aux_lock);
     }
+    wake_task(s_led_task);
 }
 
 void set_led_continuous(bool enabled)
@@ -594,10 +2531,11 @@ void set_led_continuous(bool enabled)
     s_led_continuous.store(enabled);
     s_led_blink_count.store(0);
     s_led_blink_period_ms.store(0);
-    if (xSemaphoreTake(s_state_lock, portMAX_DELAY) == pdTRUE) {
+    if (xSemaphoreTake(s_aux_lock, portMAX_DELAY) == pdTRUE) {
         s_quick_blink_count = 0;
-        xSemaphoreGive(s_state_lock);
+        xSemaphoreGive(s_aux_lock);
     }
+    wake_task(s_led_task);
 }
 
 // === BUTTON HELPERS ===
@@ -636,22 +2574,46 @@ void reset_calibration_to_defaults()
 {
     s_home_steps = 0;
     s_bottom_steps = k_max_steps;
+    s_step_profile = baseline_step_profile();
     BS_LOG_MOTOR("🔄 Reset calibration to defaults: home=0, bottom=%u", k_max_steps);
 }
 
 void clear_calibration_nvs()
 {
+    heap_guard_exemption_t exemption;
     nvs_handle_t handle;
     esp_err_t err = nvs_open("calibration", NVS_READWRITE, &handle);
     if (err == ESP_OK) {
         nvs_erase_key(handle, "home_steps");
         nvs_erase_key(handle, "bottom_steps");
+        nvs_erase_key(handle, "cruise_us");
+        nvs_erase_key(handle, "start_us");
+        nvs_erase_key(handle, "ramp_steps");
         nvs_commit(handle);
         nvs_close(handle);
         BS_LOG_MOTOR("🗑️  Cleared calibration from NVS");
     }
 }
 
+void save_calibration_to_nvs()
+{
+    heap_guard_exemption_t exemption;
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open("calibration", NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        nvs_set_u16(handle, "home_steps", s_home_steps);
+        nvs_set_u16(handle, "bottom_steps", s_bottom_steps);
+        nvs_set_u16(handle, "cruise_us", s_step_profile.cruise_delay_us);
+        nvs_set_u16(handle, "start_us", s_step_profile.start_delay_us);
+        nvs_set_u16(handle, "ramp_steps", s_step_profile.ramp_steps);
+        nvs_commit(handle);
+        nvs_close(handle);
+        BS_LOG_STATE("💾 Calibration saved to NVS");
+    } else {
+        BS_LOG_ERROR("Failed to save calibration: %d", err);
+    }
+}
+
 void load_calibration_from_nvs()
 {
     // Start with defaults
@@ -662,13 +2624,19 @@ void load_calibration_from_nvs()
     if (err == ESP_OK) {
         uint16_t home = 0;
         uint16_t bottom = k_max_steps;
+        bs_step_profile_t baseline = baseline_step_profile();
+        bs_step_profile_t profile = baseline;
         
         nvs_get_u16(handle, "home_steps", &home);
         nvs_get_u16(handle, "bottom_steps", &bottom);
+        nvs_get_u16(handle, "cruise_us", &profile.cruise_delay_us);
+        nvs_get_u16(handle, "start_us", &profile.start_delay_us);
+        nvs_get_u16(handle, "ramp_steps", &profile.ramp_steps);
         nvs_close(handle);
         
         // Validate loaded values
         bool valid = true;
+        bool profile_valid = true;
         
         // Home should always be 0
         if (home != 0) {
@@ -677,15 +2645,35 @@ void load_calibration_from_nvs()
         }
         
         // Bottom should be reasonable (100 to 20000 steps)
-        if (bottom < k_min_travel_steps || bottom > 20000) {
-            BS_LOG_ERROR("❌ Invalid bottom position: %u (expected %u-20000)", bottom, k_min_travel_steps);
+        if (bottom < k_min_travel_steps || bottom > k_max_travel_steps) {
+            BS_LOG_ERROR("❌ Invalid bottom position: %u (expected %u-%u)", bottom, k_min_travel_steps,
+                         k_max_travel_steps);
             valid = false;
         }
         
+        // A tuned profile is only ever faster than the baseline, never past the tuner's floor.
+        // One that is not only costs the tuning: a reboot between a parameter write and the
+        // profile write (app_driver_set_param) leaves exactly that, and the travel still holds.
+        if (profile.cruise_delay_us < k_tune_config.min_cruise_delay_us ||
+            profile.cruise_delay_us > baseline.cruise_delay_us ||
+            profile.start_delay_us != baseline.start_delay_us ||
+            profile.ramp_steps < k_tune_config.min_ramp_steps ||
+            profile.ramp_steps > baseline.ramp_steps) {
+            BS_LOG_WARN("Step profile %u/%u us, ramp %u does not fit the baseline, using the baseline",
+                        profile.cruise_delay_us, profile.start_delay_us, profile.ramp_steps);
+            profile = baseline;
+            profile_valid = false;
+        }
+        
         if (valid) {
             s_home_steps = home;
             s_bottom_steps = bottom;
-            BS_LOG_MOTOR("✅ Loaded calibration: home=%u, bottom=%u", s_home_steps, s_bottom_steps);
+            s_step_profile = profile;
+            BS_LOG_MOTOR("✅ Loaded calibration: home=%u, bottom=%u, cruise=%uus, ramp=%u", s_home_steps,
+                         s_bottom_steps, s_step_profile.cruise_delay_us, s_step_profile.ramp_steps);
+            if (!profile_valid) {
+                save_calibration_to_nvs(); // so the next boot agrees
+            }
         } else {
             BS_LOG_ERROR("⚠️  Invalid calibration data, using defaults");
             clear_calibration_nvs();  // Clear bad data
@@ -696,21 +2684,419 @@ void load_calibration_from_nvs()
     }
 }
 
-void save_calibration_to_nvs()
+// Where an undervoltage cutoff stopped the motor. The board has most likely browned out
+// or had its pack swapped since, and the blind is still there. Used once.
+void restore_cutoff_position()
 {
+    heap_guard_exemption_t exemption;
     nvs_handle_t handle;
-    esp_err_t err = nvs_open("calibration", NVS_READWRITE, &handle);
+    if (nvs_open("calibration", NVS_READWRITE, &handle) != ESP_OK) {
+        return;
+    }
+    uint16_t steps = 0;
+    if (nvs_get_u16(handle, "cutoff_steps", &steps) == ESP_OK) {
+        nvs_erase_key(handle, "cutoff_steps");
+        nvs_commit(handle);
+        if (steps <= s_bottom_steps) {
+            s_state.current_steps = steps;
+            s_state.target_steps = steps;
+            s_state.current_percent100ths = percent100ths_from_steps(steps);
+            s_state.target_percent100ths = s_state.current_percent100ths;
+            BS_LOG_MOTOR("Resuming at %u steps, where the undervoltage cutoff stopped the motor",
+                         static_cast<unsigned>(steps));
+        }
+    }
+    nvs_close(handle);
+}
+
+void load_motion_profile_from_nvs()
+{
+    nvs_handle_t handle;
+    if (nvs_open("motion", NVS_READONLY, &handle) != ESP_OK) {
+        return; // never switched: fast
+    }
+    uint16_t profile = APP_MOTION_PROFILE_FAST;
+    uint16_t sync_ds = 0;
+    nvs_get_u16(handle, "profile", &profile);
+    nvs_get_u16(handle, "sync_ds", &sync_ds);
+    nvs_close(handle);
+    s_sync_travel_ds.store(sync_ds);
+    if (profile >= APP_MOTION_PROFILE_COUNT) {
+        BS_LOG_ERROR("❌ Invalid motion profile %u in NVS, using fast", profile);
+        profile = APP_MOTION_PROFILE_FAST;
+    }
+    s_motion_profile.store(static_cast<uint8_t>(profile));
+}
+
+void save_motion_setting_to_nvs(const char *key, uint16_t value)
+{
+    heap_guard_exemption_t exemption;
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open("motion", NVS_READWRITE, &handle);
     if (err == ESP_OK) {
-        nvs_set_u16(handle, "home_steps", s_home_steps);
-        nvs_set_u16(handle, "bottom_steps", s_bottom_steps);
+        nvs_set_u16(handle, key, value);
         nvs_commit(handle);
         nvs_close(handle);
-        BS_LOG_STATE("💾 Calibration saved to NVS");
     } else {
-        BS_LOG_ERROR("Failed to save calibration: %d", err);
+        BS_LOG_ERROR("Failed to save motion setting %s: %d", key, err);
+    }
+}
+
+void load_params_from_nvs()
+{
+    for (uint8_t i = 0; i < APP_PARAM_COUNT; ++i) {
+        s_params[i].store(k_params[i].default_value);
+    }
+    nvs_handle_t handle;
+    if (nvs_open("params", NVS_READONLY, &handle) != ESP_OK) {
+        return; // no overrides
+    }
+    for (uint8_t i = 0; i < APP_PARAM_COUNT; ++i) {
+        const bs_param_def_t &def = k_params[i];
+        uint16_t value = def.default_value;
+        if (nvs_get_u16(handle, def.key, &value) != ESP_OK) {
+            continue;
+        }
+        if (!bs_param_valid(def, value)) {
+            BS_LOG_ERROR("❌ Invalid %s=%u in NVS (%u-%u), using %u", def.key, value, def.min_value, def.max_value,
+                         def.default_value);
+            continue;
+        }
+        s_params[i].store(value);
+        BS_LOG_MOTOR("⚙️  %s=%u %s (default %u)", def.key, value, def.unit, def.default_value);
+    }
+    nvs_close(handle);
+}
+
+// Only overrides are stored: a parameter set back to its default loses its key.
+void save_param_to_nvs(app_param_t id, uint16_t value)
+{
+    heap_guard_exemption_t exemption;
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open("params", NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        if (value == k_params[id].default_value) {
+            nvs_erase_key(handle, k_params[id].key);
+        } else {
+            nvs_set_u16(handle, k_params[id].key, value);
+        }
+        nvs_commit(handle);
+        nvs_close(handle);
+    } else {
+        BS_LOG_ERROR("Failed to save parameter %s: %d", k_params[id].key, err);
+    }
+}
+
+// === SPEED AUTO-TUNE ===
+#if CONFIG_BS_ENCODER
+// Caller holds s_state_lock. False when already there (nothing to wait for).
+bool start_tune_leg_locked(uint16_t target_steps)
+{
+    s_tune_leg++;
+    s_tune_leg_running = target_steps != s_state.current_steps;
+    if (!s_tune_leg_running) {
+        return false;
+    }
+    s_tune_leg_check = s_encoder.moves_checked();
+    s_state.target_steps = target_steps;
+    s_state.target_percent100ths = percent100ths_from_steps(target_steps);
+    s_state.stopped_early = false;
+    s_state.moving = true;
+    s_state.moving_dir = (target_steps > s_state.current_steps) ? 1 : -1;
+    return true;
+}
+
+bool start_speed_tune()
+{
+    xSemaphoreTake(s_state_lock, portMAX_DELAY);
+    s_profile_before_tune = s_step_profile;
+    xSemaphoreGive(s_state_lock);
+    s_tuner = bs_speed_tuner(speed_tune_config()); // from the current baseline
+    s_tune_leg = 0;
+    s_tune_leg_running = false;
+    BS_LOG_STATE("🏎️  Tuning step speed (STOP to skip)");
+    return true;
+}
+
+void abort_speed_tune()
+{
+    xSemaphoreTake(s_state_lock, portMAX_DELAY);
+    s_step_profile = s_profile_before_tune;
+    xSemaphoreGive(s_state_lock);
+    BS_LOG_WARN("Speed tuning skipped; keeping cruise %uus, ramp %u steps", s_step_profile.cruise_delay_us,
+                s_step_profile.ramp_steps);
+}
+
+// Button task, every poll while TUNING. Each trial is one move out and one back at
+// the trial profile. Returns true once the tuned profile is in place and saved.
+bool speed_tune_step()
+{
+    xSemaphoreTake(s_state_lock, portMAX_DELAY);
+    if (s_tune_leg_running && (s_state.moving || s_encoder.moves_checked() == s_tune_leg_check)) {
+        xSemaphoreGive(s_state_lock); // leg still running, or not verified by the step generator yet
+        return false;
+    }
+    s_tune_leg_running = false;
+
+    if (s_tune_leg == 0) {
+        s_step_profile = s_tuner.trial();
+        s_tune_lost = false;
+        s_tune_origin = s_state.current_steps;
+        uint16_t distance = (s_bottom_steps / 2 < k_tune_leg_steps) ? s_bottom_steps / 2 : k_tune_leg_steps;
+        start_tune_leg_locked(s_tune_origin >= distance ? s_tune_origin - distance : s_tune_origin + distance);
+        xSemaphoreGive(s_state_lock);
+        wake_task(s_stepper_task);
+        return false;
+    }
+    if (s_tune_leg == 1) {
+        start_tune_leg_locked(s_tune_origin);
+        xSemaphoreGive(s_state_lock);
+        wake_task(s_stepper_task);
+        return false;
+    }
+
+    bs_step_profile_t trial = s_step_profile;
+    bool lost = s_tune_lost;
+    s_tuner.report(lost);
+    s_tune_leg = 0;
+    bool done = s_tuner.phase() == bs_speed_tune_phase_t::k_done;
+    if (done) {
+        s_step_profile = s_tuner.result();
+    }
+    xSemaphoreGive(s_state_lock);
+
+    BS_LOG_STATE("Tune trial %u: cruise %uus, ramp %u steps -> %s", static_cast<unsigned>(s_tuner.trials()),
+                 trial.cruise_delay_us, trial.ramp_steps, lost ? "lost steps" : "ok");
+    if (!done) {
+        return false;
+    }
+    BS_LOG_STATE("✅ Step speed tuned: cruise %uus (was %uus), ramp %u steps (was %u)",
+                 s_step_profile.cruise_delay_us, s_profile_before_tune.cruise_delay_us, s_step_profile.ramp_steps,
+                 s_profile_before_tune.ramp_steps);
+    save_calibration_to_nvs();
+    app_driver_dump_motion_profiles();
+    return true;
+}
+#else
+// Lost steps can only be detected with the encoder.
+bool start_speed_tune()
+{
+    return false;
+}
+
+void abort_speed_tune() {}
+
+bool speed_tune_step()
+{
+    return true;
+}
+#endif // CONFIG_BS_ENCODER
+
+// Raw (pre-debounce) edges, so a replay drives the pins exactly as the user did.
+void trace_button_edges(bool up_raw, bool stop_raw, bool down_raw)
+{
+    static uint8_t s_last_raw = 0;
+    uint8_t raw = (up_raw ? 1U << BS_TRACE_BUTTON_UP : 0) | (stop_raw ? 1U << BS_TRACE_BUTTON_STOP : 0) |
+                  (down_raw ? 1U << BS_TRACE_BUTTON_DOWN : 0);
+    uint8_t changed = raw ^ s_last_raw;
+    s_last_raw = raw;
+    for (uint8_t button = BS_TRACE_BUTTON_UP; button <= BS_TRACE_BUTTON_DOWN; ++button) {
+        if (changed & (1U << button)) {
+            app_trace_record(bs_trace_event_t::k_button, (raw >> button) & 0x1, button);
+        }
+    }
+}
+
+// === CALIBRATION STEPS ===
+void enter_calibration(int64_t now)
+{
+    BS_LOG_STATE("🔧 ENTERING CALIBRATION MODE");
+    s_calib_state = CalibState::READY;
+    s_calib_last_activity_us = now;
+    s_matter_blocked = true;
+    if (xSemaphoreTake(s_aux_lock, portMAX_DELAY) == pdTRUE) {
+        s_status_before_calib = s_status_led;
+        s_status_led = {255, 180, 0, APP_LED_BLINK, 600}; // yellow blink during calibration
+        xSemaphoreGive(s_aux_lock);
+    }
+    wake_task(s_led_task);
+}
+
+// Also the way out mid-step (Matter): whatever is moving stops where it is.
+void exit_calibration()
+{
+    if (s_calib_state == CalibState::TUNING) {
+        abort_speed_tune();
+    }
+    xSemaphoreTake(s_state_lock, portMAX_DELAY);
+    s_homing.cancel();
+    s_state.moving = false;
+    s_state.moving_dir = 0;
+    s_state.target_steps = s_state.current_steps;
+    s_state.target_percent100ths = s_state.current_percent100ths;
+    s_calib_state = CalibState::IDLE;
+    xSemaphoreGive(s_state_lock);
+    s_matter_blocked = false;
+    if (xSemaphoreTake(s_aux_lock, portMAX_DELAY) == pdTRUE) {
+        s_status_led = s_status_before_calib;
+        xSemaphoreGive(s_aux_lock);
+    }
+    wake_task(s_led_task);
+}
+
+void set_home_here(int64_t now)
+{
+    BS_LOG_STATE("✅ HOME position set!");
+    xSemaphoreTake(s_state_lock, portMAX_DELAY);
+    // Reset to absolute zero - this is home position
+    s_home_steps = 0;  // Home is always 0
+    s_state.current_steps = 0;
+    s_state.current_percent100ths = 0;
+    s_state.target_steps = 0;
+    s_state.target_percent100ths = 0;
+    s_state.moving = false;  // Stop motor
+    s_state.moving_dir = 0;
+    xSemaphoreGive(s_state_lock);
+
+    s_calib_state = CalibState::HOME_SET;
+    s_calib_last_activity_us = now;
+    set_led_blink(5, 120);  // 5 quick blinks
+
+    BS_LOG_STATE("💾 Saving home position (0) to NVS");
+    save_calibration_to_nvs();
+}
+
+void set_bottom_here(int64_t now)
+{
+    xSemaphoreTake(s_state_lock, portMAX_DELAY);
+    uint16_t travel = s_state.current_steps;
+    s_state.moving = false;  // Stop motor
+    s_state.moving_dir = 0;
+    xSemaphoreGive(s_state_lock);
+
+    if (travel < k_min_travel_steps) {
+        BS_LOG_ERROR("❌ Travel too short (%u < %u steps)", travel, k_min_travel_steps);
+        set_led_blink(10, 100);  // Error
+        s_calib_state = CalibState::HOME_SET;  // Try again
+    } else if (travel > k_max_travel_steps) {
+        BS_LOG_ERROR("❌ Travel too long (%u > %u steps) - motor may be stuck!", travel, k_max_travel_steps);
+        set_led_blink(10, 100);  // Error
+        s_calib_state = CalibState::HOME_SET;  // Try again
+    } else {
+        BS_LOG_STATE("✅ BOTTOM position set! Travel: %u steps from home", travel);
+        xSemaphoreTake(s_state_lock, portMAX_DELAY);
+        s_bottom_steps = travel;  // This is the total travel distance
+        s_state.target_steps = travel;
+        s_state.current_percent100ths = k_percent_100ths_max;
+        s_state.target_percent100ths = k_percent_100ths_max;
+        xSemaphoreGive(s_state_lock);
+        s_calib_last_activity_us = now;
+        set_led_blink(5, 120);  // 5 quick blinks
+
+        BS_LOG_STATE("💾 Saving bottom position (%u) to NVS", travel);
+        save_calibration_to_nvs();
+        s_calib_state = start_speed_tune() ? CalibState::TUNING : CalibState::COMPLETE;
+        if (s_calib_state == CalibState::COMPLETE) {
+            app_driver_dump_motion_profiles();
+        }
+    }
+}
+
+// seek is HOMING or FINDING_BOTTOM. False when there is no input to find that end
+// stop with; the caller falls back to the STOP-marked ritual.
+bool start_end_stop_seek(CalibState seek, int64_t now)
+{
+    bool home = seek == CalibState::HOMING;
+    if (!(home ? k_home_seek_available : k_bottom_seek_available)) {
+        return false;
+    }
+    BS_LOG_STATE("%s  Seeking the %s end stop", home ? "⬆️" : "⬇️", home ? "top" : "bottom");
+    xSemaphoreTake(s_state_lock, portMAX_DELAY);
+    s_homing.start(home ? -1 : 1);
+    s_calib_state = seek;
+    s_state.stopped_early = false;
+    s_state.moving = true;
+    s_state.moving_dir = s_homing.dir();
+    xSemaphoreGive(s_state_lock);
+    s_calib_last_activity_us = now;
+    wake_task(s_stepper_task);
+    return true;
+}
+
+void update_end_stop_seek(bool stop_pressed, int64_t now)
+{
+    bool home = s_calib_state == CalibState::HOMING;
+    CalibState retry_state = home ? CalibState::READY : CalibState::HOME_SET;
+    xSemaphoreTake(s_state_lock, portMAX_DELAY);
+    if (stop_pressed) {
+        s_homing.cancel();
+        s_state.moving = false;
+        s_state.moving_dir = 0;
+    }
+    bs_homing_phase_t phase = s_homing.phase();
+    int32_t travel = s_homing.position();
+    xSemaphoreGive(s_state_lock);
+
+    if (stop_pressed) {
+        BS_LOG_WARN("End stop seek cancelled");
+        s_calib_state = retry_state;
+    } else if (phase == bs_homing_phase_t::k_failed) {
+        BS_LOG_ERROR("❌ No %s end stop found after %d steps", home ? "top" : "bottom", static_cast<int>(travel));
+        set_led_blink(10, 100);  // Error
+        s_calib_state = retry_state;
+    } else if (phase == bs_homing_phase_t::k_done) {
+        if (home) {
+            set_home_here(now);
+        } else {
+            set_bottom_here(now);
+        }
+    }
+}
+
+// Requests posted from the CHIP thread, taken in the order a user would press them.
+void handle_calibration_requests(int64_t now)
+{
+    uint8_t requests = s_calib_requests.exchange(0);
+    if (requests == 0) {
+        return;
+    }
+    if ((requests & static_cast<uint8_t>(CalibRequest::ENTER)) && s_calib_state == CalibState::IDLE) {
+        BS_LOG_STATE("Calibration mode enabled via Matter");
+        enter_calibration(now);
+    }
+
+    bool settled = s_calib_state == CalibState::READY || s_calib_state == CalibState::HOME_SET ||
+                   s_calib_state == CalibState::COMPLETE;
+    uint8_t seek_requests = requests & (static_cast<uint8_t>(CalibRequest::HOME) |
+                                        static_cast<uint8_t>(CalibRequest::BOTTOM));
+    if (seek_requests && !settled) {
+        BS_LOG_WARN("Calibration command ignored: %s", s_calib_state == CalibState::IDLE ? "calibration mode is off"
+                                                                                         : "calibration step running");
+    } else if (requests & static_cast<uint8_t>(CalibRequest::HOME)) {
+        if (!start_end_stop_seek(CalibState::HOMING, now)) {
+            BS_LOG_WARN("Automatic homing needs an end-stop switch or the encoder; use UP and STOP");
+        }
+    } else if (requests & static_cast<uint8_t>(CalibRequest::BOTTOM)) {
+        if (s_calib_state == CalibState::READY) {
+            BS_LOG_WARN("Set home before the bottom");
+        } else if (!start_end_stop_seek(CalibState::FINDING_BOTTOM, now)) {
+            BS_LOG_WARN("Automatic bottom search needs the encoder; use DOWN and STOP");
+        }
+    }
+
+    if ((requests & static_cast<uint8_t>(CalibRequest::EXIT)) && s_calib_state != CalibState::IDLE) {
+        BS_LOG_STATE("Calibration mode disabled via Matter");
+        exit_calibration();
     }
 }
 
+void post_calibration_request(CalibRequest request, CalibRequest cancels)
+{
+    s_calib_requests.fetch_and(static_cast<uint8_t>(~static_cast<uint8_t>(cancels)));
+    s_calib_requests.fetch_or(static_cast<uint8_t>(request));
+    wake_task(s_button_task);
+}
+
 // === CALIBRATION STATE MACHINE ===
 void handle_calibration_events()
 {
@@ -720,23 +3106,29 @@ void handle_calibration_events()
     bool up_raw = (gpio_get_level(k_btn_up) == 0);
     bool stop_raw = (gpio_get_level(k_btn_stop) == 0);
     bool down_raw = (gpio_get_level(k_btn_down) == 0);
+    trace_button_edges(up_raw, stop_raw, down_raw);
     
     // Update button states
     bool up_pressed = update_button_state(s_btn_up_data, up_raw);
     bool stop_pressed = update_button_state(s_btn_stop_data, stop_raw);
     bool down_pressed = update_button_state(s_btn_down_data, down_raw);
+    if (up_pressed || stop_pressed || down_pressed) {
+        notify_activity(APP_ACTIVITY_BUTTON);
+    }
+    handle_calibration_requests(now);
     
     // Timeout check (5 minutes)
     if (s_calib_state != CalibState::IDLE) {
         if (now - s_calib_last_activity_us > k_calib_timeout_ms * 1000) {
             BS_LOG_ERROR("⏱️  Calibration timeout!");
-            if (xSemaphoreTake(s_state_lock, portMAX_DELAY) == pdTRUE) {
+            if (xSemaphoreTake(s_aux_lock, portMAX_DELAY) == pdTRUE) {
                 s_status_after_blink = s_status_before_calib;
                 s_status_led = {255, 0, 0, APP_LED_SOLID, 0};
                 s_restore_status_after_blink = true;
                 s_quick_blink_count = 3;
-                xSemaphoreGive(s_state_lock);
+                xSemaphoreGive(s_aux_lock);
             }
+            wake_task(s_led_task);
             s_calib_state = CalibState::IDLE;
             s_matter_blocked = false;
             return;
@@ -747,21 +3139,13 @@ void handle_calibration_events()
         case CalibState::IDLE:
             // Entry: Hold STOP for 2 seconds
             if (s_btn_stop_data.state == ButtonState::HELD) {
-                BS_LOG_STATE("🔧 ENTERING CALIBRATION MODE");
-                s_calib_state = CalibState::READY;
-                s_calib_last_activity_us = now;
-                s_matter_blocked = true;
-                if (xSemaphoreTake(s_state_lock, portMAX_DELAY) == pdTRUE) {
-                    s_status_before_calib = s_status_led;
-                    s_status_led = {255, 180, 0, APP_LED_BLINK, 600}; // yellow blink during calibration
-                    xSemaphoreGive(s_state_lock);
-                }
+                enter_calibration(now);
                 s_btn_stop_data.state = ButtonState::RELEASED;  // Reset to avoid re-trigger
             }
             break;
             
         case CalibState::READY:
-            if (up_pressed) {
+            if (up_pressed && !start_end_stop_seek(CalibState::HOMING, now)) {
                 BS_LOG_STATE("⬆️  Starting move to HOME position");
                 s_calib_state = CalibState::MOVING_TO_HOME;
                 s_calib_last_activity_us = now;
@@ -770,37 +3154,22 @@ void handle_calibration_events()
                 xSemaphoreTake(s_state_lock, portMAX_DELAY);
                 s_state.target_steps = 0;
                 s_state.target_percent100ths = 0;
+                s_state.stopped_early = false;
                 s_state.moving = true;
                 s_state.moving_dir = -1;  // UP = towards 0
                 xSemaphoreGive(s_state_lock);
+                wake_task(s_stepper_task);
             }
             break;
             
         case CalibState::MOVING_TO_HOME:
             if (stop_pressed) {
-                BS_LOG_STATE("✅ HOME position set!");
-                xSemaphoreTake(s_state_lock, portMAX_DELAY);
-                // Reset to absolute zero - this is home position
-                s_home_steps = 0;  // Home is always 0
-                s_state.current_steps = 0;
-                s_state.current_percent100ths = 0;
-                s_state.target_steps = 0;
-                s_state.target_percent100ths = 0;
-                s_state.moving = false;  // Stop motor
-                s_state.moving_dir = 0;
-                xSemaphoreGive(s_state_lock);
-                
-                s_calib_state = CalibState::HOME_SET;
-                s_calib_last_activity_us = now;
-                set_led_blink(5, 120);  // 5 quick blinks
-                
-                BS_LOG_STATE("💾 Saving home position (0) to NVS");
-                save_calibration_to_nvs();
+                set_home_here(now);
             }
             break;
             
         case CalibState::HOME_SET:
-            if (down_pressed) {
+            if (down_pressed && !start_end_stop_seek(CalibState::FINDING_BOTTOM, now)) {
                 BS_LOG_STATE("⬇️  Starting move to BOTTOM position");
                 s_calib_state = CalibState::MOVING_TO_BOTTOM;
                 s_calib_last_activity_us = now;
@@ -809,38 +3178,34 @@ void handle_calibration_events()
                 xSemaphoreTake(s_state_lock, portMAX_DELAY);
                 s_state.target_steps = 65535;  // Large value
                 s_state.target_percent100ths = k_percent_100ths_max;
+                s_state.stopped_early = false;
                 s_state.moving = true;
                 s_state.moving_dir = 1;  // DOWN = positive direction
                 xSemaphoreGive(s_state_lock);
+                wake_task(s_stepper_task);
             }
             break;
             
         case CalibState::MOVING_TO_BOTTOM:
             if (stop_pressed) {
-                xSemaphoreTake(s_state_lock, portMAX_DELAY);
-                uint16_t travel = s_state.current_steps;
-                s_state.moving = false;  // Stop motor
-                s_state.moving_dir = 0;
-                xSemaphoreGive(s_state_lock);
-                
-                if (travel < k_min_travel_steps) {
-                    BS_LOG_ERROR("❌ Travel too short (%u < %u steps)", travel, k_min_travel_steps);
-                    set_led_blink(10, 100);  // Error
-                    s_calib_state = CalibState::HOME_SET;  // Try again
-                } else if (travel > 20000) {
-                    BS_LOG_ERROR("❌ Travel too long (%u > 20000 steps) - motor may be stuck!", travel);
-                    set_led_blink(10, 100);  // Error
-                    s_calib_state = CalibState::HOME_SET;  // Try again
-                } else {
-                    BS_LOG_STATE("✅ BOTTOM position set! Travel: %u steps from home", travel);
-                    s_bottom_steps = travel;  // This is the total travel distance
-                    s_calib_state = CalibState::COMPLETE;
-                    s_calib_last_activity_us = now;
-                    set_led_blink(5, 120);  // 5 quick blinks
-                    
-                    BS_LOG_STATE("💾 Saving bottom position (%u) to NVS", travel);
-                    save_calibration_to_nvs();
-                }
+                set_bottom_here(now);
+            }
+            break;
+            
+        case CalibState::HOMING:
+        case CalibState::FINDING_BOTTOM:
+            s_calib_last_activity_us = now;
+            update_end_stop_seek(stop_pressed, now);
+            break;
+            
+        case CalibState::TUNING:
+            s_calib_last_activity_us = now;  // test moves keep it busy; no timeout
+            if (stop_pressed) {
+                abort_speed_tune();
+                s_calib_state = CalibState::COMPLETE;
+            } else if (speed_tune_step()) {
+                set_led_blink(5, 120);
+                s_calib_state = CalibState::COMPLETE;
             }
             break;
             
@@ -849,12 +3214,7 @@ void handle_calibration_events()
             if (stop_pressed) {
                 if (now - s_last_stop_press_us < k_double_press_ms * 1000) {
                     BS_LOG_STATE("🏁 CALIBRATION COMPLETE - Exiting");
-                    s_calib_state = CalibState::IDLE;
-                    s_matter_blocked = false;
-                    if (xSemaphoreTake(s_state_lock, portMAX_DELAY) == pdTRUE) {
-                        s_status_led = s_status_before_calib;
-                        xSemaphoreGive(s_state_lock);
-                    }
+                    exit_calibration();
                 } else {
                     s_last_stop_press_us = now;
                 }
@@ -863,6 +3223,15 @@ void handle_calibration_events()
     }
 }
 
+#if CONFIG_BS_POWER_SAVE
+bool buttons_released()
+{
+    return s_btn_up_data.state == ButtonState::RELEASED && s_btn_stop_data.state == ButtonState::RELEASED &&
+           s_btn_down_data.state == ButtonState::RELEASED && gpio_get_level(k_btn_up) != 0 &&
+           gpio_get_level(k_btn_stop) != 0 && gpio_get_level(k_btn_down) != 0;
+}
+#endif
+
 // === BUTTON TASK ===
 void button_task(void *arg)
 {
@@ -871,6 +3240,19 @@ void button_task(void *arg)
     
     while (true) {
         handle_calibration_events();
+#if CONFIG_BS_POWER_SAVE
+        bool calib_running = s_calib_state == CalibState::TUNING || s_calib_state == CalibState::HOMING ||
+                             s_calib_state == CalibState::FINDING_BOTTOM;
+        if (buttons_released() && !calib_running) {
+            // Re-arm the level wake interrupts, then block until a press or a Matter
+            // calibration request. Calibration still needs a slow tick for its timeout.
+            gpio_intr_enable(k_btn_up);
+            gpio_intr_enable(k_btn_stop);
+            gpio_intr_enable(k_btn_down);
+            ulTaskNotifyTake(pdTRUE, s_calib_state == CalibState::IDLE ? portMAX_DELAY : k_calib_idle_poll_ticks);
+            continue;
+        }
+#endif
         vTaskDelay(pdMS_TO_TICKS(20));
     }
 }
@@ -880,12 +3262,60 @@ void button_task(void *arg)
 esp_err_t app_driver_init(uint16_t endpoint_id)
 {
     s_endpoint_id = endpoint_id;
-    s_state_lock = xSemaphoreCreateMutex();
-    if (!s_state_lock) {
+    s_state_lock = xSemaphoreCreateMutexStatic(&s_state_lock_buffer);
+    s_aux_lock = xSemaphoreCreateMutexStatic(&s_aux_lock_buffer);
+    s_adc_lock = xSemaphoreCreateMutexStatic(&s_adc_lock_buffer);
+    if (!s_state_lock || !s_aux_lock || !s_adc_lock) {
         BS_LOG_ERROR("Failed to create motor state mutex");
         return ESP_ERR_NO_MEM;
     }
 
+#if CONFIG_BS_MOTOR_DC
+    gpio_config_t cfg = {};
+    cfg.pin_bit_mask = (1ULL << BS_PIN_DC_PHASE) | (1ULL << BS_PIN_DC_SLEEP);
+    cfg.mode = GPIO_MODE_OUTPUT;
+    esp_err_t err = gpio_config(&cfg);
+    if (err != ESP_OK) {
+        BS_LOG_ERROR("Failed to init motor GPIOs: %d", err);
+        return err;
+    }
+    gpio_set_level(BS_PIN_DC_SLEEP, 0);
+    gpio_set_level(BS_PIN_DC_PHASE, 1);
+
+    ledc_timer_config_t pwm_timer = {};
+    pwm_timer.speed_mode = k_dc_pwm_mode;
+    pwm_timer.duty_resolution = k_dc_pwm_bits;
+    pwm_timer.timer_num = k_dc_pwm_timer;
+    pwm_timer.freq_hz = k_dc_pwm_hz;
+    pwm_timer.clk_cfg = LEDC_AUTO_CLK;
+    err = ledc_timer_config(&pwm_timer);
+    ledc_channel_config_t pwm_channel = {};
+    pwm_channel.gpio_num = BS_PIN_DC_PWM;
+    pwm_channel.speed_mode = k_dc_pwm_mode;
+    pwm_channel.channel = k_dc_pwm_channel;
+    pwm_channel.timer_sel = k_dc_pwm_timer;
+    pwm_channel.duty = 0;
+    if (err == ESP_OK) {
+        err = ledc_channel_config(&pwm_channel);
+    }
+    if (err != ESP_OK) {
+        BS_LOG_ERROR("Failed to init motor PWM: %d", err);
+        return err;
+    }
+
+#if CONFIG_BS_DC_HALL
+    gpio_config_t hall_cfg = {};
+    hall_cfg.pin_bit_mask = (1ULL << BS_PIN_DC_HALL);
+    hall_cfg.mode = GPIO_MODE_INPUT;
+    hall_cfg.pull_up_en = GPIO_PULLUP_ENABLE; // open-collector hall output
+    hall_cfg.intr_type = GPIO_INTR_ANYEDGE;
+    err = gpio_config(&hall_cfg);
+    if (err != ESP_OK) {
+        BS_LOG_ERROR("Failed to init hall sensor GPIO: %d", err);
+        return err;
+    }
+#endif
+#else
     gpio_config_t cfg = {};
     cfg.pin_bit_mask = (1ULL << BS_PIN_STEP) | (1ULL << BS_PIN_DIR) | (1ULL << BS_PIN_EN);
     cfg.mode = GPIO_MODE_OUTPUT;
@@ -898,6 +3328,31 @@ esp_err_t app_driver_init(uint16_t endpoint_id)
     gpio_set_level(BS_PIN_STEP, 0);
     gpio_set_level(BS_PIN_DIR, 1);
     gpio_set_level(BS_PIN_EN, 1);
+#endif
+
+#if CONFIG_BS_MICROSTEP_SELECT
+    gpio_config_t ms_cfg = {};
+    ms_cfg.pin_bit_mask = (1ULL << BS_PIN_MS1) | (1ULL << BS_PIN_MS2) | (1ULL << BS_PIN_MS3);
+    ms_cfg.mode = GPIO_MODE_OUTPUT;
+    err = gpio_config(&ms_cfg);
+    if (err != ESP_OK) {
+        BS_LOG_ERROR("Failed to init microstep GPIOs: %d", err);
+        return err;
+    }
+    set_microstep_pins(1);
+#endif
+
+#if CONFIG_BS_DUAL_MOTOR
+    err = init_lockstep();
+    if (err != ESP_OK) {
+        return err;
+    }
+#endif
+
+    err = init_encoder();
+    if (err != ESP_OK) {
+        return err;
+    }
 
     gpio_config_t battery_cfg = {};
     battery_cfg.pin_bit_mask = (1ULL << k_battery_adc_gpio);
@@ -921,7 +3376,64 @@ esp_err_t app_driver_init(uint16_t endpoint_id)
         BS_LOG_ERROR("Failed to init button GPIOs: %d", err);
         return err;
     }
+
+#if CONFIG_BS_HOME_SWITCH
+    gpio_config_t switch_cfg = {};
+    switch_cfg.pin_bit_mask = (1ULL << BS_PIN_HOME_SWITCH);
+    switch_cfg.mode = GPIO_MODE_INPUT;
+    switch_cfg.pull_up_en = GPIO_PULLUP_ENABLE;
+    switch_cfg.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    err = gpio_config(&switch_cfg);
+    if (err != ESP_OK) {
+        BS_LOG_ERROR("Failed to init home switch GPIO: %d", err);
+        return err;
+    }
+#endif
+
+    // STOP also gets an edge interrupt so a press cuts the driver without waiting for
+    // the 20 ms button poll. The poll still sees the press for calibration.
+    err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        BS_LOG_ERROR("Failed to install GPIO ISR service: %d", err);
+        return err;
+    }
+#if CONFIG_BS_POWER_SAVE
+    // All three buttons wake the chip from light sleep. GPIO wakeup is level-only, so
+    // the interrupts run level-low and mask themselves until the button task re-arms them.
+    const gpio_num_t wake_buttons[] = {k_btn_up, k_btn_stop, k_btn_down};
+    for (gpio_num_t pin : wake_buttons) {
+        err = gpio_wakeup_enable(pin, GPIO_INTR_LOW_LEVEL);
+        if (err != ESP_OK) {
+            BS_LOG_ERROR("Failed to enable wakeup on GPIO%u: %d", static_cast<unsigned>(pin), err);
+            return err;
+        }
+    }
+    err = esp_sleep_enable_gpio_wakeup();
+    if (err != ESP_OK) {
+        BS_LOG_ERROR("Failed to enable GPIO wakeup: %d", err);
+        return err;
+    }
+    gpio_isr_handler_add(k_btn_up, button_wake_isr, reinterpret_cast<void *>(static_cast<uintptr_t>(k_btn_up)));
+    gpio_isr_handler_add(k_btn_down, button_wake_isr, reinterpret_cast<void *>(static_cast<uintptr_t>(k_btn_down)));
+#else
+    gpio_set_intr_type(k_btn_stop, GPIO_INTR_NEGEDGE);
+#endif
+    err = gpio_isr_handler_add(k_btn_stop, stop_button_isr, nullptr);
+    if (err != ESP_OK) {
+        BS_LOG_ERROR("Failed to attach STOP button ISR: %d", err);
+        return err;
+    }
+#if CONFIG_BS_DC_HALL
+    err = gpio_isr_handler_add(BS_PIN_DC_HALL, hall_isr, nullptr);
+    if (err != ESP_OK) {
+        BS_LOG_ERROR("Failed to attach hall sensor ISR: %d", err);
+        return err;
+    }
+#endif
+    // gpio_config() above left the pin interrupts disabled.
+    gpio_intr_enable(k_btn_stop);
     
+#if CONFIG_BS_STATUS_LED_WS2812
     const rmt_channel_t ws2812_channels[] = {
         RMT_CHANNEL_0, RMT_CHANNEL_1, RMT_CHANNEL_2, RMT_CHANNEL_3
     };
@@ -929,6 +3441,7 @@ esp_err_t app_driver_init(uint16_t endpoint_id)
     err = ESP_FAIL;
     for (rmt_channel_t channel : ws2812_channels) {
         rmt_config_t rmt_tx_config = RMT_DEFAULT_CONFIG_TX(k_led_calib, channel);
+        rmt_tx_config.clk_div = k_ws2812_clk_div;
         esp_err_t channel_err = rmt_config(&rmt_tx_config);
         if (channel_err != ESP_OK) {
             BS_LOG_WARN("WS2812 RMT cfg failed on ch%d: %d", static_cast<int>(channel), channel_err);
@@ -941,21 +3454,36 @@ esp_err_t app_driver_init(uint16_t endpoint_id)
             continue;
         }
 
-        led_strip_config_t strip_config = LED_STRIP_DEFAULT_CONFIG(1, (led_strip_dev_t)channel);
-        s_led_strip = led_strip_new_rmt_ws2812(&strip_config);
-        if (s_led_strip != nullptr) {
+        uint32_t counter_clk_hz = 0;
+        channel_err = rmt_get_counter_clock(channel, &counter_clk_hz);
+        if (channel_err == ESP_OK && counter_clk_hz > 0) {
+            s_ws2812_bit0 = {};
+            s_ws2812_bit0.level0 = 1;
+            s_ws2812_bit0.duration0 = ws2812_ticks(counter_clk_hz, k_ws2812_t0h_ns);
+            s_ws2812_bit0.level1 = 0;
+            s_ws2812_bit0.duration1 = ws2812_ticks(counter_clk_hz, k_ws2812_t0l_ns);
+            s_ws2812_bit1 = {};
+            s_ws2812_bit1.level0 = 1;
+            s_ws2812_bit1.duration0 = ws2812_ticks(counter_clk_hz, k_ws2812_t1h_ns);
+            s_ws2812_bit1.level1 = 0;
+            s_ws2812_bit1.duration1 = ws2812_ticks(counter_clk_hz, k_ws2812_t1l_ns);
+            s_ws2812_channel = channel;
+            s_ws2812_ready = true;
             err = ESP_OK;
             BS_LOG_MOTOR("WS2812 using RMT channel %d", static_cast<int>(channel));
             break;
         }
 
         rmt_driver_uninstall(channel);
-        BS_LOG_WARN("WS2812 driver alloc failed on ch%d", static_cast<int>(channel));
+        BS_LOG_WARN("WS2812 RMT clock query failed on ch%d: %d", static_cast<int>(channel), channel_err);
     }
+#else
+    err = ESP_ERR_NOT_SUPPORTED;  // WS2812 support compiled out (CONFIG_BS_STATUS_LED_WS2812)
+#endif
 
-    if (err == ESP_OK && s_led_strip != nullptr) {
+    if (err == ESP_OK && s_ws2812_ready) {
         BS_LOG_MOTOR("WS2812 init OK on GPIO%u", static_cast<unsigned>(k_led_calib));
-      ]  for (int i = 0; i < 6; i++) {
+        for (int i = 0; i < 6; i++) {
             set_calib_led_rgb(255, 0, 0); vTaskDelay(pdMS_TO_TICKS(300));
             set_calib_led_rgb(0, 255, 0); vTaskDelay(pdMS_TO_TICKS(300));
             set_calib_led_rgb(0, 0, 255); vTaskDelay(pdMS_TO_TICKS(300));
@@ -963,7 +3491,7 @@ esp_err_t app_driver_init(uint16_t endpoint_id)
         set_calib_led(false);
     } else {
         BS_LOG_WARN("WS2812 init failed (%d), fallback to GPIO LED output", err);
-        s_led_strip = nullptr;
+        s_ws2812_ready = false;
 
         gpio_config_t led_cfg = {};
         led_cfg.pin_bit_mask = (1ULL << k_led_calib);
@@ -981,9 +3509,18 @@ esp_err_t app_driver_init(uint16_t endpoint_id)
                  static_cast<unsigned>(k_btn_stop),
                  static_cast<unsigned>(k_btn_down),
                  static_cast<unsigned>(k_led_calib));
+#if CONFIG_BS_HOME_SWITCH
+    BS_LOG_MOTOR("Homing: top end-stop switch on GPIO%u, bottom by %s", static_cast<unsigned>(BS_PIN_HOME_SWITCH),
+                 k_bottom_seek_available ? "encoder stall" : "STOP");
+#else
+    BS_LOG_MOTOR("Homing: top by %s, bottom by %s", k_home_seek_available ? "encoder stall" : "STOP",
+                 k_bottom_seek_available ? "encoder stall" : "STOP");
+#endif
 
     // Load calibration from NVS
+    load_params_from_nvs(); // before the calibration: a saved profile is checked against them
     load_calibration_from_nvs();
+    load_motion_profile_from_nvs();
 
     s_state.current_percent100ths = 0;
     s_state.target_percent100ths = 0;
@@ -991,6 +3528,8 @@ esp_err_t app_driver_init(uint16_t endpoint_id)
     s_state.target_steps = 0;
     s_state.moving_dir = 0;
     s_state.moving = false;
+    s_state.stopped_early = false;
+    restore_cutoff_position();
     s_battery_state.voltage_mv = 0;
     s_battery_state.percent = 0;
     s_battery_state.valid = false;
@@ -1001,82 +3540,112 @@ esp_err_t app_driver_init(uint16_t endpoint_id)
     }
 
     // Start LED task
-    BaseType_t ok = xTaskCreate(led_task, "calib_led", 3072, nullptr, 1, &s_led_task);
-    if (ok != pdPASS) {
+    s_led_task = xTaskCreateStaticPinnedToCore(led_task, "calib_led", k_led_task_stack, nullptr, 1, s_led_task_stack,
+                                               &s_led_task_tcb, k_driver_core);
+    if (!s_led_task) {
         BS_LOG_ERROR("Failed to start LED task");
-        return ESP_ERR_NO_MEM;
+        return ESP_FAIL;
     }
 
     // Start button calibration task
-    ok = xTaskCreate(button_task, "calib_btn", 4096, nullptr, 3, &s_button_task);
-    if (ok != pdPASS) {
+    s_button_task = xTaskCreateStaticPinnedToCore(button_task, "calib_btn", k_button_task_stack, nullptr, 3,
+                                                  s_button_task_stack, &s_button_task_tcb, k_driver_core);
+    if (!s_button_task) {
         BS_LOG_ERROR("Failed to start button task");
-        return ESP_ERR_NO_MEM;
+        return ESP_FAIL;
     }
 
-    ok = xTaskCreate(stepper_task, "wc_stepper", 4096, nullptr, 2, &s_stepper_task);
-    if (ok != pdPASS) {
+    s_stepper_task = xTaskCreateStaticPinnedToCore(stepper_task, "wc_stepper", k_stepper_task_stack, nullptr,
+                                                   k_stepper_priority, s_stepper_task_stack, &s_stepper_task_tcb,
+                                                   k_driver_core);
+    if (!s_stepper_task) {
         BS_LOG_ERROR("Failed to start stepper task");
-        return ESP_ERR_NO_MEM;
+        return ESP_FAIL;
     }
 
-    ok = xTaskCreate(update_task, "wc_update", 4096, nullptr, 1, &s_update_task);
-    if (ok != pdPASS) {
+    s_update_task = xTaskCreateStaticPinnedToCore(update_task, "wc_update", k_update_task_stack, nullptr, 1,
+                                                  s_update_task_stack, &s_update_task_tcb, k_driver_core);
+    if (!s_update_task) {
         BS_LOG_ERROR("Failed to start update task");
-        return ESP_ERR_NO_MEM;
+        return ESP_FAIL;
     }
 
-    ok = xTaskCreate(battery_task, "battery_adc", 3072, nullptr, 1, &s_battery_task);
-    if (ok != pdPASS) {
+    s_battery_task = xTaskCreateStaticPinnedToCore(battery_task, "battery_adc", k_battery_task_stack, nullptr,
+                                                   k_battery_task_priority,
+                                                   s_battery_task_stack, &s_battery_task_tcb, k_driver_core);
+    if (!s_battery_task) {
         BS_LOG_ERROR("Failed to start battery task");
-        return ESP_ERR_NO_MEM;
+        return ESP_FAIL;
     }
 
+#if CONFIG_BS_DRIVER_HEAP_GUARD
+    s_heap_guard_armed.store(true);
+    BS_LOG_MOTOR("Heap guard armed: driver tasks abort on heap allocation");
+#endif
+
+#if CONFIG_BS_MOTOR_DC
+    BS_LOG_MOTOR("Pins: PWM=GPIO%u PH=GPIO%u nSLEEP=GPIO%u, %s", static_cast<unsigned>(BS_PIN_DC_PWM),
+                 static_cast<unsigned>(BS_PIN_DC_PHASE), static_cast<unsigned>(BS_PIN_DC_SLEEP),
+                 k_dc_hall ? "hall edges as steps" : "timed steps, no hall sensor");
+#if CONFIG_BS_DC_HALL
+    BS_LOG_MOTOR("Hall sensor: GPIO%u", static_cast<unsigned>(BS_PIN_DC_HALL));
+#endif
+#else
     BS_LOG_MOTOR("Pins: STEP=GPIO%u DIR=GPIO%u EN=GPIO%u (EN active LOW)",
                  static_cast<unsigned>(BS_PIN_STEP),
                  static_cast<unsigned>(BS_PIN_DIR),
                  static_cast<unsigned>(BS_PIN_EN));
-    BS_LOG_MOTOR("Stepper: max_steps=%u, pulse=%uus, delay=%uus, start_delay=%uus, ramp_steps=%u",
-                 k_max_steps, k_step_pulse_us, k_step_delay_us, k_step_delay_start_us, k_step_ramp_steps);
+#endif
+    BS_LOG_MOTOR("Motor (%s): max_steps=%u, pulse=%uus, delay=%uus, start_delay=%uus, ramp_steps=%u%s",
+                 motor_backend_t::k_name, k_max_steps, k_step_pulse_us, s_step_profile.cruise_delay_us,
+                 s_step_profile.start_delay_us, s_step_profile.ramp_steps,
+                 s_step_profile.cruise_delay_us != param(APP_PARAM_CRUISE_US) ? " (tuned)" : "");
+    if (k_driver_core == tskNO_AFFINITY) {
+        BS_LOG_MOTOR("Driver tasks unpinned, step generator priority %u", static_cast<unsigned>(k_stepper_priority));
+    } else {
+        BS_LOG_MOTOR("Driver tasks pinned to core %d, step generator priority %u", static_cast<int>(k_driver_core),
+                     static_cast<unsigned>(k_stepper_priority));
+    }
+    app_driver_dump_motion_profiles();
 
     return ESP_OK;
 }
 
 void app_driver_set_target_percent100ths(uint16_t endpoint_id, uint16_t target_percent100ths)
+{
+    app_driver_set_target_timed(endpoint_id, target_percent100ths, 0);
+}
+
+void app_driver_set_target_timed(uint16_t endpoint_id, uint16_t target_percent100ths, uint32_t transition_ms)
 {
     if (endpoint_id != s_endpoint_id || !s_state_lock) {
         return;
     }
+    app_trace_record(bs_trace_event_t::k_target, clamp_percent100ths(target_percent100ths), 0);
     
     // Block Matter commands during calibration
     if (s_matter_blocked) {
+        s_command_queue.note_rejected();
         BS_LOG_STATE("⚠️  Matter command BLOCKED - calibration in progress");
         return;
     }
-    
-    if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE) {
+#if CONFIG_BS_UNDERVOLTAGE_CUTOFF
+    if (s_undervoltage_tripped.load()) {
+        s_command_queue.note_rejected();
+        BS_LOG_WARN("Target %u refused: battery undervoltage cutoff", static_cast<unsigned>(target_percent100ths));
         return;
     }
+#endif
 
-    uint16_t target = clamp_percent100ths(target_percent100ths);
-    uint16_t target_steps = steps_from_percent100ths(target);
-    s_state.target_percent100ths = target;
-    s_state.target_steps = target_steps;
-
-    int32_t diff = static_cast<int32_t>(target_steps) - static_cast<int32_t>(s_state.current_steps);
-    if (diff == 0) {
-        s_state.moving = false;
-        s_state.moving_dir = 0;
-    } else {
-        s_state.moving = true;
-        s_state.moving_dir = (diff > 0) ? 1 : -1;
+    // Never blocks on s_state_lock: the step generator drains the queue between steps.
+    // The stamp feeds the command latency benchmark; 0 is reserved for "unstamped".
+    uint32_t seq = s_command_queue.push_go_to(clamp_percent100ths(target_percent100ths),
+                                              static_cast<uint32_t>(esp_timer_get_time()) | 1U, transition_ms);
+    if (seq == 0) {
+        BS_LOG_WARN("Command queue full, target %u dropped", static_cast<unsigned>(target_percent100ths));
+        return;
     }
-
-    BS_LOG_STATE("Target set -> %u.%02u%% (%u steps)",
-                 static_cast<unsigned>(target / 100), static_cast<unsigned>(target % 100),
-                 static_cast<unsigned>(target_steps));
-
-    xSemaphoreGive(s_state_lock);
+    wake_task(s_stepper_task);
 }
 
 void app_driver_stop(uint16_t endpoint_id)
@@ -1084,74 +3653,540 @@ void app_driver_stop(uint16_t endpoint_id)
     if (endpoint_id != s_endpoint_id || !s_state_lock) {
         return;
     }
+    app_trace_record(bs_trace_event_t::k_stop, 0, 0);
     
     // Block Matter commands during calibration
     if (s_matter_blocked) {
+        s_command_queue.note_rejected();
         BS_LOG_STATE("⚠️  Matter STOP command BLOCKED - calibration in progress");
         return;
     }
-    
-    if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE) {
-        return;
-    }
 
-    s_state.moving = false;
-    s_state.moving_dir = 0;
-    s_state.target_percent100ths = s_state.current_percent100ths;
-    s_state.target_steps = s_state.current_steps;
-    gpio_set_level(BS_PIN_EN, 1);
+    // Cut the driver first; the step generator settles position and state.
+    halt_driver();
+    s_command_queue.push_stop();
+    wake_task(s_stepper_task);
+}
+
+void app_driver_set_activity_cb(app_driver_activity_cb_t cb)
+{
+    s_activity_cb.store(cb);
+}
 
-    BS_LOG_STATE("Stopped at %u.%02u%% (%u steps)",
-                 static_cast<unsigned>(s_state.current_percent100ths / 100),
-                 static_cast<unsigned>(s_state.current_percent100ths % 100),
-                 static_cast<unsigned>(s_state.current_steps));
+void app_driver_set_battery_cb(app_driver_battery_cb_t cb)
+{
+    s_battery_cb.store(cb);
+}
 
-    xSemaphoreGive(s_state_lock);
+esp_err_t app_driver_get_command_stats(app_command_stats_t *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    bs_command_queue_stats_t queue_stats = s_command_queue.stats();
+    stats->submitted = queue_stats.submitted;
+    stats->applied = queue_stats.applied;
+    stats->coalesced = queue_stats.coalesced;
+    stats->rejected = queue_stats.rejected;
+    stats->stops = queue_stats.stops;
+    return ESP_OK;
 }
 
 esp_err_t app_driver_get_battery_status(app_battery_status_t *status)
 {
-    if (!status || !s_state_lock) {
+    if (!status || !s_aux_lock) {
         return ESP_ERR_INVALID_ARG;
     }
-    if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE) {
+    if (xSemaphoreTake(s_aux_lock, portMAX_DELAY) != pdTRUE) {
         return ESP_ERR_TIMEOUT;
     }
 
     status->voltage_mv = s_battery_state.voltage_mv;
     status->percent = s_battery_state.percent;
     status->valid = s_battery_state.valid;
+    xSemaphoreGive(s_aux_lock);
+
+#if CONFIG_BS_UNDERVOLTAGE_CUTOFF
+    portENTER_CRITICAL(&s_undervoltage_mux);
+    status->undervoltage = s_undervoltage.tripped();
+    status->cutoff_trip_mv = s_undervoltage.trip_mv();
+    status->cutoff_trips = s_undervoltage.trips();
+    portEXIT_CRITICAL(&s_undervoltage_mux);
+#else
+    status->undervoltage = false;
+    status->cutoff_trip_mv = 0;
+    status->cutoff_trips = 0;
+#endif
+    return ESP_OK;
+}
 
+esp_err_t app_driver_get_stop_stats(app_stop_stats_t *stats)
+{
+    if (!stats || !s_state_lock) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    *stats = s_stop_stats;
     xSemaphoreGive(s_state_lock);
     return ESP_OK;
 }
 
 esp_err_t app_driver_set_status_led(const app_led_pattern_t *pattern)
 {
-    if (!pattern || !s_state_lock) {
+    if (!pattern || !s_aux_lock) {
         return ESP_ERR_INVALID_ARG;
     }
-    if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE) {
+    if (xSemaphoreTake(s_aux_lock, portMAX_DELAY) != pdTRUE) {
         return ESP_ERR_TIMEOUT;
     }
     s_status_led = *pattern;
-    xSemaphoreGive(s_state_lock);
+    xSemaphoreGive(s_aux_lock);
+    wake_task(s_led_task);
     return ESP_OK;
 }
 
 esp_err_t app_driver_signal_quick_blink(uint8_t count)
 {
-    if (!s_state_lock) {
+    if (!s_aux_lock) {
         return ESP_ERR_INVALID_STATE;
     }
-    if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE) {
+    if (xSemaphoreTake(s_aux_lock, portMAX_DELAY) != pdTRUE) {
         return ESP_ERR_TIMEOUT;
     }
     s_quick_blink_count = count;
+    xSemaphoreGive(s_aux_lock);
+    wake_task(s_led_task);
+    return ESP_OK;
+}
+
+esp_err_t app_driver_get_motion_bench(app_motion_bench_t *bench)
+{
+    if (!bench) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&s_bench_mux);
+    *bench = s_bench;
+    bench->command_latency_avg_us =
+        s_bench.commands ? static_cast<uint32_t>(s_bench_latency_sum_us / s_bench.commands) : 0;
+    portEXIT_CRITICAL(&s_bench_mux);
+    bench->motion_core = (k_driver_core == tskNO_AFFINITY) ? -1 : static_cast<int8_t>(k_driver_core);
+    bench->reports_dropped = s_report_ring.dropped();
+    return ESP_OK;
+}
+
+void app_driver_reset_motion_bench()
+{
+    portENTER_CRITICAL(&s_bench_mux);
+    s_bench = {};
+    s_bench_latency_sum_us = 0;
+    portEXIT_CRITICAL(&s_bench_mux);
+}
+
+esp_err_t app_driver_get_encoder_stats(app_encoder_stats_t *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if CONFIG_BS_ENCODER
+    if (!s_state_lock || xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    stats->moves_checked = s_encoder.moves_checked();
+    stats->drift_corrections = s_encoder.drift_corrections();
+    stats->stalls = s_encoder.stalls();
+    stats->max_error_steps = s_encoder.max_error_steps();
+    stats->measured_steps = s_encoder.steps_from_count(encoder_count());
+    stats->commanded_steps = s_state.current_steps;
+    xSemaphoreGive(s_state_lock);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t app_driver_get_load_stats(app_load_stats_t *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if CONFIG_BS_CURRENT_SENSE
+    if (!s_state_lock || xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    stats->obstructions = s_load_obstructions;
+    stats->end_stops = s_load_end_stops;
+    xSemaphoreGive(s_state_lock);
+    stats->current_ma = s_motor_current_ma.load();
+    portENTER_CRITICAL(&s_load_mux);
+    stats->running_ma = s_load.baseline_ma();
+    stats->peak_ma = s_load.peak_ma();
+    stats->trip_ma = s_load.trip_ma();
+    portEXIT_CRITICAL(&s_load_mux);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t app_driver_set_param(app_param_t id, uint16_t value)
+{
+    if (id >= APP_PARAM_COUNT || !bs_param_valid(k_params[id], value)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_state_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (param(id) == value) {
+        return ESP_OK; // the attribute reading back what the driver reported
+    }
+
+    const bs_param_def_t &def = k_params[id];
+    bool step_profile = id == APP_PARAM_CRUISE_US || id == APP_PARAM_START_US || id == APP_PARAM_RAMP_STEPS;
+    if (step_profile) {
+        // A new baseline replaces the running profile, tuned or not: the step generator
+        // ramps onto it from the next step. Saved with the calibration so the two agree.
+        if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE) {
+            return ESP_FAIL;
+        }
+        if (s_calib_state != CalibState::IDLE) {
+            xSemaphoreGive(s_state_lock);
+            BS_LOG_WARN("Step profile parameters are locked during calibration");
+            return ESP_ERR_INVALID_STATE;
+        }
+        s_params[id].store(value);
+        s_step_profile = baseline_step_profile();
+        xSemaphoreGive(s_state_lock);
+    } else {
+        s_params[id].store(value);
+    }
+    // The parameter first: a reboot before the profile lands leaves a profile that no
+    // longer fits the new baseline, which the next boot replaces with the baseline.
+    save_param_to_nvs(id, value);
+    if (step_profile) {
+        save_calibration_to_nvs();
+    }
+    BS_LOG_STATE("⚙️  %s = %u %s%s", def.key, value, def.unit,
+                 step_profile ? " (step profile reset to the baseline; recalibrate to tune)" : "");
+    return ESP_OK;
+}
+
+esp_err_t app_driver_reset_param(app_param_t id)
+{
+    if (id < APP_PARAM_COUNT) {
+        return app_driver_set_param(id, k_params[id].default_value);
+    }
+    esp_err_t result = ESP_OK;
+    for (uint8_t i = 0; i < APP_PARAM_COUNT; ++i) {
+        esp_err_t err = app_driver_set_param(static_cast<app_param_t>(i), k_params[i].default_value);
+        if (result == ESP_OK) {
+            result = err;
+        }
+    }
+    return result;
+}
+
+esp_err_t app_driver_get_param_info(app_param_t id, app_param_info_t *info)
+{
+    if (id >= APP_PARAM_COUNT || !info) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const bs_param_def_t &def = k_params[id];
+    info->key = def.key;
+    info->unit = def.unit;
+    info->value = s_state_lock ? param(id) : def.default_value;
+    info->default_value = def.default_value;
+    info->min_value = def.min_value;
+    info->max_value = def.max_value;
+    return ESP_OK;
+}
+
+app_param_t app_driver_find_param(const char *key)
+{
+    return static_cast<app_param_t>(bs_param_find(k_params, APP_PARAM_COUNT, key));
+}
+
+esp_err_t app_driver_get_state(app_driver_state_t *state)
+{
+    if (!state) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_state_lock || xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    read_state_locked(state);
+    xSemaphoreGive(s_state_lock);
+    return ESP_OK;
+}
+
+esp_err_t app_driver_get_move_summary(bs_move_summary_t *summary)
+{
+    if (!summary) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if CONFIG_BS_MOVE_LOG
+    portENTER_CRITICAL(&s_move_log_mux);
+    *summary = s_move_log.summary();
+    portEXIT_CRITICAL(&s_move_log_mux);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t app_driver_get_move_record(uint16_t index, bs_move_record_t *record)
+{
+    if (!record) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if CONFIG_BS_MOVE_LOG
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    portENTER_CRITICAL(&s_move_log_mux);
+    if (index < s_move_log.size()) {
+        *record = s_move_log.newest(index);
+        err = ESP_OK;
+    }
+    portEXIT_CRITICAL(&s_move_log_mux);
+    return err;
+#else
+    (void)index;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void app_driver_clear_move_log()
+{
+#if CONFIG_BS_MOVE_LOG
+    portENTER_CRITICAL(&s_move_log_mux);
+    s_move_log.clear();
+    portEXIT_CRITICAL(&s_move_log_mux);
+#endif
+}
+
+void app_driver_dump_moves()
+{
+    bs_move_summary_t summary = {};
+    if (app_driver_get_move_summary(&summary) != ESP_OK) {
+        BS_LOG_WARN("Move log not built in (CONFIG_BS_MOVE_LOG)");
+        return;
+    }
+    BS_LOG_STATE("Moves (newest first): end s, from -> to (%% or calibration steps), steps, ms, ramp ms, "
+                 "peak steps/s, lock wait us, reports, battery start/min mV, profile, flags");
+    bs_move_record_t r = {};
+    for (uint16_t i = 0; app_driver_get_move_record(i, &r) == ESP_OK; ++i) {
+        char from[12];
+        char to[12];
+        format_move_position(from, sizeof(from), r.start_position, (r.flags & BS_MOVE_CALIBRATION) != 0);
+        format_move_position(to, sizeof(to), r.end_position, (r.flags & BS_MOVE_CALIBRATION) != 0);
+        BS_LOG_STATE("  %6u %8s -> %8s %5u %6u %5u %4u %6u %3u %5u/%5u %s%s%s%s",
+                     static_cast<unsigned>(r.end_time_s), from, to, static_cast<unsigned>(r.steps),
+                     static_cast<unsigned>(r.duration_us / 1000), static_cast<unsigned>(r.ramp_us / 1000),
+                     static_cast<unsigned>(r.peak_steps_per_s), static_cast<unsigned>(r.lock_wait_us),
+                     static_cast<unsigned>(r.reports), static_cast<unsigned>(r.battery_start_mv),
+                     static_cast<unsigned>(r.battery_min_mv),
+                     r.profile < APP_MOTION_PROFILE_COUNT ? k_motion_profiles[r.profile].name : "?",
+                     (r.flags & BS_MOVE_STOPPED_EARLY) ? " stopped" : "", (r.flags & BS_MOVE_SYNC) ? " sync" : "",
+                     (r.flags & BS_MOVE_CALIBRATION) ? " calibration" : "");
+    }
+    int32_t trend = summary.us_per_step_trend_permille;
+    uint32_t trend_abs = static_cast<uint32_t>(trend < 0 ? -trend : trend);
+    BS_LOG_STATE("Summary: %u moves, window %u: %u us/step (trend %c%u.%u%%), battery sag %u mV (trend %+d mV), "
+                 "peak %u steps/s, %u stopped early, lock wait max %u us",
+                 static_cast<unsigned>(summary.moves), static_cast<unsigned>(summary.window),
+                 static_cast<unsigned>(summary.us_per_step), trend < 0 ? '-' : '+',
+                 static_cast<unsigned>(trend_abs / 10), static_cast<unsigned>(trend_abs % 10),
+                 static_cast<unsigned>(summary.sag_mv), static_cast<int>(summary.sag_trend_mv),
+                 static_cast<unsigned>(summary.peak_steps_per_s), static_cast<unsigned>(summary.stopped_early),
+                 static_cast<unsigned>(summary.lock_wait_max_us));
+}
+
+#if CONFIG_ENABLE_CHIP_SHELL && CONFIG_BS_MOVE_LOG
+static esp_err_t moves_command_handler(int argc, char **argv)
+{
+    if (argc >= 1 && strcmp(argv[0], "clear") == 0) {
+        app_driver_clear_move_log();
+        BS_LOG_APP("moves: cleared");
+        return ESP_OK;
+    }
+    if (argc >= 1 && strcmp(argv[0], "dump") != 0) {
+        BS_LOG_WARN("usage: moves [dump|clear]");
+        return ESP_ERR_INVALID_ARG;
+    }
+    app_driver_dump_moves();
+    return ESP_OK;
+}
+#endif
+
+esp_err_t app_driver_register_commands()
+{
+#if CONFIG_ENABLE_CHIP_SHELL && CONFIG_BS_MOVE_LOG
+    static const esp_matter::console::command_t command = {
+        .name = "moves",
+        .description = "Per-move telemetry and rolling figures. Usage: matter moves [dump|clear]",
+        .handler = moves_command_handler,
+    };
+    return esp_matter::console::add_commands(&command, 1);
+#else
+    return ESP_OK;
+#endif
+}
+
+esp_err_t app_driver_set_motor2_trim(int16_t steps)
+{
+#if CONFIG_BS_DUAL_MOTOR
+    if (!s_stepper_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_motor2_trim_target.store(steps);
+    wake_task(s_stepper_task);
+    return ESP_OK;
+#else
+    (void)steps;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t app_driver_get_lockstep_stats(app_lockstep_stats_t *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if CONFIG_BS_DUAL_MOTOR
+    portENTER_CRITICAL(&s_step_mux);
+    *stats = s_lockstep;
+    int16_t trim = s_motor2_trim.load();
+    stats->step_error = s_lockstep_net_b - s_lockstep_net_a - trim;
+    portEXIT_CRITICAL(&s_step_mux);
+    stats->trim_steps = trim;
+    stats->trim_target_steps = s_motor2_trim_target.load();
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t app_driver_set_calibration_mode(bool enabled)
+{
+    if (!s_state_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (enabled) {
+        post_calibration_request(CalibRequest::ENTER, CalibRequest::EXIT);
+    } else {
+        post_calibration_request(CalibRequest::EXIT, CalibRequest::ENTER);
+    }
+    return ESP_OK;
+}
+
+esp_err_t app_driver_calibration_command(app_calibration_command_t command)
+{
+    if (!s_state_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    switch (command) {
+    case APP_CALIBRATION_HOME:
+        post_calibration_request(CalibRequest::HOME, CalibRequest::BOTTOM);
+        return ESP_OK;
+    case APP_CALIBRATION_BOTTOM:
+        post_calibration_request(CalibRequest::BOTTOM, CalibRequest::HOME);
+        return ESP_OK;
+    default:
+        return ESP_ERR_INVALID_ARG;
+    }
+}
+
+esp_err_t app_driver_set_motion_profile(app_motion_profile_t profile)
+{
+    if (profile >= APP_MOTION_PROFILE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // The step generator picks it up before its next step, mid-move or not.
+    uint8_t previous = s_motion_profile.exchange(static_cast<uint8_t>(profile));
+    if (previous == profile) {
+        return ESP_OK;
+    }
+    save_motion_setting_to_nvs("profile", static_cast<uint16_t>(profile));
+    BS_LOG_STATE("Motion profile: %s -> %s", k_motion_profiles[previous].name, k_motion_profiles[profile].name);
+    return ESP_OK;
+}
+
+app_motion_profile_t app_driver_get_motion_profile()
+{
+    return static_cast<app_motion_profile_t>(s_motion_profile.load());
+}
+
+esp_err_t app_driver_set_sync_travel_time(uint16_t full_travel_ds)
+{
+    // Applies from the next target on; a move already running keeps its plan.
+    uint16_t previous = s_sync_travel_ds.exchange(full_travel_ds);
+    if (previous == full_travel_ds) {
+        return ESP_OK;
+    }
+    save_motion_setting_to_nvs("sync_ds", full_travel_ds);
+    if (full_travel_ds == 0) {
+        BS_LOG_STATE("Synchronized moves off");
+    } else {
+        BS_LOG_STATE("Synchronized moves: full travel in %u.%u s", static_cast<unsigned>(full_travel_ds / 10),
+                     static_cast<unsigned>(full_travel_ds % 10));
+    }
+    return ESP_OK;
+}
+
+uint16_t app_driver_get_sync_travel_time()
+{
+    return s_sync_travel_ds.load();
+}
+
+esp_err_t app_driver_get_motion_profile_info(app_motion_profile_t profile, app_motion_profile_info_t *info)
+{
+    if (!info || profile >= APP_MOTION_PROFILE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_state_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE) {
+        return ESP_FAIL;
+    }
+    bs_step_profile_t base = s_step_profile;
+    uint16_t travel = s_bottom_steps;
     xSemaphoreGive(s_state_lock);
+
+    const bs_motion_profile_t &motion = k_motion_profiles[profile];
+    bs_step_profile_t step = bs_motion_profile_apply(motion, base);
+    info->name = motion.name;
+    info->cruise_delay_us = step.cruise_delay_us;
+    info->start_delay_us = step.start_delay_us;
+    info->ramp_steps = step.ramp_steps;
+    info->microsteps = motion_microsteps(profile);
+    uint64_t travel_us = bs_move_duration_us(step, info->microsteps, k_step_pulse_us, travel);
+    // The step generator also yields for a tick every APP_PARAM_YIELD_STEPS steps.
+    travel_us += static_cast<uint64_t>(travel / param(APP_PARAM_YIELD_STEPS)) * portTICK_PERIOD_MS * 1000;
+    info->full_travel_ms = static_cast<uint32_t>(travel_us / 1000);
     return ESP_OK;
 }
 
+void app_driver_dump_motion_profiles()
+{
+    app_motion_profile_t active = app_driver_get_motion_profile();
+    for (uint8_t i = 0; i < APP_MOTION_PROFILE_COUNT; ++i) {
+        app_motion_profile_info_t info = {};
+        if (app_driver_get_motion_profile_info(static_cast<app_motion_profile_t>(i), &info) != ESP_OK) {
+            return;
+        }
+        BS_LOG_STATE("%s Motion profile %-5s: cruise %uus, start %uus, ramp %u steps, 1/%u step, full travel %u.%01us",
+                     i == active ? "*" : " ", info.name, info.cruise_delay_us, info.start_delay_us, info.ramp_steps,
+                     info.microsteps, static_cast<unsigned>(info.full_travel_ms / 1000),
+                     static_cast<unsigned>((info.full_travel_ms % 1000) / 100));
+    }
+    uint16_t sync_ds = app_driver_get_sync_travel_time();
+    if (sync_ds != 0) {
+        BS_LOG_STATE("  Synchronized moves: full travel in %u.%us", static_cast<unsigned>(sync_ds / 10),
+                     static_cast<unsigned>(sync_ds % 10));
+    }
+}
+
 bool app_driver_is_calibrating()
 {
     if (!s_state_lock) {
@@ -1164,3 +4199,24 @@ bool app_driver_is_calibrating()
     xSemaphoreGive(s_state_lock);
     return calibrating;
 }
+
+#if CONFIG_BS_DRIVER_HEAP_GUARD
+// Heap hook (CONFIG_HEAP_USE_HOOKS): once init is done, any allocation made on a
+// driver task is a bug. Print with the ROM printf (no heap, no locks) and abort so
+// the backtrace points at the offending call.
+extern "C" void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps)
+{
+    (void)ptr;
+    if (!s_heap_guard_armed.load(std::memory_order_relaxed) || xPortInIsrContext() || s_heap_guard_exempt != 0) {
+        return;
+    }
+
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    if (self == s_stepper_task || self == s_update_task || self == s_battery_task || self == s_button_task ||
+        self == s_led_task) {
+        esp_rom_printf("\nHEAP GUARD: %s allocated %u bytes (caps 0x%x) after driver init\n", pcTaskGetName(self),
+                       static_cast<unsigned>(size), static_cast<unsigned>(caps));
+        abort();
+    }
+}
+#endif
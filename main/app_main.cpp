@@ -8,8 +8,11 @@
 
 #include <atomic>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 #include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <freertos/task.h>
 
 #include <esp_err.h>
@@ -25,15 +28,29 @@
 
 #include "app_priv.h"
 #include "bs_log.h"
+#include "bs_wc_commands.h"
 
 #if CHIP_DEVICE_CONFIG_ENABLE_THREAD
 #include <platform/ESP32/OpenthreadLauncher.h>
 #endif
 
+#if CONFIG_BS_ICD_POLICY
+#include <app/icd/server/ICDNotifier.h>
+#include <esp_timer.h>
+
+#include "bs_icd_policy.h"
+#endif
+
+#include <app/CommandHandler.h>
 #include <app/InteractionModelEngine.h>
+#include <app/clusters/mode-select-server/supported-modes-manager.h>
+#if CONFIG_BS_SCENES
+#include <app/clusters/scenes-server/SceneTableImpl.h>
+#endif
 #include <app/clusters/window-covering-server/window-covering-delegate.h>
 #include <app/server/CommissioningWindowManager.h>
 #include <app/server/Server.h>
+#include <credentials/GroupDataProvider.h>
 
 #ifdef CONFIG_ENABLE_SET_CERT_DECLARATION_API
 #include <esp_matter_providers.h>
@@ -55,6 +72,19 @@ using namespace chip::app::Clusters;
 
 constexpr auto k_timeout_seconds = 300;
 constexpr TickType_t k_battery_report_period_ticks = pdMS_TO_TICKS(5000);
+// Manufacturer-specific WindowCovering attributes (CALIBRATION_GUIDE.md).
+constexpr uint32_t k_attr_calibration_mode = 0xFFF1;    // bool: calibration mode on/off
+constexpr uint32_t k_attr_calibration_command = 0xFFF2; // uint8: app_calibration_command_t, reads back 0
+constexpr uint32_t k_attr_sync_travel_time = 0xFFF3;    // uint16: group full-travel time in 0.1 s, 0 = off
+constexpr uint32_t k_attr_param_select = 0xFFF4;        // uint8: app_param_t that 0xFFF5 reads and writes
+constexpr uint32_t k_attr_param_value = 0xFFF5;         // uint16: value of the selected tunable parameter
+// Manufacturer-specific GeneralDiagnostics attributes (root endpoint): the move log summary.
+constexpr uint32_t k_attr_move_count = 0xFFF0;          // uint32: moves recorded since boot
+constexpr uint32_t k_attr_move_us_per_step = 0xFFF1;    // uint32: wall time per step over the held moves
+constexpr uint32_t k_attr_move_step_trend = 0xFFF2;     // int32: newer vs older half, per mille; > 0 is slower
+constexpr uint32_t k_attr_move_sag = 0xFFF3;            // uint16: mean battery sag during a move, mV
+constexpr uint32_t k_attr_move_sag_trend = 0xFFF4;      // int16: newer minus older half, mV
+constexpr uint32_t k_attr_last_move = 0xFFF5;           // octet string: the newest bs_move_record_t, as stored
 static TaskHandle_t s_battery_report_task = nullptr;
 static std::atomic<bool> s_commissioning_window_open(false);
 static std::atomic<bool> s_device_online(false);
@@ -77,7 +107,7 @@ static void apply_led_state()
     } else {
         app_battery_status_t battery = {};
         if (app_driver_get_battery_status(&battery) == ESP_OK && battery.valid) {
-            if (battery.percent < 10) {
+            if (battery.percent < 10 || battery.undervoltage) {
                 pattern = {255, 0, 0, APP_LED_SOLID, 0}; // critical battery
             } else if (battery.percent < 40) {
                 pattern = {255, 128, 0, APP_LED_SOLID, 0}; // low battery orange
@@ -134,6 +164,7 @@ static void app_event_cb(const ChipDeviceEvent *event, intptr_t arg)
         s_device_online.store(true);
         apply_led_state();
         MEMORY_PROFILER_DUMP_HEAP_STAT("commissioning complete");
+        app_monitor_log_summary("commissioning complete");
         break;
 
     case chip::DeviceLayer::DeviceEventType::kFailSafeTimerExpired:
@@ -159,6 +190,7 @@ static void app_event_cb(const ChipDeviceEvent *event, intptr_t arg)
         s_commissioning_window_open.store(true);
         apply_led_state();
         MEMORY_PROFILER_DUMP_HEAP_STAT("commissioning window opened");
+        app_monitor_log_summary("commissioning window opened");
         break;
 
     case chip::DeviceLayer::DeviceEventType::kCommissioningWindowClosed:
@@ -211,6 +243,7 @@ static void app_event_cb(const ChipDeviceEvent *event, intptr_t arg)
         BS_LOG_APP("BLE deinitialized and memory reclaimed");
         apply_led_state();
         MEMORY_PROFILER_DUMP_HEAP_STAT("BLE deinitialized");
+        app_monitor_log_summary("BLE deinitialized");
         break;
 
     default:
@@ -227,15 +260,24 @@ static esp_err_t app_identification_cb(identification::callback_type_t type, uin
     return ESP_OK;
 }
 
-enum class bs_wc_command_t : uint8_t {
-    k_none = 0,
-    k_up_or_open,
-    k_down_or_close,
-    k_go_to_lift_pct,
-    k_stop_motion,
-};
+// Command pre-callback <-> TargetPosition write pairing (see bs_wc_commands.h).
+static bs_wc_command_tracker s_wc_commands;
+
+static void drop_unpaired_command_work(intptr_t arg)
+{
+    uint32_t serial = static_cast<uint32_t>(arg);
+    if (s_wc_commands.drop_unpaired(serial)) {
+        BS_LOG_WARN("Command #%u got no target write (%u unpaired total)", static_cast<unsigned>(serial),
+                    static_cast<unsigned>(s_wc_commands.unpaired()));
+    }
+}
 
-static std::atomic<bs_wc_command_t> s_pending_command(bs_wc_command_t::k_none);
+static void begin_inflight_command(bs_wc_command_t command, uint16_t target_percent100ths)
+{
+    uint32_t serial = s_wc_commands.begin(command, target_percent100ths);
+    app_trace_record(bs_trace_event_t::k_wc_command, target_percent100ths, static_cast<uint8_t>(command));
+    chip::DeviceLayer::PlatformMgr().ScheduleWork(drop_unpaired_command_work, static_cast<intptr_t>(serial));
+}
 
 class bs_window_covering_delegate : public chip::app::Clusters::WindowCovering::Delegate {
 public:
@@ -264,15 +306,17 @@ static esp_err_t app_window_covering_command_pre_cb(const ConcreteCommandPath &c
 
     switch (command_path.mCommandId) {
     case WindowCovering::Commands::UpOrOpen::Id:
-        s_pending_command.store(bs_wc_command_t::k_up_or_open);
+        begin_inflight_command(bs_wc_command_t::k_up_or_open, 10000);
         BS_LOG_APP("Command: Open");
         break;
     case WindowCovering::Commands::DownOrClose::Id:
-        s_pending_command.store(bs_wc_command_t::k_down_or_close);
+        begin_inflight_command(bs_wc_command_t::k_down_or_close, 0);
         BS_LOG_APP("Command: Close");
         break;
     case WindowCovering::Commands::StopMotion::Id:
-        s_pending_command.store(bs_wc_command_t::k_stop_motion);
+        // Stop does not write TargetPosition; it goes straight to the driver's priority lane.
+        s_wc_commands.clear();
+        app_trace_record(bs_trace_event_t::k_wc_command, 0, static_cast<uint8_t>(bs_wc_command_t::k_stop_motion));
         BS_LOG_APP("Command: Stop");
         app_driver_stop(window_covering_endpoint_id);
         break;
@@ -282,10 +326,312 @@ static esp_err_t app_window_covering_command_pre_cb(const ConcreteCommandPath &c
         if (err == CHIP_NO_ERROR) {
             uint16_t pct100ths = command_data.liftPercent100thsValue;
             BS_LOG_APP("Command: GoToLiftPercentage %u.%02u%%", pct100ths / 100, pct100ths % 100);
+            begin_inflight_command(bs_wc_command_t::k_go_to_lift_pct, pct100ths);
         } else {
             BS_LOG_WARN("Command: GoToLiftPercentage decode failed: %" CHIP_ERROR_FORMAT, err.Format());
+            s_wc_commands.clear();
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return ESP_OK;
+}
+
+#if CONFIG_BS_SCENES
+// Scenes Management on the WindowCovering endpoint, backed by the on-device table in
+// app_scenes.cpp. The cluster server still validates and answers every scene command.
+// The pre-callbacks run before it does, so they only queue the table change; a work
+// item applies it once the server has handled the command, and only where the
+// server's own scene table agrees. A recall starts its move right here, with its
+// transition time, so a single multicast RecallScene moves a whole group.
+// This covering only lifts: scenes keep tilt for coverings that have it.
+static bool s_reporting_recalled_target = false; // TargetPosition write that only reports a recall
+
+enum class scene_mirror_kind_t : uint8_t {
+    k_add,   // AddScene: the server's entry must carry the command's transition time
+    k_store, // StoreScene, CopyScene: the server's entry gives the transition time
+    k_remove,
+    k_remove_group,
+};
+
+// A table change waiting for the server's verdict. k_remove_group uses fabric and group only.
+struct scene_mirror_t {
+    scene_mirror_kind_t kind;
+    const char *command;
+    bs_scene_t scene;
+};
+
+// CHIP thread only. Enough for a CopyScene of a whole group; one message can batch several commands.
+static scene_mirror_t s_scene_mirrors[CONFIG_BS_SCENES_MAX];
+static uint8_t s_scene_mirror_count = 0;
+
+static uint8_t accessing_fabric_index(void *opaque_ptr)
+{
+    auto *handler = static_cast<chip::app::CommandHandler *>(opaque_ptr);
+    return handler ? handler->GetAccessingFabricIndex() : chip::kUndefinedFabricIndex;
+}
+
+// The server rejects a scene command for a group this endpoint is not in; so does the table.
+static bool scene_group_ok(uint8_t fabric_index, uint16_t group_id)
+{
+    return group_id == 0 ||
+           chip::Credentials::GetGroupDataProvider()->HasEndpoint(fabric_index, group_id, window_covering_endpoint_id);
+}
+
+// What the Scenes server holds for this scene on the WindowCovering endpoint.
+static bool server_has_scene(const bs_scene_t &scene, uint32_t *transition_ms)
+{
+    using scene_table_t = chip::scenes::DefaultSceneTableImpl;
+    chip::scenes::SceneTable<chip::scenes::ExtensionFieldSetsImpl> *table =
+        chip::scenes::GetSceneTableImpl(window_covering_endpoint_id);
+    scene_table_t::SceneTableEntry entry;
+    if (!table || table->GetSceneTableEntry(scene.fabric_index,
+                                            scene_table_t::SceneStorageId(scene.scene_id, scene.group_id),
+                                            entry) != CHIP_NO_ERROR) {
+        return false;
+    }
+    if (transition_ms) {
+        *transition_ms = entry.mStorageData.mSceneTransitionTimeMs;
+    }
+    return true;
+}
+
+static void store_scene(const bs_scene_t &scene, const char *command)
+{
+    esp_err_t err = app_scenes_store(&scene);
+    if (err != ESP_OK) {
+        BS_LOG_WARN("Command: %s 0x%04X/%u not kept (%d, %u scenes held)", command,
+                    static_cast<unsigned>(scene.group_id), static_cast<unsigned>(scene.scene_id), err,
+                    static_cast<unsigned>(app_scenes_count()));
+        return;
+    }
+    BS_LOG_APP("Command: %s 0x%04X/%u: lift %u.%02u%% in %u ms", command, static_cast<unsigned>(scene.group_id),
+               static_cast<unsigned>(scene.scene_id), static_cast<unsigned>(scene.lift_percent100ths / 100),
+               static_cast<unsigned>(scene.lift_percent100ths % 100), static_cast<unsigned>(scene.transition_ms));
+}
+
+static void recall_scene(const bs_scene_t &scene, uint32_t transition_ms)
+{
+    BS_LOG_APP("Command: RecallScene 0x%04X/%u -> %u.%02u%% in %u ms", static_cast<unsigned>(scene.group_id),
+               static_cast<unsigned>(scene.scene_id), static_cast<unsigned>(scene.lift_percent100ths / 100),
+               static_cast<unsigned>(scene.lift_percent100ths % 100), static_cast<unsigned>(transition_ms));
+    app_trace_record(bs_trace_event_t::k_wc_command, scene.lift_percent100ths,
+                     static_cast<uint8_t>(bs_wc_command_t::k_recall_scene));
+    s_wc_commands.clear();
+    app_driver_set_target_timed(window_covering_endpoint_id, scene.lift_percent100ths, transition_ms);
+
+    // Controllers see the new target; the write must not reach the driver again, untimed.
+    s_reporting_recalled_target = true;
+    esp_matter_attr_val_t target = esp_matter_nullable_uint16(scene.lift_percent100ths);
+    attribute::update(window_covering_endpoint_id, WindowCovering::Id,
+                      WindowCovering::Attributes::TargetPositionLiftPercent100ths::Id, &target);
+    s_reporting_recalled_target = false;
+}
+
+// RemoveAllScenes: drop what the server dropped, in one NVS write when it took the lot.
+static void remove_scene_group(const bs_scene_t &group)
+{
+    uint8_t kept_by_server = 0;
+    uint8_t held = 0;
+    bs_scene_t scene;
+    for (uint16_t scene_id = 0; scene_id <= UINT8_MAX; ++scene_id) {
+        if (app_scenes_find(group.fabric_index, group.group_id, static_cast<uint8_t>(scene_id), &scene) == ESP_OK) {
+            held++;
+            kept_by_server += server_has_scene(scene, nullptr) ? 1 : 0;
+        }
+    }
+    uint8_t removed = 0;
+    if (held != 0 && kept_by_server == 0) {
+        removed = app_scenes_remove_group(group.fabric_index, group.group_id);
+    } else if (kept_by_server != held) {
+        for (uint16_t scene_id = 0; scene_id <= UINT8_MAX; ++scene_id) {
+            if (app_scenes_find(group.fabric_index, group.group_id, static_cast<uint8_t>(scene_id), &scene) == ESP_OK &&
+                !server_has_scene(scene, nullptr) &&
+                app_scenes_remove(scene.fabric_index, scene.group_id, scene.scene_id) == ESP_OK) {
+                removed++;
+            }
+        }
+    }
+    BS_LOG_APP("Command: RemoveAllScenes 0x%04X (%u removed)", static_cast<unsigned>(group.group_id),
+               static_cast<unsigned>(removed));
+}
+
+// CHIP thread, after the server has answered the commands that queued these changes.
+static void scene_mirror_work(intptr_t arg)
+{
+    (void)arg;
+    for (uint8_t i = 0; i < s_scene_mirror_count; ++i) {
+        scene_mirror_t &mirror = s_scene_mirrors[i];
+        bs_scene_t &scene = mirror.scene;
+        uint32_t transition_ms = 0;
+        switch (mirror.kind) {
+        case scene_mirror_kind_t::k_add:
+        case scene_mirror_kind_t::k_store:
+            // An AddScene the server refused leaves any older entry in place: it differs in transition time.
+            if (!server_has_scene(scene, &transition_ms) ||
+                (mirror.kind == scene_mirror_kind_t::k_add && transition_ms != scene.transition_ms)) {
+                BS_LOG_WARN("Command: %s 0x%04X/%u rejected by the Scenes server; table unchanged", mirror.command,
+                            static_cast<unsigned>(scene.group_id), static_cast<unsigned>(scene.scene_id));
+                break;
+            }
+            scene.transition_ms = transition_ms;
+            store_scene(scene, mirror.command);
+            break;
+        case scene_mirror_kind_t::k_remove:
+            if (!server_has_scene(scene, nullptr) &&
+                app_scenes_remove(scene.fabric_index, scene.group_id, scene.scene_id) == ESP_OK) {
+                BS_LOG_APP("Command: RemoveScene 0x%04X/%u", static_cast<unsigned>(scene.group_id),
+                           static_cast<unsigned>(scene.scene_id));
+            }
+            break;
+        case scene_mirror_kind_t::k_remove_group:
+            remove_scene_group(scene);
+            break;
+        }
+    }
+    s_scene_mirror_count = 0;
+}
+
+static void queue_scene_mirror(scene_mirror_kind_t kind, const char *command, const bs_scene_t &scene)
+{
+    if (s_scene_mirror_count == CONFIG_BS_SCENES_MAX) {
+        BS_LOG_WARN("Command: %s 0x%04X/%u not mirrored, too many scene commands at once", command,
+                    static_cast<unsigned>(scene.group_id), static_cast<unsigned>(scene.scene_id));
+        return;
+    }
+    if (s_scene_mirror_count == 0) {
+        chip::DeviceLayer::PlatformMgr().ScheduleWork(scene_mirror_work, 0);
+    }
+    s_scene_mirrors[s_scene_mirror_count++] = {kind, command, scene};
+}
+
+// AddScene carries the scene: the WindowCovering lift (and tilt) among its extension field sets.
+static void add_scene(uint8_t fabric_index, const ScenesManagement::Commands::AddScene::DecodableType &command_data)
+{
+    bs_scene_t scene = {fabric_index, command_data.sceneID, command_data.groupID, 0,
+                        bs_scene_t::k_no_tilt, command_data.transitionTime};
+    bool has_lift = false;
+    auto sets = command_data.extensionFieldSetStructs.begin();
+    while (sets.Next()) {
+        const auto &set = sets.GetValue();
+        if (set.clusterID != WindowCovering::Id) {
+            continue;
+        }
+        auto pairs = set.attributeValueList.begin();
+        while (pairs.Next()) {
+            const auto &pair = pairs.GetValue();
+            if (!pair.valueUnsigned16.HasValue()) {
+                continue;
+            }
+            if (pair.attributeID == WindowCovering::Attributes::CurrentPositionLiftPercent100ths::Id) {
+                scene.lift_percent100ths = pair.valueUnsigned16.Value();
+                has_lift = true;
+            } else if (pair.attributeID == WindowCovering::Attributes::CurrentPositionTiltPercent100ths::Id) {
+                scene.tilt_percent100ths = pair.valueUnsigned16.Value();
+            }
+        }
+    }
+    if (!has_lift) {
+        BS_LOG_WARN("Command: AddScene 0x%04X/%u has no lift; nothing to recall here",
+                    static_cast<unsigned>(scene.group_id), static_cast<unsigned>(scene.scene_id));
+        return;
+    }
+    queue_scene_mirror(scene_mirror_kind_t::k_add, "AddScene", scene);
+}
+
+// StoreScene keeps where the blind is now; the transition time comes from the server's entry.
+static void store_current_scene(uint8_t fabric_index, uint16_t group_id, uint8_t scene_id)
+{
+    app_driver_state_t state = {};
+    app_driver_get_state(&state);
+    bs_scene_t scene = {fabric_index, scene_id, group_id, state.current_percent100ths, bs_scene_t::k_no_tilt, 0};
+    queue_scene_mirror(scene_mirror_kind_t::k_store, "StoreScene", scene);
+}
+
+static void copy_scenes(uint8_t fabric_index, const ScenesManagement::Commands::CopyScene::DecodableType &command_data)
+{
+    bool copy_all = command_data.mode.Has(ScenesManagement::CopyModeBitmap::kCopyAllScenes);
+    for (uint16_t scene_id = 0; scene_id <= UINT8_MAX; ++scene_id) {
+        uint8_t from_id = copy_all ? static_cast<uint8_t>(scene_id) : command_data.sceneIdentifierFrom;
+        bs_scene_t scene;
+        if (app_scenes_find(fabric_index, command_data.groupIdentifierFrom, from_id, &scene) == ESP_OK) {
+            scene.group_id = command_data.groupIdentifierTo;
+            scene.scene_id = copy_all ? from_id : command_data.sceneIdentifierTo;
+            queue_scene_mirror(scene_mirror_kind_t::k_store, "CopyScene", scene);
+        }
+        if (!copy_all) {
+            break;
+        }
+    }
+}
+
+static esp_err_t app_scenes_command_pre_cb(const ConcreteCommandPath &command_path, TLVReader &tlv_data,
+                                           void *opaque_ptr)
+{
+    if (command_path.mClusterId != ScenesManagement::Id || command_path.mEndpointId != window_covering_endpoint_id) {
+        return ESP_OK;
+    }
+    uint8_t fabric_index = accessing_fabric_index(opaque_ptr);
+
+    switch (command_path.mCommandId) {
+    case ScenesManagement::Commands::AddScene::Id: {
+        ScenesManagement::Commands::AddScene::DecodableType command_data;
+        if (chip::app::DataModel::Decode(tlv_data, command_data) == CHIP_NO_ERROR &&
+            scene_group_ok(fabric_index, command_data.groupID)) {
+            add_scene(fabric_index, command_data);
+        }
+        break;
+    }
+    case ScenesManagement::Commands::StoreScene::Id: {
+        ScenesManagement::Commands::StoreScene::DecodableType command_data;
+        if (chip::app::DataModel::Decode(tlv_data, command_data) == CHIP_NO_ERROR &&
+            scene_group_ok(fabric_index, command_data.groupID)) {
+            store_current_scene(fabric_index, command_data.groupID, command_data.sceneID);
+        }
+        break;
+    }
+    case ScenesManagement::Commands::RecallScene::Id: {
+        ScenesManagement::Commands::RecallScene::DecodableType command_data;
+        bs_scene_t scene;
+        if (chip::app::DataModel::Decode(tlv_data, command_data) != CHIP_NO_ERROR ||
+            !scene_group_ok(fabric_index, command_data.groupID) ||
+            app_scenes_find(fabric_index, command_data.groupID, command_data.sceneID, &scene) != ESP_OK) {
+            break;
+        }
+        // A transition time in the command overrides the scene's own.
+        uint32_t transition_ms = scene.transition_ms;
+        if (command_data.transitionTime.HasValue() && !command_data.transitionTime.Value().IsNull()) {
+            transition_ms = command_data.transitionTime.Value().Value();
+        }
+        recall_scene(scene, transition_ms);
+        break;
+    }
+    case ScenesManagement::Commands::RemoveScene::Id: {
+        ScenesManagement::Commands::RemoveScene::DecodableType command_data;
+        bs_scene_t scene;
+        if (chip::app::DataModel::Decode(tlv_data, command_data) == CHIP_NO_ERROR &&
+            app_scenes_find(fabric_index, command_data.groupID, command_data.sceneID, &scene) == ESP_OK) {
+            queue_scene_mirror(scene_mirror_kind_t::k_remove, "RemoveScene", scene);
+        }
+        break;
+    }
+    case ScenesManagement::Commands::RemoveAllScenes::Id: {
+        ScenesManagement::Commands::RemoveAllScenes::DecodableType command_data;
+        if (chip::app::DataModel::Decode(tlv_data, command_data) == CHIP_NO_ERROR) {
+            bs_scene_t group = {fabric_index, 0, command_data.groupID, 0, bs_scene_t::k_no_tilt, 0};
+            queue_scene_mirror(scene_mirror_kind_t::k_remove_group, "RemoveAllScenes", group);
+        }
+        break;
+    }
+    case ScenesManagement::Commands::CopyScene::Id: {
+        ScenesManagement::Commands::CopyScene::DecodableType command_data;
+        if (chip::app::DataModel::Decode(tlv_data, command_data) == CHIP_NO_ERROR &&
+            scene_group_ok(fabric_index, command_data.groupIdentifierFrom) &&
+            scene_group_ok(fabric_index, command_data.groupIdentifierTo)) {
+            copy_scenes(fabric_index, command_data);
         }
-        s_pending_command.store(bs_wc_command_t::k_go_to_lift_pct);
         break;
     }
     default:
@@ -294,6 +640,96 @@ static esp_err_t app_window_covering_command_pre_cb(const ConcreteCommandPath &c
     return ESP_OK;
 }
 
+// Scenes are fabric-scoped: they go with the fabric that made them.
+class scene_fabric_delegate : public chip::FabricTable::Delegate {
+public:
+    void OnFabricRemoved(const chip::FabricTable &fabric_table, chip::FabricIndex fabric_index) override
+    {
+        (void)fabric_table;
+        uint8_t removed = app_scenes_remove_fabric(fabric_index);
+        if (removed != 0) {
+            BS_LOG_APP("Fabric %u removed: %u scenes dropped", static_cast<unsigned>(fabric_index),
+                       static_cast<unsigned>(removed));
+        }
+    }
+};
+
+static scene_fabric_delegate s_scene_fabric_delegate;
+
+static void scene_fabric_delegate_work(intptr_t arg)
+{
+    (void)arg;
+    chip::Server::GetInstance().GetFabricTable().AddFabricDelegate(&s_scene_fabric_delegate);
+}
+#endif // CONFIG_BS_SCENES
+
+// Mode Select on the WindowCovering endpoint: one mode per motion profile, mode number
+// = app_motion_profile_t. The labels are what controllers show.
+class motion_profile_modes : public ModeSelect::SupportedModesManager {
+public:
+    using mode_option_t = ModeSelect::Structs::ModeOptionStruct::Type;
+
+    motion_profile_modes()
+    {
+        static const char *const labels[APP_MOTION_PROFILE_COUNT] = {"Fast", "Quiet", "Night"};
+        for (uint8_t i = 0; i < APP_MOTION_PROFILE_COUNT; ++i) {
+            m_options[i].label = chip::CharSpan::fromCharString(labels[i]);
+            m_options[i].mode = i;
+        }
+    }
+
+    ModeOptionsProvider getModeOptionsProvider(chip::EndpointId endpoint_id) const override
+    {
+        if (endpoint_id != window_covering_endpoint_id) {
+            return ModeOptionsProvider(nullptr, nullptr);
+        }
+        return ModeOptionsProvider(m_options, m_options + APP_MOTION_PROFILE_COUNT);
+    }
+
+    chip::Protocols::InteractionModel::Status getModeOptionByMode(chip::EndpointId endpoint_id, uint8_t mode,
+                                                                 const mode_option_t **data) const override
+    {
+        if (endpoint_id != window_covering_endpoint_id) {
+            return chip::Protocols::InteractionModel::Status::UnsupportedCluster;
+        }
+        if (mode >= APP_MOTION_PROFILE_COUNT) {
+            return chip::Protocols::InteractionModel::Status::InvalidCommand;
+        }
+        *data = &m_options[mode];
+        return chip::Protocols::InteractionModel::Status::Success;
+    }
+
+private:
+    mode_option_t m_options[APP_MOTION_PROFILE_COUNT];
+};
+
+static motion_profile_modes s_motion_profile_modes;
+
+static std::atomic<uint8_t> s_param_select(0); // app_param_t behind 0xFFF5
+
+// CurrentMode, 0xFFF3 and 0xFFF5 follow the driver: at boot (all are persisted in NVS)
+// and after a console change. Writing the same value back through the callback is a no-op.
+static void motion_settings_report_work(intptr_t arg)
+{
+    (void)arg;
+    app_param_info_t info = {};
+    if (app_driver_get_param_info(static_cast<app_param_t>(s_param_select.load()), &info) == ESP_OK) {
+        esp_matter_attr_val_t value = esp_matter_uint16(info.value);
+        attribute::update(window_covering_endpoint_id, WindowCovering::Id, k_attr_param_value, &value);
+    }
+    esp_matter_attr_val_t mode = esp_matter_uint8(static_cast<uint8_t>(app_driver_get_motion_profile()));
+    attribute::update(window_covering_endpoint_id, ModeSelect::Id, ModeSelect::Attributes::CurrentMode::Id, &mode);
+    esp_matter_attr_val_t sync = esp_matter_uint16(app_driver_get_sync_travel_time());
+    attribute::update(window_covering_endpoint_id, WindowCovering::Id, k_attr_sync_travel_time, &sync);
+}
+
+static void calibration_command_reset_work(intptr_t arg)
+{
+    (void)arg;
+    esp_matter_attr_val_t none = esp_matter_uint8(APP_CALIBRATION_NONE);
+    attribute::update(window_covering_endpoint_id, WindowCovering::Id, k_attr_calibration_command, &none);
+}
+
 // This callback is called for every attribute update. The callback implementation shall
 // handle the desired attributes and return an appropriate error code. If the attribute
 // is not of your interest, please do not return an error code and strictly return ESP_OK.
@@ -306,18 +742,58 @@ static esp_err_t app_attribute_update_cb(attribute::callback_type_t type, uint16
     if (endpoint_id == window_covering_endpoint_id && cluster_id == WindowCovering::Id &&
         attribute_id == WindowCovering::Attributes::TargetPositionLiftPercent100ths::Id) {
         if (type == PRE_UPDATE) {
-            bs_wc_command_t pending = s_pending_command.exchange(bs_wc_command_t::k_none);
-            if (pending == bs_wc_command_t::k_up_or_open) {
-                val->val.u16 = 10000;
-            } else if (pending == bs_wc_command_t::k_down_or_close) {
-                val->val.u16 = 0;
-            }
-            if (val->val.u16 > 10000) {
-                val->val.u16 = 10000;
-            }
+            val->val.u16 = s_wc_commands.resolve_target(val->val.u16);
         } else if (type == POST_UPDATE) {
+#if CONFIG_BS_SCENES
+            if (s_reporting_recalled_target) {
+                return ESP_OK; // the driver already has it, with the scene's transition time
+            }
+#endif
             app_driver_set_target_percent100ths(endpoint_id, val->val.u16);
         }
+    } else if (endpoint_id == window_covering_endpoint_id && cluster_id == WindowCovering::Id &&
+               attribute_id == k_attr_calibration_mode) {
+        if (type == POST_UPDATE) {
+            err = app_driver_set_calibration_mode(val->val.b);
+        }
+    } else if (endpoint_id == window_covering_endpoint_id && cluster_id == WindowCovering::Id &&
+               attribute_id == k_attr_calibration_command) {
+        if (type == PRE_UPDATE && val->val.u8 > APP_CALIBRATION_BOTTOM) {
+            err = ESP_ERR_INVALID_ARG; // rejects the write
+        } else if (type == POST_UPDATE && val->val.u8 != APP_CALIBRATION_NONE) {
+            err = app_driver_calibration_command(static_cast<app_calibration_command_t>(val->val.u8));
+            // A trigger, not a setting: read back 0 so the same command can be written again.
+            chip::DeviceLayer::PlatformMgr().ScheduleWork(calibration_command_reset_work, 0);
+        }
+    } else if (endpoint_id == window_covering_endpoint_id && cluster_id == WindowCovering::Id &&
+               attribute_id == k_attr_sync_travel_time) {
+        if (type == POST_UPDATE) {
+            err = app_driver_set_sync_travel_time(val->val.u16);
+        }
+    } else if (endpoint_id == window_covering_endpoint_id && cluster_id == WindowCovering::Id &&
+               attribute_id == k_attr_param_select) {
+        if (type == PRE_UPDATE && val->val.u8 >= APP_PARAM_COUNT) {
+            err = ESP_ERR_INVALID_ARG;
+        } else if (type == POST_UPDATE) {
+            // 0xFFF5 now reads the newly selected parameter.
+            s_param_select.store(val->val.u8);
+            chip::DeviceLayer::PlatformMgr().ScheduleWork(motion_settings_report_work, 0);
+        }
+    } else if (endpoint_id == window_covering_endpoint_id && cluster_id == WindowCovering::Id &&
+               attribute_id == k_attr_param_value) {
+        app_param_info_t info = {};
+        app_driver_get_param_info(static_cast<app_param_t>(s_param_select.load()), &info);
+        if (type == PRE_UPDATE && (val->val.u16 < info.min_value || val->val.u16 > info.max_value)) {
+            err = ESP_ERR_INVALID_ARG;
+        } else if (type == POST_UPDATE) {
+            err = app_driver_set_param(static_cast<app_param_t>(s_param_select.load()), val->val.u16);
+        }
+    } else if (endpoint_id == window_covering_endpoint_id && cluster_id == ModeSelect::Id &&
+               attribute_id == ModeSelect::Attributes::CurrentMode::Id) {
+        // ChangeToMode has already checked the mode against the supported list.
+        if (type == POST_UPDATE) {
+            err = app_driver_set_motion_profile(static_cast<app_motion_profile_t>(val->val.u8));
+        }
     }
 
     return err;
@@ -345,9 +821,49 @@ static void battery_report_work(intptr_t arg)
     }
     esp_matter_attr_val_t percent_val = esp_matter_nullable_uint8(static_cast<uint8_t>(matter_percent));
     attribute::update(power_source_endpoint_id, PowerSource::Id, PowerSource::Attributes::BatPercentRemaining::Id, &percent_val);
+
+    // At rest a pack that collapses under load can read a healthy percentage.
+    esp_matter_attr_val_t level_val = esp_matter_enum8(static_cast<uint8_t>(
+        status.undervoltage ? PowerSource::BatChargeLevelEnum::kCritical : PowerSource::BatChargeLevelEnum::kOk));
+    attribute::update(power_source_endpoint_id, PowerSource::Id, PowerSource::Attributes::BatChargeLevel::Id, &level_val);
     apply_led_state();
 }
 
+// Driver task: the undervoltage cutoff tripped or released. Report now, not on the next period.
+static void battery_cutoff_cb(bool undervoltage)
+{
+    (void)undervoltage;
+    chip::DeviceLayer::PlatformMgr().ScheduleWork(battery_report_work, 0);
+}
+
+// Move log summary on GeneralDiagnostics, refreshed with the battery report once a new
+// move has been recorded.
+static void move_log_report_work(intptr_t arg)
+{
+    (void)arg;
+    static uint32_t s_moves_reported = UINT32_MAX;
+    static bs_move_record_t s_last_move = {};
+    bs_move_summary_t summary = {};
+    if (app_driver_get_move_summary(&summary) != ESP_OK || summary.moves == s_moves_reported) {
+        return;
+    }
+    s_moves_reported = summary.moves;
+    esp_matter_attr_val_t val = esp_matter_uint32(summary.moves);
+    attribute::update(chip::kRootEndpointId, GeneralDiagnostics::Id, k_attr_move_count, &val);
+    val = esp_matter_uint32(summary.us_per_step);
+    attribute::update(chip::kRootEndpointId, GeneralDiagnostics::Id, k_attr_move_us_per_step, &val);
+    val = esp_matter_int32(summary.us_per_step_trend_permille);
+    attribute::update(chip::kRootEndpointId, GeneralDiagnostics::Id, k_attr_move_step_trend, &val);
+    val = esp_matter_uint16(summary.sag_mv);
+    attribute::update(chip::kRootEndpointId, GeneralDiagnostics::Id, k_attr_move_sag, &val);
+    val = esp_matter_int16(summary.sag_trend_mv);
+    attribute::update(chip::kRootEndpointId, GeneralDiagnostics::Id, k_attr_move_sag_trend, &val);
+    if (app_driver_get_move_record(0, &s_last_move) == ESP_OK) {
+        val = esp_matter_octet_str(reinterpret_cast<uint8_t *>(&s_last_move), sizeof(s_last_move));
+        attribute::update(chip::kRootEndpointId, GeneralDiagnostics::Id, k_attr_last_move, &val);
+    }
+}
+
 static void battery_report_task(void *arg)
 {
     (void)arg;
@@ -356,10 +872,287 @@ static void battery_report_task(void *arg)
         if (err != CHIP_NO_ERROR) {
             BS_LOG_WARN("Battery report schedule failed: %" CHIP_ERROR_FORMAT, err.Format());
         }
+        chip::DeviceLayer::PlatformMgr().ScheduleWork(move_log_report_work, 0);
         vTaskDelay(k_battery_report_period_ticks);
     }
 }
 
+#if CONFIG_BS_ICD_POLICY
+// Refresh must stay below the ICD active mode threshold so active mode never lapses mid-move.
+constexpr TickType_t k_icd_refresh_ticks = pdMS_TO_TICKS(500);
+constexpr uint8_t k_icd_event_button = 0x1;
+constexpr uint8_t k_icd_event_motion = 0x2;
+
+static bs_icd_policy s_icd_policy({CONFIG_ICD_SLOW_POLL_INTERVAL_MS, CONFIG_ICD_FAST_POLL_INTERVAL_MS,
+                                   CONFIG_BS_ICD_POST_MOTION_HOLD_MS, CONFIG_BS_ICD_BUTTON_HOLD_MS,
+                                   CONFIG_BS_ICD_POLL_RADIO_ON_MS});
+static SemaphoreHandle_t s_icd_lock = nullptr;
+static TaskHandle_t s_icd_task = nullptr;
+static std::atomic<uint8_t> s_icd_events(0);
+static std::atomic<bool> s_icd_moving(false);
+
+static uint32_t icd_now_ms()
+{
+    return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+}
+
+static void icd_activity_cb(app_activity_t activity)
+{
+    if (activity == APP_ACTIVITY_BUTTON) {
+        s_icd_events.fetch_or(k_icd_event_button);
+    } else {
+        s_icd_moving.store(activity == APP_ACTIVITY_MOTION_START);
+        s_icd_events.fetch_or(k_icd_event_motion);
+    }
+    if (s_icd_task) {
+        xTaskNotifyGive(s_icd_task);
+    }
+}
+
+static void icd_keep_active_work(intptr_t arg)
+{
+    (void)arg;
+    chip::app::ICDNotifier::GetInstance().NotifyNetworkActivityNotification();
+}
+
+static void icd_log_estimate(const char *label)
+{
+    if (xSemaphoreTake(s_icd_lock, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    s_icd_policy.advance(icd_now_ms());
+    uint32_t fast_s = static_cast<uint32_t>(s_icd_policy.fast_ms() / 1000);
+    uint32_t slow_s = static_cast<uint32_t>(s_icd_policy.slow_ms() / 1000);
+    uint32_t radio_ms = s_icd_policy.radio_on_ms_per_hour();
+    xSemaphoreGive(s_icd_lock);
+    BS_LOG_APP("ICD %s: fast %us, slow %us, est. radio-on %u ms/h", label, static_cast<unsigned>(fast_s),
+               static_cast<unsigned>(slow_s), static_cast<unsigned>(radio_ms));
+}
+
+static void icd_policy_task(void *arg)
+{
+    (void)arg;
+    bool was_fast = false;
+    while (true) {
+        // Nothing to refresh while slow; the next driver activity wakes the task.
+        ulTaskNotifyTake(pdTRUE, was_fast ? k_icd_refresh_ticks : portMAX_DELAY);
+
+        bool fast = false;
+        if (xSemaphoreTake(s_icd_lock, portMAX_DELAY) == pdTRUE) {
+            uint32_t now = icd_now_ms();
+            uint8_t events = s_icd_events.exchange(0);
+            if (events & k_icd_event_button) {
+                s_icd_policy.on_button(now);
+            }
+            if (events & k_icd_event_motion) {
+                s_icd_policy.on_motion(s_icd_moving.load(), now);
+            }
+            s_icd_policy.advance(now);
+            fast = s_icd_policy.fast(now);
+            xSemaphoreGive(s_icd_lock);
+        }
+
+        if (fast) {
+            chip::DeviceLayer::PlatformMgr().ScheduleWork(icd_keep_active_work, 0);
+        }
+        if (was_fast && !fast) {
+            icd_log_estimate("back to slow poll");
+        }
+        was_fast = fast;
+    }
+}
+
+#if CONFIG_ENABLE_CHIP_SHELL
+static esp_err_t icd_command_handler(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    icd_log_estimate("stats");
+    return ESP_OK;
+}
+
+static void icd_register_commands()
+{
+    static const esp_matter::console::command_t command = {
+        .name = "icd",
+        .description = "ICD poll policy: fast/slow time and estimated radio-on ms per hour",
+        .handler = icd_command_handler,
+    };
+    esp_matter::console::add_commands(&command, 1);
+}
+#endif
+
+static esp_err_t app_icd_policy_init()
+{
+    s_icd_lock = xSemaphoreCreateMutex();
+    if (!s_icd_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_icd_policy.start(icd_now_ms());
+    if (xTaskCreate(icd_policy_task, "icd_policy", 3072, nullptr, 1, &s_icd_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    app_driver_set_activity_cb(icd_activity_cb);
+    BS_LOG_STATE("ICD poll policy: fast %ums / slow %ums, hold %ums after move, %ums after button",
+                 static_cast<unsigned>(CONFIG_ICD_FAST_POLL_INTERVAL_MS),
+                 static_cast<unsigned>(CONFIG_ICD_SLOW_POLL_INTERVAL_MS),
+                 static_cast<unsigned>(CONFIG_BS_ICD_POST_MOTION_HOLD_MS),
+                 static_cast<unsigned>(CONFIG_BS_ICD_BUTTON_HOLD_MS));
+    return ESP_OK;
+}
+#endif // CONFIG_BS_ICD_POLICY
+
+#if CONFIG_ENABLE_CHIP_SHELL
+static esp_err_t profile_command_handler(int argc, char **argv)
+{
+    if (argc >= 2 && strcmp(argv[0], "sync") == 0) {
+        app_driver_set_sync_travel_time(static_cast<uint16_t>(strtoul(argv[1], nullptr, 10)));
+        chip::DeviceLayer::PlatformMgr().ScheduleWork(motion_settings_report_work, 0);
+        return ESP_OK;
+    }
+    if (argc >= 1 && strcmp(argv[0], "list") != 0) {
+        for (uint8_t i = 0; i < APP_MOTION_PROFILE_COUNT; ++i) {
+            app_motion_profile_info_t info = {};
+            app_motion_profile_t profile = static_cast<app_motion_profile_t>(i);
+            if (app_driver_get_motion_profile_info(profile, &info) == ESP_OK && strcmp(argv[0], info.name) == 0) {
+                app_driver_set_motion_profile(profile);
+                chip::DeviceLayer::PlatformMgr().ScheduleWork(motion_settings_report_work, 0);
+                return ESP_OK;
+            }
+        }
+        BS_LOG_WARN("usage: profile [list|fast|quiet|night|sync <0.1 s, 0 = off>]");
+        return ESP_ERR_INVALID_ARG;
+    }
+    app_driver_dump_motion_profiles();
+    return ESP_OK;
+}
+
+static void profile_register_commands()
+{
+    static const esp_matter::console::command_t command = {
+        .name = "profile",
+        .description = "Motion profiles and their full-travel times, or switch. "
+                       "Usage: matter profile [list|fast|quiet|night|sync <0.1 s, 0 = off>]",
+        .handler = profile_command_handler,
+    };
+    esp_matter::console::add_commands(&command, 1);
+}
+
+static esp_err_t param_command_handler(int argc, char **argv)
+{
+    if (argc >= 2 && strcmp(argv[0], "reset") == 0) {
+        app_param_t param = strcmp(argv[1], "all") == 0 ? APP_PARAM_COUNT : app_driver_find_param(argv[1]);
+        if (param == APP_PARAM_COUNT && strcmp(argv[1], "all") != 0) {
+            BS_LOG_WARN("param: no parameter %s", argv[1]);
+            return ESP_ERR_INVALID_ARG;
+        }
+        esp_err_t err = app_driver_reset_param(param);
+        chip::DeviceLayer::PlatformMgr().ScheduleWork(motion_settings_report_work, 0);
+        return err;
+    }
+    if (argc >= 2) {
+        app_param_t param = app_driver_find_param(argv[0]);
+        app_param_info_t info = {};
+        if (app_driver_get_param_info(param, &info) != ESP_OK) {
+            BS_LOG_WARN("param: no parameter %s", argv[0]);
+            return ESP_ERR_INVALID_ARG;
+        }
+        unsigned long value = strtoul(argv[1], nullptr, 10);
+        if (value < info.min_value || value > info.max_value) {
+            BS_LOG_WARN("param %s: %u-%u %s", info.key, info.min_value, info.max_value, info.unit);
+            return ESP_ERR_INVALID_ARG;
+        }
+        esp_err_t err = app_driver_set_param(param, static_cast<uint16_t>(value));
+        chip::DeviceLayer::PlatformMgr().ScheduleWork(motion_settings_report_work, 0);
+        return err;
+    }
+    if (argc >= 1 && strcmp(argv[0], "list") != 0) {
+        BS_LOG_WARN("usage: param [list|<name> <value>|reset <name>|reset all]");
+        return ESP_ERR_INVALID_ARG;
+    }
+    BS_LOG_STATE("Tunable parameters (0xFFF4 index, value, default, range):");
+    for (uint8_t i = 0; i < APP_PARAM_COUNT; ++i) {
+        app_param_info_t info = {};
+        app_driver_get_param_info(static_cast<app_param_t>(i), &info);
+        BS_LOG_STATE("  %u %-12s %5u %-5s (default %u, %u-%u)%s", static_cast<unsigned>(i), info.key, info.value,
+                     info.unit, info.default_value, info.min_value, info.max_value,
+                     info.value != info.default_value ? " *" : "");
+    }
+    return ESP_OK;
+}
+
+static void param_register_commands()
+{
+    static const esp_matter::console::command_t command = {
+        .name = "param",
+        .description = "Tunable motion/reporting parameters, persisted in NVS. "
+                       "Usage: matter param [list|<name> <value>|reset <name>|reset all]",
+        .handler = param_command_handler,
+    };
+    esp_matter::console::add_commands(&command, 1);
+}
+
+#if CONFIG_BS_CURRENT_SENSE
+static esp_err_t current_command_handler(int argc, char **argv)
+{
+    (void)argv;
+    if (argc > 0) {
+        BS_LOG_WARN("usage: current");
+        return ESP_ERR_INVALID_ARG;
+    }
+    app_load_stats_t stats = {};
+    app_driver_get_load_stats(&stats);
+    BS_LOG_STATE("Motor current %u mA; last move ran at %u mA, peak %u mA; last trip %u mA; "
+                 "%u obstructions, %u end stops",
+                 static_cast<unsigned>(stats.current_ma), static_cast<unsigned>(stats.running_ma),
+                 static_cast<unsigned>(stats.peak_ma), static_cast<unsigned>(stats.trip_ma),
+                 static_cast<unsigned>(stats.obstructions), static_cast<unsigned>(stats.end_stops));
+    return ESP_OK;
+}
+
+static void current_register_commands()
+{
+    static const esp_matter::console::command_t command = {
+        .name = "current",
+        .description = "Motor current and load detection counters. Usage: matter current",
+        .handler = current_command_handler,
+    };
+    esp_matter::console::add_commands(&command, 1);
+}
+#endif // CONFIG_BS_CURRENT_SENSE
+
+#if CONFIG_BS_DUAL_MOTOR
+static esp_err_t lockstep_command_handler(int argc, char **argv)
+{
+    if (argc >= 2 && strcmp(argv[0], "trim") == 0) {
+        return app_driver_set_motor2_trim(static_cast<int16_t>(strtol(argv[1], nullptr, 10)));
+    }
+    if (argc >= 1 && strcmp(argv[0], "dump") != 0) {
+        BS_LOG_WARN("usage: lockstep [dump|trim <steps>]");
+        return ESP_ERR_INVALID_ARG;
+    }
+    app_lockstep_stats_t stats = {};
+    app_driver_get_lockstep_stats(&stats);
+    BS_LOG_STATE("Lockstep: %u edges, %u misaligned, step error %d; motor B trim %d (target %d)",
+                 static_cast<unsigned>(stats.edges), static_cast<unsigned>(stats.misaligned_edges),
+                 static_cast<int>(stats.step_error), static_cast<int>(stats.trim_steps),
+                 static_cast<int>(stats.trim_target_steps));
+    return ESP_OK;
+}
+
+static void lockstep_register_commands()
+{
+    static const esp_matter::console::command_t command = {
+        .name = "lockstep",
+        .description = "Dual-motor alignment, or level the bar by moving motor B alone. "
+                       "Usage: matter lockstep [dump|trim <steps>]",
+        .handler = lockstep_command_handler,
+    };
+    esp_matter::console::add_commands(&command, 1);
+}
+#endif // CONFIG_BS_DUAL_MOTOR
+#endif
+
 extern "C" void app_main()
 {
     esp_err_t err = ESP_OK;
@@ -367,6 +1160,16 @@ extern "C" void app_main()
     /* Initialize the ESP NVS layer */
     nvs_flash_init();
 
+    /* Before anything records into the trace ring: it still holds the previous boot's */
+    err = app_postmortem_init();
+    ABORT_APP_ON_FAILURE(err == ESP_OK, BS_LOG_ERROR("Failed to init post-mortem record, err:%d", err));
+
+    err = app_power_init();
+    ABORT_APP_ON_FAILURE(err == ESP_OK, BS_LOG_ERROR("Failed to init power management, err:%d", err));
+
+    err = app_scenes_init();
+    ABORT_APP_ON_FAILURE(err == ESP_OK, BS_LOG_ERROR("Failed to load the scene table, err:%d", err));
+
     MEMORY_PROFILER_DUMP_HEAP_STAT("Bootup");
 
     /* Create a Matter node and add the mandatory Root Node device type on endpoint 0 */
@@ -403,6 +1206,81 @@ extern "C" void app_main()
                                app_window_covering_command_pre_cb);
     command::set_user_callback(command::get(wc_cluster, WindowCovering::Commands::GoToLiftPercentage::Id, COMMAND_FLAG_ACCEPTED),
                                app_window_covering_command_pre_cb);
+    // The driver raises MotorJammed / PositionFailure when encoder feedback disagrees.
+    cluster::window_covering::attribute::create_safety_status(wc_cluster, 0);
+    // Calibration over Matter: 0xFFF1 enters/leaves calibration mode, 0xFFF2 runs the
+    // automatic home (1) or bottom (2) end-stop seek.
+    attribute_t *calibration_mode = attribute::create(wc_cluster, k_attr_calibration_mode, ATTRIBUTE_FLAG_WRITABLE,
+                                                      esp_matter_bool(false));
+    attribute_t *calibration_command = attribute::create(wc_cluster, k_attr_calibration_command,
+                                                         ATTRIBUTE_FLAG_WRITABLE, esp_matter_uint8(APP_CALIBRATION_NONE));
+    ABORT_APP_ON_FAILURE(calibration_mode != nullptr && calibration_command != nullptr,
+                         BS_LOG_ERROR("Failed to add calibration attributes"));
+    // Synchronized group moves: write the same full-travel time to every blind in the group.
+    attribute_t *sync_travel_time = attribute::create(wc_cluster, k_attr_sync_travel_time, ATTRIBUTE_FLAG_WRITABLE,
+                                                      esp_matter_uint16(0));
+    ABORT_APP_ON_FAILURE(sync_travel_time != nullptr, BS_LOG_ERROR("Failed to add sync travel time attribute"));
+    // Tunable parameters: write the index (app_param_t) to 0xFFF4, then read or write 0xFFF5.
+    attribute_t *param_select = attribute::create(wc_cluster, k_attr_param_select, ATTRIBUTE_FLAG_WRITABLE,
+                                                  esp_matter_uint8(0));
+    attribute_t *param_value = attribute::create(wc_cluster, k_attr_param_value, ATTRIBUTE_FLAG_WRITABLE,
+                                                 esp_matter_uint16(0));
+    ABORT_APP_ON_FAILURE(param_select != nullptr && param_value != nullptr,
+                         BS_LOG_ERROR("Failed to add parameter attributes"));
+    BS_LOG_APP("Custom attributes added: CalibrationMode=0x%04X, CalibrationCommand=0x%04X, SyncTravelTime=0x%04X, "
+               "ParamSelect=0x%04X, ParamValue=0x%04X",
+               static_cast<unsigned>(k_attr_calibration_mode), static_cast<unsigned>(k_attr_calibration_command),
+               static_cast<unsigned>(k_attr_sync_travel_time), static_cast<unsigned>(k_attr_param_select),
+               static_cast<unsigned>(k_attr_param_value));
+
+#if CONFIG_BS_MOVE_LOG
+    // Move log summary, next to the standard diagnostics on the root endpoint.
+    static bs_move_record_t s_no_move = {};
+    cluster_t *diag_cluster = cluster::get(chip::kRootEndpointId, GeneralDiagnostics::Id);
+    ABORT_APP_ON_FAILURE(diag_cluster != nullptr, BS_LOG_ERROR("No GeneralDiagnostics cluster on the root endpoint"));
+    bool move_attrs_ok =
+        attribute::create(diag_cluster, k_attr_move_count, ATTRIBUTE_FLAG_NONE, esp_matter_uint32(0)) &&
+        attribute::create(diag_cluster, k_attr_move_us_per_step, ATTRIBUTE_FLAG_NONE, esp_matter_uint32(0)) &&
+        attribute::create(diag_cluster, k_attr_move_step_trend, ATTRIBUTE_FLAG_NONE, esp_matter_int32(0)) &&
+        attribute::create(diag_cluster, k_attr_move_sag, ATTRIBUTE_FLAG_NONE, esp_matter_uint16(0)) &&
+        attribute::create(diag_cluster, k_attr_move_sag_trend, ATTRIBUTE_FLAG_NONE, esp_matter_int16(0)) &&
+        attribute::create(diag_cluster, k_attr_last_move, ATTRIBUTE_FLAG_NONE,
+                          esp_matter_octet_str(reinterpret_cast<uint8_t *>(&s_no_move), sizeof(s_no_move)),
+                          sizeof(s_no_move));
+    ABORT_APP_ON_FAILURE(move_attrs_ok, BS_LOG_ERROR("Failed to add move log attributes"));
+#endif
+
+#if CONFIG_BS_SCENES
+    // Scenes on the same endpoint; group-addressed scene commands need it in Groups too.
+    if (!cluster::get(endpoint, Groups::Id)) {
+        cluster::groups::config_t groups_config;
+        ABORT_APP_ON_FAILURE(cluster::groups::create(endpoint, &groups_config, CLUSTER_FLAG_SERVER) != nullptr,
+                             BS_LOG_ERROR("Failed to add Groups cluster"));
+    }
+    cluster::scenes_management::config_t scenes_config;
+    cluster_t *scenes_cluster = cluster::scenes_management::create(endpoint, &scenes_config, CLUSTER_FLAG_SERVER);
+    ABORT_APP_ON_FAILURE(scenes_cluster != nullptr, BS_LOG_ERROR("Failed to add Scenes Management cluster"));
+    static const uint32_t k_scene_commands[] = {
+        ScenesManagement::Commands::AddScene::Id,        ScenesManagement::Commands::StoreScene::Id,
+        ScenesManagement::Commands::RecallScene::Id,     ScenesManagement::Commands::RemoveScene::Id,
+        ScenesManagement::Commands::RemoveAllScenes::Id, ScenesManagement::Commands::CopyScene::Id,
+    };
+    for (uint32_t command_id : k_scene_commands) {
+        command_t *scene_command = command::get(scenes_cluster, command_id, COMMAND_FLAG_ACCEPTED);
+        ABORT_APP_ON_FAILURE(scene_command != nullptr, BS_LOG_ERROR("Scenes Management lacks command 0x%02X",
+                                                                    static_cast<unsigned>(command_id)));
+        command::set_user_callback(scene_command, app_scenes_command_pre_cb);
+    }
+#endif
+
+    // Motion profile (fast / quiet / night) as Mode Select on the same endpoint.
+    ModeSelect::setSupportedModesManager(&s_motion_profile_modes);
+    cluster::mode_select::config_t mode_select_config;
+    snprintf(mode_select_config.mode_select_description, sizeof(mode_select_config.mode_select_description),
+             "Motion profile");
+    mode_select_config.current_mode = APP_MOTION_PROFILE_FAST;
+    cluster_t *mode_select_cluster = cluster::mode_select::create(endpoint, &mode_select_config, CLUSTER_FLAG_SERVER, 0);
+    ABORT_APP_ON_FAILURE(mode_select_cluster != nullptr, BS_LOG_ERROR("Failed to add motion profile Mode Select cluster"));
 
     esp_matter::endpoint::power_source::config_t power_source_config;
     power_source_config.power_source.feature_flags = esp_matter::cluster::power_source::feature::battery::get_id();
@@ -460,14 +1338,27 @@ extern "C" void app_main()
 
     MEMORY_PROFILER_DUMP_HEAP_STAT("matter started");
 
+    app_driver_set_battery_cb(battery_cutoff_cb);
     err = app_driver_init(window_covering_endpoint_id);
     ABORT_APP_ON_FAILURE(err == ESP_OK, BS_LOG_ERROR("Failed to init motor driver, err:%d", err));
     s_driver_ready.store(true);
     apply_led_state();
+    chip::DeviceLayer::PlatformMgr().ScheduleWork(motion_settings_report_work, 0);
+#if CONFIG_BS_SCENES
+    chip::DeviceLayer::PlatformMgr().ScheduleWork(scene_fabric_delegate_work, 0);
+#endif
 
     BaseType_t ok = xTaskCreate(battery_report_task, "battery_report", 3072, nullptr, 1, &s_battery_report_task);
     ABORT_APP_ON_FAILURE(ok == pdPASS, BS_LOG_ERROR("Failed to start battery report task"));
 
+    err = app_monitor_init();
+    ABORT_APP_ON_FAILURE(err == ESP_OK, BS_LOG_ERROR("Failed to start memory monitor, err:%d", err));
+
+#if CONFIG_BS_ICD_POLICY
+    err = app_icd_policy_init();
+    ABORT_APP_ON_FAILURE(err == ESP_OK, BS_LOG_ERROR("Failed to start ICD poll policy, err:%d", err));
+#endif
+
 #if CONFIG_ENABLE_ENCRYPTED_OTA
     err = esp_matter_ota_requestor_encrypted_init(s_decryption_key, s_decryption_key_len);
     ABORT_APP_ON_FAILURE(err == ESP_OK, BS_LOG_ERROR("Failed to init encrypted OTA, err: %d", err));
@@ -478,6 +1369,24 @@ extern "C" void app_main()
     esp_matter::console::wifi_register_commands();
     esp_matter::console::factoryreset_register_commands();
     esp_matter::console::attribute_register_commands();
+    app_monitor_register_commands();
+    app_driver_register_commands();
+    app_power_register_commands();
+    app_trace_register_commands();
+    app_postmortem_register_commands();
+    app_scenes_register_commands();
+    profile_register_commands();
+    param_register_commands();
+    app_bench_register_commands(window_covering_endpoint_id);
+#if CONFIG_BS_CURRENT_SENSE
+    current_register_commands();
+#endif
+#if CONFIG_BS_DUAL_MOTOR
+    lockstep_register_commands();
+#endif
+#if CONFIG_BS_ICD_POLICY
+    icd_register_commands();
+#endif
 #if CONFIG_OPENTHREAD_CLI
     esp_matter::console::otcli_register_commands();
 #endif
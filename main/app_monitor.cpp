@@ -0,0 +1,290 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <cstdlib>
+#include <cstring>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <esp_heap_caps.h>
+
+#if CONFIG_ENABLE_CHIP_SHELL
+#include <esp_matter_console.h>
+#endif
+
+#include "app_priv.h"
+#include "bs_log.h"
+
+#if CONFIG_BS_MONITOR
+namespace {
+// uxTaskGetSystemState() returns nothing at all when the array is short, so it is sized
+// from the live task count with room for tasks created between the count and the call.
+constexpr UBaseType_t k_task_headroom = 8;
+constexpr UBaseType_t k_max_tracked_tasks = 255; // s_task_count is a uint8_t
+constexpr TickType_t k_sample_period_ticks = pdMS_TO_TICKS(CONFIG_BS_MONITOR_PERIOD_MS);
+constexpr uint32_t k_stack_warn_bytes = 512;
+constexpr uint32_t k_largest_block_warn_bytes = 8 * 1024;
+constexpr uint32_t k_heap_caps = MALLOC_CAP_8BIT;
+
+struct task_record_t {
+    char name[configMAX_TASK_NAME_LEN];
+    uint32_t stack_hwm_min;
+    uint32_t stack_hwm_max;
+    uint32_t stack_hwm_last;
+    bool warned;
+};
+
+struct heap_record_t {
+    uint32_t free_last;
+    uint32_t free_min;
+    uint32_t free_max;
+    uint32_t largest_last;
+    uint32_t largest_min;
+    uint32_t largest_max;
+    uint32_t min_ever_free;
+    bool warned;
+};
+
+SemaphoreHandle_t s_monitor_lock = nullptr;
+TaskHandle_t s_monitor_task = nullptr;
+TaskStatus_t *s_task_status = nullptr; // both arrays hold s_task_capacity entries
+task_record_t *s_tasks = nullptr;
+UBaseType_t s_task_capacity = 0;
+uint8_t s_task_count = 0;
+bool s_task_snapshot_warned = false;
+heap_record_t s_heap = {};
+uint32_t s_samples = 0;
+
+task_record_t *find_or_add_task(const char *name)
+{
+    for (uint8_t i = 0; i < s_task_count; ++i) {
+        if (strncmp(s_tasks[i].name, name, sizeof(s_tasks[i].name)) == 0) {
+            return &s_tasks[i];
+        }
+    }
+    if (s_task_count >= s_task_capacity) {
+        return nullptr;
+    }
+    task_record_t *record = &s_tasks[s_task_count++];
+    strncpy(record->name, name, sizeof(record->name) - 1);
+    record->name[sizeof(record->name) - 1] = '\0';
+    record->stack_hwm_min = UINT32_MAX;
+    record->stack_hwm_max = 0;
+    record->stack_hwm_last = 0;
+    record->warned = false;
+    return record;
+}
+
+// Grow both arrays to hold `tasks` plus headroom. False, keeping the old ones, when out of memory.
+bool reserve_tasks_locked(UBaseType_t tasks)
+{
+    if (tasks <= s_task_capacity) {
+        return true;
+    }
+    UBaseType_t capacity = tasks + k_task_headroom;
+    capacity = capacity < k_max_tracked_tasks ? capacity : k_max_tracked_tasks;
+    auto *status = static_cast<TaskStatus_t *>(realloc(s_task_status, capacity * sizeof(TaskStatus_t)));
+    if (status) {
+        s_task_status = status;
+    }
+    auto *records = static_cast<task_record_t *>(realloc(s_tasks, capacity * sizeof(task_record_t)));
+    if (records) {
+        s_tasks = records;
+    }
+    if (!status || !records) {
+        return false;
+    }
+    s_task_capacity = capacity;
+    return true;
+}
+
+void sample_locked()
+{
+    // One snapshot of every task, so nothing is read from a TCB that is being deleted.
+    UBaseType_t tasks = uxTaskGetNumberOfTasks();
+    UBaseType_t count = reserve_tasks_locked(tasks) ? uxTaskGetSystemState(s_task_status, s_task_capacity, nullptr) : 0;
+    if (count == 0 && !s_task_snapshot_warned) {
+        s_task_snapshot_warned = true;
+        BS_LOG_ERROR("Task snapshot failed (%u tasks, room for %u): stack high-water marks are not tracked",
+                     static_cast<unsigned>(tasks), static_cast<unsigned>(s_task_capacity));
+    }
+    for (UBaseType_t i = 0; i < count; ++i) {
+        task_record_t *record = find_or_add_task(s_task_status[i].pcTaskName);
+        if (!record) {
+            continue;
+        }
+        uint32_t hwm = static_cast<uint32_t>(s_task_status[i].usStackHighWaterMark);
+        record->stack_hwm_last = hwm;
+        if (hwm < record->stack_hwm_min) {
+            record->stack_hwm_min = hwm;
+        }
+        if (hwm > record->stack_hwm_max) {
+            record->stack_hwm_max = hwm;
+        }
+        if (hwm < k_stack_warn_bytes && !record->warned) {
+            record->warned = true;
+            BS_LOG_WARN("Task %s stack high-water mark low: %u bytes left", record->name, static_cast<unsigned>(hwm));
+        }
+    }
+
+    uint32_t free_now = static_cast<uint32_t>(heap_caps_get_free_size(k_heap_caps));
+    uint32_t largest_now = static_cast<uint32_t>(heap_caps_get_largest_free_block(k_heap_caps));
+    if (s_samples == 0) {
+        s_heap.free_min = s_heap.free_max = free_now;
+        s_heap.largest_min = s_heap.largest_max = largest_now;
+    }
+    s_heap.free_last = free_now;
+    s_heap.largest_last = largest_now;
+    s_heap.free_min = free_now < s_heap.free_min ? free_now : s_heap.free_min;
+    s_heap.free_max = free_now > s_heap.free_max ? free_now : s_heap.free_max;
+    s_heap.largest_min = largest_now < s_heap.largest_min ? largest_now : s_heap.largest_min;
+    s_heap.largest_max = largest_now > s_heap.largest_max ? largest_now : s_heap.largest_max;
+    s_heap.min_ever_free = static_cast<uint32_t>(heap_caps_get_minimum_free_size(k_heap_caps));
+    if (largest_now < k_largest_block_warn_bytes && !s_heap.warned) {
+        s_heap.warned = true;
+        BS_LOG_WARN("Heap fragmented: largest block %u of %u bytes free", static_cast<unsigned>(largest_now),
+                    static_cast<unsigned>(free_now));
+    }
+    s_samples++;
+}
+
+uint32_t fragmentation_pct(uint32_t free_bytes, uint32_t largest_bytes)
+{
+    if (free_bytes == 0 || largest_bytes >= free_bytes) {
+        return 0;
+    }
+    return 100 - (largest_bytes * 100) / free_bytes;
+}
+
+void monitor_task(void *arg)
+{
+    (void)arg;
+    while (true) {
+        if (xSemaphoreTake(s_monitor_lock, portMAX_DELAY) == pdTRUE) {
+            sample_locked();
+            xSemaphoreGive(s_monitor_lock);
+        }
+        vTaskDelay(k_sample_period_ticks);
+    }
+}
+
+#if CONFIG_ENABLE_CHIP_SHELL
+esp_err_t memmon_command_handler(int argc, char **argv)
+{
+    if (argc >= 1 && strcmp(argv[0], "reset") == 0) {
+        app_monitor_reset();
+        BS_LOG_APP("memmon: rolling min/max reset");
+        return ESP_OK;
+    }
+    if (argc >= 1 && strcmp(argv[0], "dump") != 0) {
+        BS_LOG_WARN("usage: memmon [dump|reset]");
+        return ESP_ERR_INVALID_ARG;
+    }
+    app_monitor_dump();
+    return ESP_OK;
+}
+#endif
+} // namespace
+
+esp_err_t app_monitor_init()
+{
+    s_monitor_lock = xSemaphoreCreateMutex();
+    if (!s_monitor_lock) {
+        BS_LOG_ERROR("Failed to create monitor mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    BaseType_t ok = xTaskCreate(monitor_task, "mem_monitor", 3072, nullptr, 1, &s_monitor_task);
+    if (ok != pdPASS) {
+        BS_LOG_ERROR("Failed to start memory monitor task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void app_monitor_reset()
+{
+    if (!s_monitor_lock || xSemaphoreTake(s_monitor_lock, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    s_task_count = 0;
+    s_heap = {};
+    s_samples = 0;
+    sample_locked();
+    xSemaphoreGive(s_monitor_lock);
+}
+
+void app_monitor_dump()
+{
+    if (!s_monitor_lock || xSemaphoreTake(s_monitor_lock, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    sample_locked();
+    BS_LOG_STATE("Heap: free %u (min %u max %u) largest %u (min %u max %u) min-ever %u frag %u%%",
+                 static_cast<unsigned>(s_heap.free_last), static_cast<unsigned>(s_heap.free_min),
+                 static_cast<unsigned>(s_heap.free_max), static_cast<unsigned>(s_heap.largest_last),
+                 static_cast<unsigned>(s_heap.largest_min), static_cast<unsigned>(s_heap.largest_max),
+                 static_cast<unsigned>(s_heap.min_ever_free),
+                 static_cast<unsigned>(fragmentation_pct(s_heap.free_last, s_heap.largest_last)));
+    BS_LOG_STATE("Stack high-water (bytes left) over %u samples:", static_cast<unsigned>(s_samples));
+    for (uint8_t i = 0; i < s_task_count; ++i) {
+        const task_record_t &record = s_tasks[i];
+        BS_LOG_STATE("  %-16s last %5u min %5u max %5u", record.name, static_cast<unsigned>(record.stack_hwm_last),
+                     static_cast<unsigned>(record.stack_hwm_min), static_cast<unsigned>(record.stack_hwm_max));
+    }
+    xSemaphoreGive(s_monitor_lock);
+}
+
+void app_monitor_log_summary(const char *label)
+{
+    uint32_t free_now = static_cast<uint32_t>(heap_caps_get_free_size(k_heap_caps));
+    uint32_t largest_now = static_cast<uint32_t>(heap_caps_get_largest_free_block(k_heap_caps));
+    BS_LOG_STATE("[%s] heap free %u largest %u min-ever %u frag %u%%", label, static_cast<unsigned>(free_now),
+                 static_cast<unsigned>(largest_now),
+                 static_cast<unsigned>(heap_caps_get_minimum_free_size(k_heap_caps)),
+                 static_cast<unsigned>(fragmentation_pct(free_now, largest_now)));
+}
+
+esp_err_t app_monitor_register_commands()
+{
+#if CONFIG_ENABLE_CHIP_SHELL
+    static const esp_matter::console::command_t command = {
+        .name = "memmon",
+        .description = "Stack high-water / heap monitor. Usage: matter memmon [dump|reset]",
+        .handler = memmon_command_handler,
+    };
+    return esp_matter::console::add_commands(&command, 1);
+#else
+    return ESP_OK;
+#endif
+}
+
+#else // CONFIG_BS_MONITOR
+
+esp_err_t app_monitor_init()
+{
+    return ESP_OK;
+}
+
+void app_monitor_reset() {}
+
+void app_monitor_dump() {}
+
+void app_monitor_log_summary(const char *label)
+{
+    (void)label;
+}
+
+esp_err_t app_monitor_register_commands()
+{
+    return ESP_OK;
+}
+
+#endif // CONFIG_BS_MONITOR
@@ -0,0 +1,497 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Post-mortem records (bs_postmortem.h). The running boot only ever writes RAM: the
+// driver refreshes a motor snapshot on every update pass and a low-priority task
+// refreshes per-task CPU figures, both in .noinit next to the trace ring. A panic,
+// watchdog or brownout reset leaves that RAM alone, and the next boot, with the
+// supply back up, seals it into the postmortem partition before anything else runs.
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <esp_attr.h>
+#include <esp_partition.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+
+#if CONFIG_ENABLE_CHIP_SHELL
+#include <esp_matter_console.h>
+#endif
+
+#include "app_priv.h"
+#include "bs_log.h"
+
+#if CONFIG_BS_POSTMORTEM
+namespace {
+constexpr char k_partition_label[] = "postmortem";
+constexpr uint32_t k_live_magic = 0x4c505342 + BS_POSTMORTEM_VERSION; // "BSPL"
+constexpr uint32_t k_task_window_ms = 2000;
+constexpr uint8_t k_max_sampled_tasks = 24;
+constexpr uint32_t k_sampler_task_stack = 3072;
+constexpr size_t k_chunk_records = 32;
+constexpr size_t k_tasks_offset = offsetof(bs_postmortem_record_t, tasks);
+constexpr size_t k_trace_offset = offsetof(bs_postmortem_record_t, trace);
+#if CONFIG_BS_TRACE
+constexpr uint32_t k_trace_ring_records = CONFIG_BS_TRACE_RECORDS;
+#else
+constexpr uint32_t k_trace_ring_records = 0;
+#endif
+
+// Each snapshot has a sequence counter that is odd while it is being rewritten, so a
+// reset in the middle shows up as torn instead of as a mix of two snapshots.
+struct live_t {
+    uint32_t magic;
+    std::atomic<uint32_t> motor_seq;
+    bs_postmortem_motor_t motor;
+    std::atomic<uint32_t> tasks_seq;
+    uint32_t tasks_uptime_ms;
+    uint8_t task_count;
+    bs_postmortem_task_t tasks[BS_POSTMORTEM_TASKS];
+};
+
+__NOINIT_ATTR live_t s_live;
+
+const esp_partition_t *s_partition = nullptr;
+uint32_t s_slots = 0;
+
+void begin_snapshot(std::atomic<uint32_t> &seq)
+{
+    seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void end_snapshot(std::atomic<uint32_t> &seq)
+{
+    seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+uint32_t uptime_ms()
+{
+    return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+}
+
+// Header of `slot` if it holds a whole record whose CRC matches.
+bool read_slot(uint32_t slot, bs_postmortem_header_t *header)
+{
+    uint32_t base = slot * BS_POSTMORTEM_SLOT_BYTES;
+    if (esp_partition_read(s_partition, base, header, sizeof(*header)) != ESP_OK ||
+        !bs_postmortem_header_ok(*header)) {
+        return false;
+    }
+    uint32_t crc = bs_postmortem_crc32(reinterpret_cast<const uint8_t *>(header) + BS_POSTMORTEM_CRC_START,
+                                       sizeof(*header) - BS_POSTMORTEM_CRC_START);
+    uint8_t chunk[256];
+    for (uint32_t offset = sizeof(*header); offset < header->size; offset += sizeof(chunk)) {
+        uint32_t len = header->size - offset < sizeof(chunk) ? header->size - offset : sizeof(chunk);
+        if (esp_partition_read(s_partition, base + offset, chunk, len) != ESP_OK) {
+            return false;
+        }
+        crc = bs_postmortem_crc32(chunk, len, crc);
+    }
+    return crc == header->crc32;
+}
+
+// Newest record's slot, or -1. `free_slot` gets the slot the next record goes to: an
+// empty one if there is any, else the oldest.
+int find_newest(bs_postmortem_header_t *newest, uint32_t *free_slot)
+{
+    int newest_slot = -1;
+    int oldest_slot = -1;
+    int empty_slot = -1;
+    uint32_t oldest_sequence = UINT32_MAX;
+    for (uint32_t slot = 0; slot < s_slots; ++slot) {
+        bs_postmortem_header_t header;
+        if (!read_slot(slot, &header)) {
+            empty_slot = empty_slot < 0 ? static_cast<int>(slot) : empty_slot;
+            continue;
+        }
+        if (newest_slot < 0 || header.sequence > newest->sequence) {
+            newest_slot = static_cast<int>(slot);
+            *newest = header;
+        }
+        if (header.sequence < oldest_sequence) {
+            oldest_sequence = header.sequence;
+            oldest_slot = static_cast<int>(slot);
+        }
+    }
+    if (free_slot) {
+        *free_slot = static_cast<uint32_t>(empty_slot >= 0 ? empty_slot : (oldest_slot >= 0 ? oldest_slot : 0));
+    }
+    return newest_slot;
+}
+
+esp_err_t write_part(uint32_t base, size_t offset, const void *data, size_t len, uint32_t *crc)
+{
+    *crc = bs_postmortem_crc32(data, len, *crc);
+    return esp_partition_write(s_partition, base + offset, data, len);
+}
+
+// Seals the previous boot's RAM into the next slot. The header goes last, so a record
+// cut short by another reset never validates.
+esp_err_t save_record(uint32_t reset_reason, uint32_t trace_written, bs_postmortem_header_t *out)
+{
+    bs_postmortem_header_t newest = {};
+    uint32_t slot = 0;
+    bool have_newest = find_newest(&newest, &slot) >= 0;
+
+    bs_postmortem_header_t header = {};
+    header.magic = BS_POSTMORTEM_MAGIC;
+    header.version = BS_POSTMORTEM_VERSION;
+    header.size = sizeof(bs_postmortem_record_t);
+    header.sequence = have_newest ? newest.sequence + 1 : 1;
+    header.reset_reason = reset_reason;
+    header.uptime_ms = s_live.motor.uptime_ms > s_live.tasks_uptime_ms ? s_live.motor.uptime_ms : s_live.tasks_uptime_ms;
+    header.trace_written = trace_written;
+    uint32_t held = trace_written < k_trace_ring_records ? trace_written : k_trace_ring_records;
+    header.trace_count = static_cast<uint16_t>(held < BS_POSTMORTEM_TRACE_RECORDS ? held : BS_POSTMORTEM_TRACE_RECORDS);
+    header.task_count = s_live.task_count < BS_POSTMORTEM_TASKS ? s_live.task_count : BS_POSTMORTEM_TASKS;
+    header.flags = ((s_live.motor_seq.load() & 1) ? BS_POSTMORTEM_MOTOR_TORN : 0) |
+                   ((s_live.tasks_seq.load() & 1) ? BS_POSTMORTEM_TASKS_TORN : 0);
+    header.task_window_ms = k_task_window_ms;
+
+    uint32_t base = slot * BS_POSTMORTEM_SLOT_BYTES;
+    esp_err_t err = esp_partition_erase_range(s_partition, base, BS_POSTMORTEM_SLOT_BYTES);
+    uint32_t crc = bs_postmortem_crc32(reinterpret_cast<const uint8_t *>(&header) + BS_POSTMORTEM_CRC_START,
+                                       sizeof(header) - BS_POSTMORTEM_CRC_START);
+    if (err == ESP_OK) {
+        err = write_part(base, sizeof(header), &s_live.motor, sizeof(s_live.motor), &crc);
+    }
+    if (err == ESP_OK) {
+        bs_postmortem_task_t tasks[BS_POSTMORTEM_TASKS] = {};
+        memcpy(tasks, s_live.tasks, header.task_count * sizeof(tasks[0]));
+        err = write_part(base, k_tasks_offset, tasks, sizeof(tasks), &crc);
+    }
+    uint32_t first = held - header.trace_count;
+    for (size_t done = 0; err == ESP_OK && done < BS_POSTMORTEM_TRACE_RECORDS; done += k_chunk_records) {
+        bs_trace_record_t chunk[k_chunk_records] = {};
+        for (size_t i = 0; i < k_chunk_records && done + i < header.trace_count; ++i) {
+            app_trace_get(static_cast<uint32_t>(first + done + i), &chunk[i]);
+        }
+        err = write_part(base, k_trace_offset + done * sizeof(chunk[0]), chunk, sizeof(chunk), &crc);
+    }
+    header.crc32 = crc;
+    if (err == ESP_OK) {
+        err = esp_partition_write(s_partition, base, &header, sizeof(header));
+    }
+    *out = header;
+    return err;
+}
+
+void reset_live()
+{
+    s_live.magic = k_live_magic;
+    s_live.motor_seq.store(0);
+    s_live.motor = {};
+    s_live.tasks_seq.store(0);
+    s_live.tasks_uptime_ms = 0;
+    s_live.task_count = 0;
+}
+
+#if configUSE_TRACE_FACILITY
+using run_time_t = decltype(TaskStatus_t::ulRunTimeCounter);
+
+struct task_run_time_t {
+    UBaseType_t number;
+    run_time_t run_time;
+};
+
+StaticTask_t s_sampler_task_tcb;
+StackType_t s_sampler_task_stack[k_sampler_task_stack];
+TaskHandle_t s_sampler_task = nullptr;
+TaskStatus_t s_task_status[k_max_sampled_tasks];
+task_run_time_t s_last_run_time[k_max_sampled_tasks] = {};
+UBaseType_t s_last_task_count = 0;
+run_time_t s_last_total = 0;
+
+run_time_t last_run_time(UBaseType_t number, run_time_t fallback)
+{
+    for (UBaseType_t i = 0; i < s_last_task_count; ++i) {
+        if (s_last_run_time[i].number == number) {
+            return s_last_run_time[i].run_time;
+        }
+    }
+    return fallback; // started within the window
+}
+
+// Keeps the busiest tasks of the last window. Run-time counters need
+// CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS; without it every share reads 0.
+void sample_tasks()
+{
+    run_time_t total = 0;
+    UBaseType_t count = uxTaskGetSystemState(s_task_status, k_max_sampled_tasks, &total);
+    run_time_t window = total - s_last_total;
+    uint32_t delta[k_max_sampled_tasks];
+    uint8_t order[k_max_sampled_tasks];
+    for (UBaseType_t i = 0; i < count; ++i) {
+        const TaskStatus_t &task = s_task_status[i];
+        delta[i] = static_cast<uint32_t>(task.ulRunTimeCounter - last_run_time(task.xTaskNumber, task.ulRunTimeCounter));
+        uint8_t at = static_cast<uint8_t>(i);
+        for (; at > 0 && delta[order[at - 1]] < delta[i]; --at) {
+            order[at] = order[at - 1];
+        }
+        order[at] = static_cast<uint8_t>(i);
+    }
+
+    uint8_t kept = count < BS_POSTMORTEM_TASKS ? static_cast<uint8_t>(count) : BS_POSTMORTEM_TASKS;
+    begin_snapshot(s_live.tasks_seq);
+    for (uint8_t i = 0; i < kept; ++i) {
+        const TaskStatus_t &task = s_task_status[order[i]];
+        bs_postmortem_task_t &out = s_live.tasks[i];
+        strncpy(out.name, task.pcTaskName, sizeof(out.name) - 1);
+        out.name[sizeof(out.name) - 1] = '\0';
+        out.run_time = delta[order[i]];
+        out.cpu_permille = window ? static_cast<uint16_t>(static_cast<uint64_t>(delta[order[i]]) * 1000 / window) : 0;
+        out.stack_hwm = static_cast<uint16_t>(task.usStackHighWaterMark);
+    }
+    s_live.task_count = kept;
+    s_live.tasks_uptime_ms = uptime_ms();
+    end_snapshot(s_live.tasks_seq);
+
+    for (UBaseType_t i = 0; i < count; ++i) {
+        s_last_run_time[i] = {s_task_status[i].xTaskNumber, s_task_status[i].ulRunTimeCounter};
+    }
+    s_last_task_count = count;
+    s_last_total = total;
+}
+
+void sampler_task(void *arg)
+{
+    (void)arg;
+    while (true) {
+        sample_tasks();
+        vTaskDelay(pdMS_TO_TICKS(k_task_window_ms));
+    }
+}
+#endif // configUSE_TRACE_FACILITY
+
+void log_record(const bs_postmortem_header_t &header, const bs_postmortem_motor_t &motor)
+{
+    BS_LOG_STATE("Post-mortem #%u: %s reset after %u.%03u s uptime%s", static_cast<unsigned>(header.sequence),
+                 bs_postmortem_reset_name(header.reset_reason), static_cast<unsigned>(header.uptime_ms / 1000),
+                 static_cast<unsigned>(header.uptime_ms % 1000),
+                 (header.flags & (BS_POSTMORTEM_MOTOR_TORN | BS_POSTMORTEM_TASKS_TORN)) ? " (snapshot torn)" : "");
+    BS_LOG_STATE("  motor at %u.%03u s: %u.%02u%% (%u / %u steps), target %u.%02u%%, %s%s%s, battery %u mV",
+                 static_cast<unsigned>(motor.uptime_ms / 1000), static_cast<unsigned>(motor.uptime_ms % 1000),
+                 static_cast<unsigned>(motor.current_percent100ths / 100),
+                 static_cast<unsigned>(motor.current_percent100ths % 100), static_cast<unsigned>(motor.current_steps),
+                 static_cast<unsigned>(motor.travel_steps), static_cast<unsigned>(motor.target_percent100ths / 100),
+                 static_cast<unsigned>(motor.target_percent100ths % 100),
+                 (motor.flags & BS_POSTMORTEM_MOVING) ? (motor.dir > 0 ? "moving down" : "moving up") : "idle",
+                 (motor.flags & BS_POSTMORTEM_STOPPED_EARLY) ? ", last move stopped early" : "",
+                 (motor.flags & BS_POSTMORTEM_CALIBRATING) ? ", calibrating" : "",
+                 static_cast<unsigned>(motor.battery_mv));
+}
+
+#if CONFIG_ENABLE_CHIP_SHELL
+esp_err_t postmortem_command_handler(int argc, char **argv)
+{
+    if (argc == 0 || strcmp(argv[0], "show") == 0) {
+        app_postmortem_dump(false);
+    } else if (strcmp(argv[0], "trace") == 0) {
+        app_postmortem_dump(true);
+    } else if (strcmp(argv[0], "clear") == 0) {
+        esp_err_t err = app_postmortem_clear();
+        if (err != ESP_OK) {
+            BS_LOG_WARN("postmortem: clear failed (%d)", err);
+            return err;
+        }
+        BS_LOG_APP("postmortem: cleared");
+    } else {
+        BS_LOG_WARN("usage: postmortem [show|trace|clear]");
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+#endif
+} // namespace
+
+esp_err_t app_postmortem_init()
+{
+    uint32_t trace_written = app_trace_recover();
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool left_over = s_live.magic == k_live_magic && reason != ESP_RST_POWERON;
+
+    s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, k_partition_label);
+    s_slots = s_partition ? s_partition->size / BS_POSTMORTEM_SLOT_BYTES : 0;
+    if (s_slots == 0) {
+        BS_LOG_WARN("No \"%s\" partition: post-mortem records are not kept", k_partition_label);
+    } else if (left_over) {
+        bs_postmortem_header_t header = {};
+        esp_err_t err = save_record(reason, trace_written, &header);
+        if (err != ESP_OK) {
+            BS_LOG_ERROR("Post-mortem record not saved, err:%d", err);
+        } else if (reason == ESP_RST_SW) {
+            BS_LOG_APP("Post-mortem #%u saved: software reset after %u s", static_cast<unsigned>(header.sequence),
+                       static_cast<unsigned>(header.uptime_ms / 1000));
+        } else {
+            BS_LOG_WARN("Post-mortem #%u saved: %s reset after %u s, %u trace records; `matter postmortem` shows it",
+                        static_cast<unsigned>(header.sequence), bs_postmortem_reset_name(reason),
+                        static_cast<unsigned>(header.uptime_ms / 1000), static_cast<unsigned>(header.trace_count));
+        }
+    }
+
+    app_trace_clear();
+    reset_live();
+#if configUSE_TRACE_FACILITY
+    if (!s_sampler_task) {
+        s_sampler_task = xTaskCreateStatic(sampler_task, "postmortem", k_sampler_task_stack, nullptr, 1,
+                                           s_sampler_task_stack, &s_sampler_task_tcb);
+        if (!s_sampler_task) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+#endif
+    return ESP_OK;
+}
+
+void app_postmortem_note_motor(const app_driver_state_t *state, uint16_t battery_mv)
+{
+    if (s_live.magic != k_live_magic) {
+        return; // before app_postmortem_init()
+    }
+    begin_snapshot(s_live.motor_seq);
+    bs_postmortem_motor_t &motor = s_live.motor;
+    motor.uptime_ms = uptime_ms();
+    motor.current_percent100ths = state->current_percent100ths;
+    motor.target_percent100ths = state->target_percent100ths;
+    motor.current_steps = state->current_steps;
+    motor.target_steps = state->target_steps;
+    motor.travel_steps = state->travel_steps;
+    motor.battery_mv = battery_mv;
+    motor.dir = state->dir;
+    motor.flags = (state->moving ? BS_POSTMORTEM_MOVING : 0) | (state->stopped_early ? BS_POSTMORTEM_STOPPED_EARLY : 0) |
+                  (state->calibrating ? BS_POSTMORTEM_CALIBRATING : 0);
+    end_snapshot(s_live.motor_seq);
+}
+
+esp_err_t app_postmortem_get_last(bs_postmortem_header_t *header, bs_postmortem_motor_t *motor)
+{
+    if (!header || !motor) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_slots == 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    int slot = find_newest(header, nullptr);
+    if (slot < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return esp_partition_read(s_partition, slot * BS_POSTMORTEM_SLOT_BYTES + sizeof(*header), motor, sizeof(*motor));
+}
+
+void app_postmortem_dump(bool trace)
+{
+    bs_postmortem_header_t header = {};
+    int slot = s_slots ? find_newest(&header, nullptr) : -1;
+    if (slot < 0) {
+        BS_LOG_STATE("Post-mortem: %s", s_slots ? "no record" : "no partition");
+        return;
+    }
+    uint32_t base = slot * BS_POSTMORTEM_SLOT_BYTES;
+
+    if (trace) {
+        BS_LOG_STATE("Post-mortem #%u trace: newest %u of %u records", static_cast<unsigned>(header.sequence),
+                     static_cast<unsigned>(header.trace_count), static_cast<unsigned>(header.trace_written));
+        bs_trace_clock clock;
+        char line[64];
+        for (uint16_t done = 0; done < header.trace_count; done += k_chunk_records) {
+            bs_trace_record_t chunk[k_chunk_records];
+            if (esp_partition_read(s_partition, base + k_trace_offset + done * sizeof(chunk[0]), chunk,
+                                   sizeof(chunk)) != ESP_OK) {
+                return;
+            }
+            for (uint16_t i = 0; i < k_chunk_records && done + i < header.trace_count; ++i) {
+                bs_trace_format(line, sizeof(line), clock.unwrap(chunk[i].time_us), chunk[i]);
+                printf("%s\n", line);
+            }
+        }
+        return;
+    }
+
+    bs_postmortem_motor_t motor;
+    bs_postmortem_task_t tasks[BS_POSTMORTEM_TASKS];
+    if (esp_partition_read(s_partition, base + sizeof(header), &motor, sizeof(motor)) != ESP_OK ||
+        esp_partition_read(s_partition, base + k_tasks_offset, tasks, sizeof(tasks)) != ESP_OK) {
+        return;
+    }
+    log_record(header, motor);
+    printf("  %-16s %7s %10s %11s   (last %u ms)\n", "task", "CPU", "run time", "stack free",
+           static_cast<unsigned>(header.task_window_ms));
+    for (uint8_t i = 0; i < header.task_count; ++i) {
+        printf("  %-16.16s %5u.%u%% %10u %9u B\n", tasks[i].name, static_cast<unsigned>(tasks[i].cpu_permille / 10),
+               static_cast<unsigned>(tasks[i].cpu_permille % 10), static_cast<unsigned>(tasks[i].run_time),
+               static_cast<unsigned>(tasks[i].stack_hwm));
+    }
+    printf("  trace: newest %u of %u records (`matter postmortem trace`)\n", static_cast<unsigned>(header.trace_count),
+           static_cast<unsigned>(header.trace_written));
+}
+
+esp_err_t app_postmortem_clear()
+{
+    if (s_slots == 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return esp_partition_erase_range(s_partition, 0, s_slots * BS_POSTMORTEM_SLOT_BYTES);
+}
+
+esp_err_t app_postmortem_register_commands()
+{
+#if CONFIG_ENABLE_CHIP_SHELL
+    static const esp_matter::console::command_t command = {
+        .name = "postmortem",
+        .description = "Record the previous boot left behind: reset reason, motor state, task CPU and trace. "
+                       "Usage: matter postmortem [show|trace|clear]",
+        .handler = postmortem_command_handler,
+    };
+    return esp_matter::console::add_commands(&command, 1);
+#else
+    return ESP_OK;
+#endif
+}
+
+#else // CONFIG_BS_POSTMORTEM
+
+esp_err_t app_postmortem_init()
+{
+    return ESP_OK;
+}
+
+void app_postmortem_note_motor(const app_driver_state_t *state, uint16_t battery_mv)
+{
+    (void)state;
+    (void)battery_mv;
+}
+
+esp_err_t app_postmortem_get_last(bs_postmortem_header_t *header, bs_postmortem_motor_t *motor)
+{
+    (void)header;
+    (void)motor;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void app_postmortem_dump(bool trace)
+{
+    (void)trace;
+}
+
+esp_err_t app_postmortem_clear()
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t app_postmortem_register_commands()
+{
+    return ESP_OK;
+}
+
+#endif // CONFIG_BS_POSTMORTEM
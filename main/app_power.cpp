@@ -0,0 +1,245 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <cstring>
+
+#include <freertos/FreeRTOS.h>
+
+#include <esp_attr.h>
+#include <esp_pm.h>
+#include <esp_timer.h>
+
+#if CONFIG_ENABLE_CHIP_SHELL
+#include <esp_matter_console.h>
+#endif
+
+#include "app_priv.h"
+#include "bs_log.h"
+
+#if CONFIG_BS_POWER_SAVE
+namespace {
+struct power_lock_t {
+    esp_pm_lock_type_t type;
+    const char *name;
+    esp_pm_lock_handle_t handle;
+    bool held;
+    int64_t held_since_us;
+};
+
+// Indexed by app_power_lock_t. Any held lock keeps the chip out of light sleep; the
+// motion lock also pins the CPU at full clock so step timing does not stretch.
+power_lock_t s_locks[APP_POWER_LOCK_COUNT] = {
+    {ESP_PM_CPU_FREQ_MAX, "bs_motion", nullptr, false, 0},
+    {ESP_PM_NO_LIGHT_SLEEP, "bs_led", nullptr, false, 0},
+    {ESP_PM_APB_FREQ_MAX, "bs_adc", nullptr, false, 0},
+};
+
+// Guards the counters below; the sleep exit callback runs on the idle task with
+// interrupts masked.
+portMUX_TYPE s_power_mux = portMUX_INITIALIZER_UNLOCKED;
+app_power_stats_t s_stats = {};
+int64_t s_window_start_us = 0;
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+esp_err_t IRAM_ATTR light_sleep_exit_cb(int64_t sleep_time_us, void *arg)
+{
+    (void)arg;
+    portENTER_CRITICAL_SAFE(&s_power_mux);
+    s_stats.sleep_us += static_cast<uint64_t>(sleep_time_us);
+    s_stats.sleep_count++;
+    portEXIT_CRITICAL_SAFE(&s_power_mux);
+    return ESP_OK;
+}
+#endif
+
+uint32_t permille(uint64_t part, uint64_t whole)
+{
+    return whole == 0 ? 0 : static_cast<uint32_t>((part * 1000) / whole);
+}
+
+#if CONFIG_ENABLE_CHIP_SHELL
+esp_err_t power_command_handler(int argc, char **argv)
+{
+    if (argc >= 1 && strcmp(argv[0], "reset") == 0) {
+        app_power_reset();
+        BS_LOG_APP("power: accounting window reset");
+        return ESP_OK;
+    }
+    if (argc >= 1 && strcmp(argv[0], "dump") != 0) {
+        BS_LOG_WARN("usage: power [dump|reset]");
+        return ESP_ERR_INVALID_ARG;
+    }
+    app_power_dump();
+    return ESP_OK;
+}
+#endif
+} // namespace
+
+esp_err_t app_power_init()
+{
+    esp_pm_config_t pm_config = {};
+    pm_config.max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    pm_config.min_freq_mhz = CONFIG_XTAL_FREQ;
+    pm_config.light_sleep_enable = true;
+    esp_err_t err = esp_pm_configure(&pm_config);
+    if (err != ESP_OK) {
+        BS_LOG_ERROR("Failed to enable automatic light sleep: %d", err);
+        return err;
+    }
+
+    for (power_lock_t &lock : s_locks) {
+        err = esp_pm_lock_create(lock.type, 0, lock.name, &lock.handle);
+        if (err != ESP_OK) {
+            BS_LOG_ERROR("Failed to create PM lock %s: %d", lock.name, err);
+            return err;
+        }
+    }
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+    esp_pm_sleep_cbs_register_config_t cbs = {};
+    cbs.exit_cb = light_sleep_exit_cb;
+    err = esp_pm_light_sleep_register_cbs(&cbs);
+    if (err != ESP_OK) {
+        BS_LOG_ERROR("Failed to register light sleep callback: %d", err);
+        return err;
+    }
+    s_stats.sleep_tracked = true;
+#endif
+
+    s_window_start_us = esp_timer_get_time();
+    BS_LOG_STATE("Power save: automatic light sleep, CPU %u-%u MHz",
+                 static_cast<unsigned>(pm_config.min_freq_mhz), static_cast<unsigned>(pm_config.max_freq_mhz));
+    return ESP_OK;
+}
+
+void app_power_hold(app_power_lock_t lock, bool hold)
+{
+    if (lock >= APP_POWER_LOCK_COUNT) {
+        return;
+    }
+    power_lock_t &entry = s_locks[lock];
+    if (!entry.handle || entry.held == hold) {
+        return;
+    }
+
+    if (hold) {
+        esp_pm_lock_acquire(entry.handle);
+    }
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_power_mux);
+    if (hold) {
+        entry.held_since_us = now;
+        s_stats.lock_acquired[lock]++;
+    } else {
+        s_stats.lock_held_us[lock] += static_cast<uint64_t>(now - entry.held_since_us);
+    }
+    entry.held = hold;
+    portEXIT_CRITICAL(&s_power_mux);
+    if (!hold) {
+        esp_pm_lock_release(entry.handle);
+    }
+}
+
+esp_err_t app_power_get_stats(app_power_stats_t *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_power_mux);
+    *stats = s_stats;
+    for (uint8_t i = 0; i < APP_POWER_LOCK_COUNT; ++i) {
+        if (s_locks[i].held) {
+            stats->lock_held_us[i] += static_cast<uint64_t>(now - s_locks[i].held_since_us);
+        }
+    }
+    portEXIT_CRITICAL(&s_power_mux);
+    stats->window_us = static_cast<uint64_t>(now - s_window_start_us);
+    return ESP_OK;
+}
+
+void app_power_reset()
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_power_mux);
+    bool sleep_tracked = s_stats.sleep_tracked;
+    s_stats = {};
+    s_stats.sleep_tracked = sleep_tracked;
+    for (power_lock_t &lock : s_locks) {
+        lock.held_since_us = now;
+    }
+    s_window_start_us = now;
+    portEXIT_CRITICAL(&s_power_mux);
+}
+
+void app_power_dump()
+{
+    app_power_stats_t stats = {};
+    app_power_get_stats(&stats);
+    uint32_t window_s = static_cast<uint32_t>(stats.window_us / 1000000);
+    if (stats.sleep_tracked) {
+        uint32_t sleep_pm = permille(stats.sleep_us, stats.window_us);
+        BS_LOG_STATE("Power: %us window, asleep %u.%u%% (%u entries), awake %us",
+                     static_cast<unsigned>(window_s), static_cast<unsigned>(sleep_pm / 10),
+                     static_cast<unsigned>(sleep_pm % 10), static_cast<unsigned>(stats.sleep_count),
+                     static_cast<unsigned>((stats.window_us - stats.sleep_us) / 1000000));
+    } else {
+        BS_LOG_STATE("Power: %us window, sleep time not tracked (CONFIG_PM_LIGHT_SLEEP_CALLBACKS off)",
+                     static_cast<unsigned>(window_s));
+    }
+    for (uint8_t i = 0; i < APP_POWER_LOCK_COUNT; ++i) {
+        uint32_t held_pm = permille(stats.lock_held_us[i], stats.window_us);
+        BS_LOG_STATE("  %-10s held %u ms (%u.%u%%) x%u", s_locks[i].name,
+                     static_cast<unsigned>(stats.lock_held_us[i] / 1000), static_cast<unsigned>(held_pm / 10),
+                     static_cast<unsigned>(held_pm % 10), static_cast<unsigned>(stats.lock_acquired[i]));
+    }
+}
+
+esp_err_t app_power_register_commands()
+{
+#if CONFIG_ENABLE_CHIP_SHELL
+    static const esp_matter::console::command_t command = {
+        .name = "power",
+        .description = "Light sleep vs. active time and driver PM locks. Usage: matter power [dump|reset]",
+        .handler = power_command_handler,
+    };
+    return esp_matter::console::add_commands(&command, 1);
+#else
+    return ESP_OK;
+#endif
+}
+
+#else // CONFIG_BS_POWER_SAVE
+
+esp_err_t app_power_init()
+{
+    return ESP_OK;
+}
+
+void app_power_hold(app_power_lock_t lock, bool hold)
+{
+    (void)lock;
+    (void)hold;
+}
+
+esp_err_t app_power_get_stats(app_power_stats_t *stats)
+{
+    (void)stats;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void app_power_reset() {}
+
+void app_power_dump() {}
+
+esp_err_t app_power_register_commands()
+{
+    return ESP_OK;
+}
+
+#endif // CONFIG_BS_POWER_SAVE
@@ -11,19 +11,194 @@
 #include <esp_err.h>
 #include <stdint.h>
 
+#include "bs_move_log.h"
+#include "bs_postmortem.h"
+#include "bs_scene_table.h"
+#include "bs_trace.h"
+
 typedef void *app_driver_handle_t;
 
 typedef struct {
     uint32_t voltage_mv;
     uint8_t percent;
     bool valid;
+    bool undervoltage;       /* cutoff tripped: moves refused until the pack recovers at rest */
+    uint16_t cutoff_trip_mv; /* reading that tripped the cutoff last, 0 if it never did */
+    uint32_t cutoff_trips;
 } app_battery_status_t;
 
+typedef struct {
+    uint32_t count;                /* hard stops acknowledged by the step generator */
+    uint32_t last_en_latency_ns;   /* stop request -> EN driven high */
+    uint32_t max_en_latency_ns;
+    uint32_t last_halt_latency_us; /* stop request -> step generator halted */
+    uint32_t max_halt_latency_us;
+} app_stop_stats_t;
+
+typedef struct {
+    uint32_t submitted; /* GoTo + Stop commands accepted into the queue */
+    uint32_t applied;   /* commands the step generator acted on */
+    uint32_t coalesced; /* superseded by a newer GoTo or a Stop before being applied */
+    uint32_t rejected;  /* queue full or blocked by calibration */
+    uint32_t stops;
+} app_command_stats_t;
+
+typedef struct {
+    int8_t motion_core;               /* core the driver tasks are pinned to, -1 when unpinned */
+    uint32_t step_intervals;          /* consecutive step-to-step intervals measured */
+    int32_t step_dev_min_us;          /* interval minus nominal (pulse + ramp delay) */
+    int32_t step_dev_max_us;
+    uint32_t step_late;               /* intervals more than 50 us over nominal */
+    uint32_t commands;                /* GoTo commands picked up by the step generator */
+    uint32_t command_latency_last_us; /* submit on the CHIP thread -> picked up */
+    uint32_t command_latency_max_us;
+    uint32_t command_latency_avg_us;
+    uint32_t reports_dropped;         /* position reports lost to a full ring */
+    uint32_t steps;                   /* steps issued */
+    uint32_t reports;                 /* position reports queued for the CHIP thread */
+    uint32_t lock_takes;              /* s_state_lock takes by the step generator */
+    uint32_t lock_wait_total_us;      /* time the step generator waited for them */
+    uint32_t lock_wait_max_us;
+} app_motion_bench_t;
+
+typedef struct {
+    uint16_t current_percent100ths;
+    uint16_t target_percent100ths;
+    uint16_t current_steps;
+    uint16_t target_steps;
+    uint16_t travel_steps; /* calibrated bottom */
+    int8_t dir;            /* +1 down, -1 up, 0 idle */
+    bool moving;
+    bool stopped_early;    /* the last move was cut short by a stop */
+    bool calibrating;
+} app_driver_state_t;
+
+typedef enum {
+    APP_BENCH_SWEEP = 0, /* 0 -> 100 -> 0% */
+    APP_BENCH_HOPS,      /* ten 2% hops, each run to a standstill */
+    APP_BENCH_RETARGET,  /* a new target every 50 ms, then run to a standstill */
+    APP_BENCH_COUNT
+} app_bench_script_t;
+
+typedef struct {
+    const char *name;
+    uint32_t duration_ms;        /* first command -> standstill */
+    uint32_t steps;
+    uint32_t steps_per_s;        /* achieved rate over the run */
+    int32_t jitter_min_us;       /* step interval minus nominal */
+    int32_t jitter_max_us;
+    uint32_t late_steps;         /* more than 50 us over nominal */
+    uint32_t lock_wait_avg_us;   /* per s_state_lock take by the step generator */
+    uint32_t lock_wait_max_us;
+    uint32_t reports;            /* position reports */
+    uint32_t command_latency_max_us;
+    bool completed;              /* false when the blind did not come to rest in time */
+} app_bench_result_t;
+
+typedef struct {
+    uint32_t moves_checked;     /* moves compared against the encoder */
+    uint32_t drift_corrections; /* moves that ended off by more than the tolerance */
+    uint32_t stalls;            /* moves the encoder saw under half of */
+    uint32_t max_error_steps;   /* largest |encoder - step count| at the end of a move */
+    int32_t measured_steps;     /* encoder position now, in steps from home */
+    uint16_t commanded_steps;   /* step count now */
+} app_encoder_stats_t;
+
+typedef struct {
+    uint16_t current_ma;    /* motor current, latest reading while stepping */
+    uint16_t running_ma;    /* running current the current or last move learnt */
+    uint16_t peak_ma;       /* highest smoothed reading of the current or last move */
+    uint16_t trip_ma;       /* smoothed reading that stopped the motor last, 0 if none did */
+    uint32_t obstructions;  /* moves stopped by a load spike mid-travel (ObstacleDetected) */
+    uint32_t end_stops;     /* moves stopped by a load spike at the end they headed for */
+} app_load_stats_t;
+
+typedef struct {
+    int16_t trim_steps;        /* motor B offset from motor A, applied */
+    int16_t trim_target_steps; /* offset asked for; differs while the trim is being stepped out */
+    uint32_t edges;            /* STEP rising edges written to both motors at once */
+    uint32_t misaligned_edges; /* edges read back with only one of the two STEP outputs high */
+    int32_t step_error;        /* motor B - motor A - trim, from the outputs read back; 0 in lockstep */
+} app_lockstep_stats_t;
+
 typedef enum {
     APP_LED_SOLID = 0,
     APP_LED_BLINK
 } app_led_mode_t;
 
+typedef enum {
+    APP_ACTIVITY_BUTTON = 0,
+    APP_ACTIVITY_MOTION_START,
+    APP_ACTIVITY_MOTION_STOP
+} app_activity_t;
+
+/** Called from driver tasks; must not block. */
+typedef void (*app_driver_activity_cb_t)(app_activity_t activity);
+
+/** Called from a driver task when the undervoltage cutoff trips or releases; must not block. */
+typedef void (*app_driver_battery_cb_t)(bool undervoltage);
+
+typedef enum {
+    APP_CALIBRATION_NONE = 0,
+    APP_CALIBRATION_HOME,   /* find the top end stop; it becomes step 0 */
+    APP_CALIBRATION_BOTTOM, /* find the bottom end stop and save the travel */
+} app_calibration_command_t;
+
+typedef enum {
+    APP_MOTION_PROFILE_FAST = 0, /* the calibrated profile as is */
+    APP_MOTION_PROFILE_QUIET,
+    APP_MOTION_PROFILE_NIGHT,
+    APP_MOTION_PROFILE_COUNT
+} app_motion_profile_t;
+
+typedef struct {
+    const char *name;
+    uint16_t cruise_delay_us;  /* after each step at full speed */
+    uint16_t start_delay_us;   /* after the first step of a move */
+    uint16_t ramp_steps;
+    uint8_t microsteps;        /* STEP pulses per step; 1 unless CONFIG_BS_MICROSTEP_SELECT */
+    uint32_t full_travel_ms;   /* one 0 -> 100% move at the current calibration */
+} app_motion_profile_info_t;
+
+typedef enum {
+    APP_PARAM_CRUISE_US = 0, /* untuned step profile: delay after each step at full speed */
+    APP_PARAM_START_US,      /* untuned step profile: delay after the first step of a move */
+    APP_PARAM_RAMP_STEPS,    /* untuned step profile: steps from start to cruise delay */
+    APP_PARAM_REPORT_STEPS,  /* position report while moving after this many steps */
+    APP_PARAM_REPORT_MS,     /* ... and no more often than this */
+    APP_PARAM_UPDATE_MS,     /* position update task period */
+    APP_PARAM_YIELD_STEPS,   /* step generator yields a tick every this many steps */
+    APP_PARAM_BATTERY_MS,    /* battery sample period */
+    APP_PARAM_CUTOFF_MV,     /* undervoltage cutoff: stop the motor under this while moving */
+    APP_PARAM_LOAD_MA,       /* motor current rise over the running current that stops a move */
+    APP_PARAM_COUNT
+} app_param_t;
+
+typedef struct {
+    const char *key;        /* console name and NVS key */
+    const char *unit;
+    uint16_t value;
+    uint16_t default_value;
+    uint16_t min_value;
+    uint16_t max_value;
+} app_param_info_t;
+
+typedef enum {
+    APP_POWER_LOCK_MOTION = 0, /* step generator running: full CPU clock, no sleep */
+    APP_POWER_LOCK_LED,        /* status LED blinking */
+    APP_POWER_LOCK_ADC,        /* battery sample in progress */
+    APP_POWER_LOCK_COUNT
+} app_power_lock_t;
+
+typedef struct {
+    uint64_t window_us;                          /* time covered by these counters */
+    uint64_t sleep_us;                           /* spent in automatic light sleep */
+    uint32_t sleep_count;                        /* light sleep entries */
+    bool sleep_tracked;                          /* false without CONFIG_PM_LIGHT_SLEEP_CALLBACKS */
+    uint64_t lock_held_us[APP_POWER_LOCK_COUNT]; /* time each driver lock kept the chip awake */
+    uint32_t lock_acquired[APP_POWER_LOCK_COUNT];
+} app_power_stats_t;
+
 typedef struct {
     uint8_t red;
     uint8_t green;
@@ -35,12 +210,60 @@ typedef struct {
 /** Initialize the window covering dummy motor driver. */
 esp_err_t app_driver_init(uint16_t endpoint_id);
 
-/** Handle target position updates (percent100ths). */
+/** Queue a target position (percent100ths). Newer targets replace ones not yet applied. */
 void app_driver_set_target_percent100ths(uint16_t endpoint_id, uint16_t target_percent100ths);
 
-/** Stop motion immediately. */
+/** As app_driver_set_target_percent100ths, moving in exactly transition_ms (0 = as the motion settings say). */
+void app_driver_set_target_timed(uint16_t endpoint_id, uint16_t target_percent100ths, uint32_t transition_ms);
+
+/** Stop motion immediately: EN is asserted before the state lock is taken. */
 void app_driver_stop(uint16_t endpoint_id);
 
+/** Register a hook for local button presses and motion start/stop. */
+void app_driver_set_activity_cb(app_driver_activity_cb_t cb);
+
+/** Register a hook for the undervoltage cutoff, after the stop position is saved. */
+void app_driver_set_battery_cb(app_driver_battery_cb_t cb);
+
+/** Get command queue counters. */
+esp_err_t app_driver_get_command_stats(app_command_stats_t *stats);
+
+/** Get hard stop latency statistics (STOP button ISR and StopMotion). */
+esp_err_t app_driver_get_stop_stats(app_stop_stats_t *stats);
+
+/** Get step jitter and command latency measurements. */
+esp_err_t app_driver_get_motion_bench(app_motion_bench_t *bench);
+
+/** Restart the step jitter / command latency measurement. */
+void app_driver_reset_motion_bench();
+
+/** Get encoder-vs-step-count reconciliation counters. ESP_ERR_NOT_SUPPORTED without CONFIG_BS_ENCODER. */
+esp_err_t app_driver_get_encoder_stats(app_encoder_stats_t *stats);
+
+/** Get motor current and load detection counters. ESP_ERR_NOT_SUPPORTED without CONFIG_BS_CURRENT_SENSE. */
+esp_err_t app_driver_get_load_stats(app_load_stats_t *stats);
+
+/** Rolling figures over the per-move telemetry ring. ESP_ERR_NOT_SUPPORTED without CONFIG_BS_MOVE_LOG. */
+esp_err_t app_driver_get_move_summary(bs_move_summary_t *summary);
+
+/** Per-move record `index`, 0 = newest. ESP_ERR_NOT_FOUND past the oldest one held. */
+esp_err_t app_driver_get_move_record(uint16_t index, bs_move_record_t *record);
+
+/** Empty the per-move telemetry ring and restart its move count. */
+void app_driver_clear_move_log();
+
+/** Log every held move, oldest first, and the summary. */
+void app_driver_dump_moves();
+
+/** Register the driver's console commands (`moves` with CONFIG_BS_MOVE_LOG). */
+esp_err_t app_driver_register_commands();
+
+/** Move motor B alone until it sits `steps` from motor A; runs while idle, saved in NVS. ESP_ERR_NOT_SUPPORTED without CONFIG_BS_DUAL_MOTOR. */
+esp_err_t app_driver_set_motor2_trim(int16_t steps);
+
+/** Get dual-motor alignment counters. ESP_ERR_NOT_SUPPORTED without CONFIG_BS_DUAL_MOTOR. */
+esp_err_t app_driver_get_lockstep_stats(app_lockstep_stats_t *stats);
+
 /** Get latest battery measurement (GPIO0). */
 esp_err_t app_driver_get_battery_status(app_battery_status_t *status);
 
@@ -50,9 +273,153 @@ esp_err_t app_driver_set_status_led(const app_led_pattern_t *pattern);
 /** Blink current status color quickly N times (one-shot). */
 esp_err_t app_driver_signal_quick_blink(uint8_t count);
 
+/** Enter or leave calibration mode, as holding / double-pressing STOP does. Backs attribute 0xFFF1. */
+esp_err_t app_driver_set_calibration_mode(bool enabled);
+
+/** Run an automatic end-stop seek in calibration mode. Backs attribute 0xFFF2. */
+esp_err_t app_driver_calibration_command(app_calibration_command_t command);
+
+/** Switch motion profile; takes effect on the next step, even mid-move. Persisted in NVS. */
+esp_err_t app_driver_set_motion_profile(app_motion_profile_t profile);
+
+/** Active motion profile. */
+app_motion_profile_t app_driver_get_motion_profile();
+
+/** Timing of `profile` on this blind, including its full-travel move duration. */
+esp_err_t app_driver_get_motion_profile_info(app_motion_profile_t profile, app_motion_profile_info_t *info);
+
+/** Group full-travel time in 0.1 s (0 = off); every move takes its share, so grouped blinds arrive together. Backs 0xFFF3. */
+esp_err_t app_driver_set_sync_travel_time(uint16_t full_travel_ds);
+
+/** Synchronized full-travel time in 0.1 s, 0 when off. */
+uint16_t app_driver_get_sync_travel_time();
+
+/** Log every motion profile with its full-travel move duration; the active one is starred. */
+void app_driver_dump_motion_profiles();
+
+/** Override a tunable parameter; the running tasks pick it up on their next pass. Persisted in NVS. Backs 0xFFF5. */
+esp_err_t app_driver_set_param(app_param_t param, uint16_t value);
+
+/** Drop the override of a tunable parameter (APP_PARAM_COUNT: all of them). */
+esp_err_t app_driver_reset_param(app_param_t param);
+
+/** Current value, default and range of a tunable parameter. */
+esp_err_t app_driver_get_param_info(app_param_t param, app_param_info_t *info);
+
+/** Look a tunable parameter up by its key; APP_PARAM_COUNT if there is none. */
+app_param_t app_driver_find_param(const char *key);
+
 /** True when calibration mode is active. */
 bool app_driver_is_calibrating();
 
+/** Snapshot of position, target and motion. */
+esp_err_t app_driver_get_state(app_driver_state_t *state);
+
+/** Run a motor bench script to completion on the calling task; resets the motion bench. Not during calibration. */
+esp_err_t app_bench_run(uint16_t endpoint_id, app_bench_script_t script, app_bench_result_t *result);
+
+/** Register the `motor-bench` and `motionbench` console commands. */
+esp_err_t app_bench_register_commands(uint16_t endpoint_id);
+
+/** Start the stack high-water / heap fragmentation monitor. */
+esp_err_t app_monitor_init();
+
+/** Register the `memmon` console command. */
+esp_err_t app_monitor_register_commands();
+
+/** Print rolling heap and per-task stack statistics. */
+void app_monitor_dump();
+
+/** Restart the rolling min/max window. */
+void app_monitor_reset();
+
+/** Log a one-line heap summary tagged with label. */
+void app_monitor_log_summary(const char *label);
+
+/** Enable automatic light sleep and create the driver PM locks. Call before app_driver_init. */
+esp_err_t app_power_init();
+
+/** Hold or release a driver PM lock. Idempotent; each lock is owned by one task. */
+void app_power_hold(app_power_lock_t lock, bool hold);
+
+/** Get sleep/active time counters. */
+esp_err_t app_power_get_stats(app_power_stats_t *stats);
+
+/** Restart the sleep/active accounting window. */
+void app_power_reset();
+
+/** Log sleep vs. active time and what kept the chip awake. */
+void app_power_dump();
+
+/** Register the `power` console command. */
+esp_err_t app_power_register_commands();
+
+/** Append a record to the trace ring. Safe from ISRs; no-op without CONFIG_BS_TRACE. */
+void app_trace_record(bs_trace_event_t event, uint16_t value, uint8_t detail);
+
+/** Print the trace ring oldest first as BSTRACE lines (see bs_trace.h). */
+void app_trace_dump();
+
+/** Drop every recorded trace entry. */
+void app_trace_clear();
+
+/** Keep the ring the previous boot left in RAM if it is intact, else empty it; returns its record count. Call before anything records. */
+uint32_t app_trace_recover();
+
+/** Held record `index`, 0 = oldest. False past the newest. */
+bool app_trace_get(uint32_t index, bs_trace_record_t *record);
+
+/** Register the `trace` console command. */
+esp_err_t app_trace_register_commands();
+
+/** Seal what the previous boot left in RAM into the postmortem partition, then start keeping this boot's. Call first in app_main. */
+esp_err_t app_postmortem_init();
+
+/** Keep the driver state for the post-mortem record. Called by the driver's update task; no-op without CONFIG_BS_POSTMORTEM. */
+void app_postmortem_note_motor(const app_driver_state_t *state, uint16_t battery_mv);
+
+/** Header and motor state of the newest stored record. ESP_ERR_NOT_FOUND when the partition holds none. */
+esp_err_t app_postmortem_get_last(bs_postmortem_header_t *header, bs_postmortem_motor_t *motor);
+
+/** Print the newest stored record; with `trace`, its trace as BSTRACE lines instead. */
+void app_postmortem_dump(bool trace);
+
+/** Erase every stored record. */
+esp_err_t app_postmortem_clear();
+
+/** Register the `postmortem` console command. */
+esp_err_t app_postmortem_register_commands();
+
+/** Load the scene table from NVS. Call before the scene commands can arrive. */
+esp_err_t app_scenes_init();
+
+/** Add a scene, or overwrite the one with its fabric/group/scene ID; saved to NVS. ESP_ERR_NO_MEM when full. */
+esp_err_t app_scenes_store(const bs_scene_t *scene);
+
+/** Copy of the scene with this key. ESP_ERR_NOT_FOUND when there is none. */
+esp_err_t app_scenes_find(uint8_t fabric_index, uint16_t group_id, uint8_t scene_id, bs_scene_t *scene);
+
+/** Remove one scene. ESP_ERR_NOT_FOUND when there is none. */
+esp_err_t app_scenes_remove(uint8_t fabric_index, uint16_t group_id, uint8_t scene_id);
+
+/** Remove every scene of a group; returns how many went. */
+uint8_t app_scenes_remove_group(uint8_t fabric_index, uint16_t group_id);
+
+/** Remove every scene of a fabric that left; returns how many went. */
+uint8_t app_scenes_remove_fabric(uint8_t fabric_index);
+
+/** Scenes held, all fabrics. */
+uint8_t app_scenes_count();
+
+/** Remove every scene. */
+esp_err_t app_scenes_clear();
+
+/** Print every scene held. */
+void app_scenes_dump();
+
+/** Register the `scenes` console command. */
+esp_err_t app_scenes_register_commands();
+
 #if CHIP_DEVICE_CONFIG_ENABLE_THREAD
 #include "esp_openthread_types.h"
 #define ESP_OPENTHREAD_DEFAULT_RADIO_CONFIG()                                           \
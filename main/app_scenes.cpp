@@ -0,0 +1,303 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// On-device scene table (bs_scene_table.h) behind the Scenes Management cluster of the
+// WindowCovering endpoint. app_main decodes the scene commands and calls in here; the
+// table is written through to one NVS blob on every change, so a recall after a reboot
+// finds the same scenes.
+
+#include <cstdio>
+#include <cstring>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include <nvs.h>
+
+#if CONFIG_ENABLE_CHIP_SHELL
+#include <esp_matter_console.h>
+#endif
+
+#include "app_priv.h"
+#include "bs_log.h"
+
+#if CONFIG_BS_SCENES
+namespace {
+constexpr char k_nvs_namespace[] = "scenes";
+constexpr char k_nvs_key[] = "table";
+
+using scene_table_t = bs_scene_table<CONFIG_BS_SCENES_MAX>;
+
+StaticSemaphore_t s_lock_buffer;
+SemaphoreHandle_t s_lock = nullptr;
+scene_table_t s_table;
+
+// Caller holds s_lock.
+esp_err_t save_locked()
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(k_nvs_namespace, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = s_table.count() != 0 ? nvs_set_blob(handle, k_nvs_key, s_table.bytes(), s_table.byte_size())
+                               : nvs_erase_key(handle, k_nvs_key);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        err = ESP_OK;
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    if (err != ESP_OK) {
+        BS_LOG_WARN("Scene table not saved (%d)", err);
+    }
+    return err;
+}
+
+bool lock()
+{
+    return s_lock && xSemaphoreTake(s_lock, portMAX_DELAY) == pdTRUE;
+}
+
+void unlock()
+{
+    xSemaphoreGive(s_lock);
+}
+
+#if CONFIG_ENABLE_CHIP_SHELL
+esp_err_t scenes_command_handler(int argc, char **argv)
+{
+    if (argc == 0 || strcmp(argv[0], "show") == 0) {
+        app_scenes_dump();
+    } else if (strcmp(argv[0], "clear") == 0) {
+        esp_err_t err = app_scenes_clear();
+        if (err != ESP_OK) {
+            BS_LOG_WARN("scenes: clear failed (%d)", err);
+            return err;
+        }
+        BS_LOG_APP("scenes: cleared");
+    } else {
+        BS_LOG_WARN("usage: scenes [show|clear]");
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+#endif
+} // namespace
+
+esp_err_t app_scenes_init()
+{
+    if (s_lock) {
+        return ESP_OK;
+    }
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_buffer);
+    if (!s_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    nvs_handle_t handle;
+    if (nvs_open(k_nvs_namespace, NVS_READONLY, &handle) != ESP_OK) {
+        return ESP_OK; // nothing stored yet
+    }
+    uint8_t blob[sizeof(bs_scene_t) * CONFIG_BS_SCENES_MAX];
+    size_t size = sizeof(blob);
+    esp_err_t err = nvs_get_blob(handle, k_nvs_key, blob, &size);
+    nvs_close(handle);
+    if (err == ESP_OK && !s_table.load(blob, size)) {
+        BS_LOG_WARN("Stored scene table is invalid (%u bytes), starting empty", static_cast<unsigned>(size));
+    } else if (err == ESP_OK) {
+        BS_LOG_APP("Scene table: %u of %u scenes restored", static_cast<unsigned>(s_table.count()),
+                   static_cast<unsigned>(scene_table_t::capacity()));
+    }
+    return ESP_OK;
+}
+
+esp_err_t app_scenes_store(const bs_scene_t *scene)
+{
+    if (!scene) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!lock()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = s_table.store(*scene) ? save_locked() : ESP_ERR_NO_MEM;
+    unlock();
+    return err;
+}
+
+esp_err_t app_scenes_find(uint8_t fabric_index, uint16_t group_id, uint8_t scene_id, bs_scene_t *scene)
+{
+    if (!lock()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const bs_scene_t *found = s_table.find(fabric_index, group_id, scene_id);
+    if (found && scene) {
+        *scene = *found;
+    }
+    unlock();
+    return found ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t app_scenes_remove(uint8_t fabric_index, uint16_t group_id, uint8_t scene_id)
+{
+    if (!lock()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = s_table.remove(fabric_index, group_id, scene_id) ? save_locked() : ESP_ERR_NOT_FOUND;
+    unlock();
+    return err;
+}
+
+uint8_t app_scenes_remove_group(uint8_t fabric_index, uint16_t group_id)
+{
+    if (!lock()) {
+        return 0;
+    }
+    uint8_t removed = s_table.remove_group(fabric_index, group_id);
+    if (removed != 0) {
+        save_locked();
+    }
+    unlock();
+    return removed;
+}
+
+uint8_t app_scenes_remove_fabric(uint8_t fabric_index)
+{
+    if (!lock()) {
+        return 0;
+    }
+    uint8_t removed = s_table.remove_fabric(fabric_index);
+    if (removed != 0) {
+        save_locked();
+    }
+    unlock();
+    return removed;
+}
+
+uint8_t app_scenes_count()
+{
+    if (!lock()) {
+        return 0;
+    }
+    uint8_t count = s_table.count();
+    unlock();
+    return count;
+}
+
+esp_err_t app_scenes_clear()
+{
+    if (!lock()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_table.clear();
+    esp_err_t err = save_locked();
+    unlock();
+    return err;
+}
+
+void app_scenes_dump()
+{
+    if (!lock()) {
+        return;
+    }
+    BS_LOG_STATE("Scenes: %u of %u held (%u bytes in NVS)", static_cast<unsigned>(s_table.count()),
+                 static_cast<unsigned>(scene_table_t::capacity()), static_cast<unsigned>(s_table.byte_size()));
+    for (uint8_t i = 0; i < s_table.count(); ++i) {
+        const bs_scene_t &scene = s_table.at(i);
+        char tilt[16] = "-";
+        if (scene.tilt_percent100ths != bs_scene_t::k_no_tilt) {
+            snprintf(tilt, sizeof(tilt), "%u.%02u%%", static_cast<unsigned>(scene.tilt_percent100ths / 100),
+                     static_cast<unsigned>(scene.tilt_percent100ths % 100));
+        }
+        printf("  fabric %u group 0x%04X scene %3u: lift %u.%02u%% tilt %s in %u.%03u s\n",
+               static_cast<unsigned>(scene.fabric_index), static_cast<unsigned>(scene.group_id),
+               static_cast<unsigned>(scene.scene_id), static_cast<unsigned>(scene.lift_percent100ths / 100),
+               static_cast<unsigned>(scene.lift_percent100ths % 100), tilt,
+               static_cast<unsigned>(scene.transition_ms / 1000), static_cast<unsigned>(scene.transition_ms % 1000));
+    }
+    unlock();
+}
+
+esp_err_t app_scenes_register_commands()
+{
+#if CONFIG_ENABLE_CHIP_SHELL
+    static const esp_matter::console::command_t command = {
+        .name = "scenes",
+        .description = "Scenes held on the device: lift, tilt and transition time. Usage: matter scenes [show|clear]",
+        .handler = scenes_command_handler,
+    };
+    return esp_matter::console::add_commands(&command, 1);
+#else
+    return ESP_OK;
+#endif
+}
+
+#else // CONFIG_BS_SCENES
+
+esp_err_t app_scenes_init()
+{
+    return ESP_OK;
+}
+
+esp_err_t app_scenes_store(const bs_scene_t *scene)
+{
+    (void)scene;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t app_scenes_find(uint8_t fabric_index, uint16_t group_id, uint8_t scene_id, bs_scene_t *scene)
+{
+    (void)fabric_index;
+    (void)group_id;
+    (void)scene_id;
+    (void)scene;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t app_scenes_remove(uint8_t fabric_index, uint16_t group_id, uint8_t scene_id)
+{
+    (void)fabric_index;
+    (void)group_id;
+    (void)scene_id;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+uint8_t app_scenes_remove_group(uint8_t fabric_index, uint16_t group_id)
+{
+    (void)fabric_index;
+    (void)group_id;
+    return 0;
+}
+
+uint8_t app_scenes_remove_fabric(uint8_t fabric_index)
+{
+    (void)fabric_index;
+    return 0;
+}
+
+uint8_t app_scenes_count()
+{
+    return 0;
+}
+
+esp_err_t app_scenes_clear()
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void app_scenes_dump()
+{
+}
+
+esp_err_t app_scenes_register_commands()
+{
+    return ESP_OK;
+}
+
+#endif // CONFIG_BS_SCENES
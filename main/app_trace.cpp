@@ -0,0 +1,189 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <cstdio>
+#include <cstring>
+
+#include <freertos/FreeRTOS.h>
+
+#include <esp_attr.h>
+#include <esp_timer.h>
+
+#if CONFIG_ENABLE_CHIP_SHELL
+#include <esp_matter_console.h>
+#endif
+
+#include "app_priv.h"
+#include "bs_log.h"
+
+#if CONFIG_BS_TRACE
+namespace {
+constexpr uint32_t k_trace_records = CONFIG_BS_TRACE_RECORDS;
+
+// Written from tasks and the STOP ISR; the spinlock covers one 8-byte store, so
+// recording costs well under a microsecond and never blocks.
+portMUX_TYPE s_trace_mux = portMUX_INITIALIZER_UNLOCKED;
+#if CONFIG_BS_POSTMORTEM
+// Left alone by startup code, so a panic, watchdog or brownout reset leaves the ring
+// for the next boot's post-mortem record. app_trace_recover() vets it.
+constexpr uint32_t k_trace_magic = 0x42535452; // "BSTR"
+__NOINIT_ATTR bs_trace_record_t s_trace_ring[k_trace_records];
+__NOINIT_ATTR uint32_t s_trace_written;
+__NOINIT_ATTR uint32_t s_trace_magic;
+#else
+bs_trace_record_t s_trace_ring[k_trace_records];
+uint32_t s_trace_written = 0; // total records ever written; the ring holds the newest k_trace_records
+#endif
+bool s_trace_paused = false;
+
+#if CONFIG_ENABLE_CHIP_SHELL
+esp_err_t trace_command_handler(int argc, char **argv)
+{
+    if (argc == 0 || strcmp(argv[0], "dump") == 0) {
+        app_trace_dump();
+    } else if (strcmp(argv[0], "clear") == 0) {
+        app_trace_clear();
+        BS_LOG_APP("trace: cleared");
+    } else if (strcmp(argv[0], "pause") == 0 || strcmp(argv[0], "resume") == 0) {
+        bool pause = strcmp(argv[0], "pause") == 0;
+        portENTER_CRITICAL(&s_trace_mux);
+        s_trace_paused = pause;
+        portEXIT_CRITICAL(&s_trace_mux);
+        BS_LOG_APP("trace: %s", pause ? "paused" : "recording");
+    } else {
+        BS_LOG_WARN("usage: trace [dump|clear|pause|resume]");
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+#endif
+} // namespace
+
+void IRAM_ATTR app_trace_record(bs_trace_event_t event, uint16_t value, uint8_t detail)
+{
+    uint32_t now = static_cast<uint32_t>(esp_timer_get_time());
+    portENTER_CRITICAL_SAFE(&s_trace_mux);
+    if (!s_trace_paused) {
+        bs_trace_record_t &record = s_trace_ring[s_trace_written % k_trace_records];
+        record.time_us = now;
+        record.event = event;
+        record.detail = detail;
+        record.value = value;
+        s_trace_written++;
+    }
+    portEXIT_CRITICAL_SAFE(&s_trace_mux);
+}
+
+void app_trace_dump()
+{
+    portENTER_CRITICAL(&s_trace_mux);
+    uint32_t written = s_trace_written;
+    portEXIT_CRITICAL(&s_trace_mux);
+    uint32_t first = written > k_trace_records ? written - k_trace_records : 0;
+    BS_LOG_STATE("Trace: %u records (%u lost to wrap)", static_cast<unsigned>(written - first),
+                 static_cast<unsigned>(first));
+
+    bs_trace_clock clock;
+    char line[64];
+    for (uint32_t i = first; i < written; ++i) {
+        bs_trace_record_t record;
+        bool overwritten;
+        portENTER_CRITICAL(&s_trace_mux);
+        record = s_trace_ring[i % k_trace_records];
+        overwritten = s_trace_written - i > k_trace_records;
+        portEXIT_CRITICAL(&s_trace_mux);
+        if (overwritten) {
+            continue; // recorded over while dumping
+        }
+        bs_trace_format(line, sizeof(line), clock.unwrap(record.time_us), record);
+        printf("%s\n", line);
+    }
+}
+
+void app_trace_clear()
+{
+    portENTER_CRITICAL(&s_trace_mux);
+    s_trace_written = 0;
+#if CONFIG_BS_POSTMORTEM
+    s_trace_magic = k_trace_magic;
+#endif
+    portEXIT_CRITICAL(&s_trace_mux);
+}
+
+uint32_t app_trace_recover()
+{
+#if CONFIG_BS_POSTMORTEM
+    portENTER_CRITICAL(&s_trace_mux);
+    // After a power-on the counter is whatever the RAM came up with.
+    if (s_trace_magic != k_trace_magic) {
+        s_trace_written = 0;
+        s_trace_magic = k_trace_magic;
+    }
+    portEXIT_CRITICAL(&s_trace_mux);
+#endif
+    return s_trace_written;
+}
+
+bool app_trace_get(uint32_t index, bs_trace_record_t *record)
+{
+    portENTER_CRITICAL(&s_trace_mux);
+    uint32_t written = s_trace_written;
+    uint32_t first = written > k_trace_records ? written - k_trace_records : 0;
+    bool held = index < written - first;
+    if (held) {
+        *record = s_trace_ring[(first + index) % k_trace_records];
+    }
+    portEXIT_CRITICAL(&s_trace_mux);
+    return held;
+}
+
+esp_err_t app_trace_register_commands()
+{
+#if CONFIG_ENABLE_CHIP_SHELL
+    static const esp_matter::console::command_t command = {
+        .name = "trace",
+        .description = "Command/motion trace ring. Usage: matter trace [dump|clear|pause|resume]",
+        .handler = trace_command_handler,
+    };
+    return esp_matter::console::add_commands(&command, 1);
+#else
+    return ESP_OK;
+#endif
+}
+
+#else // CONFIG_BS_TRACE
+
+void IRAM_ATTR app_trace_record(bs_trace_event_t event, uint16_t value, uint8_t detail)
+{
+    (void)event;
+    (void)value;
+    (void)detail;
+}
+
+void app_trace_dump() {}
+
+void app_trace_clear() {}
+
+uint32_t app_trace_recover()
+{
+    return 0;
+}
+
+bool app_trace_get(uint32_t index, bs_trace_record_t *record)
+{
+    (void)index;
+    (void)record;
+    return false;
+}
+
+esp_err_t app_trace_register_commands()
+{
+    return ESP_OK;
+}
+
+#endif // CONFIG_BS_TRACE
@@ -0,0 +1,214 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Motion commands travelling from the Matter layer to the step generator.
+//
+// GoTo targets go through a bounded lock-free ring (Vyukov MPMC cells, so any
+// thread may submit). Stop bypasses the ring through its own lane so it is never
+// stuck behind queued targets. The consumer folds everything pending into one
+// batch: the newest GoTo wins, anything older than a Stop is dropped.
+//
+// No FreeRTOS/ESP-IDF dependencies: this header builds on the host as-is.
+
+enum class bs_command_kind_t : uint8_t {
+    k_none = 0,
+    k_go_to,
+    k_stop,
+};
+
+struct bs_command_t {
+    uint32_t seq;
+    bs_command_kind_t kind;
+    uint16_t target_percent100ths;
+    uint32_t stamp_us;      // caller's submit timestamp, for latency measurement
+    uint32_t transition_ms; // move in exactly this long, 0 = as the motion settings say
+};
+
+struct bs_command_batch_t {
+    bool stop;
+    uint32_t stop_seq;
+    bool has_go_to;
+    bs_command_t go_to;
+};
+
+struct bs_command_queue_stats_t {
+    uint32_t submitted;
+    uint32_t applied;
+    uint32_t coalesced;
+    uint32_t rejected;
+    uint32_t stops;
+};
+
+template <size_t Capacity>
+class bs_command_queue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bs_command_queue()
+    {
+        for (size_t i = 0; i < Capacity; ++i) {
+            m_cells[i].sequence.store(static_cast<uint32_t>(i), std::memory_order_relaxed);
+        }
+    }
+
+    /** Queue a GoTo target. Returns its sequence number, or 0 when the ring is full. */
+    uint32_t push_go_to(uint16_t target_percent100ths, uint32_t stamp_us = 0, uint32_t transition_ms = 0)
+    {
+        uint32_t seq = next_seq();
+        uint32_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        cell_t *cell = nullptr;
+        while (true) {
+            cell = &m_cells[pos & k_mask];
+            uint32_t cell_seq = cell->sequence.load(std::memory_order_acquire);
+            int32_t dif = static_cast<int32_t>(cell_seq - pos);
+            if (dif == 0) {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (dif < 0) {
+                m_rejected.fetch_add(1, std::memory_order_relaxed);
+                return 0;
+            } else {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->command.seq = seq;
+        cell->command.kind = bs_command_kind_t::k_go_to;
+        cell->command.target_percent100ths = target_percent100ths;
+        cell->command.stamp_us = stamp_us;
+        cell->command.transition_ms = transition_ms;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        m_submitted.fetch_add(1, std::memory_order_relaxed);
+        return seq;
+    }
+
+    /** Raise a Stop. Takes priority over every GoTo queued before it. */
+    uint32_t push_stop()
+    {
+        uint32_t seq = next_seq();
+        uint32_t current = m_stop_seq.load(std::memory_order_relaxed);
+        while (current < seq &&
+               !m_stop_seq.compare_exchange_weak(current, seq, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+        if (current != 0) {
+            // Either an older pending Stop was replaced, or a newer one already covers this.
+            m_coalesced.fetch_add(1, std::memory_order_relaxed);
+        }
+        m_submitted.fetch_add(1, std::memory_order_relaxed);
+        m_stops.fetch_add(1, std::memory_order_relaxed);
+        return seq;
+    }
+
+    /** Latest sequence number handed out. Safe from ISR context (always inlined into IRAM callers). */
+    __attribute__((always_inline)) uint32_t last_seq() const { return m_next_seq.load(std::memory_order_acquire); }
+
+    /** Count a command refused before it reached the queue. */
+    void note_rejected() { m_rejected.fetch_add(1, std::memory_order_relaxed); }
+
+    /** Consumer only: drop every command up to and including seq (e.g. after a hard stop). */
+    void cancel_through(uint32_t seq)
+    {
+        if (seq > m_applied_seq) {
+            m_applied_seq = seq;
+        }
+    }
+
+    /** Consumer only: fold all pending commands into one batch. False when nothing is pending. */
+    bool take(bs_command_batch_t &batch)
+    {
+        batch = {};
+        uint32_t stop_seq = m_stop_seq.exchange(0, std::memory_order_acquire);
+        if (stop_seq != 0 && stop_seq > m_applied_seq) {
+            batch.stop = true;
+            batch.stop_seq = stop_seq;
+        } else if (stop_seq != 0) {
+            m_coalesced.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        bs_command_t command = {};
+        while (pop(command)) {
+            bool stale = command.seq <= m_applied_seq || (batch.stop && command.seq < batch.stop_seq) ||
+                         (batch.has_go_to && command.seq < batch.go_to.seq);
+            if (stale) {
+                m_coalesced.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (batch.has_go_to) {
+                m_coalesced.fetch_add(1, std::memory_order_relaxed);
+            }
+            batch.go_to = command;
+            batch.has_go_to = true;
+        }
+
+        if (batch.stop) {
+            m_applied_seq = batch.stop_seq;
+            m_applied.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (batch.has_go_to) {
+            m_applied_seq = batch.go_to.seq;
+            m_applied.fetch_add(1, std::memory_order_relaxed);
+        }
+        return batch.stop || batch.has_go_to;
+    }
+
+    bs_command_queue_stats_t stats() const
+    {
+        bs_command_queue_stats_t out = {};
+        out.submitted = m_submitted.load(std::memory_order_relaxed);
+        out.applied = m_applied.load(std::memory_order_relaxed);
+        out.coalesced = m_coalesced.load(std::memory_order_relaxed);
+        out.rejected = m_rejected.load(std::memory_order_relaxed);
+        out.stops = m_stops.load(std::memory_order_relaxed);
+        return out;
+    }
+
+private:
+    static constexpr uint32_t k_mask = static_cast<uint32_t>(Capacity - 1);
+
+    struct cell_t {
+        std::atomic<uint32_t> sequence;
+        bs_command_t command;
+    };
+
+    uint32_t next_seq() { return m_next_seq.fetch_add(1, std::memory_order_acq_rel) + 1; }
+
+    bool pop(bs_command_t &out)
+    {
+        uint32_t pos = m_dequeue_pos;
+        cell_t *cell = &m_cells[pos & k_mask];
+        uint32_t cell_seq = cell->sequence.load(std::memory_order_acquire);
+        if (static_cast<int32_t>(cell_seq - (pos + 1)) < 0) {
+            return false;
+        }
+        out = cell->command;
+        cell->sequence.store(pos + k_mask + 1, std::memory_order_release);
+        m_dequeue_pos = pos + 1;
+        return true;
+    }
+
+    cell_t m_cells[Capacity];
+    std::atomic<uint32_t> m_enqueue_pos{0};
+    std::atomic<uint32_t> m_next_seq{0};
+    std::atomic<uint32_t> m_stop_seq{0};
+    std::atomic<uint32_t> m_submitted{0};
+    std::atomic<uint32_t> m_applied{0};
+    std::atomic<uint32_t> m_coalesced{0};
+    std::atomic<uint32_t> m_rejected{0};
+    std::atomic<uint32_t> m_stops{0};
+
+    // Consumer-side state, only touched from the draining task.
+    uint32_t m_dequeue_pos = 0;
+    uint32_t m_applied_seq = 0;
+};
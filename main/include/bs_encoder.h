@@ -0,0 +1,140 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Closed-loop check of the open-loop step count against a quadrature encoder.
+//
+// The step generator's count is where the motor should be; the encoder count is where
+// it is. When a move ends the two are compared. A disagreement beyond the tolerance is
+// drift (skipped steps): the caller adopts the measured position and re-runs the move.
+// A move during which the encoder saw less than stall_percent of the commanded travel
+// is a stall: the caller stops, adopts the measured position and raises a fault.
+//
+// Counts are the PCNT's accumulated value and may be negative. Not thread-safe; the
+// step generator owns it.
+//
+// No FreeRTOS/ESP-IDF dependencies: this header builds on the host as-is.
+
+struct bs_encoder_config_t {
+    uint32_t counts_per_rev;  // encoder counts per motor revolution, after x4 decoding
+    uint32_t steps_per_rev;   // STEP pulses per motor revolution, including microstepping
+    uint16_t tolerance_steps; // |measured - commanded| accepted as-is
+    uint8_t stall_percent;    // measured travel below this share of the commanded travel is a stall
+    uint16_t stall_min_steps; // commanded travel below this is never judged a stall
+};
+
+enum class bs_encoder_verdict_t : uint8_t {
+    k_ok,
+    k_drift,
+    k_stall,
+};
+
+struct bs_encoder_check_t {
+    bs_encoder_verdict_t verdict;
+    int32_t measured_steps; // encoder position converted to steps from home
+    int32_t error_steps;    // measured - commanded
+};
+
+class bs_encoder_reconciler {
+public:
+    explicit bs_encoder_reconciler(const bs_encoder_config_t &config) : m_config(config) {}
+
+    /** Declare that the encoder reading `count` is `steps` from home (boot, calibrated home). */
+    void rebase(int32_t count, int32_t steps)
+    {
+        m_zero_count = count - counts_from_steps(steps);
+        begin_move(count, steps);
+    }
+
+    /** Mark where a move (or a correction move) starts. */
+    void begin_move(int32_t count, int32_t steps)
+    {
+        m_move_start_steps = steps;
+        m_move_start_measured = steps_from_count(count);
+    }
+
+    int32_t steps_from_count(int32_t count) const
+    {
+        return scale(count - m_zero_count, m_config.steps_per_rev, m_config.counts_per_rev);
+    }
+
+    /** Cheap mid-move test: has the encoder fallen behind enough to call it a stall already? */
+    bool stalled(int32_t count, int32_t steps) const { return is_stall(steps_from_count(count), steps); }
+
+    /** End of a move: classify it and update the statistics. */
+    bs_encoder_check_t check(int32_t count, int32_t steps)
+    {
+        bs_encoder_check_t result = {};
+        result.measured_steps = steps_from_count(count);
+        result.error_steps = result.measured_steps - steps;
+        uint32_t error = magnitude(result.error_steps);
+        if (is_stall(result.measured_steps, steps)) {
+            result.verdict = bs_encoder_verdict_t::k_stall;
+            m_stalls++;
+        } else if (error > m_config.tolerance_steps) {
+            result.verdict = bs_encoder_verdict_t::k_drift;
+            m_drift_corrections++;
+        } else {
+            result.verdict = bs_encoder_verdict_t::k_ok;
+        }
+        if (error > m_max_error_steps) {
+            m_max_error_steps = error;
+        }
+        m_moves_checked++;
+        return result;
+    }
+
+    uint32_t moves_checked() const { return m_moves_checked; }
+    uint32_t drift_corrections() const { return m_drift_corrections; }
+    uint32_t stalls() const { return m_stalls; }
+    uint32_t max_error_steps() const { return m_max_error_steps; }
+
+private:
+    static uint32_t magnitude(int32_t value) { return value < 0 ? static_cast<uint32_t>(-value) : value; }
+
+    // value * num / den rounded half away from zero, so +n and -n counts map symmetrically.
+    static int32_t scale(int32_t value, uint32_t num, uint32_t den)
+    {
+        if (den == 0) {
+            return 0;
+        }
+        int64_t product = static_cast<int64_t>(value) * num;
+        int64_t half = den / 2;
+        return static_cast<int32_t>(product >= 0 ? (product + half) / den : (product - half) / den);
+    }
+
+    int32_t counts_from_steps(int32_t steps) const
+    {
+        return scale(steps, m_config.counts_per_rev, m_config.steps_per_rev);
+    }
+
+    bool is_stall(int32_t measured_steps, int32_t steps) const
+    {
+        uint32_t commanded = magnitude(steps - m_move_start_steps);
+        if (commanded < m_config.stall_min_steps) {
+            return false;
+        }
+        // Travel the wrong way counts as none.
+        int32_t signed_travel = measured_steps - m_move_start_measured;
+        bool same_way = (signed_travel >= 0) == (steps >= m_move_start_steps);
+        uint32_t travel = same_way ? magnitude(signed_travel) : 0;
+        return static_cast<uint64_t>(travel) * 100 < static_cast<uint64_t>(commanded) * m_config.stall_percent;
+    }
+
+    bs_encoder_config_t m_config;
+    int32_t m_zero_count = 0;
+    int32_t m_move_start_steps = 0;
+    int32_t m_move_start_measured = 0;
+    uint32_t m_moves_checked = 0;
+    uint32_t m_drift_corrections = 0;
+    uint32_t m_stalls = 0;
+    uint32_t m_max_error_steps = 0;
+};
@@ -0,0 +1,124 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Two-speed homing against an end stop.
+//
+// Seek the limit at full speed, back off a short distance, then re-approach at a
+// crawl so the limit is found at the same spot every time regardless of how much the
+// fast seek overran. The limit input is whatever the caller has: an end-stop switch
+// or a stall seen by the encoder. The step generator calls on_step() after every
+// step and follows dir()/fast(); a seek that travels too far without reaching the
+// limit fails instead of grinding on.
+//
+// Positions are signed steps from where homing started. Not thread-safe; the step
+// generator owns it.
+//
+// No FreeRTOS/ESP-IDF dependencies: this header builds on the host as-is.
+
+struct bs_homing_config_t {
+    uint16_t backoff_steps;      // distance moved off the limit before the slow approach
+    uint16_t max_seek_steps;     // fast seek gives up after this much travel
+    uint16_t max_approach_steps; // slow approach gives up after this much travel
+};
+
+enum class bs_homing_phase_t : uint8_t {
+    k_idle,
+    k_seek_fast,
+    k_back_off,
+    k_seek_slow,
+    k_done,
+    k_failed,
+};
+
+class bs_homing {
+public:
+    explicit bs_homing(const bs_homing_config_t &config) : m_config(config) {}
+
+    /** Begin a seek towards the limit in direction `toward` (+1 or -1). */
+    void start(int8_t toward)
+    {
+        m_toward = toward < 0 ? -1 : 1;
+        m_position = 0;
+        enter(bs_homing_phase_t::k_seek_fast);
+    }
+
+    void cancel() { m_phase = bs_homing_phase_t::k_idle; }
+
+    bs_homing_phase_t phase() const { return m_phase; }
+
+    /** True while the step generator should keep stepping. */
+    bool active() const
+    {
+        return m_phase == bs_homing_phase_t::k_seek_fast || m_phase == bs_homing_phase_t::k_back_off ||
+               m_phase == bs_homing_phase_t::k_seek_slow;
+    }
+
+    /** Step direction for the current phase. */
+    int8_t dir() const { return m_phase == bs_homing_phase_t::k_back_off ? -m_toward : m_toward; }
+
+    /** Full speed (seek) or crawl (back-off and approach). */
+    bool fast() const { return m_phase == bs_homing_phase_t::k_seek_fast; }
+
+    /** Signed steps issued since start(). */
+    int32_t position() const { return m_position; }
+
+    /**
+     * One step went out in dir(); `limit` is the limit input after it. Returns true
+     * when the phase changed (new direction or speed, or finished).
+     */
+    bool on_step(bool limit)
+    {
+        if (!active()) {
+            return false;
+        }
+        m_position += dir();
+        m_leg_steps++;
+        switch (m_phase) {
+        case bs_homing_phase_t::k_seek_fast:
+            if (limit) {
+                enter(bs_homing_phase_t::k_back_off);
+            } else if (m_leg_steps >= m_config.max_seek_steps) {
+                enter(bs_homing_phase_t::k_failed);
+            }
+            break;
+        case bs_homing_phase_t::k_back_off:
+            if (m_leg_steps >= m_config.backoff_steps) {
+                // Still on the limit after backing off: a stuck switch or a jammed shaft.
+                enter(limit ? bs_homing_phase_t::k_failed : bs_homing_phase_t::k_seek_slow);
+            }
+            break;
+        case bs_homing_phase_t::k_seek_slow:
+            if (limit) {
+                enter(bs_homing_phase_t::k_done);
+            } else if (m_leg_steps >= m_config.max_approach_steps) {
+                enter(bs_homing_phase_t::k_failed);
+            }
+            break;
+        default:
+            break;
+        }
+        return m_leg_steps == 0;
+    }
+
+private:
+    void enter(bs_homing_phase_t phase)
+    {
+        m_phase = phase;
+        m_leg_steps = 0;
+    }
+
+    bs_homing_config_t m_config;
+    bs_homing_phase_t m_phase = bs_homing_phase_t::k_idle;
+    int8_t m_toward = -1;
+    int32_t m_position = 0;
+    uint32_t m_leg_steps = 0;
+};
@@ -0,0 +1,128 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Poll policy for a Thread Intermittently Connected Device.
+//
+// Fast polling while the blind moves, for a hold window after it stops (so the
+// final position report and follow-up commands are not stuck behind a slow poll)
+// and for a window after any local button press. Slow polling otherwise.
+//
+// Pure logic over caller-supplied millisecond timestamps (wrap-safe), so it runs
+// unchanged on the host. Not thread-safe; the caller serialises access.
+
+struct bs_icd_policy_config_t {
+    uint32_t slow_poll_ms;
+    uint32_t fast_poll_ms;
+    uint32_t post_motion_hold_ms;
+    uint32_t button_hold_ms;
+    uint32_t poll_radio_on_ms; // radio-on time one data poll costs
+};
+
+class bs_icd_policy {
+public:
+    explicit bs_icd_policy(const bs_icd_policy_config_t &config) : m_config(config) {}
+
+    void start(uint32_t now_ms)
+    {
+        m_last_ms = now_ms;
+        m_fast_until_ms = now_ms;
+        m_started = true;
+    }
+
+    void on_motion(bool moving, uint32_t now_ms)
+    {
+        advance(now_ms);
+        if (m_moving && !moving) {
+            extend_fast(now_ms, m_config.post_motion_hold_ms);
+        }
+        m_moving = moving;
+    }
+
+    void on_button(uint32_t now_ms)
+    {
+        advance(now_ms);
+        extend_fast(now_ms, m_config.button_hold_ms);
+    }
+
+    bool fast(uint32_t now_ms) const { return m_moving || before(now_ms, m_fast_until_ms); }
+
+    uint32_t poll_interval_ms(uint32_t now_ms) const
+    {
+        return fast(now_ms) ? m_config.fast_poll_ms : m_config.slow_poll_ms;
+    }
+
+    /** Milliseconds until the policy would drop back to slow polling (0 when already slow or moving). */
+    uint32_t fast_remaining_ms(uint32_t now_ms) const
+    {
+        if (m_moving || !before(now_ms, m_fast_until_ms)) {
+            return 0;
+        }
+        return m_fast_until_ms - now_ms;
+    }
+
+    /** Account elapsed time to the fast/slow buckets. Call before reading statistics. */
+    void advance(uint32_t now_ms)
+    {
+        if (!m_started) {
+            start(now_ms);
+            return;
+        }
+        uint32_t elapsed = now_ms - m_last_ms;
+        uint32_t fast_part = 0;
+        if (m_moving) {
+            fast_part = elapsed;
+        } else if (before(m_last_ms, m_fast_until_ms)) {
+            uint32_t remaining = m_fast_until_ms - m_last_ms;
+            fast_part = remaining < elapsed ? remaining : elapsed;
+        }
+        m_fast_ms += fast_part;
+        m_slow_ms += elapsed - fast_part;
+        m_last_ms = now_ms;
+        if (!before(now_ms, m_fast_until_ms)) {
+            m_fast_until_ms = now_ms; // keep the deadline close to now so wrap-safe compares stay valid
+        }
+    }
+
+    uint64_t fast_ms() const { return m_fast_ms; }
+    uint64_t slow_ms() const { return m_slow_ms; }
+
+    /** Estimated radio-on time per hour of uptime under the observed fast/slow mix. */
+    uint32_t radio_on_ms_per_hour() const
+    {
+        uint64_t total = m_fast_ms + m_slow_ms;
+        if (total == 0 || m_config.fast_poll_ms == 0 || m_config.slow_poll_ms == 0) {
+            return 0;
+        }
+        uint64_t polls_x1000 = (m_fast_ms * 1000) / m_config.fast_poll_ms + (m_slow_ms * 1000) / m_config.slow_poll_ms;
+        uint64_t radio_on_ms = (polls_x1000 * m_config.poll_radio_on_ms) / 1000;
+        return static_cast<uint32_t>((radio_on_ms * 3600000ULL) / total);
+    }
+
+private:
+    static bool before(uint32_t a, uint32_t b) { return static_cast<int32_t>(a - b) < 0; }
+
+    void extend_fast(uint32_t now_ms, uint32_t hold_ms)
+    {
+        uint32_t until = now_ms + hold_ms;
+        if (!before(now_ms, m_fast_until_ms) || before(m_fast_until_ms, until)) {
+            m_fast_until_ms = until;
+        }
+    }
+
+    bs_icd_policy_config_t m_config;
+    bool m_started = false;
+    bool m_moving = false;
+    uint32_t m_last_ms = 0;
+    uint32_t m_fast_until_ms = 0;
+    uint64_t m_fast_ms = 0;
+    uint64_t m_slow_ms = 0;
+};
@@ -0,0 +1,135 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Motor load detector over the current-sense readings the step generator takes about
+// every millisecond of a move. Readings are smoothed (an exponential filter over about
+// 2^filter_shift of them) and compared with the running current of this move, learnt
+// the same way over a longer window once the blanking at the start is over: inrush and
+// the ramp are not a load. A blind that meets an obstruction or its end stop pulls well
+// over that baseline and stays there; `spike_samples` smoothed readings in a row over
+// it (or over the absolute limit, which a slowly stiffening mechanism cannot hide
+// behind a baseline that crept up with it) trip the detector until the next move.
+//
+// The baseline only learns from readings under the threshold, so a spike building up
+// over a few readings does not raise its own bar. With no sensor fitted every reading
+// is about 0 mA and nothing ever trips.
+//
+// Not thread-safe; the step generator owns it while a move runs.
+//
+// No FreeRTOS/ESP-IDF dependencies: this header builds on the host as-is.
+
+struct bs_load_detect_config_t {
+    uint16_t blank_samples;  // readings ignored at the start of a move
+    uint8_t filter_shift;    // smoothing over ~2^shift readings
+    uint8_t baseline_shift;  // running current learnt over ~2^shift readings
+    uint16_t rise_permille;  // a spike is this much over the baseline...
+    uint16_t rise_min_ma;    // ...and at least this many mA over it
+    uint8_t spike_samples;   // consecutive smoothed readings over the threshold
+    uint16_t limit_ma;       // over this is a spike whatever the baseline
+};
+
+enum class bs_load_verdict_t : uint8_t {
+    k_ok,
+    k_spike,    // over the learnt running current
+    k_overload, // over the absolute limit
+};
+
+class bs_load_detector {
+public:
+    explicit bs_load_detector(const bs_load_detect_config_t &config) : m_config(config) {}
+
+    /** New minimum rise over the running current; takes effect on the next reading. */
+    void set_rise_min_ma(uint16_t rise_min_ma) { m_config.rise_min_ma = rise_min_ma; }
+
+    uint16_t rise_min_ma() const { return m_config.rise_min_ma; }
+
+    /** The motor starts: blank, then learn this move's running current afresh. */
+    void begin_move()
+    {
+        m_samples = 0;
+        m_run = 0;
+        m_tripped = false;
+        m_peak_ma = 0;
+    }
+
+    /** A reading in mA. Anything but k_ok is returned once, by the reading that trips it. */
+    bs_load_verdict_t sample(uint16_t ma)
+    {
+        int32_t reading_q = static_cast<int32_t>(ma) << k_frac_bits;
+        if (m_samples == 0) {
+            m_filtered_q = reading_q;
+        } else {
+            m_filtered_q += (reading_q - m_filtered_q) >> m_config.filter_shift;
+        }
+        uint16_t filtered = filtered_ma();
+        m_peak_ma = filtered > m_peak_ma ? filtered : m_peak_ma;
+        if (m_tripped) {
+            return bs_load_verdict_t::k_ok;
+        }
+        if (m_samples < m_config.blank_samples) {
+            if (++m_samples == m_config.blank_samples) {
+                m_baseline_q = m_filtered_q;
+            }
+            return bs_load_verdict_t::k_ok;
+        }
+
+        bool overload = filtered > m_config.limit_ma;
+        if (!overload && filtered <= threshold_ma()) {
+            m_run = 0;
+            m_baseline_q += (m_filtered_q - m_baseline_q) >> m_config.baseline_shift;
+            return bs_load_verdict_t::k_ok;
+        }
+        if (++m_run < m_config.spike_samples) {
+            return bs_load_verdict_t::k_ok;
+        }
+        m_tripped = true;
+        m_trip_ma = filtered;
+        m_trip_baseline_ma = baseline_ma();
+        return overload ? bs_load_verdict_t::k_overload : bs_load_verdict_t::k_spike;
+    }
+
+    bool tripped() const { return m_tripped; }
+
+    /** Still blanking: no baseline for this move yet. */
+    bool blanking() const { return m_samples < m_config.blank_samples; }
+
+    uint16_t filtered_ma() const { return static_cast<uint16_t>(m_filtered_q >> k_frac_bits); }
+    uint16_t baseline_ma() const { return static_cast<uint16_t>(m_baseline_q >> k_frac_bits); }
+    uint16_t peak_ma() const { return m_peak_ma; }
+
+    /** Smoothed current a spike has to be over. */
+    uint16_t threshold_ma() const
+    {
+        uint32_t baseline = baseline_ma();
+        uint32_t rise = baseline * m_config.rise_permille / 1000;
+        rise = rise > m_config.rise_min_ma ? rise : m_config.rise_min_ma;
+        uint32_t threshold = baseline + rise;
+        return static_cast<uint16_t>(threshold > m_config.limit_ma ? m_config.limit_ma : threshold);
+    }
+
+    /** Smoothed reading and baseline at the last trip, 0 before the first. */
+    uint16_t trip_ma() const { return m_trip_ma; }
+    uint16_t trip_baseline_ma() const { return m_trip_baseline_ma; }
+
+private:
+    static constexpr int k_frac_bits = 4; // filters keep 1/16 mA
+
+    bs_load_detect_config_t m_config;
+    int32_t m_filtered_q = 0;
+    int32_t m_baseline_q = 0;
+    uint16_t m_samples = 0; // readings this move, up to blank_samples
+    uint8_t m_run = 0;      // consecutive readings over the threshold
+    bool m_tripped = false;
+    uint16_t m_peak_ma = 0;
+    uint16_t m_trip_ma = 0;
+    uint16_t m_trip_baseline_ma = 0;
+};
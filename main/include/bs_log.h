@@ -9,7 +9,22 @@
 #pragma once
 
 #include <esp_log.h>
+#include <sdkconfig.h>
 
+#if CONFIG_BS_LEAN_BUILD
+// Lean profile: no colour escapes, and informational logs are dead code so the
+// optimiser drops their format strings (emoji included) from flash.
+#define BS_LOG_COLOR_RESET ""
+#define BS_LOG_COLOR_CYAN ""
+#define BS_LOG_COLOR_BLUE ""
+#define BS_LOG_COLOR_YELLOW ""
+#define BS_LOG_COLOR_MAGENTA ""
+#define BS_LOG_COLOR_RED ""
+#define BS_LOG_COLOR_GREEN ""
+#define BS_LOG_COLOR_DIM ""
+#define BS_LOG_INFO_ENABLED 0
+#else
+#define BS_LOG_INFO_ENABLED 1
 #define BS_LOG_COLOR_RESET "\x1b[0m"
 #define BS_LOG_COLOR_CYAN "\x1b[36m"
 #define BS_LOG_COLOR_BLUE "\x1b[34m"
@@ -18,6 +33,7 @@
 #define BS_LOG_COLOR_RED "\x1b[31m"
 #define BS_LOG_COLOR_GREEN "\x1b[32m"
 #define BS_LOG_COLOR_DIM "\x1b[90m"
+#endif
 
 #define BS_TAG_APP "APP[WC]"
 #define BS_TAG_MOTOR "DRIVER[MOTOR]"
@@ -27,11 +43,18 @@
 #define BS_TAG_STATE "OK/STATE"
 #define BS_TAG_TICK "TICK/PROGRESS"
 
-#define BS_LOG_APP(fmt, ...) ESP_LOGI(BS_TAG_APP, BS_LOG_COLOR_CYAN fmt BS_LOG_COLOR_RESET, ##__VA_ARGS__)
-#define BS_LOG_MOTOR(fmt, ...) ESP_LOGI(BS_TAG_MOTOR, BS_LOG_COLOR_BLUE fmt BS_LOG_COLOR_RESET, ##__VA_ARGS__)
-#define BS_LOG_LED(fmt, ...) ESP_LOGI(BS_TAG_LED, BS_LOG_COLOR_MAGENTA fmt BS_LOG_COLOR_RESET, ##__VA_ARGS__)
+#define BS_LOG_INFO(tag, fmt, ...)                              \
+    do {                                                        \
+        if (BS_LOG_INFO_ENABLED) {                              \
+            ESP_LOGI(tag, fmt, ##__VA_ARGS__);                  \
+        }                                                       \
+    } while (0)
+
+#define BS_LOG_APP(fmt, ...) BS_LOG_INFO(BS_TAG_APP, BS_LOG_COLOR_CYAN fmt BS_LOG_COLOR_RESET, ##__VA_ARGS__)
+#define BS_LOG_MOTOR(fmt, ...) BS_LOG_INFO(BS_TAG_MOTOR, BS_LOG_COLOR_BLUE fmt BS_LOG_COLOR_RESET, ##__VA_ARGS__)
+#define BS_LOG_LED(fmt, ...) BS_LOG_INFO(BS_TAG_LED, BS_LOG_COLOR_MAGENTA fmt BS_LOG_COLOR_RESET, ##__VA_ARGS__)
 
 #define BS_LOG_WARN(fmt, ...) ESP_LOGW(BS_TAG_WARN, BS_LOG_COLOR_YELLOW fmt BS_LOG_COLOR_RESET, ##__VA_ARGS__)
 #define BS_LOG_ERROR(fmt, ...) ESP_LOGE(BS_TAG_ERROR, BS_LOG_COLOR_RED fmt BS_LOG_COLOR_RESET, ##__VA_ARGS__)
-#define BS_LOG_STATE(fmt, ...) ESP_LOGI(BS_TAG_STATE, BS_LOG_COLOR_GREEN fmt BS_LOG_COLOR_RESET, ##__VA_ARGS__)
-#define BS_LOG_TICK(fmt, ...) ESP_LOGI(BS_TAG_TICK, BS_LOG_COLOR_DIM fmt BS_LOG_COLOR_RESET, ##__VA_ARGS__)
+#define BS_LOG_STATE(fmt, ...) BS_LOG_INFO(BS_TAG_STATE, BS_LOG_COLOR_GREEN fmt BS_LOG_COLOR_RESET, ##__VA_ARGS__)
+#define BS_LOG_TICK(fmt, ...) BS_LOG_INFO(BS_TAG_TICK, BS_LOG_COLOR_DIM fmt BS_LOG_COLOR_RESET, ##__VA_ARGS__)
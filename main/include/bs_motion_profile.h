@@ -0,0 +1,93 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "bs_speed_tune.h"
+
+// Named motion profiles on top of the calibrated step profile, and the ramp math the
+// step generator runs.
+//
+// The calibrated (or auto-tuned) profile is the fastest the blind follows reliably.
+// A motion profile scales it: a slower cruise, a longer and therefore gentler ramp,
+// and finer microstepping trade speed for noise. Because the step generator re-reads
+// its profile on every step, a profile may change mid-move; the ramp then resumes at
+// the point of the new profile that matches the current speed instead of jumping.
+//
+// No FreeRTOS/ESP-IDF dependencies: this header builds on the host as-is.
+
+struct bs_motion_profile_t {
+    const char *name;
+    uint8_t speed_percent; // cruise and start speed relative to the calibrated profile
+    uint16_t ramp_percent; // ramp length relative to the calibrated profile
+    uint8_t microsteps;    // STEP pulses per step: 1, 2, 4, 8 or 16
+};
+
+/** Delay after the pulse of step `ramp_progress` of a move (0 = first step). */
+inline uint16_t bs_step_delay_for_ramp(const bs_step_profile_t &profile, uint16_t ramp_progress)
+{
+    if (profile.start_delay_us <= profile.cruise_delay_us || profile.ramp_steps == 0 ||
+        ramp_progress >= profile.ramp_steps) {
+        return profile.cruise_delay_us;
+    }
+
+    uint32_t delta = static_cast<uint32_t>(profile.start_delay_us - profile.cruise_delay_us);
+    uint32_t reduced = (delta * ramp_progress) / profile.ramp_steps;
+    return static_cast<uint16_t>(profile.start_delay_us - reduced);
+}
+
+/**
+ * Ramp position of `profile` to continue from after steps of `delay_us`: the furthest
+ * point whose delay is not shorter, so a profile change never speeds the shaft up in
+ * one step. Slower than the start delay resumes at the start, which the motor follows
+ * from a standstill anyway; at or below the cruise delay, past the end of the ramp.
+ */
+inline uint16_t bs_ramp_progress_for_delay(const bs_step_profile_t &profile, uint16_t delay_us)
+{
+    if (delay_us <= profile.cruise_delay_us || profile.start_delay_us <= profile.cruise_delay_us) {
+        return profile.ramp_steps;
+    }
+    if (delay_us >= profile.start_delay_us) {
+        return 0;
+    }
+    uint32_t delta = static_cast<uint32_t>(profile.start_delay_us - profile.cruise_delay_us);
+    return static_cast<uint16_t>((static_cast<uint32_t>(profile.start_delay_us - delay_us) * profile.ramp_steps) /
+                                 delta);
+}
+
+/** The step profile `motion` runs at on a blind calibrated to `base`. */
+inline bs_step_profile_t bs_motion_profile_apply(const bs_motion_profile_t &motion, const bs_step_profile_t &base)
+{
+    auto scale = [](uint32_t value, uint32_t numerator, uint32_t denominator) -> uint16_t {
+        uint32_t scaled = denominator ? (value * numerator + denominator / 2) / denominator : value;
+        return static_cast<uint16_t>(scaled > UINT16_MAX ? UINT16_MAX : scaled);
+    };
+    bs_step_profile_t profile = {};
+    profile.cruise_delay_us = scale(base.cruise_delay_us, 100, motion.speed_percent);
+    profile.start_delay_us = scale(base.start_delay_us, 100, motion.speed_percent);
+    profile.ramp_steps = scale(base.ramp_steps, motion.ramp_percent, 100);
+    return profile;
+}
+
+/**
+ * Time one move of `steps` takes from a standstill: every step costs `microsteps`
+ * pulses of `pulse_us` plus its ramp delay.
+ */
+inline uint64_t bs_move_duration_us(const bs_step_profile_t &profile, uint8_t microsteps, uint16_t pulse_us,
+                                    uint32_t steps)
+{
+    uint64_t total = static_cast<uint64_t>(steps) * microsteps * pulse_us;
+    uint32_t ramp = steps < profile.ramp_steps ? steps : profile.ramp_steps;
+    for (uint32_t step = 0; step < ramp; ++step) {
+        total += bs_step_delay_for_ramp(profile, static_cast<uint16_t>(step));
+    }
+    total += static_cast<uint64_t>(steps - ramp) * profile.cruise_delay_us;
+    return total;
+}
@@ -0,0 +1,270 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Motor backends for the step generator.
+//
+// The driver counts the blind's position in steps: the planner ramps and times them,
+// calibration and NVS keep the travel in them, Matter sees them as a percentage. A
+// backend turns one step into motion. The stepper issues the STEP pulses of a full
+// step. The DC backend drives an H-bridge and counts a hall sensor edge as a step,
+// running the motor at whatever duty keeps the edges on the planner's step delay;
+// without a sensor it counts one step delay at the asked-for speed as a step.
+//
+// A backend is a class over an Io policy, a struct of static functions for the
+// hardware it runs on. The step generator holds one concrete backend, chosen at build
+// time, so every call is resolved at compile time and inlined: no virtual calls, and
+// the stepper's hot path is the code it was before the split. The simulator runs the
+// same classes over its motor models.
+//
+// Every backend has:
+//   k_name, k_pulse_us      what it is; the fixed time a step adds to its delay
+//   halt_locked()           static: motor power off now (STOP ISR, step lock held)
+//   step(dir, delay, micro) one step; false if none was counted (a halt or a stall)
+//   idle()                  motor off between moves
+//   take_coast()            signed steps the shaft made past the counted ones (a DC
+//                           motor coasting on); the caller adds them to the position
+//   take_stall()            the last step() gave up on a shaft that did not turn
+//
+// No FreeRTOS/ESP-IDF dependencies: this header builds on the host as-is.
+
+// A4988 STEP/DIR/EN. Io provides:
+//   lock(), unlock()          the lock the STOP ISR takes around halt_locked()
+//   halt_requested()          with the lock held
+//   set_enable(bool)          driver outputs on (EN low) or off
+//   set_dir(int8_t dir), set_step(uint32_t level)
+//   on_edge(int8_t dir)       with the lock held, right after a step's first rising edge
+//   delay_us(us)              busy wait
+//   delay_or_halt_us(us)      busy wait that ends early on a halt
+template <typename Io>
+class bs_stepper_backend {
+public:
+    static constexpr const char *k_name = "stepper";
+    static constexpr uint16_t k_pulse_us = 10;
+
+    static void halt_locked() { Io::set_enable(false); }
+
+    /**
+     * Returns false without pulsing when a halt is pending; EN is only ever pulled low
+     * here, under the same lock the ISR uses to pull it high. A step is `microsteps`
+     * pulses spread over the step delay. Once the first has gone out the rest follow
+     * even if a halt lands in between (without the delays): with EN high they only move
+     * the A4988 translator, which then sits on the full step the count says, and the
+     * rotor snaps to it on the next enable.
+     */
+    bool step(int8_t dir, uint16_t step_delay_us, uint8_t microsteps)
+    {
+        Io::lock();
+        if (Io::halt_requested()) {
+            Io::unlock();
+            return false;
+        }
+        Io::set_enable(true);
+        Io::set_dir(dir);
+        Io::set_step(1);
+        Io::on_edge(dir);
+        Io::unlock();
+
+        Io::delay_us(k_pulse_us);
+        Io::set_step(0);
+        uint16_t micro_delay_us = step_delay_us / microsteps;
+        for (uint8_t micro = 1; micro < microsteps; ++micro) {
+            Io::delay_or_halt_us(micro_delay_us);
+            Io::set_step(1);
+            Io::delay_us(k_pulse_us);
+            Io::set_step(0);
+        }
+        Io::delay_or_halt_us(step_delay_us - micro_delay_us * (microsteps - 1));
+        return true;
+    }
+
+    void idle() { Io::set_enable(false); }
+
+    // A stepper makes the steps it is given and no others.
+    constexpr int32_t take_coast() const { return 0; }
+    constexpr bool take_stall() const { return false; }
+};
+
+// DC motor on a phase/enable H-bridge, with or without a hall sensor.
+struct bs_dc_config_t {
+    uint16_t full_speed_step_us; // step period at full duty: a hall edge, or the timed step
+    uint16_t min_duty_permille;  // the motor does not turn under this
+    uint32_t stall_us;           // driven with no hall edge for this long (plus 4 step delays): stalled
+    uint32_t stopped_us;         // no hall edge for this long: the shaft has stopped
+    bool hall;                   // false: steps are timed, the position is dead reckoning
+};
+
+// Io provides lock(), unlock(), halt_requested(), delay_us() and delay_or_halt_us() as
+// for the stepper, and:
+//   set_power(bool)                      bridge awake, or asleep (outputs off, coasting)
+//   drive(int8_t dir, uint16_t permille) phase and PWM duty; duty 0 brakes
+//   hall_edges()                         edges since boot, either direction
+//   now_us()
+template <typename Io>
+class bs_dc_backend {
+public:
+    static constexpr const char *k_name = "dc";
+    static constexpr uint16_t k_pulse_us = 0;
+    static constexpr uint16_t k_poll_us = 20;             // hall edge polling inside the step
+    static constexpr uint16_t k_scale_min_permille = 250; // learnt duty correction limits
+    static constexpr uint16_t k_scale_max_permille = 4000;
+
+    explicit bs_dc_backend(const bs_dc_config_t &config) : m_config(config) {}
+
+    static void halt_locked() { Io::set_power(false); }
+
+    /**
+     * Runs the motor towards `dir` until the next hall edge and counts it. A reversal,
+     * or a new start after a halt or stall, first brakes to a standstill; take_coast()
+     * has what the shaft made meanwhile. The bridge is only woken here, under the lock
+     * the ISR uses to put it to sleep.
+     */
+    bool step(int8_t dir, uint16_t step_delay_us, uint8_t microsteps)
+    {
+        (void)microsteps;
+        if (dir != m_dir || m_restart) {
+            stop_driving();
+            m_restart = false;
+            m_dir = dir;
+            m_duty = 0;
+            m_timed_edge = false;
+            m_counted = Io::hall_edges();
+            m_last_edge_us = Io::now_us();
+        }
+        Io::lock();
+        if (Io::halt_requested()) {
+            Io::unlock();
+            m_restart = true;
+            return false;
+        }
+        Io::set_power(true);
+        Io::unlock();
+
+        uint16_t duty = duty_for(step_delay_us);
+        if (duty != m_duty) {
+            Io::drive(dir, duty);
+            m_duty = duty;
+        }
+        if (!m_config.hall) {
+            Io::delay_or_halt_us(step_delay_us);
+            m_restart = Io::halt_requested();
+            return !m_restart;
+        }
+
+        uint64_t stall_us = m_config.stall_us + 4ULL * step_delay_us;
+        while (Io::hall_edges() == m_counted) {
+            if (Io::halt_requested()) {
+                m_restart = true;
+                return false;
+            }
+            if (Io::now_us() - m_last_edge_us > stall_us) {
+                Io::drive(dir, 0);
+                m_stalled = true;
+                m_restart = true;
+                return false;
+            }
+            Io::delay_or_halt_us(k_poll_us);
+        }
+        // Edges that piled up while the caller was away (a yield) are counted one per
+        // call with no wait; their intervals say nothing about the speed.
+        bool backlog = Io::hall_edges() - m_counted > 1;
+        m_counted++;
+        uint64_t now_us = Io::now_us();
+        if (m_timed_edge) {
+            learn_speed(static_cast<uint32_t>(now_us - m_last_edge_us), step_delay_us);
+        }
+        m_timed_edge = !backlog;
+        m_last_edge_us = now_us;
+        return true;
+    }
+
+    void idle()
+    {
+        stop_driving();
+        Io::set_power(false);
+    }
+
+    int32_t take_coast()
+    {
+        int32_t coast = m_coast;
+        m_coast = 0;
+        return coast;
+    }
+
+    bool take_stall()
+    {
+        bool stalled = m_stalled;
+        m_stalled = false;
+        return stalled;
+    }
+
+    /** Learnt correction of the open-loop duty, 1000 = as the config predicts. */
+    uint16_t scale_permille() const { return m_scale_permille; }
+
+private:
+    // Open-loop duty for the step delay (speed is about proportional to duty), times
+    // what the hall edges taught.
+    uint16_t duty_for(uint16_t step_delay_us) const
+    {
+        uint32_t delay = step_delay_us ? step_delay_us : 1;
+        uint32_t duty = static_cast<uint32_t>(m_config.full_speed_step_us) * m_scale_permille / delay;
+        duty = duty < m_config.min_duty_permille ? m_config.min_duty_permille : duty;
+        return static_cast<uint16_t>(duty > 1000 ? 1000 : duty);
+    }
+
+    // An edge later than the delay asks for more duty next time: a quarter of the
+    // error per edge, so one slow edge (a seam in the fabric) does not surge the motor.
+    void learn_speed(uint32_t interval_us, uint16_t step_delay_us)
+    {
+        int32_t wanted = static_cast<int32_t>(static_cast<uint64_t>(m_scale_permille) * interval_us /
+                                              (step_delay_us ? step_delay_us : 1));
+        wanted = wanted < k_scale_min_permille ? k_scale_min_permille : wanted;
+        wanted = wanted > k_scale_max_permille ? k_scale_max_permille : wanted;
+        m_scale_permille = static_cast<uint16_t>(m_scale_permille + (wanted - m_scale_permille) / 4);
+    }
+
+    // Brake and, with a sensor, wait for the shaft to stop: every edge after the last
+    // counted step is coast, in the direction it was driven.
+    void stop_driving()
+    {
+        if (m_dir == 0) {
+            return;
+        }
+        Io::drive(m_dir, 0);
+        if (m_config.hall) {
+            uint32_t seen = Io::hall_edges();
+            uint64_t quiet_since_us = Io::now_us();
+            while (Io::now_us() - quiet_since_us < m_config.stopped_us) {
+                Io::delay_us(k_poll_us);
+                uint32_t edges = Io::hall_edges();
+                if (edges != seen) {
+                    seen = edges;
+                    quiet_since_us = Io::now_us();
+                }
+            }
+            m_coast += static_cast<int32_t>(seen - m_counted) * m_dir;
+            m_counted = seen;
+        }
+        m_dir = 0;
+        m_duty = 0;
+    }
+
+    bs_dc_config_t m_config;
+    uint32_t m_counted = 0;      // hall edges turned into steps or coast
+    uint64_t m_last_edge_us = 0; // when the last counted edge was seen, or the motor started
+    int32_t m_coast = 0;
+    uint16_t m_scale_permille = 1000;
+    uint16_t m_duty = 0;         // permille driven now, 0 = braking
+    int8_t m_dir = 0;            // driven direction, 0 = not driven
+    bool m_timed_edge = false;   // m_last_edge_us is an edge seen on time: the next interval counts
+    bool m_stalled = false;
+    bool m_restart = false;      // halted or stalled: brake to a standstill before driving again
+};
@@ -0,0 +1,153 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-move telemetry: one record per motion, from the first step until the blind is at
+// rest again (retargets on the way are the same move), kept in a fixed ring.
+//
+// The summary compares the older half of the held moves with the newer half. Step
+// timing is fixed by the profile, so a mechanism that gets stiffer shows up first as
+// more battery sag during moves (the motor draws more current), then as encoder
+// corrections and longer wall time per step. Calibration moves are left out.
+//
+// Not thread-safe; the driver copies records in and out under its own lock.
+//
+// No FreeRTOS/ESP-IDF dependencies: this header builds on the host as-is.
+
+enum bs_move_flag_t : uint8_t {
+    BS_MOVE_STOPPED_EARLY = 0x01, // STOP / hard stop / stall ended it short of the target
+    BS_MOVE_SYNC = 0x02,          // ran to a planned time: group sync or a scene transition
+    BS_MOVE_CALIBRATION = 0x04,   // homing, end-stop seek or speed tuning
+};
+
+// 32 bytes.
+struct bs_move_record_t {
+    uint32_t end_time_s;          // uptime when the blind came to rest
+    uint32_t duration_us;         // first step to rest, yields and encoder corrections included
+    uint32_t ramp_us;             // first step to the first cruise step; the whole move if it never got there
+    uint32_t lock_wait_us;        // step generator waiting for the state lock
+    uint16_t start_position;      // percent100ths; steps in a calibration move, which re-measures the
+    uint16_t end_position;        // travel the percentage is taken over
+    uint16_t steps;               // STEP pulses issued (full steps)
+    uint16_t peak_steps_per_s;    // fastest commanded step rate
+    uint16_t reports;             // position reports pushed during the move
+    uint16_t battery_start_mv;    // 0 without a valid reading
+    uint16_t battery_min_mv;      // lowest sample during the move
+    uint8_t profile;              // app_motion_profile_t
+    uint8_t flags;                // bs_move_flag_t bits
+};
+
+struct bs_move_summary_t {
+    uint32_t moves;                      // recorded since boot (or the last clear)
+    uint32_t window;                     // held non-calibration moves the figures below cover
+    uint32_t us_per_step;                // wall time per step over the window
+    int32_t us_per_step_trend_permille;  // newer half vs older half; > 0 is slower
+    uint16_t sag_mv;                     // mean battery start - minimum over the window
+    int16_t sag_trend_mv;                // newer half mean minus older half mean; > 0 is more sag
+    uint16_t peak_steps_per_s;           // fastest of the window
+    uint16_t stopped_early;              // window moves that did not reach their target
+    uint32_t lock_wait_max_us;           // longest per-move lock wait of the window
+};
+
+/** Battery sag of one move, 0 without readings. */
+inline uint16_t bs_move_sag_mv(const bs_move_record_t &record)
+{
+    if (record.battery_start_mv == 0 || record.battery_min_mv == 0 ||
+        record.battery_min_mv >= record.battery_start_mv) {
+        return 0;
+    }
+    return static_cast<uint16_t>(record.battery_start_mv - record.battery_min_mv);
+}
+
+template <size_t N>
+class bs_move_log {
+public:
+    void push(const bs_move_record_t &record)
+    {
+        m_records[m_written % N] = record;
+        m_written++;
+    }
+
+    void clear() { m_written = 0; }
+
+    /** Moves recorded; the ring holds the newest N of them. */
+    uint32_t written() const { return m_written; }
+
+    size_t size() const { return m_written < N ? m_written : N; }
+
+    /** Held record `index`, 0 = newest. */
+    const bs_move_record_t &newest(size_t index) const { return m_records[(m_written - 1 - index) % N]; }
+
+    bs_move_summary_t summary() const
+    {
+        bs_move_summary_t summary = {};
+        summary.moves = m_written;
+        size_t held = size();
+        for (size_t i = 0; i < held; ++i) {
+            if (!(newest(i).flags & BS_MOVE_CALIBRATION)) {
+                summary.window++;
+            }
+        }
+
+        // Oldest first: the first window / 2 eligible records are the older half.
+        half_t halves[2] = {};
+        size_t seen = 0;
+        for (size_t i = held; i-- > 0;) {
+            const bs_move_record_t &record = newest(i);
+            if (record.flags & BS_MOVE_CALIBRATION) {
+                continue;
+            }
+            half_t &half = halves[seen++ < summary.window / 2 ? 0 : 1];
+            half.duration_us += record.duration_us;
+            half.steps += record.steps;
+            if (record.battery_start_mv != 0) {
+                half.sag_mv += bs_move_sag_mv(record);
+                half.sag_moves++;
+            }
+            if (record.peak_steps_per_s > summary.peak_steps_per_s) {
+                summary.peak_steps_per_s = record.peak_steps_per_s;
+            }
+            if (record.lock_wait_us > summary.lock_wait_max_us) {
+                summary.lock_wait_max_us = record.lock_wait_us;
+            }
+            if (record.flags & BS_MOVE_STOPPED_EARLY) {
+                summary.stopped_early++;
+            }
+        }
+
+        uint64_t steps = halves[0].steps + halves[1].steps;
+        uint32_t sag_moves = halves[0].sag_moves + halves[1].sag_moves;
+        summary.us_per_step = steps ? static_cast<uint32_t>((halves[0].duration_us + halves[1].duration_us) / steps) : 0;
+        summary.sag_mv = sag_moves ? static_cast<uint16_t>((halves[0].sag_mv + halves[1].sag_mv) / sag_moves) : 0;
+        if (halves[0].steps && halves[1].steps) {
+            int64_t older = static_cast<int64_t>(halves[0].duration_us / halves[0].steps);
+            int64_t newer = static_cast<int64_t>(halves[1].duration_us / halves[1].steps);
+            summary.us_per_step_trend_permille = older ? static_cast<int32_t>((newer - older) * 1000 / older) : 0;
+        }
+        if (halves[0].sag_moves && halves[1].sag_moves) {
+            summary.sag_trend_mv = static_cast<int16_t>(static_cast<int32_t>(halves[1].sag_mv / halves[1].sag_moves) -
+                                                        static_cast<int32_t>(halves[0].sag_mv / halves[0].sag_moves));
+        }
+        return summary;
+    }
+
+private:
+    struct half_t {
+        uint64_t duration_us;
+        uint64_t steps;
+        uint32_t sag_mv;
+        uint32_t sag_moves;
+    };
+
+    bs_move_record_t m_records[N] = {};
+    uint32_t m_written = 0;
+};
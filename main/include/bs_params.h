@@ -0,0 +1,45 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// Runtime-tunable parameters.
+//
+// Each entry of a table has a compile-time default and a valid range. Values are
+// 16-bit: the firmware stores only overrides, one NVS u16 per key (so keys stay within
+// NVS's 15 characters), and a value equal to its default is not an override.
+//
+// No FreeRTOS/ESP-IDF dependencies: this header builds on the host as-is.
+
+struct bs_param_def_t {
+    const char *key;        // console name and NVS key
+    uint16_t default_value;
+    uint16_t min_value;
+    uint16_t max_value;
+    const char *unit;
+};
+
+/** True if `value` is within `def`'s range. */
+inline bool bs_param_valid(const bs_param_def_t &def, uint16_t value)
+{
+    return value >= def.min_value && value <= def.max_value;
+}
+
+/** Index of the entry called `key`, or `count` if there is none. */
+inline uint8_t bs_param_find(const bs_param_def_t *table, uint8_t count, const char *key)
+{
+    for (uint8_t i = 0; i < count; ++i) {
+        if (strcmp(table[i].key, key) == 0) {
+            return i;
+        }
+    }
+    return count;
+}
@@ -10,7 +10,42 @@
 
 #include <driver/gpio.h>
 
+#if CONFIG_BS_MOTOR_DC
+// DC motor H-bridge in phase/enable mode, on the stepper's STEP/DIR/EN pins
+// (nSLEEP is active LOW: the outputs sleep and the motor coasts).
+static constexpr gpio_num_t BS_PIN_DC_PWM = GPIO_NUM_4;
+static constexpr gpio_num_t BS_PIN_DC_PHASE = GPIO_NUM_5;
+static constexpr gpio_num_t BS_PIN_DC_SLEEP = GPIO_NUM_6;
+#if CONFIG_BS_DC_HALL
+static constexpr gpio_num_t BS_PIN_DC_HALL = static_cast<gpio_num_t>(CONFIG_BS_DC_HALL_PIN);
+#endif
+#else
 // Stepper driver wiring (A4988 EN is active LOW).
 static constexpr gpio_num_t BS_PIN_STEP = GPIO_NUM_4;
 static constexpr gpio_num_t BS_PIN_DIR = GPIO_NUM_5;
 static constexpr gpio_num_t BS_PIN_EN = GPIO_NUM_6;
+#endif
+
+#if CONFIG_BS_ENCODER
+// Quadrature encoder on the motor shaft, counted by the PCNT.
+static constexpr gpio_num_t BS_PIN_ENC_A = static_cast<gpio_num_t>(CONFIG_BS_ENCODER_PIN_A);
+static constexpr gpio_num_t BS_PIN_ENC_B = static_cast<gpio_num_t>(CONFIG_BS_ENCODER_PIN_B);
+#endif
+
+#if CONFIG_BS_HOME_SWITCH
+// Normally-open end stop at the top of travel, closing to GND.
+static constexpr gpio_num_t BS_PIN_HOME_SWITCH = static_cast<gpio_num_t>(CONFIG_BS_HOME_SWITCH_PIN);
+#endif
+
+#if CONFIG_BS_DUAL_MOTOR
+// Second A4988 for lockstep; shares EN with the first.
+static constexpr gpio_num_t BS_PIN_STEP2 = static_cast<gpio_num_t>(CONFIG_BS_MOTOR2_STEP_PIN);
+static constexpr gpio_num_t BS_PIN_DIR2 = static_cast<gpio_num_t>(CONFIG_BS_MOTOR2_DIR_PIN);
+#endif
+
+#if CONFIG_BS_MICROSTEP_SELECT
+// A4988 microstep resolution, set per motion profile.
+static constexpr gpio_num_t BS_PIN_MS1 = static_cast<gpio_num_t>(CONFIG_BS_MICROSTEP_MS1_PIN);
+static constexpr gpio_num_t BS_PIN_MS2 = static_cast<gpio_num_t>(CONFIG_BS_MICROSTEP_MS2_PIN);
+static constexpr gpio_num_t BS_PIN_MS3 = static_cast<gpio_num_t>(CONFIG_BS_MICROSTEP_MS3_PIN);
+#endif
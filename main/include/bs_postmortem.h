@@ -0,0 +1,129 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bs_trace.h"
+
+// Post-mortem record: what the firmware knew when it last stopped running. While it
+// runs, the motor state, per-task CPU figures and the trace ring sit in RAM that
+// survives a panic, watchdog or brownout reset; the next boot seals them into one
+// record in the "postmortem" partition. Nothing touches flash while the failing boot
+// is still running.
+//
+// The partition holds one record per 4 KB slot, newest = highest sequence. The layout
+// is little-endian with no implicit padding; tools/postmortem_decode.py reads the same
+// structs from a partition dump, so a layout change must bump BS_POSTMORTEM_VERSION.
+//
+// No FreeRTOS/ESP-IDF dependencies: this header builds on the host as-is.
+
+constexpr uint32_t BS_POSTMORTEM_MAGIC = 0x4d505342; // "BSPM"
+constexpr uint16_t BS_POSTMORTEM_VERSION = 1;
+constexpr uint32_t BS_POSTMORTEM_SLOT_BYTES = 4096;
+constexpr size_t BS_POSTMORTEM_TASKS = 16;
+constexpr size_t BS_POSTMORTEM_TRACE_RECORDS = 256;
+
+enum bs_postmortem_flag_t : uint8_t {
+    BS_POSTMORTEM_MOTOR_TORN = 0x01, // the reset hit while the motor snapshot was being written
+    BS_POSTMORTEM_TASKS_TORN = 0x02, // same for the task table
+};
+
+enum bs_postmortem_motor_flag_t : uint8_t {
+    BS_POSTMORTEM_MOVING = 0x01,
+    BS_POSTMORTEM_STOPPED_EARLY = 0x02, // the last move was cut short by a stop
+    BS_POSTMORTEM_CALIBRATING = 0x04,
+};
+
+// 36 bytes.
+struct bs_postmortem_header_t {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;          // bytes of the whole record
+    uint32_t crc32;         // CRC-32 (IEEE) of the record from `sequence` on
+    uint32_t sequence;      // records written since the partition was erased
+    uint32_t reset_reason;  // esp_reset_reason_t the next boot saw
+    uint32_t uptime_ms;     // newest snapshot before the reset
+    uint32_t trace_written; // records the trace ring had taken in that boot
+    uint16_t trace_count;   // newest of them kept below, oldest first
+    uint8_t task_count;
+    uint8_t flags;          // bs_postmortem_flag_t bits
+    uint32_t task_window_ms; // period the task CPU figures cover
+};
+
+// 20 bytes. Refreshed by the driver's update task on every pass.
+struct bs_postmortem_motor_t {
+    uint32_t uptime_ms;
+    uint16_t current_percent100ths;
+    uint16_t target_percent100ths;
+    uint16_t current_steps;
+    uint16_t target_steps;
+    uint16_t travel_steps;
+    uint16_t battery_mv; // latest unfiltered sample, 0 if invalid
+    int8_t dir;          // +1 down, -1 up, 0 idle
+    uint8_t flags;       // bs_postmortem_motor_flag_t bits
+    uint16_t reserved;
+};
+
+// 24 bytes.
+struct bs_postmortem_task_t {
+    char name[16];
+    uint16_t cpu_permille; // share of the run-time counter over the last window
+    uint16_t stack_hwm;    // bytes never used
+    uint32_t run_time;     // run-time counter ticks in the last window
+};
+
+struct bs_postmortem_record_t {
+    bs_postmortem_header_t header;
+    bs_postmortem_motor_t motor;
+    bs_postmortem_task_t tasks[BS_POSTMORTEM_TASKS];
+    bs_trace_record_t trace[BS_POSTMORTEM_TRACE_RECORDS];
+};
+
+static_assert(sizeof(bs_postmortem_header_t) == 36, "header layout is shared with the decoder");
+static_assert(sizeof(bs_postmortem_motor_t) == 20, "motor layout is shared with the decoder");
+static_assert(sizeof(bs_postmortem_task_t) == 24, "task layout is shared with the decoder");
+static_assert(sizeof(bs_trace_record_t) == 8, "trace layout is shared with the decoder");
+static_assert(sizeof(bs_postmortem_record_t) <= BS_POSTMORTEM_SLOT_BYTES, "one record per slot");
+
+/** Byte offset of the first CRC-covered field. */
+constexpr size_t BS_POSTMORTEM_CRC_START = offsetof(bs_postmortem_header_t, sequence);
+
+/** CRC-32 (IEEE, as zlib) of `len` bytes, continuing from `crc` (0 to start). */
+inline uint32_t bs_postmortem_crc32(const void *data, size_t len, uint32_t crc = 0)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+    return ~crc;
+}
+
+/** True if `header` starts a record this firmware can read; the CRC is checked separately. */
+inline bool bs_postmortem_header_ok(const bs_postmortem_header_t &header)
+{
+    return header.magic == BS_POSTMORTEM_MAGIC && header.version == BS_POSTMORTEM_VERSION &&
+           header.size == sizeof(bs_postmortem_record_t) && header.trace_count <= BS_POSTMORTEM_TRACE_RECORDS &&
+           header.task_count <= BS_POSTMORTEM_TASKS;
+}
+
+/** Name of an esp_reset_reason_t value. */
+inline const char *bs_postmortem_reset_name(uint32_t reason)
+{
+    static const char *const names[] = {"unknown", "power-on", "external", "software", "panic",
+                                        "interrupt watchdog", "task watchdog", "watchdog", "deep sleep",
+                                        "brownout", "SDIO", "USB", "JTAG", "eFuse", "power glitch",
+                                        "CPU lockup"};
+    return reason < sizeof(names) / sizeof(names[0]) ? names[reason] : "?";
+}
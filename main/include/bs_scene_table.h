@@ -0,0 +1,176 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Scenes of the WindowCovering endpoint: where the blind goes and how long it takes to
+// get there. A scene is keyed by fabric, group and scene ID like a Matter scene, and
+// holds lift, tilt (k_no_tilt on a covering without it) and the transition time.
+//
+// Entries are kept packed at the front of the array, 12 bytes each, so the used part
+// is also the NVS blob: load() takes back exactly what bytes() / byte_size() gave.
+//
+// Not thread-safe; the owner serializes access.
+//
+// No FreeRTOS/ESP-IDF dependencies: this header builds on the host as-is.
+
+struct bs_scene_t {
+    static constexpr uint16_t k_no_tilt = 0xFFFF;
+
+    uint8_t fabric_index;
+    uint8_t scene_id;
+    uint16_t group_id;
+    uint16_t lift_percent100ths;
+    uint16_t tilt_percent100ths;
+    uint32_t transition_ms;
+};
+static_assert(sizeof(bs_scene_t) == 12, "bs_scene_t is stored in NVS as is");
+
+template <size_t Capacity>
+class bs_scene_table {
+    static_assert(Capacity > 0 && Capacity <= 255, "scene count must fit a uint8_t");
+
+public:
+    static constexpr uint16_t k_percent100ths_max = 10000;
+    static constexpr uint32_t k_transition_max_ms = 60000000; // Scenes Management: 60 000 s
+
+    static constexpr size_t capacity() { return Capacity; }
+
+    /** Add `scene`, or overwrite the one with its key. False when the table is full. */
+    bool store(const bs_scene_t &scene)
+    {
+        bs_scene_t *slot = find_slot(scene.fabric_index, scene.group_id, scene.scene_id);
+        if (!slot) {
+            if (m_count == Capacity) {
+                return false;
+            }
+            slot = &m_scenes[m_count++];
+        }
+        *slot = sanitized(scene);
+        return true;
+    }
+
+    /** The scene with this key, nullptr when there is none. Valid until the table changes. */
+    const bs_scene_t *find(uint8_t fabric_index, uint16_t group_id, uint8_t scene_id) const
+    {
+        for (uint8_t i = 0; i < m_count; ++i) {
+            const bs_scene_t &scene = m_scenes[i];
+            if (scene.fabric_index == fabric_index && scene.group_id == group_id && scene.scene_id == scene_id) {
+                return &scene;
+            }
+        }
+        return nullptr;
+    }
+
+    bool remove(uint8_t fabric_index, uint16_t group_id, uint8_t scene_id)
+    {
+        const bs_scene_t *scene = find(fabric_index, group_id, scene_id);
+        if (!scene) {
+            return false;
+        }
+        erase(static_cast<uint8_t>(scene - m_scenes));
+        return true;
+    }
+
+    /** Remove every scene of one group; returns how many went. */
+    uint8_t remove_group(uint8_t fabric_index, uint16_t group_id)
+    {
+        uint8_t removed = 0;
+        for (uint8_t i = 0; i < m_count;) {
+            if (m_scenes[i].fabric_index == fabric_index && m_scenes[i].group_id == group_id) {
+                erase(i);
+                removed++;
+            } else {
+                i++;
+            }
+        }
+        return removed;
+    }
+
+    /** Remove every scene of one fabric (it left); returns how many went. */
+    uint8_t remove_fabric(uint8_t fabric_index)
+    {
+        uint8_t removed = 0;
+        for (uint8_t i = 0; i < m_count;) {
+            if (m_scenes[i].fabric_index == fabric_index) {
+                erase(i);
+                removed++;
+            } else {
+                i++;
+            }
+        }
+        return removed;
+    }
+
+    void clear() { m_count = 0; }
+
+    uint8_t count() const { return m_count; }
+
+    /** Scene `index`, 0 .. count() - 1, in no particular order. */
+    const bs_scene_t &at(uint8_t index) const { return m_scenes[index]; }
+
+    const void *bytes() const { return m_scenes; }
+    size_t byte_size() const { return m_count * sizeof(bs_scene_t); }
+
+    /** Replace the table with a stored blob. False, leaving it empty, if the blob is not one. */
+    bool load(const void *data, size_t size)
+    {
+        m_count = 0;
+        if (size % sizeof(bs_scene_t) != 0 || size > sizeof(m_scenes)) {
+            return false;
+        }
+        memcpy(m_scenes, data, size);
+        uint8_t count = static_cast<uint8_t>(size / sizeof(bs_scene_t));
+        for (uint8_t i = 0; i < count; ++i) {
+            const bs_scene_t &scene = m_scenes[i];
+            bool valid = scene.lift_percent100ths <= k_percent100ths_max &&
+                         (scene.tilt_percent100ths <= k_percent100ths_max ||
+                          scene.tilt_percent100ths == bs_scene_t::k_no_tilt) &&
+                         scene.transition_ms <= k_transition_max_ms;
+            for (uint8_t j = 0; valid && j < i; ++j) {
+                valid = m_scenes[j].fabric_index != scene.fabric_index || m_scenes[j].group_id != scene.group_id ||
+                        m_scenes[j].scene_id != scene.scene_id;
+            }
+            if (!valid) {
+                return false;
+            }
+        }
+        m_count = count;
+        return true;
+    }
+
+private:
+    static bs_scene_t sanitized(bs_scene_t scene)
+    {
+        if (scene.lift_percent100ths > k_percent100ths_max) {
+            scene.lift_percent100ths = k_percent100ths_max;
+        }
+        if (scene.tilt_percent100ths > k_percent100ths_max && scene.tilt_percent100ths != bs_scene_t::k_no_tilt) {
+            scene.tilt_percent100ths = k_percent100ths_max;
+        }
+        if (scene.transition_ms > k_transition_max_ms) {
+            scene.transition_ms = k_transition_max_ms;
+        }
+        return scene;
+    }
+
+    bs_scene_t *find_slot(uint8_t fabric_index, uint16_t group_id, uint8_t scene_id)
+    {
+        return const_cast<bs_scene_t *>(find(fabric_index, group_id, scene_id));
+    }
+
+    // The last entry fills the hole: order does not matter, packing does.
+    void erase(uint8_t index) { m_scenes[index] = m_scenes[--m_count]; }
+
+    bs_scene_t m_scenes[Capacity] = {};
+    uint8_t m_count = 0;
+};
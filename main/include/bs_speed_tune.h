@@ -0,0 +1,135 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Search for the fastest step profile a particular blind follows reliably.
+//
+// Starting from a known-good baseline, each trial runs a little faster than the last
+// good one: first the cruise step delay shrinks until a trial loses position (or the
+// floor is reached), then the ramp shortens at the chosen cruise speed. Each winner is
+// backed off by margin_percent, and the result is never slower than the baseline.
+// The caller runs one test move per trial and reports whether position was lost.
+//
+// No FreeRTOS/ESP-IDF dependencies: this header builds on the host as-is.
+
+struct bs_step_profile_t {
+    uint16_t cruise_delay_us; // delay after each pulse at full speed
+    uint16_t start_delay_us;  // delay for the first step of a move
+    uint16_t ramp_steps;      // steps from start_delay_us to cruise_delay_us
+};
+
+struct bs_speed_tune_config_t {
+    bs_step_profile_t baseline;
+    uint16_t min_cruise_delay_us;
+    uint16_t min_ramp_steps;
+    uint8_t speedup_percent; // each trial is this much faster than the last good one
+    uint8_t margin_percent;  // the result is this much slower than the fastest good trial
+};
+
+enum class bs_speed_tune_phase_t : uint8_t {
+    k_cruise,
+    k_ramp,
+    k_done,
+};
+
+class bs_speed_tuner {
+public:
+    explicit bs_speed_tuner(const bs_speed_tune_config_t &config) : m_config(config) { start(); }
+
+    void start()
+    {
+        m_phase = bs_speed_tune_phase_t::k_cruise;
+        m_good = m_config.baseline;
+        m_result = m_config.baseline;
+        m_trials = 0;
+        m_trial = m_good;
+        if (!faster(m_trial.cruise_delay_us, m_config.min_cruise_delay_us)) {
+            finish_cruise();
+        }
+    }
+
+    bs_speed_tune_phase_t phase() const { return m_phase; }
+
+    /** Profile to run the next test move with. Meaningless once done. */
+    const bs_step_profile_t &trial() const { return m_trial; }
+
+    /** Outcome of the test move run with trial(). */
+    void report(bool position_lost)
+    {
+        if (m_phase == bs_speed_tune_phase_t::k_done) {
+            return;
+        }
+        m_trials++;
+        if (m_phase == bs_speed_tune_phase_t::k_cruise) {
+            if (!position_lost) {
+                m_good.cruise_delay_us = m_trial.cruise_delay_us;
+                if (faster(m_trial.cruise_delay_us, m_config.min_cruise_delay_us)) {
+                    return;
+                }
+            }
+            finish_cruise();
+            return;
+        }
+        if (!position_lost) {
+            m_good.ramp_steps = m_trial.ramp_steps;
+            if (faster(m_trial.ramp_steps, m_config.min_ramp_steps)) {
+                return;
+            }
+        }
+        m_result.ramp_steps = backed_off(m_good.ramp_steps, m_config.baseline.ramp_steps);
+        m_phase = bs_speed_tune_phase_t::k_done;
+    }
+
+    /** Tuned profile; the baseline until the search is done. */
+    const bs_step_profile_t &result() const { return m_result; }
+
+    uint16_t trials() const { return m_trials; }
+
+private:
+    // Shrink value by speedup_percent (at least by one) without going under floor.
+    bool faster(uint16_t &value, uint16_t floor) const
+    {
+        if (value <= floor) {
+            return false;
+        }
+        uint32_t reduced = (static_cast<uint32_t>(value) * (100 - m_config.speedup_percent)) / 100;
+        if (reduced >= value) {
+            reduced = value - 1;
+        }
+        value = static_cast<uint16_t>(reduced < floor ? floor : reduced);
+        return true;
+    }
+
+    uint16_t backed_off(uint16_t good, uint16_t ceiling) const
+    {
+        uint32_t value = (static_cast<uint32_t>(good) * (100 + m_config.margin_percent) + 99) / 100;
+        return static_cast<uint16_t>(value > ceiling ? ceiling : value);
+    }
+
+    void finish_cruise()
+    {
+        m_result.cruise_delay_us = backed_off(m_good.cruise_delay_us, m_config.baseline.cruise_delay_us);
+        m_phase = bs_speed_tune_phase_t::k_ramp;
+        // The ramp is tuned at the speed it will actually run at.
+        m_good.cruise_delay_us = m_result.cruise_delay_us;
+        m_trial = m_good;
+        if (!faster(m_trial.ramp_steps, m_config.min_ramp_steps)) {
+            m_phase = bs_speed_tune_phase_t::k_done;
+        }
+    }
+
+    bs_speed_tune_config_t m_config;
+    bs_speed_tune_phase_t m_phase = bs_speed_tune_phase_t::k_cruise;
+    bs_step_profile_t m_good = {};
+    bs_step_profile_t m_trial = {};
+    bs_step_profile_t m_result = {};
+    uint16_t m_trials = 0;
+};
@@ -0,0 +1,72 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded single-producer/single-consumer ring. Exactly one task pushes and exactly
+// one task pops; the two may run on different cores. Each index is written by one
+// side only, so no locks and no CAS: an acquire/release pair per operation.
+//
+// No FreeRTOS/ESP-IDF dependencies: this header builds on the host as-is.
+
+template <typename T, size_t Capacity>
+class bs_spsc_ring {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    /** Producer only. False (and counted) when the ring is full. */
+    bool push(const T &item)
+    {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) >= Capacity) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_items[head & k_mask] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Consumer only. False when the ring is empty. */
+    bool pop(T &out)
+    {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        out = m_items[tail & k_mask];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Consumer only: drain everything and keep the newest item. */
+    bool pop_latest(T &out)
+    {
+        bool any = false;
+        while (pop(out)) {
+            any = true;
+        }
+        return any;
+    }
+
+    bool empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); }
+
+    uint32_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t k_mask = static_cast<uint32_t>(Capacity - 1);
+
+    T m_items[Capacity];
+    std::atomic<uint32_t> m_head{0};
+    std::atomic<uint32_t> m_tail{0};
+    std::atomic<uint32_t> m_dropped{0};
+};
@@ -0,0 +1,78 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "bs_motion_profile.h"
+#include "bs_speed_tune.h"
+
+// Synchronized group moves.
+//
+// Every blind in a group is given the same full-travel time. A shared command then
+// takes each blind the same share of that time: moving by D percent takes D% of the
+// full-travel time, however long the blind is. Blinds that start level stay level the
+// whole way and arrive together. Each device slows its own motion profile just enough
+// to take that long. A device that cannot (the agreed time is shorter than its fastest
+// move) runs flat out and arrives late.
+//
+// No FreeRTOS/ESP-IDF dependencies: this header builds on the host as-is.
+
+struct bs_sync_plan_t {
+    bs_step_profile_t profile; // what to run the move at
+    uint64_t duration_us;      // what the move takes with it
+    uint32_t spare_us;         // left over by rounding the cruise delay to whole us: < 1 us per step
+    bool on_time;              // within one step (plus 1 us per step of rounding) of the asked time
+};
+
+/** Time a group move from one position to another should take. */
+inline uint64_t bs_sync_move_time_us(uint32_t full_travel_ms, uint16_t from_percent100ths, uint16_t to_percent100ths)
+{
+    uint32_t distance = from_percent100ths > to_percent100ths ? from_percent100ths - to_percent100ths
+                                                               : to_percent100ths - from_percent100ths;
+    return static_cast<uint64_t>(full_travel_ms) * 1000 * distance / 10000;
+}
+
+/**
+ * Slowest cruise delay that keeps a move of `steps` on `fastest`'s ramp within
+ * `move_time_us`. Start delay and ramp length stay; once the cruise delay passes the
+ * start delay the move runs at one speed throughout. Never faster than `fastest`.
+ */
+inline bs_sync_plan_t bs_sync_plan(const bs_step_profile_t &fastest, uint8_t microsteps, uint16_t pulse_us,
+                                   uint32_t steps, uint64_t move_time_us)
+{
+    bs_sync_plan_t plan = {fastest, bs_move_duration_us(fastest, microsteps, pulse_us, steps), 0, true};
+    if (steps == 0) {
+        return plan;
+    }
+    if (plan.duration_us < move_time_us) {
+        // The duration only grows with the cruise delay: binary search for the slowest fit.
+        uint32_t low = fastest.cruise_delay_us;
+        uint32_t high = UINT16_MAX;
+        bs_step_profile_t probe = fastest;
+        while (low < high) {
+            uint32_t mid = (low + high + 1) / 2;
+            probe.cruise_delay_us = static_cast<uint16_t>(mid);
+            if (bs_move_duration_us(probe, microsteps, pulse_us, steps) <= move_time_us) {
+                low = mid;
+            } else {
+                high = mid - 1;
+            }
+        }
+        plan.profile.cruise_delay_us = static_cast<uint16_t>(low);
+        plan.duration_us = bs_move_duration_us(plan.profile, microsteps, pulse_us, steps);
+        uint64_t spare = move_time_us - plan.duration_us;
+        plan.spare_us = static_cast<uint32_t>(spare < steps ? spare : steps);
+    }
+    uint64_t step_us = static_cast<uint64_t>(plan.profile.cruise_delay_us) + static_cast<uint64_t>(microsteps) * pulse_us;
+    uint64_t error_us = plan.duration_us > move_time_us ? plan.duration_us - move_time_us
+                                                        : move_time_us - plan.duration_us;
+    plan.on_time = error_us <= step_us + steps;
+    return plan;
+}
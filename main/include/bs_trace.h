@@ -0,0 +1,115 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Command/motion trace records and their text form. The device keeps records in a
+// RAM ring (app_trace.cpp) and `matter trace dump` prints one line per record:
+//
+//     BSTRACE <time_us> <event> <value> <detail>
+//
+// The host simulator replays those lines (blindshade_sim --replay), so the parser
+// accepts them anywhere in a captured console log.
+//
+// No FreeRTOS/ESP-IDF dependencies: this header builds on the host as-is.
+
+enum class bs_trace_event_t : uint8_t {
+    k_wc_command = 0, // Matter command arrived: value = target, detail = bs_wc_command_t
+    k_target,         // driver GoTo (TargetPosition write): value = target percent100ths
+    k_stop,           // driver Stop
+    k_button,         // raw button edge: value = 1 pressed / 0 released, detail = bs_trace_button_t
+    k_motion_start,   // value = position percent100ths, detail = 1 closing / 0 opening
+    k_motion_stop,    // value = position percent100ths
+    k_hard_stop,      // halt acknowledged: value = position percent100ths
+    k_report,         // position reported: value = percent100ths, detail = OperationalState
+    k_count,
+};
+
+enum bs_trace_button_t : uint8_t {
+    BS_TRACE_BUTTON_UP = 0,
+    BS_TRACE_BUTTON_STOP,
+    BS_TRACE_BUTTON_DOWN,
+};
+
+// 8 bytes; the 32-bit timestamp wraps after ~71 minutes, see bs_trace_clock.
+struct bs_trace_record_t {
+    uint32_t time_us;
+    bs_trace_event_t event;
+    uint8_t detail;
+    uint16_t value;
+};
+
+inline const char *bs_trace_event_name(bs_trace_event_t event)
+{
+    static const char *const names[] = {"command", "target", "stop", "button",
+                                        "motion_start", "motion_stop", "hard_stop", "report"};
+    static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(bs_trace_event_t::k_count),
+                  "one name per event");
+    return event < bs_trace_event_t::k_count ? names[static_cast<uint8_t>(event)] : "?";
+}
+
+/** Text line for one record, without a newline. */
+inline int bs_trace_format(char *buf, size_t len, uint64_t time_us, const bs_trace_record_t &record)
+{
+    return snprintf(buf, len, "BSTRACE %llu %s %u %u", static_cast<unsigned long long>(time_us),
+                    bs_trace_event_name(record.event), static_cast<unsigned>(record.value),
+                    static_cast<unsigned>(record.detail));
+}
+
+/** Parse a BSTRACE line (log prefixes allowed). False for anything else. */
+inline bool bs_trace_parse(const char *line, uint64_t &time_us, bs_trace_record_t &record)
+{
+    const char *start = strstr(line, "BSTRACE ");
+    if (!start) {
+        return false;
+    }
+    unsigned long long time = 0;
+    char name[16] = {};
+    unsigned value = 0;
+    unsigned detail = 0;
+    if (sscanf(start, "BSTRACE %llu %15s %u %u", &time, name, &value, &detail) != 4) {
+        return false;
+    }
+    for (uint8_t i = 0; i < static_cast<uint8_t>(bs_trace_event_t::k_count); ++i) {
+        bs_trace_event_t event = static_cast<bs_trace_event_t>(i);
+        if (strcmp(name, bs_trace_event_name(event)) == 0) {
+            time_us = time;
+            record.time_us = static_cast<uint32_t>(time);
+            record.event = event;
+            record.value = static_cast<uint16_t>(value);
+            record.detail = static_cast<uint8_t>(detail);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Rebuilds 64-bit time from records read oldest first, assuming consecutive records
+// are less than ~71 minutes apart.
+class bs_trace_clock {
+public:
+    uint64_t unwrap(uint32_t time_us)
+    {
+        if (m_started) {
+            m_time_us += static_cast<uint32_t>(time_us - static_cast<uint32_t>(m_time_us));
+        } else {
+            m_time_us = time_us;
+            m_started = true;
+        }
+        return m_time_us;
+    }
+
+private:
+    uint64_t m_time_us = 0;
+    bool m_started = false;
+};
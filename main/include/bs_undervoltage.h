@@ -0,0 +1,98 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Battery undervoltage cutoff. The step generator feeds it a reading about every
+// millisecond while the motor runs; `trip_samples` readings in a row under the cutoff
+// trip it, so the dip of a motor start or a single noisy conversion does not. Once
+// tripped it stays tripped until `release_samples` readings in a row at rest are back
+// at or over the release voltage, which sits above the cutoff because a pack that
+// has just collapsed under load reads higher again as soon as the load is gone.
+//
+// A reading of 0 (no valid conversion) neither counts nor breaks a run.
+//
+// Not thread-safe; the driver feeds it under its own spinlock.
+//
+// No FreeRTOS/ESP-IDF dependencies: this header builds on the host as-is.
+
+struct bs_undervoltage_config_t {
+    uint16_t cutoff_mv;
+    uint16_t hysteresis_mv;  // release at cutoff + this
+    uint8_t trip_samples;    // consecutive readings under the cutoff
+    uint8_t release_samples; // consecutive resting readings at or over the release voltage
+};
+
+class bs_undervoltage_guard {
+public:
+    explicit bs_undervoltage_guard(const bs_undervoltage_config_t &config) : m_config(config) {}
+
+    /** New cutoff; a run in progress starts over. */
+    void set_cutoff_mv(uint16_t cutoff_mv)
+    {
+        m_config.cutoff_mv = cutoff_mv;
+        m_run = 0;
+    }
+
+    uint16_t cutoff_mv() const { return m_config.cutoff_mv; }
+    uint16_t release_mv() const { return static_cast<uint16_t>(m_config.cutoff_mv + m_config.hysteresis_mv); }
+
+    /** A reading under load. True when this one trips the guard. */
+    bool sample(uint16_t mv)
+    {
+        if (m_tripped || mv == 0) {
+            return false;
+        }
+        if (mv >= m_config.cutoff_mv) {
+            m_run = 0;
+            return false;
+        }
+        if (++m_run < m_config.trip_samples) {
+            return false;
+        }
+        m_tripped = true;
+        m_trip_mv = mv;
+        m_trips++;
+        m_run = 0;
+        return true;
+    }
+
+    /** A reading with the motor off. True when this one releases a tripped guard. */
+    bool rest_sample(uint16_t mv)
+    {
+        if (!m_tripped || mv == 0) {
+            return false;
+        }
+        if (mv < release_mv()) {
+            m_run = 0;
+            return false;
+        }
+        if (++m_run < m_config.release_samples) {
+            return false;
+        }
+        m_tripped = false;
+        m_run = 0;
+        return true;
+    }
+
+    bool tripped() const { return m_tripped; }
+
+    /** Reading that tripped the guard last, 0 before the first trip. */
+    uint16_t trip_mv() const { return m_trip_mv; }
+
+    uint32_t trips() const { return m_trips; }
+
+private:
+    bs_undervoltage_config_t m_config;
+    uint8_t m_run = 0; // consecutive readings towards the next trip or release
+    bool m_tripped = false;
+    uint16_t m_trip_mv = 0;
+    uint32_t m_trips = 0;
+};
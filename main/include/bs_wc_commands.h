@@ -0,0 +1,81 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Pairs a WindowCovering command with the TargetPositionLiftPercent100ths write the
+// cluster server issues for it. The command pre-callback calls begin() and schedules
+// drop_unpaired() behind the command. The attribute PRE_UPDATE callback calls
+// resolve_target(). If the write never arrives, drop_unpaired() clears the entry, so
+// a later plain attribute write cannot be paired with a stale Open/Close.
+//
+// Used only from the Matter thread. No FreeRTOS/ESP-IDF dependencies: this header
+// builds on the host as-is.
+
+enum class bs_wc_command_t : uint8_t {
+    k_none = 0,
+    k_up_or_open,
+    k_down_or_close,
+    k_go_to_lift_pct,
+    k_stop_motion,
+    k_recall_scene, // trace only: a recall goes to the driver itself, not through a target write
+};
+
+class bs_wc_command_tracker {
+public:
+    static constexpr uint16_t k_percent100ths_max = 10000;
+
+    /** Returns the serial to hand to drop_unpaired(). */
+    uint32_t begin(bs_wc_command_t command, uint16_t target_percent100ths)
+    {
+        m_inflight.serial = ++m_serial;
+        m_inflight.command = command;
+        m_inflight.target_percent100ths = target_percent100ths;
+        return m_inflight.serial;
+    }
+
+    /** Stop, or a command that failed to decode: nothing will write the target. */
+    void clear() { m_inflight = {}; }
+
+    /** TargetPosition PRE_UPDATE: the value to store. Open/Close force their fixed target. */
+    uint16_t resolve_target(uint16_t requested)
+    {
+        if (m_inflight.command == bs_wc_command_t::k_up_or_open ||
+            m_inflight.command == bs_wc_command_t::k_down_or_close) {
+            requested = m_inflight.target_percent100ths;
+        }
+        m_inflight = {};
+        return requested > k_percent100ths_max ? k_percent100ths_max : requested;
+    }
+
+    /** True (and counted) when command `serial` is still waiting for its target write. */
+    bool drop_unpaired(uint32_t serial)
+    {
+        if (m_inflight.command == bs_wc_command_t::k_none || m_inflight.serial != serial) {
+            return false;
+        }
+        m_unpaired++;
+        m_inflight = {};
+        return true;
+    }
+
+    uint32_t unpaired() const { return m_unpaired; }
+
+private:
+    struct inflight_t {
+        uint32_t serial;
+        bs_wc_command_t command;
+        uint16_t target_percent100ths;
+    };
+
+    inflight_t m_inflight = {};
+    uint32_t m_serial = 0;
+    uint32_t m_unpaired = 0;
+};
@@ -0,0 +1,25 @@
+# Lean footprint profile for ESP32-C2. Layer on top of the regular C2 defaults:
+#   idf.py -D SDKCONFIG_DEFAULTS="sdkconfig.defaults;sdkconfig.defaults.esp32c2;sdkconfig.defaults.esp32c2.lean" build
+# then check the result with `cmake --build build --target size-budget`.
+
+# App features (main/Kconfig.projbuild)
+CONFIG_BS_LEAN_BUILD=y
+CONFIG_BS_MONITOR=n
+CONFIG_BS_TRACE=n
+CONFIG_BS_STATUS_LED_WS2812=n
+CONFIG_BS_BATTERY_ADC_CALI=n
+CONFIG_ENABLE_MEMORY_PROFILING=n
+
+# Logging: warnings and errors only, everything below compiled out
+CONFIG_LOG_DEFAULT_LEVEL_WARN=y
+CONFIG_LOG_MAXIMUM_EQUALS_DEFAULT=y
+CONFIG_LOG_COLORS=n
+CONFIG_BOOTLOADER_LOG_LEVEL_WARN=y
+CONFIG_ESP_ERR_TO_NAME_LOOKUP=n
+
+# libc / compiler
+CONFIG_NEWLIB_NANO_FORMAT=y
+CONFIG_COMPILER_OPTIMIZATION_CHECKS_SILENT=y
+
+# Console is already off on C2; keep it that way
+CONFIG_ENABLE_CHIP_SHELL=n
@@ -0,0 +1,47 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include "esp_matter.h"
+
+namespace chip {
+namespace app {
+namespace Clusters {
+namespace WindowCovering {
+constexpr uint32_t Id = 0x0102;
+
+namespace Attributes {
+namespace TargetPositionLiftPercent100ths {
+constexpr uint32_t Id = 0x000B;
+} // namespace TargetPositionLiftPercent100ths
+namespace CurrentPositionLiftPercent100ths {
+constexpr uint32_t Id = 0x000E;
+} // namespace CurrentPositionLiftPercent100ths
+namespace SafetyStatus {
+constexpr uint32_t Id = 0x001A;
+} // namespace SafetyStatus
+} // namespace Attributes
+
+enum class OperationalState : uint8_t {
+    Stall = 0,
+    MovingUpOrOpen = 1,
+    MovingDownOrClose = 2,
+};
+
+enum class OperationalStatus : uint8_t {
+    kGlobal = 0x03,
+    kLift = 0x0C,
+    kTilt = 0x30,
+};
+
+void OperationalStateSet(chip::EndpointId endpoint, OperationalStatus field, OperationalState state);
+} // namespace WindowCovering
+} // namespace Clusters
+} // namespace app
+} // namespace chip
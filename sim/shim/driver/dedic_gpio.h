@@ -0,0 +1,34 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Dedicated GPIO bundles as used for dual-motor lockstep. A write sets every masked
+// pin at the same virtual instant, lowest bit first, as the single CPU store would.
+
+typedef struct sim_dedic_bundle_t *dedic_gpio_bundle_handle_t;
+
+typedef struct {
+    const int *gpio_array;
+    size_t array_size;
+    struct {
+        unsigned int in_en : 1;
+        unsigned int in_invert : 1;
+        unsigned int out_en : 1;
+        unsigned int out_invert : 1;
+    } flags;
+} dedic_gpio_bundle_config_t;
+
+esp_err_t dedic_gpio_new_bundle(const dedic_gpio_bundle_config_t *config, dedic_gpio_bundle_handle_t *ret_bundle);
+void dedic_gpio_bundle_write(dedic_gpio_bundle_handle_t bundle, uint32_t mask, uint32_t value);
+uint32_t dedic_gpio_bundle_read_out(dedic_gpio_bundle_handle_t bundle);
@@ -0,0 +1,16 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_oneshot.h"
+
+// No calibration scheme on the host: the driver falls back to the linear conversion.
+#define ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED 0
+#define ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED 0
@@ -0,0 +1,40 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// The slice of esp-matter and the CHIP SDK the driver touches. Attribute writes and
+// scheduled work land in sim/sim_matter.cpp.
+
+typedef struct {
+    uint8_t type;
+    union {
+        uint16_t u16;
+    } val;
+    bool is_null;
+} esp_matter_attr_val_t;
+
+esp_matter_attr_val_t esp_matter_nullable_uint16(uint16_t value);
+esp_matter_attr_val_t esp_matter_bitmap16(uint16_t value);
+
+namespace esp_matter {
+namespace attribute {
+esp_err_t update(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, esp_matter_attr_val_t *val);
+} // namespace attribute
+} // namespace esp_matter
+
+namespace chip {
+using EndpointId = uint16_t;
+} // namespace chip
+
+typedef int32_t CHIP_ERROR;
+#define CHIP_NO_ERROR 0
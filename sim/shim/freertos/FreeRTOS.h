@@ -0,0 +1,54 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+// FreeRTOS API surface used by the firmware, implemented by sim/sim_kernel.cpp on a
+// virtual clock. One simulated core: exactly one task runs at a time.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t StackType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ CONFIG_FREERTOS_HZ
+#define configMAX_TASK_NAME_LEN 16
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000U))
+#define tskNO_AFFINITY ((BaseType_t)0x7FFFFFFF)
+
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+
+void sim_critical_enter(portMUX_TYPE *mux);
+void sim_critical_exit(portMUX_TYPE *mux);
+void sim_yield_from_isr(void);
+BaseType_t xPortInIsrContext(void);
+
+#define portENTER_CRITICAL(mux) sim_critical_enter(mux)
+#define portEXIT_CRITICAL(mux) sim_critical_exit(mux)
+#define portENTER_CRITICAL_ISR(mux) sim_critical_enter(mux)
+#define portEXIT_CRITICAL_ISR(mux) sim_critical_exit(mux)
+#define portENTER_CRITICAL_SAFE(mux) sim_critical_enter(mux)
+#define portEXIT_CRITICAL_SAFE(mux) sim_critical_exit(mux)
+#define portYIELD_FROM_ISR(...) sim_yield_from_isr()
@@ -0,0 +1,26 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_matter.h"
+
+namespace chip {
+namespace DeviceLayer {
+typedef void (*AsyncWorkFunct)(intptr_t arg);
+
+class PlatformManager {
+public:
+    CHIP_ERROR ScheduleWork(AsyncWorkFunct work, intptr_t arg = 0);
+};
+
+PlatformManager &PlatformMgr();
+} // namespace DeviceLayer
+} // namespace chip
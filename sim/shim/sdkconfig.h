@@ -0,0 +1,58 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+// Configuration the simulator builds app_driver.cpp with. Mirrors sdkconfig.defaults
+// where the option exists on the host; hardware-only features stay off.
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_BS_STATUS_LED_WS2812 1
+#define CONFIG_BS_BATTERY_ADC_CALI 0
+#define CONFIG_BS_UNDERVOLTAGE_CUTOFF 1
+#define CONFIG_BS_MONITOR 0
+#define CONFIG_BS_POWER_SAVE 0
+// -DSIM_MOTION_CORE_PINNED=ON builds the S3 pinned configuration for comparison.
+#ifndef CONFIG_BS_MOTION_CORE_PINNED
+#define CONFIG_BS_MOTION_CORE_PINNED 0
+#endif
+#if CONFIG_BS_MOTION_CORE_PINNED
+#define CONFIG_BS_MOTION_CORE 1
+#define CONFIG_BS_MOTION_PRIORITY 10
+#endif
+#define CONFIG_BS_DRIVER_HEAP_GUARD 0
+#define CONFIG_BS_LEAN_BUILD 0
+// The driver runs the stepper backend; the DC backend runs over its own model (sim_dc.cpp).
+#define CONFIG_BS_MOTOR_STEPPER 1
+#define CONFIG_BS_ENCODER 1
+#define CONFIG_BS_ENCODER_PIN_A 10
+#define CONFIG_BS_ENCODER_PIN_B 11
+#define CONFIG_BS_ENCODER_COUNTS_PER_REV 1600
+#define CONFIG_BS_ENCODER_STEPS_PER_REV 200
+#define CONFIG_BS_ENCODER_TOLERANCE_STEPS 2
+#define CONFIG_BS_HOME_SWITCH 1
+#define CONFIG_BS_HOME_SWITCH_PIN 18
+// The motor current model (sim_hw.cpp) sits behind the shunt amplifier.
+#define CONFIG_BS_CURRENT_SENSE 1
+#define CONFIG_BS_CURRENT_SENSE_ADC_CHANNEL 3
+#define CONFIG_BS_CURRENT_SENSE_MV_PER_A 500
+// The motor model counts every STEP edge as a full step.
+#define CONFIG_BS_MICROSTEP_SELECT 0
+// Two motors in lockstep; the second one is modelled as an ideal shaft.
+#define CONFIG_BS_DUAL_MOTOR 1
+#define CONFIG_BS_MOTOR2_STEP_PIN 16
+#define CONFIG_BS_MOTOR2_DIR_PIN 17
+#define CONFIG_BS_MOTOR2_DIR_INVERT 1
+// Large enough to hold a whole scripted session for --trace.
+#define CONFIG_BS_TRACE 1
+#define CONFIG_BS_TRACE_RECORDS 4096
+#define CONFIG_BS_MOVE_LOG 1
+#define CONFIG_BS_MOVE_LOG_RECORDS 32
+// Flash is a RAM image (sim_partition_image); no task run-time stats on the host.
+#define CONFIG_BS_POSTMORTEM 1
+#define CONFIG_BS_SCENES 1
+#define CONFIG_BS_SCENES_MAX 16
@@ -0,0 +1,230 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <driver/gpio.h>
+#include <esp_system.h>
+
+// Host simulator internals shared by the sim_*.cpp files. Not seen by firmware code.
+
+constexpr uint32_t k_sim_tick_us = 1000000 / configTICK_RATE_HZ;
+constexpr uint32_t k_sim_cpu_mhz = 160;
+
+// === KERNEL (sim_kernel.cpp) ===
+/** Virtual microseconds since boot. */
+uint64_t sim_now_us();
+
+/** Burn CPU on the calling task until now + us; other tasks and hardware events run as they would on one core. */
+void sim_busy_wait_us(uint32_t us);
+
+/** Run fn at virtual time at_us in interrupt context (hardware stimulus). */
+void sim_at(uint64_t at_us, std::function<void()> fn);
+
+/** Call an ISR: task switches it requests happen when it returns. */
+void sim_run_isr(void (*isr)(void *), void *arg);
+
+/** Start the scheduler with main_fn as the first task. Never returns. */
+[[noreturn]] void sim_kernel_run(TaskFunction_t main_fn, const char *name, UBaseType_t priority);
+
+/** Flush output and terminate every simulated task. */
+[[noreturn]] void sim_exit(int code);
+
+/** Label mutexes in creation order for the report. */
+void sim_kernel_name_mutexes(const std::vector<std::string> &names);
+
+void sim_kernel_report();
+
+// === HARDWARE (sim_hw.cpp) ===
+struct sim_motor_t {
+    int32_t position;             // shaft position in steps: STEP rising edges with EN low, minus slips
+    int32_t commanded;            // STEP rising edges with EN low, by DIR, whether the shaft followed or not
+    uint32_t steps;
+    uint32_t slipped;             // STEP edges the shaft did not follow (sim_motor_skip_steps / jam)
+    uint32_t steps_while_disabled; // STEP edges with EN high: must stay 0
+    uint64_t last_edge_us;
+    uint64_t edge_min_us;
+    uint64_t edge_max_us;
+};
+
+void sim_gpio_drive(gpio_num_t pin, int level);
+int sim_gpio_level(gpio_num_t pin);
+const sim_motor_t &sim_motor();
+
+// Dual-motor lockstep (CONFIG_BS_DUAL_MOTOR): motor B is an ideal shaft on its own
+// STEP/DIR pins, counted in the blind's direction (its DIR inversion undone).
+struct sim_lockstep_t {
+    uint32_t aligned_edges; // motor B edges that landed with one of motor A's
+    uint32_t solo_edges;    // motor B edges on its own (trim)
+    uint64_t max_skew_us;   // largest motor A -> motor B edge delay among the aligned ones
+};
+const sim_motor_t &sim_motor2();
+const sim_lockstep_t &sim_lockstep();
+
+/** The shaft ignores the next `count` STEP edges, as a motor skipping steps under load. */
+void sim_motor_skip_steps(uint32_t count);
+
+/** While jammed the shaft follows no STEP edges at all. */
+void sim_motor_jam(bool jammed);
+
+/**
+ * Load the shaft: it drops steps above max_rate_hz or accelerating faster than
+ * max_accel_hz_per_step, except up to pull_in_hz. 0 = no limit.
+ */
+void sim_motor_set_limits(uint32_t max_rate_hz, uint32_t max_accel_hz_per_step, uint32_t pull_in_hz);
+
+/**
+ * Hard stops at shaft positions top and bottom: STEP edges past them are lost. The home
+ * switch (CONFIG_BS_HOME_SWITCH) closes within switch_travel steps of the top; -1 = none.
+ */
+void sim_motor_set_end_stops(int32_t top, int32_t bottom, int32_t switch_travel);
+
+/** Make the current shaft position step 0 (calibration moved home); the encoder keeps counting. */
+void sim_motor_set_origin();
+
+/** Value the driver stored in NVS, -1 when absent. */
+int32_t sim_nvs_get_u16(const char *name, const char *key);
+void sim_hw_set_battery_mv(uint32_t mv);
+
+/** Fit the motor current shunt (CONFIG_BS_CURRENT_SENSE); unfitted, the channel reads about 0 mA. */
+void sim_current_sense_fit(bool fitted);
+
+/** Make every read of the current channel fail, as a dead amplifier or a bad channel would. */
+void sim_current_sense_fail(bool failing);
+
+/** Extra motor current on top of the running current, for synthetic load profiles. */
+void sim_motor_set_load_ma(uint32_t extra_ma);
+
+/** Motor supply current now: idle, running plus inrush and extra load, or stalled against a jam or end stop. */
+uint32_t sim_motor_current_ma();
+
+/** Raw bytes of the "postmortem" partition. */
+const std::vector<uint8_t> &sim_partition_image();
+
+/** What esp_reset_reason() returns from now on, for re-running boot code as after that reset. */
+void sim_set_reset_reason(esp_reset_reason_t reason);
+uint32_t sim_led_rgb();
+uint32_t sim_led_writes();
+void sim_set_quiet(bool quiet);
+
+/** Error lines logged so far, quiet or not. */
+uint32_t sim_log_errors();
+
+// DC motor with a hall sensor (sim_dc.cpp), for the DC motor backend. Not wired to
+// the driver's pins: a stage runs the backend over it directly.
+struct sim_dc_config_t {
+    double full_speed_edge_us;   // hall edge period at full duty
+    uint16_t dead_band_permille; // duty the motor needs before it turns
+    double drive_tau_us;         // speed lag behind the duty
+    double brake_tau_us;         // driven at duty 0
+    double coast_tau_us;         // bridge asleep
+};
+
+struct sim_dc_motor_t {
+    int32_t position;         // hall edges, signed by the direction the shaft turned
+    uint32_t edges;           // hall edges, either direction
+    uint32_t drive_writes;    // phase/duty changes
+    double speed_edges_per_s; // signed
+};
+
+/** Fresh motor at rest, position 0, bridge asleep. */
+void sim_dc_reset(const sim_dc_config_t &config);
+void sim_dc_set_power(bool powered);
+void sim_dc_drive(int8_t dir, uint16_t duty_permille);
+
+/** A jammed shaft stops dead and turns no further. */
+void sim_dc_jam(bool jammed);
+uint32_t sim_dc_hall_edges();
+const sim_dc_motor_t &sim_dc_motor();
+
+// === MATTER (sim_matter.cpp) ===
+struct sim_matter_stats_t {
+    uint32_t attribute_updates;
+    uint64_t reports_delivered; // attribute updates x subscribers
+    uint32_t position_updates;
+    uint32_t op_state_updates;
+    uint16_t last_position;
+    uint8_t last_op_state;
+    uint16_t safety_status;
+    uint64_t last_update_us;
+    uint64_t work_items;
+    uint64_t max_work_latency_us; // ScheduleWork -> run on the CHIP task
+};
+
+/** Start the CHIP task. attr_cost_us models one attribute write or one command dispatch. */
+void sim_matter_start(UBaseType_t priority, uint32_t attr_cost_us);
+
+/** Every attribute update is also reported to `count` subscribers at report_cost_us each. */
+void sim_matter_set_subscribers(uint32_t count, uint32_t report_cost_us);
+
+/** Run fn on the CHIP task, like a Matter command callback. Safe from sim_at events. */
+void sim_matter_post(std::function<void()> fn);
+
+const sim_matter_stats_t &sim_matter_stats();
+
+// === COMMAND QUEUE STRESS (sim_queue.cpp) ===
+/**
+ * Drain the driver's command queue type while `producers` host threads each submit
+ * `commands_per_producer` interleaved GoTo/Stop commands. Runs on real threads, not on
+ * the virtual clock. Prints a summary and returns the number of failed checks.
+ */
+int sim_queue_stress(uint32_t producers, uint32_t commands_per_producer);
+
+// === LOAD TEST (sim_load.cpp) ===
+struct sim_load_config_t {
+    uint32_t commands;    // 0 = run the scripted scenario instead
+    uint32_t rate_hz;     // mean offered rate, exponential inter-arrival
+    uint32_t subscribers;
+    uint32_t report_cost_us;
+};
+
+/**
+ * Offer config.commands WindowCovering commands (GoTo mix with Open/Close/Stop) to the
+ * CHIP task through the app layer's command/attribute path. Returns once all are answered.
+ */
+void sim_load_run(const sim_load_config_t &config, uint16_t endpoint_id);
+
+void sim_load_report();
+
+// === BATTERY TRACES (sim_voltage.cpp) ===
+/** Read a battery voltage trace: `<ms> <mV>` lines, `#` comments. Replaces the previous one. */
+bool sim_voltage_load(const char *path);
+
+/** Play the loaded trace into the battery model from now on. Returns the virtual time of its last reading. */
+uint64_t sim_voltage_schedule();
+
+/** Offset of the drop under `mv` that the trace never recovers from, -1 if it ends at or above it. */
+int64_t sim_voltage_crossing_us(uint32_t mv);
+
+uint32_t sim_voltage_min_mv();
+
+// === TRACE REPLAY (sim_replay.cpp) ===
+/** Read BSTRACE lines from a trace dump or a captured console log. */
+bool sim_replay_load(const char *path);
+
+/** Position the first recorded motion/report event implies, -1 when the trace has none. */
+int32_t sim_replay_start_position();
+
+/** Schedule every driver input from now on. Returns the virtual time of the last one. */
+uint64_t sim_replay_schedule(uint16_t endpoint_id);
+
+/**
+ * The replay reproduced the recording: the same number of hard stops and position
+ * reports, and the same final position. The virtual clock is exact, so no tolerance.
+ */
+bool sim_replay_matches();
+
+void sim_replay_report();
@@ -0,0 +1,128 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// DC tubular motor with a hall sensor, behind a phase/enable H-bridge, for the DC
+// motor backend (bs_motor_backend.h). The speed follows the PWM duty past a dead band
+// with a first-order lag; braking stops the shaft much faster than letting it coast
+// with the bridge asleep. Hall edges come from the integrated travel, so a shaft that
+// coasts on after the drive stops keeps producing them.
+//
+// The model only advances when it is asked: every call integrates up to sim_now_us()
+// in fixed slices, which is exact enough at the edge rates involved.
+
+#include <algorithm>
+#include <cmath>
+
+#include "sim.h"
+
+namespace {
+constexpr double k_slice_us = 20.0;
+
+sim_dc_config_t s_config = {};
+bool s_powered = false;
+bool s_jammed = false;
+int8_t s_dir = 0;
+uint16_t s_duty = 0;
+double s_speed = 0.0;    // edges per us, signed
+double s_travel = 0.0;   // fraction of an edge since the last one, signed
+uint64_t s_updated_us = 0;
+sim_dc_motor_t s_motor = {};
+
+double target_speed()
+{
+    if (!s_powered || s_jammed || s_duty <= s_config.dead_band_permille) {
+        return 0.0;
+    }
+    double share = static_cast<double>(s_duty - s_config.dead_band_permille) / (1000 - s_config.dead_band_permille);
+    return s_dir * share / s_config.full_speed_edge_us;
+}
+
+double lag_us()
+{
+    if (!s_powered) {
+        return s_config.coast_tau_us;
+    }
+    return s_duty == 0 ? s_config.brake_tau_us : s_config.drive_tau_us;
+}
+
+void advance()
+{
+    uint64_t now_us = sim_now_us();
+    double target = target_speed();
+    double tau = lag_us();
+    while (s_updated_us < now_us) {
+        double slice = std::min(k_slice_us, static_cast<double>(now_us - s_updated_us));
+        s_updated_us += static_cast<uint64_t>(slice);
+        if (s_jammed) {
+            s_speed = 0.0;
+            continue;
+        }
+        s_speed += (target - s_speed) * (1.0 - std::exp(-slice / tau));
+        if (target == 0.0 && std::fabs(s_speed) * s_config.full_speed_edge_us < 0.002) {
+            s_speed = 0.0; // friction holds it
+        }
+        s_travel += s_speed * slice;
+        while (s_travel >= 1.0) {
+            s_travel -= 1.0;
+            s_motor.position++;
+            s_motor.edges++;
+        }
+        while (s_travel <= -1.0) {
+            s_travel += 1.0;
+            s_motor.position--;
+            s_motor.edges++;
+        }
+    }
+}
+} // namespace
+
+void sim_dc_reset(const sim_dc_config_t &config)
+{
+    s_config = config;
+    s_powered = false;
+    s_jammed = false;
+    s_dir = 0;
+    s_duty = 0;
+    s_speed = 0.0;
+    s_travel = 0.0;
+    s_updated_us = sim_now_us();
+    s_motor = {};
+}
+
+void sim_dc_set_power(bool powered)
+{
+    advance();
+    s_powered = powered;
+}
+
+void sim_dc_drive(int8_t dir, uint16_t duty_permille)
+{
+    advance();
+    s_dir = dir;
+    s_duty = duty_permille;
+    s_motor.drive_writes++;
+}
+
+void sim_dc_jam(bool jammed)
+{
+    advance();
+    s_jammed = jammed;
+}
+
+uint32_t sim_dc_hall_edges()
+{
+    advance();
+    return s_motor.edges;
+}
+
+const sim_dc_motor_t &sim_dc_motor()
+{
+    advance();
+    s_motor.speed_edges_per_s = s_speed * 1e6;
+    return s_motor;
+}
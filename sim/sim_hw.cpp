@@ -0,0 +1,918 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Peripherals behind the firmware: GPIO with ISRs, an A4988 + stepper model on the
+// STEP/DIR/EN pins with end stops and a home switch, a second motor for lockstep, the battery divider and the motor
+// current shunt on the ADC, the WS2812 on RMT, NVS in memory and the timers, all on the virtual clock.
+
+#include <climits>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <driver/dedic_gpio.h>
+#include <driver/gpio.h>
+#include <driver/pulse_cnt.h>
+#include <driver/rmt.h>
+#include <esp_adc/adc_cali.h>
+#include <esp_adc/adc_oneshot.h>
+#include <esp_cpu.h>
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <esp_rom_sys.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <nvs.h>
+#include <nvs_flash.h>
+
+#include "bs_pins.h"
+#include "sim.h"
+
+// The dedicated-GPIO handle type the shim declares.
+struct sim_dedic_bundle_t {
+    static constexpr size_t k_max_pins = 8;
+    int gpios[k_max_pins];
+    size_t count;
+};
+
+namespace {
+constexpr uint32_t k_adc_conversion_us = 20;
+constexpr uint32_t k_ws2812_bit_ns = 1250;
+constexpr uint32_t k_rmt_source_clk_hz = 80000000;
+
+struct pin_t {
+    int level;
+    bool output;
+    gpio_int_type_t intr_type;
+    bool intr_enabled;
+    gpio_isr_t isr;
+    void *isr_arg;
+};
+
+pin_t s_pins[GPIO_NUM_MAX] = {};
+bool s_isr_service = false;
+sim_motor_t s_motor = {};
+uint32_t s_motor_skip = 0;
+bool s_motor_jammed = false;
+uint32_t s_motor_max_rate_hz = 0;  // 0 = the shaft keeps up with any step rate
+uint32_t s_motor_max_accel_hz = 0; // per step; 0 = unlimited
+uint32_t s_motor_pull_in_hz = 0;   // rate the shaft follows from any speed, even a standstill
+uint32_t s_shaft_rate_hz = 0;      // rate the rotor is turning at
+bool s_shaft_slowing = false;      // the last step was slower than the rotor
+constexpr uint64_t k_shaft_standstill_us = 20000;
+constexpr uint64_t k_lockstep_window_us = 10; // a motor B edge within one pulse of motor A's is aligned
+constexpr size_t k_max_bundles = 4;
+int32_t s_stop_top = INT32_MIN;    // hard stops at the ends of travel; none by default
+int32_t s_stop_bottom = INT32_MAX;
+int32_t s_switch_travel = -1;      // home switch closes within this of the top stop; -1 = no switch
+int32_t s_pcnt_zero = 0;
+bool s_pcnt_created = false;
+sim_motor_t s_motor2 = {};
+sim_lockstep_t s_lockstep = {};
+uint64_t s_motor_rise_us = 0;  // motor A's last STEP rising edge, EN high or low
+bool s_motor_rise_paired = true;
+sim_dedic_bundle_t s_bundles[k_max_bundles] = {};
+size_t s_bundle_count = 0;
+uint32_t s_battery_mv = 11800;
+uint32_t s_adc_noise = 12345;
+// Motor supply current behind the shunt amplifier (CONFIG_BS_CURRENT_SENSE). Unfitted,
+// the channel reads the amplifier's offset: noise around 0 mA.
+constexpr uint32_t k_motor_idle_ma = 10;            // EN high: driver logic only
+constexpr uint32_t k_motor_run_ma = 420;            // EN low, shaft following
+constexpr uint32_t k_motor_stall_ma = 1150;         // STEP edges lost against a jam or an end stop
+constexpr uint64_t k_motor_inrush_us = 40000;       // EN low: up to twice the running current, decaying over this
+constexpr uint64_t k_motor_stall_hold_us = 5000;    // a lost edge keeps the stall current up this long
+bool s_current_fitted = false;
+bool s_current_failing = false; // every read of the current channel fails
+uint32_t s_motor_load_ma = 0;   // extra running current, for synthetic load profiles
+uint64_t s_motor_en_low_us = 0; // EN went low, 0 while high
+uint64_t s_motor_stall_us = 0;  // last edge lost against a jam or an end stop
+uint32_t s_current_noise = 54321;
+uint8_t s_rmt_clk_div[RMT_CHANNEL_MAX] = {};
+bool s_rmt_installed[RMT_CHANNEL_MAX] = {};
+uint32_t s_led_rgb = 0;
+uint32_t s_led_writes = 0;
+bool s_quiet = false;
+uint32_t s_log_errors = 0;
+
+std::map<std::string, uint16_t> s_nvs;
+std::map<std::string, std::vector<uint8_t>> s_nvs_blobs;
+std::map<nvs_handle_t, std::string> s_nvs_handles;
+nvs_handle_t s_nvs_next_handle = 1;
+
+constexpr uint32_t k_flash_sector_bytes = 4096;
+esp_partition_t s_postmortem_partition = {ESP_PARTITION_TYPE_DATA, 0x40, 0x3E6000, 0x4000, "postmortem"};
+std::vector<uint8_t> s_partition_image(0x4000, 0xFF);
+esp_reset_reason_t s_reset_reason = ESP_RST_POWERON;
+
+bool valid_pin(gpio_num_t pin)
+{
+    return pin >= 0 && pin < GPIO_NUM_MAX;
+}
+
+bool intr_matches(gpio_int_type_t type, int old_level, int new_level)
+{
+    switch (type) {
+    case GPIO_INTR_POSEDGE:
+        return old_level == 0 && new_level == 1;
+    case GPIO_INTR_NEGEDGE:
+        return old_level == 1 && new_level == 0;
+    case GPIO_INTR_ANYEDGE:
+        return old_level != new_level;
+    case GPIO_INTR_LOW_LEVEL:
+        return new_level == 0;
+    case GPIO_INTR_HIGH_LEVEL:
+        return new_level == 1;
+    default:
+        return false;
+    }
+}
+
+// Crude torque model: the shaft drops a step that asks for more than the pull-out rate,
+// or for a faster rate than it can accelerate to since the last step (the pull-in rate
+// is always reachable). Slowing down is free. Inertia carries the rotor over a single
+// slow step (the stepper's periodic yield); a sustained slow stretch brings it down as
+// fast as it could speed up, and has to be accelerated out of again.
+bool shaft_loses_step(uint64_t interval_us)
+{
+    if (interval_us >= k_shaft_standstill_us || interval_us == 0) {
+        s_shaft_rate_hz = 0;
+        s_shaft_slowing = false;
+        return false;
+    }
+    uint32_t rate_hz = static_cast<uint32_t>(1000000 / interval_us);
+    if (s_motor_max_rate_hz && rate_hz > s_motor_max_rate_hz) {
+        return true;
+    }
+    if (s_motor_max_accel_hz && s_shaft_rate_hz && rate_hz > s_motor_pull_in_hz &&
+        rate_hz > s_shaft_rate_hz + s_motor_max_accel_hz) {
+        return true;
+    }
+    if (rate_hz >= s_shaft_rate_hz) {
+        s_shaft_rate_hz = rate_hz;
+        s_shaft_slowing = false;
+    } else if (!s_shaft_slowing) {
+        s_shaft_slowing = true;
+    } else if (s_motor_max_accel_hz) {
+        uint32_t slowest = s_shaft_rate_hz > s_motor_max_accel_hz ? s_shaft_rate_hz - s_motor_max_accel_hz : 0;
+        s_shaft_rate_hz = rate_hz > slowest ? rate_hz : slowest;
+    }
+    return false;
+}
+
+void set_pin_level(gpio_num_t pin, int level);
+
+void update_home_switch()
+{
+#if CONFIG_BS_HOME_SWITCH
+    if (s_switch_travel >= 0) {
+        int level = s_motor.position - s_stop_top <= s_switch_travel ? 0 : 1;
+        if (s_pins[BS_PIN_HOME_SWITCH].level != level) {
+            set_pin_level(BS_PIN_HOME_SWITCH, level);
+        }
+    }
+#endif
+}
+
+void motor_edge(int old_level, int new_level)
+{
+    if (old_level != 0 || new_level != 1) {
+        return;
+    }
+    s_motor_rise_us = sim_now_us();
+    s_motor_rise_paired = false;
+    if (s_pins[BS_PIN_EN].level != 0) {
+        s_motor.steps_while_disabled++;
+        return;
+    }
+    s_motor.commanded += s_pins[BS_PIN_DIR].level ? 1 : -1;
+    uint64_t now = sim_now_us();
+    bool pulled_out = false;
+    if (s_motor.steps > 0) {
+        uint64_t interval = now - s_motor.last_edge_us;
+        pulled_out = shaft_loses_step(interval);
+        if (s_motor.edge_min_us == 0 || interval < s_motor.edge_min_us) {
+            s_motor.edge_min_us = interval;
+        }
+        if (interval > s_motor.edge_max_us) {
+            s_motor.edge_max_us = interval;
+        }
+    }
+    s_motor.last_edge_us = now;
+    s_motor.steps++;
+    if (s_motor_jammed) {
+        s_motor_stall_us = now;
+    }
+    if (pulled_out || s_motor_jammed || s_motor_skip > 0) {
+        s_motor_skip -= s_motor_skip > 0 ? 1 : 0;
+        s_motor.slipped++;
+        return;
+    }
+    int32_t next = s_motor.position + (s_pins[BS_PIN_DIR].level ? 1 : -1);
+    if (next < s_stop_top || next > s_stop_bottom) {
+        s_motor.slipped++; // against the end stop
+        s_motor_stall_us = now;
+        return;
+    }
+    s_motor.position = next;
+    update_home_switch();
+}
+
+#if CONFIG_BS_DUAL_MOTOR
+// Motor B follows every step; what it is checked for is landing on motor A's edges.
+void motor2_edge(int old_level, int new_level)
+{
+    if (old_level != 0 || new_level != 1) {
+        return;
+    }
+    if (s_pins[BS_PIN_EN].level != 0) {
+        s_motor2.steps_while_disabled++;
+        return;
+    }
+    uint64_t now = sim_now_us();
+    if (s_motor2.steps > 0) {
+        uint64_t interval = now - s_motor2.last_edge_us;
+        if (s_motor2.edge_min_us == 0 || interval < s_motor2.edge_min_us) {
+            s_motor2.edge_min_us = interval;
+        }
+        if (interval > s_motor2.edge_max_us) {
+            s_motor2.edge_max_us = interval;
+        }
+    }
+    s_motor2.last_edge_us = now;
+    s_motor2.steps++;
+    bool down = (s_pins[BS_PIN_DIR2].level != 0) != (CONFIG_BS_MOTOR2_DIR_INVERT != 0);
+    s_motor2.commanded += down ? 1 : -1;
+    s_motor2.position = s_motor2.commanded;
+    if (!s_motor_rise_paired && now - s_motor_rise_us <= k_lockstep_window_us) {
+        s_motor_rise_paired = true;
+        s_lockstep.aligned_edges++;
+        if (now - s_motor_rise_us > s_lockstep.max_skew_us) {
+            s_lockstep.max_skew_us = now - s_motor_rise_us;
+        }
+    } else {
+        s_lockstep.solo_edges++;
+    }
+}
+#endif
+
+void set_pin_level(gpio_num_t pin, int level)
+{
+    pin_t &state = s_pins[pin];
+    int old_level = state.level;
+    state.level = level ? 1 : 0;
+    if (pin == BS_PIN_EN && old_level != state.level) {
+        s_motor_en_low_us = state.level ? 0 : sim_now_us();
+    }
+    if (pin == BS_PIN_STEP) {
+        motor_edge(old_level, state.level);
+    }
+#if CONFIG_BS_DUAL_MOTOR
+    if (pin == BS_PIN_STEP2) {
+        motor2_edge(old_level, state.level);
+    }
+#endif
+    if (s_isr_service && state.isr && state.intr_enabled && intr_matches(state.intr_type, old_level, state.level)) {
+        sim_run_isr(state.isr, state.isr_arg);
+    }
+}
+} // namespace
+
+// === SIMULATOR API ===
+void sim_gpio_drive(gpio_num_t pin, int level)
+{
+    if (valid_pin(pin)) {
+        set_pin_level(pin, level);
+    }
+}
+
+int sim_gpio_level(gpio_num_t pin)
+{
+    return valid_pin(pin) ? s_pins[pin].level : 0;
+}
+
+const sim_motor_t &sim_motor()
+{
+    return s_motor;
+}
+
+const sim_motor_t &sim_motor2()
+{
+    return s_motor2;
+}
+
+const sim_lockstep_t &sim_lockstep()
+{
+    return s_lockstep;
+}
+
+void sim_motor_skip_steps(uint32_t count)
+{
+    s_motor_skip += count;
+}
+
+void sim_motor_jam(bool jammed)
+{
+    s_motor_jammed = jammed;
+}
+
+void sim_motor_set_limits(uint32_t max_rate_hz, uint32_t max_accel_hz_per_step, uint32_t pull_in_hz)
+{
+    s_motor_pull_in_hz = pull_in_hz;
+    s_motor_max_rate_hz = max_rate_hz;
+    s_motor_max_accel_hz = max_accel_hz_per_step;
+}
+
+void sim_motor_set_end_stops(int32_t top, int32_t bottom, int32_t switch_travel)
+{
+    s_stop_top = top;
+    s_stop_bottom = bottom;
+    s_switch_travel = switch_travel;
+    update_home_switch();
+}
+
+void sim_motor_set_origin()
+{
+    s_pcnt_zero -= s_motor.position * CONFIG_BS_ENCODER_COUNTS_PER_REV / CONFIG_BS_ENCODER_STEPS_PER_REV;
+    if (s_stop_top != INT32_MIN) {
+        s_stop_top -= s_motor.position;
+    }
+    if (s_stop_bottom != INT32_MAX) {
+        s_stop_bottom -= s_motor.position;
+    }
+    s_motor.position = 0;
+}
+
+int32_t sim_nvs_get_u16(const char *name, const char *key)
+{
+    auto it = s_nvs.find(std::string(name) + "/" + key);
+    return it == s_nvs.end() ? -1 : it->second;
+}
+
+const std::vector<uint8_t> &sim_partition_image()
+{
+    return s_partition_image;
+}
+
+void sim_set_reset_reason(esp_reset_reason_t reason)
+{
+    s_reset_reason = reason;
+}
+
+void sim_hw_set_battery_mv(uint32_t mv)
+{
+    s_battery_mv = mv;
+}
+
+void sim_current_sense_fit(bool fitted)
+{
+    s_current_fitted = fitted;
+}
+
+void sim_current_sense_fail(bool failing)
+{
+    s_current_failing = failing;
+}
+
+void sim_motor_set_load_ma(uint32_t extra_ma)
+{
+    s_motor_load_ma = extra_ma;
+}
+
+uint32_t sim_motor_current_ma()
+{
+    if (s_motor_en_low_us == 0) {
+        return k_motor_idle_ma;
+    }
+    uint64_t now = sim_now_us();
+    if (s_motor_stall_us != 0 && now - s_motor_stall_us < k_motor_stall_hold_us) {
+        return k_motor_stall_ma + s_motor_load_ma;
+    }
+    uint32_t ma = k_motor_run_ma + s_motor_load_ma;
+    uint64_t since_us = now - s_motor_en_low_us;
+    if (since_us < k_motor_inrush_us) {
+        ma += static_cast<uint32_t>(k_motor_run_ma * (k_motor_inrush_us - since_us) / k_motor_inrush_us);
+    }
+    return ma;
+}
+
+uint32_t sim_led_rgb()
+{
+    return s_led_rgb;
+}
+
+uint32_t sim_led_writes()
+{
+    return s_led_writes;
+}
+
+void sim_set_quiet(bool quiet)
+{
+    s_quiet = quiet;
+}
+
+uint32_t sim_log_errors()
+{
+    return s_log_errors;
+}
+
+void sim_log(char level, const char *tag, const char *fmt, ...)
+{
+    if (level == 'E') {
+        s_log_errors++;
+    }
+    if (s_quiet && level != 'E' && level != 'W') {
+        return;
+    }
+    uint64_t now = sim_now_us();
+    std::printf("%c (%llu.%06llu) %s: ", level, static_cast<unsigned long long>(now / 1000000),
+                static_cast<unsigned long long>(now % 1000000), tag);
+    va_list args;
+    va_start(args, fmt);
+    std::vprintf(fmt, args);
+    va_end(args);
+    std::printf("\n");
+}
+
+// === GPIO ===
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    if (!config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int pin = 0; pin < GPIO_NUM_MAX; ++pin) {
+        if (!(config->pin_bit_mask & (1ULL << pin))) {
+            continue;
+        }
+        pin_t &state = s_pins[pin];
+        state.output = (config->mode & GPIO_MODE_OUTPUT) != 0;
+        state.intr_type = config->intr_type;
+        state.intr_enabled = config->intr_type != GPIO_INTR_DISABLE;
+        if (!state.output && config->pull_up_en == GPIO_PULLUP_ENABLE) {
+            state.level = 1;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (!valid_pin(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    set_pin_level(gpio_num, static_cast<int>(level));
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    return sim_gpio_level(gpio_num);
+}
+
+// === DEDICATED GPIO ===
+esp_err_t dedic_gpio_new_bundle(const dedic_gpio_bundle_config_t *config, dedic_gpio_bundle_handle_t *ret_bundle)
+{
+    if (!config || !ret_bundle || !config->gpio_array || config->array_size == 0 ||
+        config->array_size > sim_dedic_bundle_t::k_max_pins || s_bundle_count >= k_max_bundles) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sim_dedic_bundle_t &bundle = s_bundles[s_bundle_count++];
+    bundle.count = config->array_size;
+    for (size_t i = 0; i < bundle.count; ++i) {
+        if (!valid_pin(static_cast<gpio_num_t>(config->gpio_array[i]))) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        bundle.gpios[i] = config->gpio_array[i];
+        s_pins[bundle.gpios[i]].output = config->flags.out_en != 0;
+    }
+    *ret_bundle = &bundle;
+    return ESP_OK;
+}
+
+void dedic_gpio_bundle_write(dedic_gpio_bundle_handle_t bundle, uint32_t mask, uint32_t value)
+{
+    for (size_t i = 0; i < bundle->count; ++i) {
+        if (mask & (1U << i)) {
+            set_pin_level(static_cast<gpio_num_t>(bundle->gpios[i]), (value >> i) & 1U);
+        }
+    }
+}
+
+uint32_t dedic_gpio_bundle_read_out(dedic_gpio_bundle_handle_t bundle)
+{
+    uint32_t out = 0;
+    for (size_t i = 0; i < bundle->count; ++i) {
+        out |= static_cast<uint32_t>(s_pins[bundle->gpios[i]].level) << i;
+    }
+    return out;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    (void)intr_alloc_flags;
+    if (s_isr_service) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_isr_service = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+    if (!valid_pin(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_pins[gpio_num].intr_type = intr_type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args)
+{
+    if (!valid_pin(gpio_num) || !s_isr_service) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_pins[gpio_num].isr = isr_handler;
+    s_pins[gpio_num].isr_arg = args;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num)
+{
+    if (!valid_pin(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pin_t &state = s_pins[gpio_num];
+    state.intr_enabled = true;
+    bool level_pending = (state.intr_type == GPIO_INTR_LOW_LEVEL && state.level == 0) ||
+                         (state.intr_type == GPIO_INTR_HIGH_LEVEL && state.level == 1);
+    if (level_pending && s_isr_service && state.isr) {
+        sim_run_isr(state.isr, state.isr_arg);
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num)
+{
+    if (!valid_pin(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_pins[gpio_num].intr_enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+    return gpio_set_intr_type(gpio_num, intr_type);
+}
+
+// === RMT (WS2812) ===
+esp_err_t rmt_config(const rmt_config_t *config)
+{
+    if (!config || config->channel >= RMT_CHANNEL_MAX || config->clk_div == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_rmt_clk_div[config->channel] = config->clk_div;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags)
+{
+    (void)rx_buf_size;
+    (void)intr_alloc_flags;
+    if (channel >= RMT_CHANNEL_MAX || s_rmt_installed[channel]) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_rmt_installed[channel] = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel)
+{
+    if (channel >= RMT_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_rmt_installed[channel] = false;
+    return ESP_OK;
+}
+
+esp_err_t rmt_get_counter_clock(rmt_channel_t channel, uint32_t *clock_hz)
+{
+    if (channel >= RMT_CHANNEL_MAX || !clock_hz || s_rmt_clk_div[channel] == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *clock_hz = k_rmt_source_clk_hz / s_rmt_clk_div[channel];
+    return ESP_OK;
+}
+
+esp_err_t rmt_write_items(rmt_channel_t channel, const rmt_item32_t *items, int item_num, bool wait_tx_done)
+{
+    if (channel >= RMT_CHANNEL_MAX || !s_rmt_installed[channel] || !items) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // A WS2812 "1" holds the line high longer than low; frames are GRB, MSB first.
+    uint32_t grb = 0;
+    for (int i = 0; i < item_num && i < 24; ++i) {
+        grb = (grb << 1) | (items[i].duration0 > items[i].duration1 ? 1U : 0U);
+    }
+    s_led_rgb = ((grb >> 8) & 0xFF) << 16 | ((grb >> 16) & 0xFF) << 8 | (grb & 0xFF);
+    s_led_writes++;
+    if (wait_tx_done) {
+        sim_busy_wait_us((static_cast<uint32_t>(item_num) * k_ws2812_bit_ns + 999) / 1000);
+    }
+    return ESP_OK;
+}
+
+// === PCNT (quadrature encoder) ===
+namespace {
+int32_t encoder_raw_count()
+{
+    // Floor, like an encoder sitting between two edges.
+    int64_t scaled = static_cast<int64_t>(s_motor.position) * CONFIG_BS_ENCODER_COUNTS_PER_REV;
+    int64_t count = scaled / CONFIG_BS_ENCODER_STEPS_PER_REV;
+    if (scaled % CONFIG_BS_ENCODER_STEPS_PER_REV != 0 && scaled < 0) {
+        count--;
+    }
+    return static_cast<int32_t>(count);
+}
+} // namespace
+
+esp_err_t pcnt_new_unit(const pcnt_unit_config_t *config, pcnt_unit_handle_t *ret_unit)
+{
+    if (!config || !ret_unit || s_pcnt_created) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_pcnt_created = true;
+    *ret_unit = reinterpret_cast<pcnt_unit_handle_t>(&s_pcnt_zero);
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_set_glitch_filter(pcnt_unit_handle_t unit, const pcnt_glitch_filter_config_t *config)
+{
+    return ESP_OK;
+}
+
+esp_err_t pcnt_new_channel(pcnt_unit_handle_t unit, const pcnt_chan_config_t *config, pcnt_channel_handle_t *ret_chan)
+{
+    *ret_chan = reinterpret_cast<pcnt_channel_handle_t>(unit);
+    return ESP_OK;
+}
+
+esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t chan, pcnt_channel_edge_action_t pos_act,
+                                       pcnt_channel_edge_action_t neg_act)
+{
+    return ESP_OK;
+}
+
+esp_err_t pcnt_channel_set_level_action(pcnt_channel_handle_t chan, pcnt_channel_level_action_t high_act,
+                                        pcnt_channel_level_action_t low_act)
+{
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_add_watch_point(pcnt_unit_handle_t unit, int watch_point)
+{
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_enable(pcnt_unit_handle_t unit)
+{
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t unit)
+{
+    s_pcnt_zero = encoder_raw_count();
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_start(pcnt_unit_handle_t unit)
+{
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t unit, int *value)
+{
+    if (!value) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *value = encoder_raw_count() - s_pcnt_zero;
+    return ESP_OK;
+}
+
+// === ADC (battery divider, motor current shunt) ===
+esp_err_t adc_oneshot_new_unit(const adc_oneshot_unit_init_cfg_t *init_config, adc_oneshot_unit_handle_t *ret_unit)
+{
+    if (!init_config || !ret_unit) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    static int s_unit_storage;
+    *ret_unit = reinterpret_cast<adc_oneshot_unit_handle_t>(&s_unit_storage);
+    return ESP_OK;
+}
+
+esp_err_t adc_oneshot_config_channel(adc_oneshot_unit_handle_t handle, adc_channel_t channel,
+                                     const adc_oneshot_chan_cfg_t *config)
+{
+    (void)channel;
+    return (handle && config) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t adc_oneshot_read(adc_oneshot_unit_handle_t handle, adc_channel_t chan, int *out_raw)
+{
+    if (!handle || !out_raw) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sim_busy_wait_us(k_adc_conversion_us);
+#if CONFIG_BS_CURRENT_SENSE
+    if (chan == CONFIG_BS_CURRENT_SENSE_ADC_CHANNEL) {
+        if (s_current_failing) {
+            return ESP_FAIL;
+        }
+        // Shunt amplifier into the same 3.3 V full scale, its own +/-8 LSB of noise.
+        s_current_noise = s_current_noise * 1103515245U + 12345U;
+        int noise = static_cast<int>((s_current_noise >> 16) % 17) - 8;
+        uint32_t ma = s_current_fitted ? sim_motor_current_ma() : 0;
+        int pin_mv = static_cast<int>(ma * CONFIG_BS_CURRENT_SENSE_MV_PER_A / 1000);
+        int raw = pin_mv * 4095 / 3300 + noise;
+        *out_raw = raw < 0 ? 0 : (raw > 4095 ? 4095 : raw);
+        return ESP_OK;
+    }
+#endif
+    // 110k/10k divider into a 3.3 V full-scale, 12-bit conversion, +/-8 LSB of noise.
+    s_adc_noise = s_adc_noise * 1103515245U + 12345U;
+    int noise = static_cast<int>((s_adc_noise >> 16) % 17) - 8;
+    int pin_mv = static_cast<int>(s_battery_mv * 10 / 110);
+    int raw = pin_mv * 4095 / 3300 + noise;
+    *out_raw = raw < 0 ? 0 : (raw > 4095 ? 4095 : raw);
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int *voltage)
+{
+    (void)handle;
+    *voltage = raw * 3300 / 4095;
+    return ESP_OK;
+}
+
+// === NVS ===
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    std::string prefix = std::string(name) + "/";
+    if (open_mode == NVS_READONLY) {
+        auto it = s_nvs.lower_bound(prefix);
+        auto blob = s_nvs_blobs.lower_bound(prefix);
+        if ((it == s_nvs.end() || it->first.compare(0, prefix.size(), prefix) != 0) &&
+            (blob == s_nvs_blobs.end() || blob->first.compare(0, prefix.size(), prefix) != 0)) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+    }
+    *out_handle = s_nvs_next_handle++;
+    s_nvs_handles[*out_handle] = prefix;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_u16(nvs_handle_t handle, const char *key, uint16_t *out_value)
+{
+    auto it = s_nvs.find(s_nvs_handles[handle] + key);
+    if (it == s_nvs.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *out_value = it->second;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u16(nvs_handle_t handle, const char *key, uint16_t value)
+{
+    s_nvs[s_nvs_handles[handle] + key] = value;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    auto it = s_nvs_blobs.find(s_nvs_handles[handle] + key);
+    if (it == s_nvs_blobs.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value && *length < it->second.size()) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    if (out_value) {
+        memcpy(out_value, it->second.data(), it->second.size());
+    }
+    *length = it->second.size();
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(value);
+    s_nvs_blobs[s_nvs_handles[handle] + key].assign(bytes, bytes + length);
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    std::string name = s_nvs_handles[handle] + key;
+    return (s_nvs.erase(name) + s_nvs_blobs.erase(name)) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    (void)handle;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    s_nvs_handles.erase(handle);
+}
+
+// === FLASH PARTITION ===
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    (void)subtype;
+    if (type != s_postmortem_partition.type || !label || strcmp(label, s_postmortem_partition.label) != 0) {
+        return nullptr;
+    }
+    return &s_postmortem_partition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    if (partition != &s_postmortem_partition || src_offset + size > s_partition_image.size()) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(dst, s_partition_image.data() + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    if (partition != &s_postmortem_partition || dst_offset + size > s_partition_image.size()) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(src);
+    for (size_t i = 0; i < size; ++i) {
+        s_partition_image[dst_offset + i] &= bytes[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    if (partition != &s_postmortem_partition || offset % k_flash_sector_bytes != 0 ||
+        size % k_flash_sector_bytes != 0 || offset + size > s_partition_image.size()) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(s_partition_image.data() + offset, 0xFF, size);
+    return ESP_OK;
+}
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return s_reset_reason;
+}
+
+// === TIMERS ===
+int64_t esp_timer_get_time(void)
+{
+    return static_cast<int64_t>(sim_now_us());
+}
+
+uint32_t esp_cpu_get_cycle_count(void)
+{
+    return static_cast<uint32_t>(sim_now_us() * k_sim_cpu_mhz);
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+    sim_busy_wait_us(us);
+}
+
+uint32_t esp_rom_get_cpu_ticks_per_us(void)
+{
+    return k_sim_cpu_mhz;
+}
+
+int esp_rom_printf(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int written = std::vprintf(fmt, args);
+    va_end(args);
+    return written;
+}
@@ -0,0 +1,672 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Discrete-event FreeRTOS: every task is a host thread, but only the one holding the
+// baton (s_current) runs. Time is virtual. It only moves when a task busy-waits
+// (esp_rom_delay_us, ADC conversions, RMT transfers) or when every task is blocked,
+// in which case the clock jumps straight to the next wake-up. Code between those
+// points costs zero time, so runs are deterministic and much faster than real time.
+//
+// Tasks pinned to core 1 (CONFIG_BS_MOTION_CORE_PINNED) get a second core; every
+// other task shares core 0, as the S3 defaults pin the CHIP and network tasks there.
+// A busy-wait holds its core while the clock moves, so the other core's tasks run
+// in the meantime. Without pinned tasks core 1 stays empty and this is one core.
+//
+// Scheduling follows the FreeRTOS rules the firmware depends on: highest ready
+// priority runs, a higher-priority wake preempts immediately (deferred to the end of
+// an ISR or critical section), equal priorities time-slice on the 1 kHz tick, and
+// mutexes use priority inheritance.
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "sim.h"
+
+namespace {
+constexpr uint64_t k_forever = UINT64_MAX;
+constexpr int k_cores = 2;
+
+enum class TaskState : uint8_t {
+    READY,
+    BLOCKED,
+    DONE
+};
+} // namespace
+
+struct sim_semaphore;
+
+struct sim_task {
+    std::string name;
+    TaskFunction_t fn = nullptr;
+    void *arg = nullptr;
+    UBaseType_t base_priority = 0;
+    UBaseType_t priority = 0;
+    int core = 0;
+    TaskState state = TaskState::READY;
+    uint64_t ready_order = 0;
+    uint64_t wake_at_us = k_forever;
+    uint64_t blocked_since_us = 0;
+    uint64_t busy_until_us = 0; // busy-waiting until then: holds its core, needs no baton
+    int critical_depth = 0;
+    uint32_t notify = 0;
+    bool waiting_notify = false;
+    bool timed_out = false;
+    sim_semaphore *waiting_sem = nullptr;
+    uint64_t cpu_us = 0;
+    uint32_t switches_in = 0;
+    uint32_t preempted = 0;
+    std::condition_variable cv;
+};
+
+struct sim_semaphore {
+    std::string name;
+    sim_task *owner = nullptr;
+    std::vector<sim_task *> waiters;
+    uint64_t taken_at_us = 0;
+    uint64_t takes = 0;
+    uint64_t contended = 0;
+    uint64_t timeouts = 0;
+    uint64_t wait_total_us = 0;
+    uint64_t wait_max_us = 0;
+    uint64_t hold_max_us = 0;
+};
+
+namespace {
+struct sim_event_t {
+    uint64_t at_us;
+    uint64_t seq;
+    std::function<void()> fn;
+};
+
+std::mutex s_baton_lock;
+sim_task *s_current = nullptr;
+sim_task *s_on_core[k_cores] = {}; // the task each core runs, or last ran when idle
+bool s_core_running[k_cores] = {};
+bool s_core_used[k_cores] = {true, false};
+std::vector<sim_task *> s_tasks;
+std::vector<sim_semaphore *> s_semaphores;
+std::vector<std::string> s_mutex_names;
+std::vector<sim_event_t> s_events; // min-heap on (at_us, seq)
+uint64_t s_event_seq = 0;
+uint64_t s_now_us = 0;
+uint64_t s_idle_us[k_cores] = {};
+uint64_t s_ready_counter = 0;
+int s_isr_depth = 0;
+bool s_idling = false;
+bool s_yield_pending = false;
+
+bool event_later(const sim_event_t &a, const sim_event_t &b)
+{
+    return a.at_us != b.at_us ? a.at_us > b.at_us : a.seq > b.seq;
+}
+
+uint64_t next_event_us()
+{
+    return s_events.empty() ? k_forever : s_events.front().at_us;
+}
+
+uint64_t tick_deadline(TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY) {
+        return k_forever;
+    }
+    return (s_now_us / k_sim_tick_us + ticks) * k_sim_tick_us;
+}
+
+void make_ready(sim_task *task)
+{
+    task->state = TaskState::READY;
+    task->waiting_notify = false;
+    task->waiting_sem = nullptr;
+    task->wake_at_us = k_forever;
+    task->ready_order = ++s_ready_counter;
+}
+
+sim_task *pick_next(int core)
+{
+    sim_task *best = nullptr;
+    for (sim_task *task : s_tasks) {
+        if (task->state != TaskState::READY || task->core != core) {
+            continue;
+        }
+        if (!best || task->priority > best->priority ||
+            (task->priority == best->priority && task->ready_order < best->ready_order)) {
+            best = task;
+        }
+    }
+    return best;
+}
+
+void fire_due_events()
+{
+    while (!s_events.empty() && s_events.front().at_us <= s_now_us) {
+        std::pop_heap(s_events.begin(), s_events.end(), event_later);
+        sim_event_t event = std::move(s_events.back());
+        s_events.pop_back();
+        s_isr_depth++;
+        event.fn();
+        s_isr_depth--;
+    }
+}
+
+void wake_timed_out()
+{
+    for (sim_task *task : s_tasks) {
+        if (task->state != TaskState::BLOCKED || task->wake_at_us > s_now_us) {
+            continue;
+        }
+        if (task->waiting_sem) {
+            std::vector<sim_task *> &waiters = task->waiting_sem->waiters;
+            waiters.erase(std::remove(waiters.begin(), waiters.end(), task), waiters.end());
+            task->waiting_sem->timeouts++;
+            task->timed_out = true;
+        }
+        make_ready(task);
+    }
+}
+
+uint64_t earliest_wake_us()
+{
+    uint64_t earliest = k_forever;
+    for (sim_task *task : s_tasks) {
+        if (task->state == TaskState::BLOCKED && task->wake_at_us < earliest) {
+            earliest = task->wake_at_us;
+        }
+    }
+    return earliest;
+}
+
+[[noreturn]] void deadlock()
+{
+    std::fprintf(stderr, "\nSIM: deadlock at %.6f s, every task blocked forever:\n", s_now_us / 1e6);
+    for (sim_task *task : s_tasks) {
+        std::fprintf(stderr, "  %-12s %s%s%s\n", task->name.c_str(),
+                     task->state == TaskState::DONE ? "done" : "blocked",
+                     task->waiting_notify ? " on notify" : "",
+                     task->waiting_sem ? (" on " + task->waiting_sem->name).c_str() : "");
+    }
+    sim_exit(2);
+}
+
+// Put the best ready task on each core. A higher priority preempts, a task inside a
+// critical section keeps its core, and an equal priority waiting longer takes over
+// on the tick (rotate) or when the running task yields.
+void assign_cores(bool rotate)
+{
+    for (int core = 0; core < k_cores; ++core) {
+        sim_task *occupant = s_on_core[core];
+        bool running = s_core_running[core];
+        if (running && occupant->critical_depth > 0) {
+            continue;
+        }
+        sim_task *best = pick_next(core);
+        s_core_running[core] = best != nullptr;
+        if (!best || best == occupant || (running && !rotate && best->priority <= occupant->priority)) {
+            continue;
+        }
+        if (running) {
+            if (best->priority > occupant->priority) {
+                occupant->preempted++;
+            }
+            occupant->ready_order = ++s_ready_counter;
+        }
+        best->switches_in++;
+        s_on_core[core] = best;
+    }
+}
+
+// Hand the baton to next and wait until it comes back.
+void run_next(sim_task *self, sim_task *next)
+{
+    if (next == self) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(s_baton_lock);
+    s_current = next;
+    next->cv.notify_one();
+    if (self->state == TaskState::DONE) {
+        return;
+    }
+    self->cv.wait(lock, [self] { return s_current == self; });
+}
+
+// Runs on the thread of a task that cannot go on right now: it blocked, finished,
+// was preempted or is busy-waiting. Moves the clock until some core's task has code
+// to run, hands it the baton and returns once self runs again.
+void reschedule(sim_task *self, bool yield = false)
+{
+    s_idling = true;
+    bool rotate = yield;
+    sim_task *next = nullptr;
+    while (!next) {
+        assign_cores(rotate);
+        for (int core = 0; core < k_cores && !next; ++core) {
+            if (s_core_running[core] && s_on_core[core]->busy_until_us <= s_now_us) {
+                next = s_on_core[core];
+            }
+        }
+        if (next) {
+            break;
+        }
+
+        uint64_t step = std::min(earliest_wake_us(), next_event_us());
+        bool spinning = false;
+        for (int core = 0; core < k_cores; ++core) {
+            if (s_core_running[core]) {
+                spinning = true;
+                step = std::min(step, s_on_core[core]->busy_until_us);
+            }
+        }
+        if (spinning) {
+            step = std::min(step, (s_now_us / k_sim_tick_us + 1) * k_sim_tick_us);
+        } else if (step == k_forever) {
+            deadlock();
+        }
+        if (step > s_now_us) {
+            for (int core = 0; core < k_cores; ++core) {
+                (s_core_running[core] ? s_on_core[core]->cpu_us : s_idle_us[core]) += step - s_now_us;
+            }
+            s_now_us = step;
+        }
+        fire_due_events();
+        wake_timed_out();
+        rotate = spinning && (s_now_us % k_sim_tick_us) == 0;
+    }
+    s_idling = false;
+    s_yield_pending = false;
+    run_next(self, next);
+}
+
+void block_current()
+{
+    sim_task *self = s_current;
+    self->state = TaskState::BLOCKED;
+    self->blocked_since_us = s_now_us;
+    s_core_running[self->core] = false;
+    reschedule(self);
+}
+
+bool can_switch()
+{
+    return s_isr_depth == 0 && s_current->critical_depth == 0 && !s_idling;
+}
+
+// A higher-priority task on this core preempts at once; one woken on the other core
+// starts when this one next busy-waits or blocks, at the same virtual time.
+void maybe_preempt()
+{
+    if (!can_switch()) {
+        s_yield_pending = true;
+        return;
+    }
+    s_yield_pending = false;
+    sim_task *self = s_current;
+    sim_task *next = pick_next(self->core);
+    if (next && next != self && next->priority > self->priority) {
+        reschedule(self);
+    }
+}
+
+void task_entry(sim_task *task)
+{
+    {
+        std::unique_lock<std::mutex> lock(s_baton_lock);
+        task->cv.wait(lock, [task] { return s_current == task; });
+    }
+    task->fn(task->arg);
+    task->state = TaskState::DONE;
+    s_core_running[task->core] = false;
+    reschedule(task);
+}
+
+sim_task *create_task(TaskFunction_t fn, const char *name, void *arg, UBaseType_t priority, int core)
+{
+    sim_task *task = new sim_task;
+    task->name = name ? name : "";
+    task->fn = fn;
+    task->arg = arg;
+    task->base_priority = priority;
+    task->priority = priority;
+    task->core = core;
+    s_core_used[core] = true;
+    make_ready(task);
+    s_tasks.push_back(task);
+    std::thread(task_entry, task).detach();
+    if (s_current) {
+        maybe_preempt();
+    }
+    return task;
+}
+
+uint32_t permille(uint64_t part, uint64_t whole)
+{
+    return whole == 0 ? 0 : static_cast<uint32_t>((part * 1000) / whole);
+}
+} // namespace
+
+// === SIMULATOR API ===
+uint64_t sim_now_us()
+{
+    return s_now_us;
+}
+
+void sim_busy_wait_us(uint32_t us)
+{
+    sim_task *self = s_current;
+    self->busy_until_us = s_now_us + us;
+    reschedule(self);
+    self->busy_until_us = 0;
+}
+
+void sim_at(uint64_t at_us, std::function<void()> fn)
+{
+    s_events.push_back({at_us, ++s_event_seq, std::move(fn)});
+    std::push_heap(s_events.begin(), s_events.end(), event_later);
+}
+
+void sim_run_isr(void (*isr)(void *), void *arg)
+{
+    s_isr_depth++;
+    isr(arg);
+    s_isr_depth--;
+    if (s_yield_pending && s_current) {
+        maybe_preempt();
+    }
+}
+
+void sim_kernel_run(TaskFunction_t main_fn, const char *name, UBaseType_t priority)
+{
+    sim_task *task = create_task(main_fn, name, nullptr, priority, 0);
+    {
+        std::lock_guard<std::mutex> lock(s_baton_lock);
+        s_current = task;
+        s_on_core[0] = task;
+        s_core_running[0] = true;
+        task->switches_in++;
+        task->cv.notify_one();
+    }
+    while (true) {
+        pause();
+    }
+}
+
+void sim_exit(int code)
+{
+    std::fflush(stdout);
+    std::fflush(stderr);
+    _exit(code);
+}
+
+void sim_kernel_name_mutexes(const std::vector<std::string> &names)
+{
+    s_mutex_names = names;
+    for (size_t i = 0; i < s_semaphores.size() && i < names.size(); ++i) {
+        s_semaphores[i]->name = names[i];
+    }
+}
+
+void sim_kernel_report()
+{
+    uint32_t idle = permille(s_idle_us[0], s_now_us);
+    if (s_core_used[1]) {
+        uint32_t idle1 = permille(s_idle_us[1], s_now_us);
+        std::printf("Tasks (virtual CPU over %.3f s, idle core 0 %u.%u%%, core 1 %u.%u%%):\n", s_now_us / 1e6,
+                    idle / 10, idle % 10, idle1 / 10, idle1 % 10);
+    } else {
+        std::printf("Tasks (virtual CPU over %.3f s, idle %u.%u%%):\n", s_now_us / 1e6, idle / 10, idle % 10);
+    }
+    std::printf("  %-12s %4s %4s %12s %7s %9s %9s\n", "task", "prio", "core", "cpu_us", "cpu%", "switches",
+                "preempted");
+    for (sim_task *task : s_tasks) {
+        uint32_t cpu = permille(task->cpu_us, s_now_us);
+        std::printf("  %-12s %4u %4d %12llu %5u.%u %9u %9u\n", task->name.c_str(), task->base_priority, task->core,
+                    static_cast<unsigned long long>(task->cpu_us), cpu / 10, cpu % 10, task->switches_in,
+                    task->preempted);
+    }
+    std::printf("Mutexes:\n");
+    std::printf("  %-14s %9s %9s %8s %12s %11s %11s\n", "mutex", "takes", "contended", "timeouts", "wait_avg_us",
+                "wait_max_us", "hold_max_us");
+    for (sim_semaphore *sem : s_semaphores) {
+        std::printf("  %-14s %9llu %9llu %8llu %12llu %11llu %11llu\n", sem->name.c_str(),
+                    static_cast<unsigned long long>(sem->takes), static_cast<unsigned long long>(sem->contended),
+                    static_cast<unsigned long long>(sem->timeouts),
+                    static_cast<unsigned long long>(sem->contended ? sem->wait_total_us / sem->contended : 0),
+                    static_cast<unsigned long long>(sem->wait_max_us),
+                    static_cast<unsigned long long>(sem->hold_max_us));
+    }
+}
+
+// === PORT LAYER ===
+void sim_critical_enter(portMUX_TYPE *mux)
+{
+    mux->count++;
+    s_current->critical_depth++;
+}
+
+void sim_critical_exit(portMUX_TYPE *mux)
+{
+    mux->count--;
+    s_current->critical_depth--;
+    if (s_current->critical_depth == 0 && s_yield_pending) {
+        maybe_preempt();
+    }
+}
+
+void sim_yield_from_isr(void)
+{
+    s_yield_pending = true;
+}
+
+BaseType_t xPortInIsrContext(void)
+{
+    return s_isr_depth > 0 ? pdTRUE : pdFALSE;
+}
+
+// === TASKS ===
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                                           UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb,
+                                           BaseType_t core_id)
+{
+    (void)stack_depth;
+    (void)stack;
+    sim_task *task = create_task(fn, name, arg, priority, core_id == 1 ? 1 : 0);
+    if (tcb) {
+        tcb->reserved = task;
+    }
+    return task;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                               UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb)
+{
+    return xTaskCreateStaticPinnedToCore(fn, name, stack_depth, arg, priority, stack, tcb, tskNO_AFFINITY);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority,
+                       TaskHandle_t *out_handle)
+{
+    (void)stack_depth;
+    sim_task *task = create_task(fn, name, arg, priority, 0);
+    if (out_handle) {
+        *out_handle = task;
+    }
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    sim_task *self = s_current;
+    if (ticks == 0) {
+        self->ready_order = ++s_ready_counter;
+        reschedule(self, true);
+        return;
+    }
+    self->wake_at_us = tick_deadline(ticks);
+    block_current();
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return static_cast<TickType_t>(s_now_us / k_sim_tick_us);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+    sim_task *self = s_current;
+    if (self->notify == 0 && ticks_to_wait != 0) {
+        self->waiting_notify = true;
+        self->wake_at_us = tick_deadline(ticks_to_wait);
+        block_current();
+    }
+    uint32_t value = self->notify;
+    if (value) {
+        self->notify = clear_on_exit ? 0 : value - 1;
+    }
+    return value;
+}
+
+static bool notify_give(TaskHandle_t task)
+{
+    task->notify++;
+    if (task->state == TaskState::BLOCKED && task->waiting_notify) {
+        make_ready(task);
+        return true;
+    }
+    return false;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    if (notify_give(task)) {
+        maybe_preempt();
+    }
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken)
+{
+    if (notify_give(task) && higher_priority_task_woken && task->priority > s_current->priority) {
+        *higher_priority_task_woken = pdTRUE;
+    }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return s_current;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+    task = task ? task : s_current;
+    return task->base_priority;
+}
+
+// As FreeRTOS: an inherited priority above the new one stays until the mutex is given.
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority)
+{
+    task = task ? task : s_current;
+    bool inherited = task->priority > task->base_priority;
+    task->base_priority = priority;
+    if (!inherited || priority > task->priority) {
+        task->priority = priority;
+    }
+    maybe_preempt();
+}
+
+char *pcTaskGetName(TaskHandle_t task)
+{
+    task = task ? task : s_current;
+    return const_cast<char *>(task->name.c_str());
+}
+
+// === MUTEXES ===
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+    sim_semaphore *sem = new sim_semaphore;
+    size_t index = s_semaphores.size();
+    sem->name = index < s_mutex_names.size() ? s_mutex_names[index] : "mutex" + std::to_string(index);
+    s_semaphores.push_back(sem);
+    if (buffer) {
+        buffer->reserved = sem;
+    }
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return xSemaphoreCreateMutexStatic(nullptr);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait)
+{
+    sim_task *self = s_current;
+    if (!sem->owner) {
+        sem->owner = self;
+        sem->taken_at_us = s_now_us;
+        sem->takes++;
+        return pdTRUE;
+    }
+    if (sem->owner == self) {
+        std::fprintf(stderr, "SIM: %s takes %s twice\n", self->name.c_str(), sem->name.c_str());
+        sim_exit(2);
+    }
+    if (ticks_to_wait == 0) {
+        return pdFALSE;
+    }
+
+    sem->contended++;
+    if (sem->owner->priority < self->priority) {
+        sem->owner->priority = self->priority; // priority inheritance
+    }
+    sem->waiters.push_back(self);
+    self->waiting_sem = sem;
+    self->timed_out = false;
+    self->wake_at_us = tick_deadline(ticks_to_wait);
+    block_current();
+    return self->timed_out ? pdFALSE : pdTRUE; // on success give() handed us ownership
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    sim_task *self = s_current;
+    if (sem->owner != self) {
+        return pdFALSE;
+    }
+    sem->hold_max_us = std::max(sem->hold_max_us, s_now_us - sem->taken_at_us);
+    self->priority = self->base_priority;
+
+    if (sem->waiters.empty()) {
+        sem->owner = nullptr;
+        return pdTRUE;
+    }
+
+    auto it = std::max_element(sem->waiters.begin(), sem->waiters.end(),
+                               [](const sim_task *a, const sim_task *b) { return a->priority < b->priority; });
+    sim_task *waiter = *it;
+    sem->waiters.erase(it);
+    uint64_t waited = s_now_us - waiter->blocked_since_us;
+    sem->wait_total_us += waited;
+    sem->wait_max_us = std::max(sem->wait_max_us, waited);
+    sem->owner = waiter;
+    sem->taken_at_us = s_now_us;
+    sem->takes++;
+    make_ready(waiter);
+    maybe_preempt();
+    return pdTRUE;
+}
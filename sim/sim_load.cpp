@@ -0,0 +1,214 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Command throughput load test. A network-side generator offers WindowCovering
+// commands at a Poisson rate; each one runs on the CHIP task through the same path
+// app_main wires into esp-matter:
+//   pre-callback (bs_wc_command_tracker) -> TargetPosition write -> POST_UPDATE -> driver
+// while the real driver, update task and subscriptions compete for the one core.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include <app/clusters/window-covering-server/window-covering-server.h>
+#include <esp_matter.h>
+#include <platform/CHIPDeviceLayer.h>
+
+#include "app_priv.h"
+#include "bs_wc_commands.h"
+#include "sim.h"
+
+namespace {
+// Power Source cluster, as reported by app_main's battery task.
+constexpr uint32_t k_power_source_cluster_id = 0x002F;
+constexpr uint32_t k_bat_voltage_id = 0x000B;
+constexpr uint32_t k_bat_percent_id = 0x000C;
+constexpr uint16_t k_power_source_endpoint_id = 2;
+constexpr TickType_t k_battery_report_ticks = pdMS_TO_TICKS(5000);
+
+enum load_kind_t : uint8_t {
+    k_load_go_to = 0,
+    k_load_open,
+    k_load_close,
+    k_load_stop,
+    k_load_kind_count,
+};
+
+const char *const k_kind_names[k_load_kind_count] = {"GoTo", "Open", "Close", "Stop"};
+
+sim_load_config_t s_config = {};
+uint16_t s_endpoint_id = 0;
+bs_wc_command_tracker s_tracker;
+uint32_t s_offered = 0;
+uint32_t s_answered = 0;
+uint32_t s_kind_count[k_load_kind_count] = {};
+uint64_t s_first_arrival_us = 0;
+uint64_t s_last_answer_us = 0;
+std::vector<uint32_t> s_latencies_us;
+uint32_t s_rng = 0x2545F491;
+TaskHandle_t s_waiter = nullptr;
+
+uint32_t next_random()
+{
+    s_rng = s_rng * 1103515245U + 12345U;
+    return s_rng >> 8;
+}
+
+uint64_t next_interarrival_us()
+{
+    double u = (next_random() % 1000000 + 1) / 1000001.0;
+    return static_cast<uint64_t>(-std::log(u) * 1e6 / s_config.rate_hz) + 1;
+}
+
+load_kind_t kind_for(uint32_t index)
+{
+    if (index % 20 == 19) {
+        return k_load_stop;
+    }
+    if (index % 50 == 24) {
+        return k_load_open;
+    }
+    if (index % 50 == 49) {
+        return k_load_close;
+    }
+    return k_load_go_to;
+}
+
+void drop_unpaired_work(intptr_t arg)
+{
+    s_tracker.drop_unpaired(static_cast<uint32_t>(arg));
+}
+
+void write_target(uint16_t requested)
+{
+    uint16_t target = s_tracker.resolve_target(requested); // PRE_UPDATE
+    esp_matter_attr_val_t val = esp_matter_nullable_uint16(target);
+    esp_matter::attribute::update(s_endpoint_id, chip::app::Clusters::WindowCovering::Id,
+                                  chip::app::Clusters::WindowCovering::Attributes::TargetPositionLiftPercent100ths::Id,
+                                  &val);
+    app_driver_set_target_percent100ths(s_endpoint_id, target); // POST_UPDATE
+}
+
+// CHIP task: one invoke, from pre-callback to response.
+void handle_command(load_kind_t kind, uint16_t target, uint64_t arrival_us)
+{
+    uint32_t serial = 0;
+    switch (kind) {
+    case k_load_go_to:
+        serial = s_tracker.begin(bs_wc_command_t::k_go_to_lift_pct, target);
+        break;
+    case k_load_open:
+        serial = s_tracker.begin(bs_wc_command_t::k_up_or_open, 10000);
+        break;
+    case k_load_close:
+        serial = s_tracker.begin(bs_wc_command_t::k_down_or_close, 0);
+        break;
+    default:
+        s_tracker.clear();
+        app_driver_stop(s_endpoint_id);
+        break;
+    }
+    if (serial != 0) {
+        chip::DeviceLayer::PlatformMgr().ScheduleWork(drop_unpaired_work, static_cast<intptr_t>(serial));
+        write_target(target);
+    }
+
+    uint64_t now = sim_now_us();
+    s_latencies_us.push_back(static_cast<uint32_t>(now - arrival_us));
+    s_last_answer_us = now;
+    if (++s_answered == s_config.commands && s_waiter) {
+        xTaskNotifyGive(s_waiter);
+    }
+}
+
+// Interrupt context: the packet arrived; schedule the next one.
+void offer_next()
+{
+    uint32_t index = s_offered++;
+    load_kind_t kind = kind_for(index);
+    uint16_t target = static_cast<uint16_t>(next_random() % 10001);
+    uint64_t arrival_us = sim_now_us();
+    if (index == 0) {
+        s_first_arrival_us = arrival_us;
+    }
+    s_kind_count[kind]++;
+    sim_matter_post([kind, target, arrival_us] { handle_command(kind, target, arrival_us); });
+    if (s_offered < s_config.commands) {
+        sim_at(arrival_us + next_interarrival_us(), offer_next);
+    }
+}
+
+void battery_report_task(void *arg)
+{
+    (void)arg;
+    while (true) {
+        sim_matter_post([] {
+            app_battery_status_t status = {};
+            if (app_driver_get_battery_status(&status) != ESP_OK || !status.valid) {
+                return;
+            }
+            esp_matter_attr_val_t val = esp_matter_nullable_uint16(static_cast<uint16_t>(status.voltage_mv));
+            esp_matter::attribute::update(k_power_source_endpoint_id, k_power_source_cluster_id, k_bat_voltage_id,
+                                          &val);
+            val = esp_matter_nullable_uint16(static_cast<uint16_t>(status.percent * 2));
+            esp_matter::attribute::update(k_power_source_endpoint_id, k_power_source_cluster_id, k_bat_percent_id,
+                                          &val);
+        });
+        vTaskDelay(k_battery_report_ticks);
+    }
+}
+
+uint32_t percentile(const std::vector<uint32_t> &sorted, uint32_t per_mille)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = (sorted.size() * per_mille + 999) / 1000;
+    return sorted[index == 0 ? 0 : index - 1];
+}
+} // namespace
+
+void sim_load_run(const sim_load_config_t &config, uint16_t endpoint_id)
+{
+    s_config = config;
+    s_endpoint_id = endpoint_id;
+    s_latencies_us.reserve(config.commands);
+    sim_matter_set_subscribers(config.subscribers, config.report_cost_us);
+    xTaskCreate(battery_report_task, "batt_report", 4096, nullptr, 1, nullptr);
+
+    s_waiter = xTaskGetCurrentTaskHandle();
+    sim_at(sim_now_us() + 1000, offer_next);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    s_waiter = nullptr;
+}
+
+void sim_load_report()
+{
+    std::vector<uint32_t> sorted = s_latencies_us;
+    std::sort(sorted.begin(), sorted.end());
+    double span_s = (s_last_answer_us - s_first_arrival_us) / 1e6;
+
+    std::printf("Load: %u commands at %u/s offered (", static_cast<unsigned>(s_answered),
+                static_cast<unsigned>(s_config.rate_hz));
+    for (int kind = 0; kind < k_load_kind_count; ++kind) {
+        std::printf("%s%s %u", kind ? ", " : "", k_kind_names[kind], static_cast<unsigned>(s_kind_count[kind]));
+    }
+    std::printf("), %u subscriber%s\n", static_cast<unsigned>(s_config.subscribers),
+                s_config.subscribers == 1 ? "" : "s");
+    std::printf("  throughput %.1f commands/s over %.3f s\n", span_s > 0 ? s_answered / span_s : 0.0, span_s);
+    std::printf("  response latency us: p50 %u  p90 %u  p99 %u  max %u\n", percentile(sorted, 500),
+                percentile(sorted, 900), percentile(sorted, 990), sorted.empty() ? 0 : sorted.back());
+    const sim_matter_stats_t &matter = sim_matter_stats();
+    std::printf("  reports: %u attribute updates -> %llu subscription reports (%.1f/s)\n",
+                static_cast<unsigned>(matter.attribute_updates),
+                static_cast<unsigned long long>(matter.reports_delivered),
+                span_s > 0 ? matter.reports_delivered / span_s : 0.0);
+    std::printf("  unpaired commands %u\n", static_cast<unsigned>(s_tracker.unpaired()));
+}
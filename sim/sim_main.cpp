@@ -0,0 +1,1362 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Host simulation of the window-covering driver: the real app_driver.cpp on a virtual
+// clock, driven by a scripted Matter/button scenario. Prints scheduling, contention
+// and motion-timing figures and exits non-zero if the simulated motor ends up
+// somewhere other than where the driver reported it.
+//
+//     blindshade_sim [--quiet] [--attr-cost-us N]
+//     blindshade_sim --load N [--rate HZ] [--subscribers K] [--report-cost-us N]
+//     blindshade_sim --replay TRACE
+//     blindshade_sim --voltage-trace TRACE
+//
+// Every mode first stress-tests the command queue from several host threads (sim_queue.cpp).
+// --trace prints the driver's trace ring (BSTRACE lines) at the end of the run;
+// --postmortem-out FILE saves the postmortem partition for tools/postmortem_decode.py.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <nvs.h>
+
+#include "app_priv.h"
+#include "bs_icd_policy.h"
+#include "bs_load_detect.h"
+#include "bs_motor_backend.h"
+#include "bs_sync_move.h"
+#include "sim.h"
+
+namespace {
+constexpr uint16_t k_endpoint_id = 1;
+constexpr UBaseType_t k_harness_priority = 10;
+constexpr UBaseType_t k_chip_priority = 5;
+constexpr uint32_t k_max_steps = 5000;
+constexpr uint32_t k_settle_ms = 300;
+constexpr uint32_t k_settle_timeout_ms = 60000;
+constexpr gpio_num_t k_btn_up = GPIO_NUM_1;
+constexpr gpio_num_t k_btn_stop = GPIO_NUM_2;
+constexpr gpio_num_t k_btn_down = GPIO_NUM_3;
+constexpr uint16_t k_safety_motor_jammed = 0x0100; // WindowCovering SafetyStatus
+constexpr uint16_t k_safety_obstacle_detected = 0x0020;
+constexpr int32_t k_top_stop = 700;     // real top, above where the driver booted
+constexpr int32_t k_bottom_stop = 6000;
+constexpr int32_t k_switch_travel = 20; // home switch trips this far before the top stop
+constexpr uint32_t k_queue_producers = 4;  // CHIP task, console, bench, and one to spare
+constexpr uint32_t k_queue_commands_per_producer = 20000;
+
+uint32_t s_attr_cost_us = 300;
+sim_load_config_t s_load = {0, 100, 1, 150};
+const char *s_replay_path = nullptr;
+bool s_dump_trace = false;
+const char *s_postmortem_out = nullptr;
+const char *s_voltage_path = nullptr;
+int s_failures = 0;
+uint32_t s_travel_steps = k_max_steps; // bottom_steps the driver uses; calibration changes it
+std::chrono::steady_clock::time_point s_wall_start;
+
+void sleep_ms(uint32_t ms)
+{
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void go_to(uint16_t percent100ths)
+{
+    sim_matter_post([percent100ths] { app_driver_set_target_percent100ths(k_endpoint_id, percent100ths); });
+}
+
+void stop()
+{
+    sim_matter_post([] { app_driver_stop(k_endpoint_id); });
+}
+
+// Settled: driver disabled and the last report says Stall, for k_settle_ms in a row.
+bool wait_settled()
+{
+    uint32_t quiet_ms = 0;
+    for (uint32_t waited = 0; waited < k_settle_timeout_ms; waited += 50) {
+        sleep_ms(50);
+        bool idle = sim_gpio_level(GPIO_NUM_6) == 1 && sim_matter_stats().last_op_state == 0;
+        quiet_ms = idle ? quiet_ms + 50 : 0;
+        if (quiet_ms >= k_settle_ms) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void check(bool ok, const char *what)
+{
+    if (!ok) {
+        std::printf("FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+// The motor model counts real STEP edges; the driver's reported position must agree.
+void check_position(const char *stage, int32_t expected_steps)
+{
+    const sim_motor_t &motor = sim_motor();
+    uint32_t reported = sim_matter_stats().last_position;
+    uint32_t motor_percent = (static_cast<uint32_t>(motor.position) * 10000 + s_travel_steps / 2) / s_travel_steps;
+    std::printf("[%8.3f s] %-18s motor %5d steps, reported %5u (motor %5u)\n", sim_now_us() / 1e6, stage,
+                static_cast<int>(motor.position), static_cast<unsigned>(reported),
+                static_cast<unsigned>(motor_percent));
+    check(motor.position >= 0, "motor position went negative");
+    check(reported == motor_percent, "reported position differs from motor");
+    if (expected_steps >= 0) {
+        check(motor.position == expected_steps, "motor did not reach the target");
+    }
+#if CONFIG_BS_DUAL_MOTOR
+    app_lockstep_stats_t lockstep = {};
+    app_driver_get_lockstep_stats(&lockstep);
+    check(sim_motor2().commanded - motor.commanded == lockstep.trim_steps, "motor B out of step with motor A");
+    check(lockstep.step_error == 0 && lockstep.misaligned_edges == 0, "driver measured a lockstep error");
+#endif
+}
+
+void run_stage(const char *stage, int32_t expected_steps)
+{
+    check(wait_settled(), "timed out waiting for the blind to settle");
+    check_position(stage, expected_steps);
+}
+
+// Active-low button held for hold_ms, then released and given a poll period to land.
+void press(gpio_num_t pin, uint32_t hold_ms)
+{
+    uint64_t now = sim_now_us();
+    sim_at(now + 1000, [pin] { sim_gpio_drive(pin, 0); });
+    sim_at(now + 1000 + hold_ms * 1000ULL, [pin] { sim_gpio_drive(pin, 1); });
+    sleep_ms(hold_ms + 100);
+}
+
+// Automatic calibration on a blind whose motor cannot keep up with everything and whose
+// step 0 is not the real top: home against the end-stop switch, find the bottom by
+// stall, then the driver's speed auto-tune and a move at the result.
+void calibrate_and_tune()
+{
+    sim_motor_set_limits(1000, 25, 250);
+    sim_motor_set_end_stops(-k_top_stop, k_bottom_stop, k_switch_travel);
+    press(k_btn_stop, 2200); // hold: enter calibration
+    press(k_btn_up, 100);    // home: seek the switch, back off, creep back
+    check(wait_settled(), "homing did not finish");
+    int32_t home = sim_motor().position;
+    std::printf("[%8.3f s] homed at shaft %d, %u steps slipped\n", sim_now_us() / 1e6, static_cast<int>(home),
+                static_cast<unsigned>(sim_motor().slipped));
+    check(home == k_switch_travel - k_top_stop, "home is not where the switch trips");
+    sim_motor_set_origin();
+    press(k_btn_down, 100);  // bottom: seek the stop until the encoder sees a stall; tuning follows
+    check(wait_settled(), "bottom search / speed tuning did not finish");
+    press(k_btn_stop, 100);  // double press: leave calibration
+    press(k_btn_stop, 100);
+    check(!app_driver_is_calibrating(), "still calibrating");
+
+#if CONFIG_BS_MOVE_LOG
+    // Homing, the bottom seek and every tuning leg ran to their end: none of them may
+    // inherit the STOP that ended the session before, and their positions are steps.
+    bs_move_record_t record = {};
+    uint32_t calibration_moves = 0;
+    for (uint16_t i = 0; app_driver_get_move_record(i, &record) == ESP_OK; ++i) {
+        if ((record.flags & BS_MOVE_CALIBRATION) == 0) {
+            continue;
+        }
+        calibration_moves++;
+        check((record.flags & BS_MOVE_STOPPED_EARLY) == 0, "a calibration move was recorded as stopped early");
+        check(record.start_position <= k_bottom_stop + k_top_stop && record.end_position <= k_bottom_stop + k_top_stop,
+              "calibration move position is not in steps");
+    }
+    check(calibration_moves > 10, "calibration moves missing from the move log");
+#endif
+
+    s_travel_steps = static_cast<uint32_t>(sim_nvs_get_u16("calibration", "bottom_steps"));
+    int32_t cruise_us = sim_nvs_get_u16("calibration", "cruise_us");
+    int32_t ramp_steps = sim_nvs_get_u16("calibration", "ramp_steps");
+    std::printf("[%8.3f s] calibrated: travel %u steps, tuned cruise %d us, ramp %d steps\n", sim_now_us() / 1e6,
+                static_cast<unsigned>(s_travel_steps), static_cast<int>(cruise_us), static_cast<int>(ramp_steps));
+    check(s_travel_steps == static_cast<uint32_t>(k_bottom_stop + k_top_stop - k_switch_travel),
+          "bottom is not at the end stop");
+    check(cruise_us > 0 && cruise_us < 2000, "speed tuning found nothing faster than the default");
+    check(1000000 / (cruise_us + 10) <= 1000, "tuned cruise is faster than the motor can follow");
+
+    app_encoder_stats_t before = {};
+    app_driver_get_encoder_stats(&before);
+    go_to(5000);
+    run_stage("tuned 50%", static_cast<int32_t>((5000 * s_travel_steps + 5000) / 10000));
+    app_encoder_stats_t after = {};
+    app_driver_get_encoder_stats(&after);
+    check(after.drift_corrections == before.drift_corrections && after.stalls == before.stalls,
+          "lost steps at the tuned speed");
+}
+
+// Attributes 0xFFF1 / 0xFFF2: calibration mode on, home, off - no buttons involved.
+void rehome_over_matter()
+{
+    sim_matter_post([] { app_driver_set_calibration_mode(true); });
+    sim_matter_post([] { app_driver_calibration_command(APP_CALIBRATION_HOME); });
+    sleep_ms(100);
+    check(app_driver_is_calibrating(), "Matter did not enter calibration");
+    run_stage("Matter re-home", 0);
+    sim_matter_post([] { app_driver_set_calibration_mode(false); });
+    sleep_ms(100);
+    check(!app_driver_is_calibrating(), "Matter did not leave calibration");
+    go_to(2500);
+    run_stage("after re-home", static_cast<int32_t>((2500 * s_travel_steps + 5000) / 10000));
+}
+
+// Motion profiles: a full-travel move in each takes what the driver predicts, and
+// switching mid-move (down to night, back up to fast) loses no steps on a motor with
+// limited acceleration.
+void motion_profiles()
+{
+    go_to(0);
+    run_stage("profiles from top", 0);
+    for (uint8_t i = 0; i < APP_MOTION_PROFILE_COUNT; ++i) {
+        app_motion_profile_t profile = static_cast<app_motion_profile_t>(i);
+        sim_matter_post([profile] { app_driver_set_motion_profile(profile); });
+        app_motion_profile_info_t info = {};
+        check(app_driver_get_motion_profile_info(profile, &info) == ESP_OK, "no motion profile info");
+        uint16_t target = (i % 2 == 0) ? 10000 : 0;
+        uint64_t start_us = sim_now_us();
+        go_to(target);
+        run_stage(info.name, target ? static_cast<int32_t>(s_travel_steps) : 0);
+        uint32_t took_ms = static_cast<uint32_t>((sim_motor().last_edge_us - start_us) / 1000);
+        std::printf("[%8.3f s] %-5s full travel %u ms, predicted %u ms\n", sim_now_us() / 1e6, info.name,
+                    static_cast<unsigned>(took_ms), static_cast<unsigned>(info.full_travel_ms));
+        uint32_t slack_ms = info.full_travel_ms / 50 + 50;
+        check(took_ms + slack_ms >= info.full_travel_ms && took_ms <= info.full_travel_ms + slack_ms,
+              "full-travel time differs from the prediction");
+    }
+    check(sim_nvs_get_u16("motion", "profile") == APP_MOTION_PROFILE_NIGHT, "motion profile not persisted");
+
+    sim_matter_post([] { app_driver_set_motion_profile(APP_MOTION_PROFILE_FAST); });
+    uint32_t slipped = sim_motor().slipped;
+    app_encoder_stats_t before = {};
+    app_driver_get_encoder_stats(&before);
+    go_to(0);
+    uint64_t now = sim_now_us();
+    sim_at(now + 2000000, [] { app_driver_set_motion_profile(APP_MOTION_PROFILE_NIGHT); });
+    sim_at(now + 4000000, [] { app_driver_set_motion_profile(APP_MOTION_PROFILE_FAST); });
+    run_stage("profile mid-move", 0);
+    app_encoder_stats_t after = {};
+    app_driver_get_encoder_stats(&after);
+    check(sim_motor().slipped == slipped && after.drift_corrections == before.drift_corrections,
+          "lost steps switching profile mid-move");
+    check(app_driver_get_motion_profile() == APP_MOTION_PROFILE_FAST, "mid-move switch did not stick");
+}
+
+// Synchronized group moves: with a group full-travel time set, every move takes its
+// share of it regardless of the profile the blind would otherwise run. A second,
+// shorter blind with a slower motor is planned with the same header math; the two
+// must arrive within a step of each other. A time shorter than the blind can manage
+// runs flat out and arrives late.
+void group_moves()
+{
+    constexpr uint16_t k_group_ds = 150;
+    constexpr uint32_t k_other_travel_steps = 3200;
+    constexpr bs_step_profile_t k_other_profile = {1800, 4000, 40};
+    constexpr uint16_t k_moves[] = {10000, 5000, 8000, 0};
+
+    go_to(0);
+    run_stage("group from top", 0);
+    sim_matter_post([] { app_driver_set_sync_travel_time(k_group_ds); });
+    uint16_t from = 0;
+    for (uint16_t to : k_moves) {
+        uint64_t start_us = sim_now_us();
+        go_to(to);
+        run_stage("group move", static_cast<int32_t>((to * s_travel_steps + 5000) / 10000));
+        uint64_t took_us = sim_motor().last_edge_us - start_us;
+
+        uint64_t move_us = bs_sync_move_time_us(k_group_ds * 100, from, to);
+        uint32_t other_steps = static_cast<uint32_t>(
+            (std::abs(static_cast<int32_t>(to) - static_cast<int32_t>(from)) * k_other_travel_steps + 5000) / 10000);
+        bs_sync_plan_t other = bs_sync_plan(k_other_profile, 1, 10, other_steps, move_us);
+        uint64_t spread_us = took_us > other.duration_us ? took_us - other.duration_us : other.duration_us - took_us;
+        uint64_t step_us = other.profile.cruise_delay_us + 10;
+        std::printf("[%8.3f s] group %5u -> %5u: took %llu ms, asked %llu ms, shorter blind %llu ms, spread %llu us\n",
+                    sim_now_us() / 1e6, static_cast<unsigned>(from), static_cast<unsigned>(to),
+                    static_cast<unsigned long long>(took_us / 1000), static_cast<unsigned long long>(move_us / 1000),
+                    static_cast<unsigned long long>(other.duration_us / 1000),
+                    static_cast<unsigned long long>(spread_us));
+        check(other.on_time, "shorter blind cannot keep the group time");
+        check(spread_us <= step_us, "group members arrive more than a step apart");
+        from = to;
+    }
+    check(sim_nvs_get_u16("motion", "sync_ds") == k_group_ds, "group travel time not persisted");
+
+    // Too short for this blind: it runs at its motion profile's speed.
+    app_motion_profile_info_t fast = {};
+    app_driver_get_motion_profile_info(APP_MOTION_PROFILE_FAST, &fast);
+    sim_matter_post([] { app_driver_set_sync_travel_time(50); });
+    uint64_t start_us = sim_now_us();
+    go_to(10000);
+    run_stage("group too short", static_cast<int32_t>(s_travel_steps));
+    uint32_t took_ms = static_cast<uint32_t>((sim_motor().last_edge_us - start_us) / 1000);
+    check(took_ms + fast.full_travel_ms / 50 + 50 >= fast.full_travel_ms && took_ms <= fast.full_travel_ms + 100,
+          "a group time shorter than the blind can manage did not run flat out");
+    sim_matter_post([] { app_driver_set_sync_travel_time(0); });
+    go_to(0);
+    run_stage("group off", 0);
+}
+
+#if CONFIG_BS_DUAL_MOTOR
+// Dual-motor lockstep: trim motor B alone (and a STOP part-way through a trim), then
+// moves with both: every motor A edge lands with motor B's and the offset holds.
+void lockstep()
+{
+    go_to(3000);
+    run_stage("lockstep start", static_cast<int32_t>((3000 * s_travel_steps + 5000) / 10000));
+    int32_t a_position = sim_motor().position;
+    uint32_t solo = sim_lockstep().solo_edges;
+    sim_matter_post([] { app_driver_set_motor2_trim(40); });
+    run_stage("motor B trim +40", -1);
+    check(sim_motor().position == a_position, "motor A moved during a trim");
+    check(sim_lockstep().solo_edges - solo == 40, "trim did not step motor B alone");
+    check(sim_nvs_get_u16("lockstep", "trim") == 40, "trim not persisted");
+
+    // STOP part-way: the trim ends where it got to, and that is what is saved.
+    sim_matter_post([] { app_driver_set_motor2_trim(-60); });
+    sim_at(sim_now_us() + 300000, [] { sim_gpio_drive(k_btn_stop, 0); });
+    sim_at(sim_now_us() + 400000, [] { sim_gpio_drive(k_btn_stop, 1); });
+    run_stage("trim stopped", -1);
+    app_lockstep_stats_t stats = {};
+    app_driver_get_lockstep_stats(&stats);
+    check(stats.trim_steps > -60 && stats.trim_steps < 40 && stats.trim_target_steps == stats.trim_steps,
+          "STOP did not end the trim where it was");
+    check(sim_nvs_get_u16("lockstep", "trim") == static_cast<uint16_t>(stats.trim_steps), "stopped trim not saved");
+
+    uint32_t aligned = sim_lockstep().aligned_edges;
+    go_to(10000);
+    run_stage("lockstep close", static_cast<int32_t>(s_travel_steps));
+    go_to(0);
+    run_stage("lockstep open", 0);
+    check(sim_lockstep().aligned_edges - aligned == 2 * s_travel_steps - static_cast<uint32_t>(a_position),
+          "motor B missed lockstep edges");
+    check(sim_lockstep().max_skew_us == 0, "motor B edges trail motor A's");
+
+    sim_matter_post([] { app_driver_set_motor2_trim(0); });
+    run_stage("motor B trim 0", 0);
+    app_driver_get_lockstep_stats(&stats);
+    check(stats.trim_steps == 0, "trim did not return to 0");
+}
+#endif
+
+// The motor-bench scripts, run as `matter motor-bench all` runs them: each completes,
+// steps, reports its position, and ends where the script leaves the blind.
+void motor_bench()
+{
+    const int32_t expected_end[APP_BENCH_COUNT] = {0, static_cast<int32_t>((4000 * s_travel_steps + 5000) / 10000), -1};
+    for (int script = 0; script < APP_BENCH_COUNT; ++script) {
+        app_bench_result_t result = {};
+        check(app_bench_run(k_endpoint_id, static_cast<app_bench_script_t>(script), &result) == ESP_OK,
+              "motor-bench script not run");
+        std::printf("motor-bench %-8s %6u ms, %5u steps (%4u steps/s), jitter %d..%d us (%u late), "
+                    "lock wait avg %u / max %u us, %u reports\n",
+                    result.name, static_cast<unsigned>(result.duration_ms), static_cast<unsigned>(result.steps),
+                    static_cast<unsigned>(result.steps_per_s), static_cast<int>(result.jitter_min_us),
+                    static_cast<int>(result.jitter_max_us), static_cast<unsigned>(result.late_steps),
+                    static_cast<unsigned>(result.lock_wait_avg_us), static_cast<unsigned>(result.lock_wait_max_us),
+                    static_cast<unsigned>(result.reports));
+        check(result.completed, "motor-bench script did not settle");
+        check(result.steps > 0 && result.steps_per_s > 0, "motor-bench script did not step");
+        check(result.reports > 0, "motor-bench script did not report its position");
+        run_stage(result.name, expected_end[script]);
+    }
+}
+
+// Runtime parameters: report cadence and yield interval changed mid-session reach the
+// running driver tasks, overrides persist and reset drops them, and a new step profile baseline replaces
+// the tuned one at once.
+void params()
+{
+    go_to(0);
+    run_stage("params from top", 0);
+    uint32_t reports = sim_matter_stats().position_updates;
+    go_to(10000);
+    run_stage("default reporting", static_cast<int32_t>(s_travel_steps));
+    uint32_t default_reports = sim_matter_stats().position_updates - reports;
+
+    check(app_driver_set_param(APP_PARAM_UPDATE_MS, 10) == ESP_ERR_INVALID_ARG, "out-of-range parameter accepted");
+    sim_matter_post([] {
+        app_driver_set_param(app_driver_find_param("update_ms"), 20);
+        app_driver_set_param(APP_PARAM_REPORT_MS, 20);
+        app_driver_set_param(APP_PARAM_REPORT_STEPS, 10);
+        // The update task only runs while the step generator yields.
+        app_driver_set_param(APP_PARAM_YIELD_STEPS, 50);
+    });
+    reports = sim_matter_stats().position_updates;
+    go_to(0);
+    run_stage("fast reporting", 0);
+    uint32_t fast_reports = sim_matter_stats().position_updates - reports;
+    std::printf("params: %u reports per full travel by default, %u at 20 ms / 10 steps / yield every 50\n",
+                static_cast<unsigned>(default_reports), static_cast<unsigned>(fast_reports));
+    check(fast_reports > 3 * default_reports, "report parameters did not reach the update task");
+    check(sim_nvs_get_u16("params", "report_steps") == 10, "parameter override not persisted");
+
+    sim_matter_post([] { app_driver_set_param(APP_PARAM_CRUISE_US, 2500); });
+    sleep_ms(50);
+    app_motion_profile_info_t info = {};
+    app_driver_get_motion_profile_info(APP_MOTION_PROFILE_FAST, &info);
+    app_param_info_t ramp = {};
+    app_driver_get_param_info(APP_PARAM_RAMP_STEPS, &ramp);
+    check(info.cruise_delay_us == 2500 && info.ramp_steps == ramp.value,
+          "step profile did not follow the new baseline");
+    check(sim_nvs_get_u16("calibration", "cruise_us") == 2500, "new baseline not saved with the calibration");
+
+    sim_matter_post([] { app_driver_reset_param(APP_PARAM_COUNT); });
+    go_to(5000);
+    run_stage("params reset", static_cast<int32_t>((5000 * s_travel_steps + 5000) / 10000));
+    check(sim_nvs_get_u16("params", "report_steps") < 0 && sim_nvs_get_u16("params", "cruise_us") < 0,
+          "reset left overrides in NVS");
+    app_param_info_t param = {};
+    app_driver_get_param_info(APP_PARAM_CRUISE_US, &param);
+    check(param.value == param.default_value, "reset did not restore the default");
+}
+
+// Move log: full-travel moves, the last two with the battery sagging mid-move as a
+// stiffening mechanism would make it. Every record matches the move; the summary sees
+// the sag grow.
+void move_log()
+{
+    sim_matter_post([] {
+        app_driver_set_param(APP_PARAM_BATTERY_MS, 1000);
+        app_driver_clear_move_log();
+    });
+    const uint16_t targets[] = {0, 10000, 0, 10000};
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); ++i) {
+        bool sag = i >= 2;
+        go_to(targets[i]);
+        if (sag) {
+            sim_at(sim_now_us() + 2000000, [] { sim_hw_set_battery_mv(11200); });
+        }
+        run_stage(sag ? "move, battery sagging" : "move", targets[i] ? static_cast<int32_t>(s_travel_steps) : 0);
+        sim_hw_set_battery_mv(11800);
+        sleep_ms(1500); // a fresh battery sample before the next move starts
+        if (i == 0) {
+            // From wherever params() left it: not part of the comparison.
+            sim_matter_post([] { app_driver_clear_move_log(); });
+            sleep_ms(10);
+        }
+    }
+
+    bs_move_record_t last = {};
+    check(app_driver_get_move_record(0, &last) == ESP_OK, "no move recorded");
+    check(last.start_position == 0 && last.end_position == 10000 && last.steps == s_travel_steps,
+          "move record does not match the move");
+    check(last.ramp_us > 0 && last.ramp_us < last.duration_us && last.peak_steps_per_s > 0 && last.reports > 0,
+          "move record timing incomplete");
+    check(last.battery_start_mv > 11500 && last.battery_min_mv < 11500, "move record missed the battery sag");
+    bs_move_summary_t summary = {};
+    app_driver_get_move_summary(&summary);
+    std::printf("move log: %u moves, %u us/step (trend %d permille), sag %u mV (trend %+d mV), peak %u steps/s\n",
+                static_cast<unsigned>(summary.moves), static_cast<unsigned>(summary.us_per_step),
+                static_cast<int>(summary.us_per_step_trend_permille), static_cast<unsigned>(summary.sag_mv),
+                static_cast<int>(summary.sag_trend_mv), static_cast<unsigned>(summary.peak_steps_per_s));
+    check(summary.moves == 3 && summary.window == 3, "move log count");
+    check(summary.sag_trend_mv > 300, "summary missed the growing battery sag");
+    sim_matter_post([] { app_driver_reset_param(APP_PARAM_BATTERY_MS); });
+}
+
+// Undervoltage cutoff, from the driver's side of the ADC.
+struct cutoff_events_t {
+    uint32_t trips;
+    uint32_t releases;
+    uint64_t last_us;
+};
+cutoff_events_t s_cutoff_events = {};
+
+void cutoff_cb(bool undervoltage)
+{
+    (undervoltage ? s_cutoff_events.trips : s_cutoff_events.releases)++;
+    s_cutoff_events.last_us = sim_now_us();
+}
+
+// A move with a battery trace playing from the GoTo. Returns the move's start time.
+uint64_t move_with_voltage_trace(uint16_t target_percent100ths)
+{
+    uint64_t start_us = sim_now_us();
+    sim_voltage_schedule();
+    go_to(target_percent100ths);
+    return start_us;
+}
+
+// Virtual time the trace played from start_us drops under the cutoff for good, 0 if it never does.
+uint64_t cutoff_crossing_us(uint64_t start_us)
+{
+    app_param_info_t info = {};
+    app_driver_get_param_info(APP_PARAM_CUTOFF_MV, &info);
+    int64_t offset_us = sim_voltage_crossing_us(info.value);
+    return offset_us < 0 ? 0 : start_us + static_cast<uint64_t>(offset_us);
+}
+
+int64_t us_since(uint64_t from_us, uint64_t to_us)
+{
+    return static_cast<int64_t>(to_us) - static_cast<int64_t>(from_us);
+}
+
+// Recorded battery traces through the ADC model: the short dips of a healthy pack must
+// not trip the cutoff; a collapsing one must stop the motor within a few milliseconds,
+// keep the position in NVS, tell the app and refuse moves until it recovers at rest.
+void undervoltage()
+{
+    sim_matter_post([] {
+        app_driver_set_param(APP_PARAM_BATTERY_MS, 1000);
+        app_driver_set_battery_cb(cutoff_cb);
+    });
+    go_to(0);
+    run_stage("cutoff from top", 0);
+
+    check(sim_voltage_load(SIM_TRACE_DIR "/battery_inrush.trace"), "cannot load battery_inrush.trace");
+    move_with_voltage_trace(10000);
+    run_stage("motor start dips", static_cast<int32_t>(s_travel_steps));
+    app_battery_status_t battery = {};
+    app_driver_get_battery_status(&battery);
+    check(!battery.undervoltage && battery.cutoff_trips == 0 && s_cutoff_events.trips == 0,
+          "short dips tripped the undervoltage cutoff");
+
+    sim_hw_set_battery_mv(11800);
+    sleep_ms(1500);
+    check(sim_voltage_load(SIM_TRACE_DIR "/battery_sag.trace"), "cannot load battery_sag.trace");
+    app_command_stats_t commands_before = {};
+    app_driver_get_command_stats(&commands_before);
+    uint64_t start_us = move_with_voltage_trace(0);
+    run_stage("battery collapse", -1);
+    uint64_t crossing_us = cutoff_crossing_us(start_us);
+    int64_t latency_us = us_since(crossing_us, sim_motor().last_edge_us);
+    int32_t stopped_at = sim_motor().position;
+    app_driver_get_battery_status(&battery);
+    std::printf("undervoltage cutoff: tripped at %u mV, last step %lld us after the drop, app told after %lld us, "
+                "motor stopped at %d steps\n",
+                static_cast<unsigned>(battery.cutoff_trip_mv), static_cast<long long>(latency_us),
+                static_cast<long long>(us_since(crossing_us, s_cutoff_events.last_us)), static_cast<int>(stopped_at));
+    check(battery.undervoltage && battery.cutoff_trips == 1 && s_cutoff_events.trips == 1,
+          "battery collapse did not trip the undervoltage cutoff");
+    check(crossing_us != 0 && latency_us >= 0 && latency_us < 5000, "undervoltage cutoff too slow");
+    check(stopped_at > 0 && stopped_at < static_cast<int32_t>(s_travel_steps), "cutoff did not stop the move");
+    check(sim_nvs_get_u16("calibration", "cutoff_steps") == stopped_at, "cutoff position not saved");
+
+    go_to(10000);
+    sleep_ms(500);
+    app_command_stats_t commands = {};
+    app_driver_get_command_stats(&commands);
+    check(sim_motor().position == stopped_at && commands.rejected == commands_before.rejected + 1,
+          "move accepted below the cutoff");
+
+    // A fresh pack: two resting readings over the release voltage re-arm the blind.
+    sim_hw_set_battery_mv(11800);
+    sleep_ms(2500);
+    app_driver_get_battery_status(&battery);
+    check(!battery.undervoltage && s_cutoff_events.releases == 1, "undervoltage cutoff not released");
+    check(sim_nvs_get_u16("calibration", "cutoff_steps") == -1, "cutoff position kept after the release");
+    go_to(10000);
+    run_stage("after cutoff", static_cast<int32_t>(s_travel_steps));
+    sim_matter_post([] {
+        app_driver_set_battery_cb(nullptr);
+        app_driver_reset_param(APP_PARAM_BATTERY_MS);
+    });
+}
+
+// --voltage-trace: one full-travel move with a recorded trace playing, reporting what
+// the cutoff made of it.
+void voltage_trace_run()
+{
+    uint64_t start_us = move_with_voltage_trace(10000);
+    run_stage("voltage trace", -1);
+    app_battery_status_t battery = {};
+    app_driver_get_battery_status(&battery);
+    std::printf("voltage trace: lowest %u mV, ", static_cast<unsigned>(sim_voltage_min_mv()));
+    if (battery.cutoff_trips == 0) {
+        std::printf("cutoff not tripped\n");
+    } else {
+        uint64_t crossing_us = cutoff_crossing_us(start_us);
+        std::printf("cutoff tripped at %u mV, last step %lld us after the lasting drop, motor stopped at %d steps\n",
+                    static_cast<unsigned>(battery.cutoff_trip_mv),
+                    static_cast<long long>(crossing_us ? us_since(crossing_us, sim_motor().last_edge_us) : -1),
+                    static_cast<int>(sim_motor().position));
+    }
+}
+
+#if CONFIG_BS_CURRENT_SENSE
+// Synthetic load profiles straight into the detector, one reading per millisecond as the
+// step generator takes them: returns the verdict and the reading it came at (-1 if none).
+struct load_profile_t {
+    const char *name;
+    uint16_t (*ma_at)(uint32_t sample);
+    uint32_t samples;
+    bool trips;
+};
+
+uint16_t profile_noise(uint32_t sample)
+{
+    return static_cast<uint16_t>((sample * 2654435761U >> 16) % 25); // +/-12 mA
+}
+
+uint16_t profile_inrush(uint32_t sample)
+{
+    uint32_t inrush = sample < 40 ? 420 * (40 - sample) / 40 : 0;
+    return static_cast<uint16_t>(408 + inrush + profile_noise(sample));
+}
+
+uint16_t profile_stiffening(uint32_t sample)
+{
+    return static_cast<uint16_t>(profile_inrush(sample) + sample / 10); // +100 mA/s
+}
+
+uint16_t profile_glitches(uint32_t sample)
+{
+    return static_cast<uint16_t>(sample % 97 == 96 ? 1800 : profile_inrush(sample)); // single bad conversions
+}
+
+uint16_t profile_obstruction(uint32_t sample)
+{
+    return static_cast<uint16_t>(sample >= 1000 ? 1150 + profile_noise(sample) : profile_inrush(sample));
+}
+
+uint16_t profile_overload(uint32_t sample)
+{
+    return static_cast<uint16_t>(profile_inrush(sample) + sample); // +1 A/s: the baseline keeps up
+}
+
+uint16_t profile_unfitted(uint32_t sample)
+{
+    return static_cast<uint16_t>(profile_noise(sample) / 2);
+}
+
+void load_profiles()
+{
+    const load_profile_t profiles[] = {
+        {"inrush", profile_inrush, 5000, false},
+        {"stiffening", profile_stiffening, 5000, false},
+        {"glitches", profile_glitches, 5000, false},
+        {"obstruction", profile_obstruction, 5000, true},
+        {"overload", profile_overload, 5000, true},
+        {"unfitted", profile_unfitted, 5000, false},
+    };
+    app_param_info_t rise = {};
+    app_driver_get_param_info(APP_PARAM_LOAD_MA, &rise);
+    for (const load_profile_t &profile : profiles) {
+        bs_load_detector detector({150, 2, 6, 600, rise.value, 4, 2500});
+        detector.begin_move();
+        bs_load_verdict_t verdict = bs_load_verdict_t::k_ok;
+        uint32_t sample = 0;
+        for (; sample < profile.samples && verdict == bs_load_verdict_t::k_ok; ++sample) {
+            verdict = detector.sample(profile.ma_at(sample));
+        }
+        std::printf("load profile %-12s %s", profile.name,
+                    verdict == bs_load_verdict_t::k_spike      ? "spike"
+                    : verdict == bs_load_verdict_t::k_overload ? "overload"
+                                                               : "no trip");
+        if (verdict != bs_load_verdict_t::k_ok) {
+            std::printf(" at reading %u: %u mA over a running %u mA", static_cast<unsigned>(sample - 1),
+                        static_cast<unsigned>(detector.trip_ma()), static_cast<unsigned>(detector.trip_baseline_ma()));
+        }
+        std::printf(", peak %u mA\n", static_cast<unsigned>(detector.peak_ma()));
+        check((verdict != bs_load_verdict_t::k_ok) == profile.trips, profile.name);
+    }
+    // An obstruction shows within a few readings.
+    bs_load_detector detector({150, 2, 6, 600, rise.value, 4, 2500});
+    detector.begin_move();
+    uint32_t sample = 0;
+    while (sample < 2000 && detector.sample(profile_obstruction(sample)) == bs_load_verdict_t::k_ok) {
+        sample++;
+    }
+    check(sample >= 1000 && sample < 1008, "obstruction not caught within 8 readings");
+}
+
+// The motor current model behind the shunt: a stiff mechanism runs on, a jam mid-travel
+// stops the motor with ObstacleDetected, the end stops are told apart from obstacles.
+void current_sense()
+{
+    load_profiles();
+    sim_current_sense_fit(true);
+    app_stop_stats_t stops_before = {};
+    app_driver_get_stop_stats(&stops_before);
+
+    go_to(5000);
+    sim_at(sim_now_us() + 1000000, [] { sim_motor_set_load_ma(150); });
+    run_stage("stiff mechanism", static_cast<int32_t>((5000 * s_travel_steps + 5000) / 10000));
+    sim_motor_set_load_ma(0);
+    app_load_stats_t load = {};
+    app_driver_get_load_stats(&load);
+    check(load.obstructions == 0 && load.end_stops == 0, "a stiffer mechanism stopped the motor");
+
+    go_to(10000);
+    uint64_t jam_us = sim_now_us() + 1000000;
+    sim_at(jam_us, [] { sim_motor_jam(true); });
+    run_stage("obstruction", -1);
+    int64_t latency_us = static_cast<int64_t>(sim_motor().last_edge_us) - static_cast<int64_t>(jam_us);
+    app_driver_get_load_stats(&load);
+    std::printf("obstruction: %u mA over a running %u mA, last step %lld us after the jam, motor stopped at %d steps\n",
+                static_cast<unsigned>(load.trip_ma), static_cast<unsigned>(load.running_ma),
+                static_cast<long long>(latency_us), static_cast<int>(sim_motor().position));
+    check(load.obstructions == 1 && load.end_stops == 0, "obstruction not detected");
+    check((sim_matter_stats().safety_status & k_safety_obstacle_detected) != 0,
+          "obstruction not flagged in SafetyStatus");
+    check(latency_us >= 0 && latency_us < 10000, "obstruction detection too slow");
+    check(sim_motor().position < static_cast<int32_t>(s_travel_steps), "obstruction did not stop the move");
+    sim_motor_jam(false);
+    go_to(5000);
+    run_stage("obstruction cleared", static_cast<int32_t>((5000 * s_travel_steps + 5000) / 10000));
+    check(sim_matter_stats().safety_status == 0, "ObstacleDetected not cleared by a clean move");
+
+    // The top stop 40 steps below step 0: where the blind meets it becomes step 0.
+    sim_motor_set_end_stops(40, static_cast<int32_t>(s_travel_steps), -1);
+    go_to(0);
+    check(wait_settled(), "timed out waiting for the blind to settle");
+    sim_motor_set_origin();
+    check_position("top end stop", 0);
+    sim_motor_set_end_stops(-k_switch_travel, static_cast<int32_t>(s_travel_steps), k_switch_travel);
+
+    // The bottom stop 60 steps short of the calibrated bottom: the blind stays there.
+    sim_motor_set_end_stops(-k_switch_travel, static_cast<int32_t>(s_travel_steps) - 60, k_switch_travel);
+    go_to(10000);
+    run_stage("bottom end stop", static_cast<int32_t>(s_travel_steps) - 60);
+    app_driver_get_load_stats(&load);
+    check(load.obstructions == 1 && load.end_stops == 2, "end stops not told apart from obstructions");
+    check(sim_matter_stats().safety_status == 0, "an end stop set SafetyStatus");
+    sim_motor_set_end_stops(-k_switch_travel, static_cast<int32_t>(s_travel_steps), k_switch_travel);
+    go_to(10000);
+    run_stage("after end stops", static_cast<int32_t>(s_travel_steps));
+
+    app_stop_stats_t stops = {};
+    app_driver_get_stop_stats(&stops);
+    check(stops.count == stops_before.count + 3, "expected a hard stop per load trip");
+
+    // A current channel whose reads all fail: the moves run on without load feedback,
+    // and each one logs the failure once, not once a millisecond.
+    uint32_t errors_before = sim_log_errors();
+    sim_current_sense_fail(true);
+    go_to(0);
+    run_stage("current sense failing", 0);
+    go_to(10000);
+    run_stage("current sense failing", static_cast<int32_t>(s_travel_steps));
+    sim_current_sense_fail(false);
+    check(sim_log_errors() == errors_before + 2, "current sense failures not logged once per move");
+    sim_current_sense_fit(false);
+}
+#endif // CONFIG_BS_CURRENT_SENSE
+
+#if CONFIG_BS_SCENES
+// Recall a scene as app_main's RecallScene pre-callback does: straight to the driver,
+// with the scene's transition time unless the command brings its own.
+uint32_t recall_scene(uint8_t fabric_index, uint16_t group_id, uint8_t scene_id, int64_t override_ms,
+                      const char *stage)
+{
+    bs_scene_t scene = {};
+    check(app_scenes_find(fabric_index, group_id, scene_id, &scene) == ESP_OK, "stored scene not found");
+    uint32_t transition_ms = override_ms >= 0 ? static_cast<uint32_t>(override_ms) : scene.transition_ms;
+    uint16_t lift = scene.lift_percent100ths;
+    uint64_t start_us = sim_now_us();
+    sim_matter_post([lift, transition_ms] { app_driver_set_target_timed(k_endpoint_id, lift, transition_ms); });
+    run_stage(stage, static_cast<int32_t>((lift * s_travel_steps + 5000) / 10000));
+    uint32_t took_ms = static_cast<uint32_t>((sim_motor().last_edge_us - start_us) / 1000);
+    std::printf("[%8.3f s] scene 0x%04X/%u -> %5u: took %u ms, asked %u ms\n", sim_now_us() / 1e6,
+                static_cast<unsigned>(group_id), static_cast<unsigned>(scene_id), static_cast<unsigned>(lift),
+                static_cast<unsigned>(took_ms), static_cast<unsigned>(transition_ms));
+    return took_ms;
+}
+
+// Scenes in the on-device table: stored and saved to NVS, recalled with the move
+// lasting the transition time, scoped by fabric and group, removed again.
+void scenes()
+{
+    constexpr uint16_t k_group = 0x0010;
+    constexpr uint8_t k_fabric = 1;
+    check(app_scenes_init() == ESP_OK, "app_scenes_init failed");
+    const bs_scene_t k_scenes[] = {
+        {k_fabric, 1, k_group, 2500, bs_scene_t::k_no_tilt, 15000}, // movie: slow and quiet
+        {k_fabric, 2, k_group, 0, bs_scene_t::k_no_tilt, 0},        // morning: as the profile runs
+        {k_fabric, 3, k_group, 10000, bs_scene_t::k_no_tilt, 200},  // night: asks the impossible
+        {2, 1, k_group, 7000, bs_scene_t::k_no_tilt, 1000},         // another fabric's "movie"
+    };
+    for (const bs_scene_t &scene : k_scenes) {
+        check(app_scenes_store(&scene) == ESP_OK, "scene not stored");
+    }
+    check(app_scenes_count() == 4, "scene table count wrong");
+
+    // What NVS holds is the table: a fresh one loads it back whole.
+    nvs_handle_t handle;
+    uint8_t blob[sizeof(bs_scene_t) * CONFIG_BS_SCENES_MAX];
+    size_t size = sizeof(blob);
+    bs_scene_table<CONFIG_BS_SCENES_MAX> reloaded;
+    check(nvs_open("scenes", NVS_READONLY, &handle) == ESP_OK &&
+              nvs_get_blob(handle, "table", blob, &size) == ESP_OK && reloaded.load(blob, size),
+          "scene table not saved to NVS");
+    check(size == 4 * sizeof(bs_scene_t) && reloaded.count() == 4 && reloaded.find(2, k_group, 1) &&
+              reloaded.find(2, k_group, 1)->lift_percent100ths == 7000,
+          "scene table in NVS differs");
+
+    app_motion_profile_info_t fast = {};
+    app_driver_get_motion_profile_info(APP_MOTION_PROFILE_FAST, &fast);
+
+    uint32_t took_ms = recall_scene(k_fabric, k_group, 1, -1, "scene movie");
+    check(took_ms + 10 >= 15000 && took_ms <= 15000 + 10, "scene move did not last its transition time");
+    took_ms = recall_scene(k_fabric, k_group, 2, 4000, "scene override");
+    check(took_ms + 10 >= 4000 && took_ms <= 4000 + 10, "RecallScene transition time not applied");
+
+    // No transition time: the motion profile's own speed, not slowed down.
+    took_ms = recall_scene(k_fabric, k_group, 1, -1, "scene movie again");
+    took_ms = recall_scene(k_fabric, k_group, 2, -1, "scene untimed");
+    bs_step_profile_t fast_profile = {fast.cruise_delay_us, fast.start_delay_us, fast.ramp_steps};
+    uint64_t fast_us = bs_move_duration_us(fast_profile, fast.microsteps, 10, (2500 * s_travel_steps + 5000) / 10000);
+    check(took_ms <= fast_us / 1000 + 50, "a scene without a transition time was slowed down");
+    // Too short for this blind: it runs flat out and arrives late.
+    took_ms = recall_scene(k_fabric, k_group, 3, -1, "scene too short");
+    check(took_ms + fast.full_travel_ms / 50 + 50 >= fast.full_travel_ms && took_ms <= fast.full_travel_ms + 100,
+          "a transition shorter than the blind can manage did not run flat out");
+
+    // Scoping and removal.
+    bs_scene_t scene = {};
+    check(app_scenes_find(k_fabric, 0x0011, 1, &scene) == ESP_ERR_NOT_FOUND, "scene found in the wrong group");
+    check(app_scenes_remove(k_fabric, k_group, 3) == ESP_OK, "RemoveScene");
+    check(app_scenes_remove(k_fabric, k_group, 3) == ESP_ERR_NOT_FOUND, "RemoveScene of a removed scene");
+    check(app_scenes_remove_fabric(2) == 1 && app_scenes_find(k_fabric, k_group, 1, &scene) == ESP_OK,
+          "removing a fabric touched another fabric's scenes");
+    for (uint8_t id = 10; app_scenes_count() < CONFIG_BS_SCENES_MAX; ++id) {
+        bs_scene_t filler = {k_fabric, id, k_group, 5000, bs_scene_t::k_no_tilt, 0};
+        check(app_scenes_store(&filler) == ESP_OK, "scene not stored");
+    }
+    bs_scene_t extra = {k_fabric, 200, k_group, 5000, bs_scene_t::k_no_tilt, 0};
+    check(app_scenes_store(&extra) == ESP_ERR_NO_MEM, "a full scene table took another scene");
+    check(app_scenes_remove_group(k_fabric, k_group) == CONFIG_BS_SCENES_MAX && app_scenes_count() == 0,
+          "RemoveAllScenes left scenes behind");
+    check(nvs_open("scenes", NVS_READONLY, &handle) != ESP_OK, "empty scene table left in NVS");
+}
+#endif // CONFIG_BS_SCENES
+
+// ICD poll policy (bs_icd_policy.h) fed by the driver's activity callback, as app_main
+// wires it. The decisions on their own first, with a deadline across the 32-bit
+// millisecond wrap; then on the driver: slow while idle, fast through a move and its
+// hold window, fast again after a button press, and the time accounting behind the
+// radio-on estimate app_main logs.
+constexpr bs_icd_policy_config_t k_icd_config = {5000, 500, 5000, 10000, 6}; // c6_thread defaults
+bs_icd_policy s_icd_policy(k_icd_config);
+uint32_t s_icd_motion_start_ms = 0;
+uint32_t s_icd_motion_stop_ms = 0;
+uint32_t s_icd_button_ms = 0;
+uint32_t s_icd_motion_starts = 0;
+
+uint32_t icd_now_ms()
+{
+    return static_cast<uint32_t>(sim_now_us() / 1000);
+}
+
+// Straight onto the policy: only one task runs at a time on the virtual clock.
+void icd_activity_cb(app_activity_t activity)
+{
+    uint32_t now = icd_now_ms();
+    if (activity == APP_ACTIVITY_BUTTON) {
+        s_icd_policy.on_button(now);
+        s_icd_button_ms = now;
+        return;
+    }
+    bool moving = activity == APP_ACTIVITY_MOTION_START;
+    s_icd_policy.on_motion(moving, now);
+    if (moving) {
+        s_icd_motion_start_ms = s_icd_motion_starts++ ? s_icd_motion_start_ms : now;
+    } else {
+        s_icd_motion_stop_ms = now;
+    }
+}
+
+void icd_policy()
+{
+    const bs_icd_policy_config_t &c = k_icd_config;
+    bs_icd_policy policy(c);
+    uint32_t t = 0xFFFFF000U; // 4.1 s before the millisecond counter wraps
+    policy.start(t);
+    check(!policy.fast(t) && policy.poll_interval_ms(t) == c.slow_poll_ms, "ICD policy not slow at start");
+    policy.on_button(t + 1000);
+    check(policy.fast(t + 1000) && policy.poll_interval_ms(t + 1000) == c.fast_poll_ms,
+          "ICD policy not fast after a button press");
+    check(policy.fast(t + 1000 + c.button_hold_ms - 1) && !policy.fast(t + 1000 + c.button_hold_ms),
+          "ICD button hold window wrong across the millisecond wrap");
+    policy.on_motion(true, t + 2000);
+    check(policy.fast_remaining_ms(t + 2500) == 0 && policy.fast(t + 2000 + 60000), "ICD policy not fast while moving");
+    policy.on_motion(false, t + 3000);
+    check(policy.fast_remaining_ms(t + 3000) == 1000 + c.button_hold_ms - 3000,
+          "ICD motion hold cut a longer button window short");
+    policy.advance(t + 20000);
+    check(policy.fast_ms() == c.button_hold_ms && policy.slow_ms() == 20000 - c.button_hold_ms,
+          "ICD fast/slow time accounting wrong");
+    // 20 fast and 2 slow polls of 6 ms in 20 s.
+    check(policy.radio_on_ms_per_hour() == (20 + 2) * c.poll_radio_on_ms * 180, "ICD radio-on estimate wrong");
+    bs_icd_policy idle(c);
+    idle.start(0);
+    idle.advance(3600000);
+    check(idle.fast_ms() == 0 && idle.radio_on_ms_per_hour() == 3600000 / c.slow_poll_ms * c.poll_radio_on_ms,
+          "ICD idle radio-on estimate wrong");
+
+    go_to(0);
+    run_stage("ICD from top", 0);
+    uint32_t start_ms = icd_now_ms();
+    s_icd_policy.start(start_ms);
+    app_driver_set_activity_cb(icd_activity_cb);
+    sleep_ms(2000);
+    check(!s_icd_policy.fast(icd_now_ms()), "ICD policy fast while idle");
+
+    go_to(10000);
+    sleep_ms(1000);
+    uint32_t now = icd_now_ms();
+    check(s_icd_policy.fast(now) && s_icd_policy.poll_interval_ms(now) == c.fast_poll_ms &&
+              s_icd_policy.fast_remaining_ms(now) == 0,
+          "ICD policy not fast during a move");
+    run_stage("ICD move", static_cast<int32_t>(s_travel_steps));
+    now = icd_now_ms();
+    check(s_icd_motion_starts > 0 && s_icd_policy.fast(now) &&
+              s_icd_policy.fast_remaining_ms(now) == s_icd_motion_stop_ms + c.post_motion_hold_ms - now,
+          "ICD hold window after the move wrong");
+    sleep_ms(c.post_motion_hold_ms);
+    check(!s_icd_policy.fast(icd_now_ms()), "ICD policy still fast after the hold window");
+
+    press(k_btn_stop, 100);
+    now = icd_now_ms();
+    check(s_icd_button_ms != 0 && s_icd_policy.fast(now) &&
+              s_icd_policy.fast_remaining_ms(now) == s_icd_button_ms + c.button_hold_ms - now,
+          "ICD button window wrong");
+    sleep_ms(c.button_hold_ms);
+    app_driver_set_activity_cb(nullptr);
+
+    now = icd_now_ms();
+    s_icd_policy.advance(now);
+    uint64_t fast_ms = s_icd_motion_stop_ms - s_icd_motion_start_ms + c.post_motion_hold_ms + c.button_hold_ms;
+    check(s_icd_policy.fast_ms() == fast_ms && s_icd_policy.slow_ms() == now - start_ms - fast_ms,
+          "ICD fast/slow time differs from the driver's activity");
+    std::printf("[%8.3f s] ICD policy        fast %u ms, slow %u ms, est. radio-on %u ms/h\n", sim_now_us() / 1e6,
+                static_cast<unsigned>(s_icd_policy.fast_ms()), static_cast<unsigned>(s_icd_policy.slow_ms()),
+                static_cast<unsigned>(s_icd_policy.radio_on_ms_per_hour()));
+}
+
+// A brownout mid-move. The host process cannot reset, so the boot code runs over RAM
+// as it stands: the trace ring and motor snapshot a real reset would leave behind.
+void postmortem()
+{
+    go_to(0);
+    sleep_ms(1500);
+    sim_set_reset_reason(ESP_RST_BROWNOUT);
+    check(app_postmortem_init() == ESP_OK, "app_postmortem_init failed");
+    uint32_t reset_ms = static_cast<uint32_t>(sim_now_us() / 1000);
+
+    bs_postmortem_header_t header = {};
+    bs_postmortem_motor_t motor = {};
+    check(app_postmortem_get_last(&header, &motor) == ESP_OK, "no post-mortem record saved");
+    std::printf("post-mortem: #%u %s reset at %u ms, motor %u.%02u%% -> %u.%02u%% at %u ms, %u of %u trace records\n",
+                static_cast<unsigned>(header.sequence), bs_postmortem_reset_name(header.reset_reason),
+                static_cast<unsigned>(header.uptime_ms), static_cast<unsigned>(motor.current_percent100ths / 100),
+                static_cast<unsigned>(motor.current_percent100ths % 100),
+                static_cast<unsigned>(motor.target_percent100ths / 100),
+                static_cast<unsigned>(motor.target_percent100ths % 100), static_cast<unsigned>(motor.uptime_ms),
+                static_cast<unsigned>(header.trace_count), static_cast<unsigned>(header.trace_written));
+    check(header.sequence == 1 && header.reset_reason == ESP_RST_BROWNOUT && header.flags == 0,
+          "post-mortem header does not match the reset");
+    check((motor.flags & BS_POSTMORTEM_MOVING) && motor.dir < 0 && motor.target_percent100ths == 0 &&
+              motor.current_percent100ths > 0 && motor.current_percent100ths < 10000,
+          "post-mortem motor snapshot does not match the move");
+    check(reset_ms - motor.uptime_ms < 500, "post-mortem motor snapshot is stale");
+    check(header.trace_count == BS_POSTMORTEM_TRACE_RECORDS && header.trace_written > header.trace_count,
+          "post-mortem trace incomplete");
+    run_stage("after post-mortem", 0);
+
+    // Power-on RAM is garbage: nothing is saved.
+    sim_set_reset_reason(ESP_RST_POWERON);
+    check(app_postmortem_init() == ESP_OK, "app_postmortem_init failed");
+    check(app_postmortem_get_last(&header, &motor) == ESP_OK && header.sequence == 1,
+          "power-on saved a post-mortem record");
+}
+
+// === DC MOTOR BACKEND ===
+// The driver above runs the stepper backend. The DC backend runs here over the DC motor
+// model (sim_dc.cpp) with the step generator's ramp and the group-move planner, through
+// a STOP, a reversal and a jam. Its steps are hall edges, so the counted position must
+// end exactly where the model's shaft is, coast included.
+constexpr sim_dc_config_t k_dc_motor = {
+    1300.0,  // a lighter blind than the configured 1600 us: the backend has to learn it
+    100,     // dead band
+    40000.0, // speed lag driven
+    6000.0,  // braking
+    60000.0, // coasting with the bridge asleep
+};
+constexpr bs_dc_config_t k_dc_hall_config = {1600, 150, 200000, 30000, true};
+constexpr bs_step_profile_t k_dc_profile = {2000, 4500, 250}; // the driver's default step profile
+
+bool s_dc_halt = false;
+
+struct sim_dc_io {
+    static void lock() {}
+    static void unlock() {}
+    static bool halt_requested() { return s_dc_halt; }
+    static void set_power(bool powered) { sim_dc_set_power(powered); }
+    static void drive(int8_t dir, uint16_t duty_permille) { sim_dc_drive(dir, duty_permille); }
+    static uint32_t hall_edges() { return sim_dc_hall_edges(); }
+    static uint64_t now_us() { return sim_now_us(); }
+    static void delay_us(uint32_t us) { sim_busy_wait_us(us); }
+    static void delay_or_halt_us(uint32_t us)
+    {
+        while (us > 0 && !s_dc_halt) {
+            uint32_t slice = us > 50 ? 50 : us;
+            sim_busy_wait_us(slice);
+            us -= slice;
+        }
+    }
+};
+using sim_dc_backend_t = bs_dc_backend<sim_dc_io>;
+
+struct dc_move_t {
+    int32_t position; // counted steps, coast included
+    uint64_t duration_us;
+    bool stalled;
+};
+
+// The step generator's loop, cut down: ramp up from the start of the move, count steps
+// (and coast before a reversal) until `target` or `max_steps`. The motor stays driven.
+bool dc_run(sim_dc_backend_t &motor, dc_move_t &move, int32_t target, const bs_step_profile_t &profile,
+            uint32_t max_steps = UINT32_MAX)
+{
+    uint64_t start_us = sim_now_us();
+    int8_t dir = target > move.position ? 1 : -1;
+    uint16_t ramp = 0;
+    bool ok = true;
+    for (uint32_t steps = 0; move.position != target && steps < max_steps; ++steps) {
+        if (!motor.step(dir, bs_step_delay_for_ramp(profile, ramp), 1)) {
+            move.stalled = motor.take_stall();
+            ok = false;
+            break;
+        }
+        move.position += motor.take_coast() + dir;
+        ramp = ramp < profile.ramp_steps ? ramp + 1 : ramp;
+    }
+    move.duration_us = sim_now_us() - start_us;
+    return ok;
+}
+
+// Motor off and the shaft at rest: where the blind is now.
+void dc_settle(sim_dc_backend_t &motor, dc_move_t &move, const char *stage)
+{
+    motor.idle();
+    int32_t coast = motor.take_coast();
+    move.position += coast;
+    const sim_dc_motor_t &model = sim_dc_motor();
+    std::printf("[%8.3f s] %-18s counted %5d steps, shaft %5d, coast %d, %.3f s, duty scale %u\n", sim_now_us() / 1e6,
+                stage, static_cast<int>(move.position), static_cast<int>(model.position), static_cast<int>(coast),
+                move.duration_us / 1e6, static_cast<unsigned>(motor.scale_permille()));
+    check(move.position == model.position, "DC position differs from the shaft");
+}
+
+void dc_backend()
+{
+    sim_dc_reset(k_dc_motor);
+    sim_dc_backend_t motor(k_dc_hall_config);
+    dc_move_t move = {};
+
+    // Full travel and back. The way down teaches the backend the blind's speed; the way
+    // up must then take the time the planner says.
+    dc_run(motor, move, 3000, k_dc_profile);
+    dc_settle(motor, move, "DC down");
+    check(move.position > 3000, "DC motor did not coast past the last counted step");
+    uint64_t planned_us = bs_move_duration_us(k_dc_profile, 1, sim_dc_backend_t::k_pulse_us, move.position);
+    dc_run(motor, move, 0, k_dc_profile);
+    dc_settle(motor, move, "DC up");
+    int64_t error_us = static_cast<int64_t>(move.duration_us) - static_cast<int64_t>(planned_us);
+    std::printf("DC up: %.3f s planned, %+.1f ms\n", planned_us / 1e6, error_us / 1e3);
+    check(std::llabs(error_us) < static_cast<int64_t>(planned_us / 50), "DC move off the planned time by 2% or more");
+
+    // A group move planned by bs_sync_plan, as for the stepper.
+    int32_t start = move.position;
+    bs_sync_plan_t plan = bs_sync_plan(k_dc_profile, 1, sim_dc_backend_t::k_pulse_us, 2000, 7000000);
+    dc_run(motor, move, start + 2000, plan.profile);
+    dc_settle(motor, move, "DC group move");
+    error_us = static_cast<int64_t>(move.duration_us) - 7000000;
+    std::printf("DC group move: 7.000 s asked for, %+.1f ms\n", error_us / 1e3);
+    check(plan.on_time && std::llabs(error_us) < 70000, "DC group move off its time by 1% or more");
+
+    // Retarget the other way mid-move: brake, count the coast, then drive back.
+    dc_run(motor, move, move.position + 1500, k_dc_profile, 400);
+    dc_run(motor, move, move.position - 800, k_dc_profile);
+    dc_settle(motor, move, "DC reversal");
+
+    // STOP: the bridge sleeps from the ISR and the shaft coasts to rest.
+    uint64_t now = sim_now_us();
+    sim_at(now + 600000, [] {
+        s_dc_halt = true;
+        sim_dc_backend_t::halt_locked();
+    });
+    start = move.position;
+    check(!dc_run(motor, move, start + 2500, k_dc_profile) && !move.stalled, "DC STOP did not end the move");
+    s_dc_halt = false;
+    dc_settle(motor, move, "DC STOP");
+    check(move.position < start + 2500, "DC STOP came too late");
+
+    // A jam: no hall edge for the stall time ends the move.
+    now = sim_now_us();
+    sim_at(now + 800000, [] { sim_dc_jam(true); });
+    dc_run(motor, move, move.position - 2500, k_dc_profile);
+    uint64_t detect_us = sim_now_us() - (now + 800000);
+    std::printf("DC jam: stalled after %.1f ms\n", detect_us / 1e3);
+    check(move.stalled, "DC jam not detected");
+    check(detect_us < k_dc_hall_config.stall_us + 4 * k_dc_profile.cruise_delay_us + 20000, "DC jam detected late");
+    dc_settle(motor, move, "DC jammed");
+    sim_dc_jam(false);
+
+    // Without a hall sensor the steps are timed: the position is an estimate.
+    bs_dc_config_t timed_config = k_dc_hall_config;
+    timed_config.hall = false;
+    timed_config.full_speed_step_us = 1370; // set up for this blind at the cruise speed
+    sim_dc_reset(k_dc_motor);
+    sim_dc_backend_t timed(timed_config);
+    dc_move_t timed_move = {};
+    dc_run(timed, timed_move, 3000, k_dc_profile);
+    timed.idle();
+    int32_t shaft = sim_dc_motor().position;
+    std::printf("DC timed: counted %d steps, shaft %d (%+.1f%%)\n", static_cast<int>(timed_move.position),
+                static_cast<int>(shaft), (shaft - timed_move.position) * 100.0 / timed_move.position);
+    check(std::abs(shaft - timed_move.position) < timed_move.position / 20, "timed DC steps off by 5% or more");
+}
+
+void print_report()
+{
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - s_wall_start).count();
+    double virtual_s = sim_now_us() / 1e6;
+    std::printf("\n=== Simulation report ===\n");
+    std::printf("Virtual %.3f s in %.3f s wall (%.0fx real time)\n", virtual_s, wall_s,
+                wall_s > 0 ? virtual_s / wall_s : 0.0);
+    sim_kernel_report();
+
+    const sim_matter_stats_t &matter = sim_matter_stats();
+    std::printf("Matter: %u position reports (%.2f/s), %u op-state updates, %llu work items, "
+                "max ScheduleWork latency %llu us\n",
+                static_cast<unsigned>(matter.position_updates), matter.position_updates / virtual_s,
+                static_cast<unsigned>(matter.op_state_updates),
+                static_cast<unsigned long long>(matter.work_items),
+                static_cast<unsigned long long>(matter.max_work_latency_us));
+
+    app_motion_bench_t bench = {};
+    app_driver_get_motion_bench(&bench);
+    std::printf("Motion: %u intervals, deviation %d..%d us, %u late; %u commands, latency avg %u / max %u us; "
+                "%u reports dropped\n",
+                static_cast<unsigned>(bench.step_intervals), static_cast<int>(bench.step_dev_min_us),
+                static_cast<int>(bench.step_dev_max_us), static_cast<unsigned>(bench.step_late),
+                static_cast<unsigned>(bench.commands), static_cast<unsigned>(bench.command_latency_avg_us),
+                static_cast<unsigned>(bench.command_latency_max_us), static_cast<unsigned>(bench.reports_dropped));
+
+    const sim_motor_t &motor = sim_motor();
+    std::printf("Motor: %u steps, edge interval %llu..%llu us, %u steps with EN high\n",
+                static_cast<unsigned>(motor.steps), static_cast<unsigned long long>(motor.edge_min_us),
+                static_cast<unsigned long long>(motor.edge_max_us),
+                static_cast<unsigned>(motor.steps_while_disabled));
+
+    app_stop_stats_t stop_stats = {};
+    app_driver_get_stop_stats(&stop_stats);
+    std::printf("Hard stops: %u, halt latency max %u us\n", static_cast<unsigned>(stop_stats.count),
+                static_cast<unsigned>(stop_stats.max_halt_latency_us));
+
+    app_command_stats_t commands = {};
+    app_driver_get_command_stats(&commands);
+    std::printf("Commands: %u submitted, %u applied, %u coalesced, %u rejected, %u stops\n",
+                static_cast<unsigned>(commands.submitted), static_cast<unsigned>(commands.applied),
+                static_cast<unsigned>(commands.coalesced), static_cast<unsigned>(commands.rejected),
+                static_cast<unsigned>(commands.stops));
+#if CONFIG_BS_DUAL_MOTOR
+    app_lockstep_stats_t lockstep = {};
+    app_driver_get_lockstep_stats(&lockstep);
+    std::printf("Lockstep: %u edges (%u misaligned, step error %d), motor B %u aligned / %u solo edges, "
+                "max skew %llu us, trim %d\n",
+                static_cast<unsigned>(lockstep.edges), static_cast<unsigned>(lockstep.misaligned_edges),
+                static_cast<int>(lockstep.step_error), static_cast<unsigned>(sim_lockstep().aligned_edges),
+                static_cast<unsigned>(sim_lockstep().solo_edges),
+                static_cast<unsigned long long>(sim_lockstep().max_skew_us), static_cast<int>(lockstep.trim_steps));
+#endif
+    std::printf("LED: %u frames, last #%06x\n", static_cast<unsigned>(sim_led_writes()),
+                static_cast<unsigned>(sim_led_rgb()));
+}
+
+[[noreturn]] void finish(void (*mode_report)())
+{
+    check(sim_motor().steps_while_disabled == 0, "STEP pulses issued with EN high");
+    print_report();
+    if (mode_report) {
+        mode_report();
+    }
+    if (s_dump_trace) {
+        app_trace_dump();
+    }
+    if (s_postmortem_out) {
+        FILE *out = std::fopen(s_postmortem_out, "wb");
+        const std::vector<uint8_t> &image = sim_partition_image();
+        if (!out || std::fwrite(image.data(), 1, image.size(), out) != image.size()) {
+            check(false, "could not write the postmortem partition image");
+        }
+        if (out) {
+            std::fclose(out);
+        }
+    }
+    std::printf("\n%s (%d failure%s)\n", s_failures ? "FAILED" : "PASSED", s_failures, s_failures == 1 ? "" : "s");
+    sim_exit(s_failures ? 1 : 0);
+}
+
+void scenario_task(void *arg)
+{
+    (void)arg;
+    sim_matter_start(k_chip_priority, s_attr_cost_us);
+    sim_kernel_name_mutexes({"s_state_lock", "s_aux_lock", "s_adc_lock"});
+    check(app_postmortem_init() == ESP_OK, "app_postmortem_init failed");
+    check(app_driver_init(k_endpoint_id) == ESP_OK, "app_driver_init failed");
+
+    if (s_load.commands > 0) {
+        sim_load_run(s_load, k_endpoint_id);
+        run_stage("after load", -1);
+        finish(sim_load_report);
+    }
+
+    if (s_voltage_path) {
+        voltage_trace_run();
+        finish(nullptr);
+    }
+
+    if (s_replay_path) {
+        int32_t start_position = sim_replay_start_position();
+        if (start_position > 0) {
+            go_to(static_cast<uint16_t>(start_position));
+            run_stage("replay preroll", -1);
+        }
+        uint64_t end_us = sim_replay_schedule(k_endpoint_id);
+        sleep_ms(static_cast<uint32_t>((end_us - sim_now_us()) / 1000) + 1);
+        run_stage("replay end", -1);
+        check(sim_replay_matches(), "replay differs from the recording (hard stops, reports or final position)");
+        finish(sim_replay_report);
+    }
+
+    go_to(10000);
+    run_stage("full close", k_max_steps);
+
+    go_to(2500);
+    run_stage("go to 25%", k_max_steps / 4);
+
+    // A slider being dragged: a target every 20 ms, most of them superseded.
+    uint32_t lcg = 1;
+    for (int i = 0; i < 50; ++i) {
+        lcg = lcg * 1103515245U + 12345U;
+        go_to(static_cast<uint16_t>(3000 + (lcg >> 16) % 4000));
+        sleep_ms(20);
+    }
+    go_to(5000);
+    run_stage("burst then 50%", k_max_steps / 2);
+
+    // STOP button mid-move: the ISR cuts EN, the stepper freezes the target.
+    go_to(0);
+    uint64_t now = sim_now_us();
+    sim_at(now + 1000000, [] { sim_gpio_drive(k_btn_stop, 0); });
+    sim_at(now + 1100000, [] { sim_gpio_drive(k_btn_stop, 1); });
+    run_stage("STOP button", -1);
+
+    go_to(10000);
+    sleep_ms(500);
+    stop();
+    run_stage("Matter Stop", -1);
+
+    // The shaft slips now and then under load: the encoder sees the drift at the end
+    // and the move is re-run from the measured position.
+    go_to(8000);
+    now = sim_now_us();
+    sim_at(now + 500000, [] { sim_motor_skip_steps(15); });
+    sim_at(now + 1500000, [] { sim_motor_skip_steps(25); });
+    run_stage("skipped steps", k_max_steps * 4 / 5);
+
+    // Jammed shaft: the move ends early and SafetyStatus reports MotorJammed.
+    sim_motor_jam(true);
+    go_to(2000);
+    run_stage("jammed", -1);
+    check((sim_matter_stats().safety_status & k_safety_motor_jammed) != 0, "jam not flagged in SafetyStatus");
+    sim_motor_jam(false);
+    go_to(2000);
+    run_stage("unjammed", k_max_steps / 5);
+    check(sim_matter_stats().safety_status == 0, "SafetyStatus not cleared by a clean move");
+
+    app_stop_stats_t stop_stats = {};
+    app_driver_get_stop_stats(&stop_stats);
+    check(stop_stats.count == 2, "expected two hard stops");
+
+    go_to(0);
+    run_stage("before calibration", 0);
+    calibrate_and_tune();
+    rehome_over_matter();
+    motion_profiles();
+    group_moves();
+#if CONFIG_BS_DUAL_MOTOR
+    lockstep();
+#endif
+    motor_bench();
+    params();
+    move_log();
+    undervoltage();
+#if CONFIG_BS_CURRENT_SENSE
+    current_sense();
+#endif
+#if CONFIG_BS_SCENES
+    scenes();
+#endif
+    icd_policy();
+    // The simulated reset below starts a new trace, so --trace dumps the session first.
+    if (s_dump_trace) {
+        app_trace_dump();
+        s_dump_trace = false;
+    }
+    postmortem();
+    dc_backend();
+    finish(nullptr);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--quiet") == 0) {
+            sim_set_quiet(true);
+        } else if (strcmp(argv[i], "--attr-cost-us") == 0 && i + 1 < argc) {
+            s_attr_cost_us = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            s_dump_trace = true;
+        } else if (strcmp(argv[i], "--postmortem-out") == 0 && i + 1 < argc) {
+            s_postmortem_out = argv[++i];
+        } else if (strcmp(argv[i], "--voltage-trace") == 0 && i + 1 < argc) {
+            s_voltage_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            s_replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            s_load.commands = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            s_load.rate_hz = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--subscribers") == 0 && i + 1 < argc) {
+            s_load.subscribers = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--report-cost-us") == 0 && i + 1 < argc) {
+            s_load.report_cost_us = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else {
+            std::fprintf(stderr,
+                         "usage: %s [--quiet] [--trace] [--postmortem-out FILE] [--attr-cost-us N] [--replay TRACE] "
+                         "[--voltage-trace TRACE] [--load N [--rate HZ] [--subscribers K] [--report-cost-us N]]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+    if (s_replay_path && !sim_replay_load(s_replay_path)) {
+        return 2;
+    }
+    if (s_voltage_path && !sim_voltage_load(s_voltage_path)) {
+        return 2;
+    }
+    if (s_load.rate_hz == 0) {
+        s_load.rate_hz = 1;
+    }
+    // Before the virtual clock starts: these producers are real threads.
+    s_failures += sim_queue_stress(k_queue_producers, k_queue_commands_per_producer);
+    s_wall_start = std::chrono::steady_clock::now();
+    sim_kernel_run(scenario_task, "scenario", k_harness_priority);
+}
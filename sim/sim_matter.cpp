@@ -0,0 +1,155 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Stand-in for the CHIP task: runs ScheduleWork items and posted "command
+// callbacks" in order, and records what the driver reported through the data model.
+
+#include <deque>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <app/clusters/window-covering-server/window-covering-server.h>
+#include <esp_matter.h>
+#include <platform/CHIPDeviceLayer.h>
+
+#include "sim.h"
+
+namespace {
+struct work_item_t {
+    std::function<void()> fn;
+    uint64_t queued_us;
+};
+
+TaskHandle_t s_chip_task = nullptr;
+std::deque<work_item_t> s_work;
+uint32_t s_attr_cost_us = 0;
+uint32_t s_subscribers = 0;
+uint32_t s_report_cost_us = 0;
+sim_matter_stats_t s_stats = {};
+
+void queue_work(std::function<void()> fn)
+{
+    s_work.push_back({std::move(fn), sim_now_us()});
+    if (s_chip_task) {
+        xTaskNotifyGive(s_chip_task);
+    }
+}
+
+void chip_task(void *arg)
+{
+    (void)arg;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (!s_work.empty()) {
+            work_item_t item = std::move(s_work.front());
+            s_work.pop_front();
+            uint64_t latency = sim_now_us() - item.queued_us;
+            if (latency > s_stats.max_work_latency_us) {
+                s_stats.max_work_latency_us = latency;
+            }
+            s_stats.work_items++;
+            item.fn();
+        }
+    }
+}
+} // namespace
+
+void sim_matter_start(UBaseType_t priority, uint32_t attr_cost_us)
+{
+    s_attr_cost_us = attr_cost_us;
+    xTaskCreate(chip_task, "CHIP", 8192, nullptr, priority, &s_chip_task);
+}
+
+void sim_matter_set_subscribers(uint32_t count, uint32_t report_cost_us)
+{
+    s_subscribers = count;
+    s_report_cost_us = report_cost_us;
+}
+
+void sim_matter_post(std::function<void()> fn)
+{
+    // Decoding and dispatching an invoke costs about as much as reporting an attribute.
+    queue_work([fn = std::move(fn)] {
+        sim_busy_wait_us(s_attr_cost_us);
+        fn();
+    });
+}
+
+const sim_matter_stats_t &sim_matter_stats()
+{
+    return s_stats;
+}
+
+esp_matter_attr_val_t esp_matter_nullable_uint16(uint16_t value)
+{
+    esp_matter_attr_val_t val = {};
+    val.val.u16 = value;
+    return val;
+}
+
+esp_matter_attr_val_t esp_matter_bitmap16(uint16_t value)
+{
+    esp_matter_attr_val_t val = {};
+    val.val.u16 = value;
+    return val;
+}
+
+namespace esp_matter {
+namespace attribute {
+esp_err_t update(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, esp_matter_attr_val_t *val)
+{
+    (void)endpoint_id;
+    s_stats.attribute_updates++;
+    s_stats.reports_delivered += s_subscribers;
+    if (cluster_id == chip::app::Clusters::WindowCovering::Id &&
+        attribute_id == chip::app::Clusters::WindowCovering::Attributes::CurrentPositionLiftPercent100ths::Id) {
+        s_stats.position_updates++;
+        s_stats.last_position = val->val.u16;
+        s_stats.last_update_us = sim_now_us();
+    }
+    if (cluster_id == chip::app::Clusters::WindowCovering::Id &&
+        attribute_id == chip::app::Clusters::WindowCovering::Attributes::SafetyStatus::Id) {
+        s_stats.safety_status = val->val.u16;
+    }
+    // Attribute store, reporting engine and subscriptions are not free on the device.
+    sim_busy_wait_us(s_attr_cost_us + s_subscribers * s_report_cost_us);
+    return ESP_OK;
+}
+} // namespace attribute
+} // namespace esp_matter
+
+namespace chip {
+namespace app {
+namespace Clusters {
+namespace WindowCovering {
+void OperationalStateSet(chip::EndpointId endpoint, OperationalStatus field, OperationalState state)
+{
+    (void)endpoint;
+    (void)field;
+    s_stats.op_state_updates++;
+    s_stats.last_op_state = static_cast<uint8_t>(state);
+}
+} // namespace WindowCovering
+} // namespace Clusters
+} // namespace app
+
+namespace DeviceLayer {
+CHIP_ERROR PlatformManager::ScheduleWork(AsyncWorkFunct work, intptr_t arg)
+{
+    queue_work([work, arg] { work(arg); });
+    return CHIP_NO_ERROR;
+}
+
+PlatformManager &PlatformMgr()
+{
+    static PlatformManager s_manager;
+    return s_manager;
+}
+} // namespace DeviceLayer
+} // namespace chip
@@ -0,0 +1,207 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Multi-producer stress of the driver's command queue (bs_command_queue.h) on real host
+// threads, outside the virtual clock. On the device the CHIP task, the console and the
+// motor bench all submit; here several std::thread producers interleave GoTo and Stop
+// into the driver's queue type while one consumer drains it like the step generator,
+// now and then cancelling everything handed out so far like a hard stop does.
+//
+// A sequence number is taken before the ring slot is reserved, so the ring can hold
+// commands out of sequence order. Whatever order they drain in, the consumer must
+// only ever apply a newer command than the last one (no duplicate, no stale one
+// after a newer or after a cancel), each with the payload its producer queued, and
+// must end on the newest command unless a cancel covered it. Every command submitted
+// is counted exactly once as applied or coalesced.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "bs_command_queue.h"
+#include "sim.h"
+
+namespace {
+constexpr size_t k_queue_depth = 16; // as app_driver.cpp
+constexpr uint32_t k_cancel_every_batches = 8;
+
+using queue_t = bs_command_queue<k_queue_depth>;
+
+struct submitted_t {
+    uint32_t seq;
+    bs_command_t command; // kind k_none: rejected (ring full)
+};
+
+// What the consumer did, in order: applied a command, or cancelled through a seq.
+struct applied_t {
+    bool cancel;
+    bs_command_t command;
+};
+
+void produce(queue_t &queue, uint32_t producer, uint32_t count, std::vector<submitted_t> &out)
+{
+    uint32_t lcg = 0x9E3779B9U * (producer + 1);
+    out.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        lcg = lcg * 1103515245U + 12345U;
+        submitted_t submitted = {};
+        if ((lcg >> 16) % 16 == 0) {
+            submitted.command.kind = bs_command_kind_t::k_stop;
+            submitted.seq = queue.push_stop();
+        } else {
+            submitted.command.kind = bs_command_kind_t::k_go_to;
+            submitted.command.target_percent100ths = static_cast<uint16_t>((lcg >> 8) % 10001);
+            submitted.command.stamp_us = i;
+            submitted.command.transition_ms = producer;
+            submitted.seq = queue.push_go_to(submitted.command.target_percent100ths, submitted.command.stamp_us,
+                                             submitted.command.transition_ms);
+            if (submitted.seq == 0) {
+                submitted.command.kind = bs_command_kind_t::k_none;
+            }
+        }
+        submitted.command.seq = submitted.seq;
+        out.push_back(submitted);
+        // Bursts with gaps, so the consumer sees both a full ring and one holding only
+        // commands a cancel has just covered.
+        if ((lcg >> 24) % 8 == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        } else if ((lcg >> 24) % 8 == 1) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void consume(queue_t &queue, const std::atomic<bool> &producers_done, std::vector<applied_t> &out)
+{
+    uint32_t batches = 0;
+    bool drained_after_done = false;
+    while (!drained_after_done) {
+        bool done = producers_done.load(std::memory_order_acquire);
+        bs_command_batch_t batch = {};
+        if (!queue.take(batch)) {
+            drained_after_done = done;
+            std::this_thread::yield();
+            continue;
+        }
+        batches++;
+        if (batch.stop) {
+            bs_command_t stop = {};
+            stop.seq = batch.stop_seq;
+            stop.kind = bs_command_kind_t::k_stop;
+            out.push_back({false, stop});
+        }
+        if (batch.has_go_to) {
+            out.push_back({false, batch.go_to});
+        }
+        if (batches % k_cancel_every_batches == 0) {
+            // A hard stop lands while commands are pending: let the ring fill first.
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            bs_command_t cancel = {};
+            cancel.seq = queue.last_seq();
+            queue.cancel_through(cancel.seq);
+            out.push_back({true, cancel});
+        }
+    }
+}
+} // namespace
+
+int sim_queue_stress(uint32_t producers, uint32_t commands_per_producer)
+{
+    int failures = 0;
+    auto check = [&failures](bool ok, const char *what) {
+        if (!ok) {
+            std::printf("FAIL: command queue: %s\n", what);
+            failures++;
+        }
+    };
+
+    queue_t queue; // 16 cells: the producers overrun it now and then and get rejected
+    std::atomic<bool> producers_done(false);
+    std::vector<std::vector<submitted_t>> submitted(producers);
+    std::vector<applied_t> applied;
+
+    std::thread consumer(consume, std::ref(queue), std::cref(producers_done), std::ref(applied));
+    std::vector<std::thread> threads;
+    for (uint32_t p = 0; p < producers; ++p) {
+        threads.emplace_back(produce, std::ref(queue), p, commands_per_producer, std::ref(submitted[p]));
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    producers_done.store(true, std::memory_order_release);
+    consumer.join();
+
+    // Everything handed out, by sequence number.
+    uint32_t last_seq = queue.last_seq();
+    std::vector<bs_command_t> by_seq(last_seq + 1);
+    uint32_t accepted = 0;
+    uint32_t stops = 0;
+    uint32_t rejected = 0;
+    uint32_t newest = 0;
+    for (const std::vector<submitted_t> &list : submitted) {
+        for (const submitted_t &entry : list) {
+            if (entry.command.kind == bs_command_kind_t::k_none) {
+                rejected++;
+                continue;
+            }
+            check(entry.seq != 0 && entry.seq <= last_seq, "sequence number out of range");
+            check(by_seq[entry.seq].kind == bs_command_kind_t::k_none, "sequence number handed out twice");
+            by_seq[entry.seq] = entry.command;
+            accepted++;
+            stops += entry.command.kind == bs_command_kind_t::k_stop ? 1 : 0;
+            newest = std::max(newest, entry.seq);
+        }
+    }
+
+    uint32_t applied_seq = 0;
+    uint32_t cancelled_through = 0;
+    uint32_t cancels = 0;
+    uint32_t applied_count = 0;
+    for (const applied_t &entry : applied) {
+        if (entry.cancel) {
+            cancelled_through = std::max(cancelled_through, entry.command.seq);
+            applied_seq = std::max(applied_seq, entry.command.seq);
+            cancels++;
+            continue;
+        }
+        const bs_command_t &command = entry.command;
+        applied_count++;
+        check(command.seq > applied_seq, "applied a command no newer than the last one");
+        check(command.seq > cancelled_through, "applied a command a cancel covered");
+        applied_seq = std::max(applied_seq, command.seq);
+        if (command.seq > last_seq) {
+            check(false, "applied a sequence number never handed out");
+            continue;
+        }
+        const bs_command_t &queued = by_seq[command.seq];
+        check(queued.kind == command.kind, "applied command kind differs from the one queued");
+        if (command.kind == bs_command_kind_t::k_go_to) {
+            check(queued.target_percent100ths == command.target_percent100ths && queued.stamp_us == command.stamp_us &&
+                      queued.transition_ms == command.transition_ms,
+                  "applied GoTo payload differs from the one queued");
+        }
+    }
+    check(applied_seq >= newest, "the newest command was lost");
+
+    bs_command_queue_stats_t stats = queue.stats();
+    check(stats.submitted == accepted, "submitted count differs from the accepted pushes");
+    check(stats.applied == applied_count, "applied count differs from what the consumer saw");
+    check(stats.applied + stats.coalesced == stats.submitted, "a command was neither applied nor coalesced");
+    check(stats.rejected == rejected, "rejected count differs from the refused pushes");
+    check(stats.stops == stops, "stop count differs");
+
+    std::printf("Command queue: %u producers x %u commands (%u stops, %u rejected): %u applied, %u coalesced, "
+                "%u cancels%s\n",
+                static_cast<unsigned>(producers), static_cast<unsigned>(commands_per_producer),
+                static_cast<unsigned>(stops), static_cast<unsigned>(rejected), static_cast<unsigned>(stats.applied),
+                static_cast<unsigned>(stats.coalesced), static_cast<unsigned>(cancels), failures ? "" : ", consistent");
+    return failures;
+}
@@ -0,0 +1,159 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Replays a device trace (`matter trace dump`, see bs_trace.h) on the virtual clock.
+// Driver inputs are re-injected at their recorded offsets: targets and stops
+// through the CHIP task, button edges on the GPIO pins. Outputs (motion, hard stops,
+// reports) are only counted, to compare against what the replay produces.
+
+#include <cstdio>
+#include <vector>
+
+#include "app_priv.h"
+#include "bs_trace.h"
+#include "sim.h"
+
+namespace {
+struct replay_event_t {
+    uint64_t time_us;
+    bs_trace_record_t record;
+};
+
+std::vector<replay_event_t> s_events;
+uint16_t s_endpoint_id = 0;
+uint32_t s_recorded[static_cast<size_t>(bs_trace_event_t::k_count)] = {};
+uint16_t s_recorded_final_position = 0;
+bool s_recorded_has_position = false;
+uint32_t s_stops_before = 0;
+uint32_t s_reports_before = 0;
+
+constexpr gpio_num_t k_button_pins[] = {GPIO_NUM_1, GPIO_NUM_2, GPIO_NUM_3}; // bs_trace_button_t order
+
+bool carries_position(bs_trace_event_t event)
+{
+    return event == bs_trace_event_t::k_motion_start || event == bs_trace_event_t::k_motion_stop ||
+           event == bs_trace_event_t::k_hard_stop || event == bs_trace_event_t::k_report;
+}
+
+void inject(const bs_trace_record_t &record)
+{
+    uint16_t value = record.value;
+    switch (record.event) {
+    case bs_trace_event_t::k_target:
+        sim_matter_post([value] { app_driver_set_target_percent100ths(s_endpoint_id, value); });
+        break;
+    case bs_trace_event_t::k_stop:
+        sim_matter_post([] { app_driver_stop(s_endpoint_id); });
+        break;
+    case bs_trace_event_t::k_button:
+        if (record.detail <= BS_TRACE_BUTTON_DOWN) {
+            sim_gpio_drive(k_button_pins[record.detail], value ? 0 : 1); // active low
+        }
+        break;
+    default:
+        break;
+    }
+}
+} // namespace
+
+bool sim_replay_load(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        std::fprintf(stderr, "replay: cannot open %s\n", path);
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        replay_event_t event = {};
+        if (!bs_trace_parse(line, event.time_us, event.record)) {
+            continue;
+        }
+        if (!s_events.empty() && event.time_us < s_events.back().time_us) {
+            std::fprintf(stderr, "replay: %s is not in time order\n", path);
+            fclose(file);
+            return false;
+        }
+        s_recorded[static_cast<size_t>(event.record.event)]++;
+        if (carries_position(event.record.event)) {
+            s_recorded_final_position = event.record.value;
+            s_recorded_has_position = true;
+        }
+        s_events.push_back(event);
+    }
+    fclose(file);
+    if (s_events.empty()) {
+        std::fprintf(stderr, "replay: no BSTRACE lines in %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+int32_t sim_replay_start_position()
+{
+    for (const replay_event_t &event : s_events) {
+        if (carries_position(event.record.event)) {
+            return event.record.value;
+        }
+    }
+    return -1;
+}
+
+uint64_t sim_replay_schedule(uint16_t endpoint_id)
+{
+    s_endpoint_id = endpoint_id;
+
+    // Lead-in so reports still pending from boot or the preroll land before the baseline.
+    uint64_t start_us = sim_now_us() + 100000;
+    sim_at(start_us, [] {
+        app_stop_stats_t stops = {};
+        app_driver_get_stop_stats(&stops);
+        s_stops_before = stops.count;
+        s_reports_before = sim_matter_stats().position_updates;
+    });
+    uint64_t first_us = s_events.front().time_us;
+    for (const replay_event_t &event : s_events) {
+        bs_trace_record_t record = event.record;
+        sim_at(start_us + (event.time_us - first_us), [record] { inject(record); });
+    }
+    return start_us + (s_events.back().time_us - first_us);
+}
+
+bool sim_replay_matches()
+{
+    app_stop_stats_t stops = {};
+    app_driver_get_stop_stats(&stops);
+    const sim_matter_stats_t &matter = sim_matter_stats();
+    return s_recorded[static_cast<size_t>(bs_trace_event_t::k_hard_stop)] == stops.count - s_stops_before &&
+           s_recorded[static_cast<size_t>(bs_trace_event_t::k_report)] ==
+               matter.position_updates - s_reports_before &&
+           (!s_recorded_has_position || s_recorded_final_position == matter.last_position);
+}
+
+void sim_replay_report()
+{
+    app_stop_stats_t stops = {};
+    app_driver_get_stop_stats(&stops);
+    const sim_matter_stats_t &matter = sim_matter_stats();
+    auto row = [](const char *name, unsigned recorded, unsigned replayed) {
+        std::printf("  %-16s %9u %9u%s\n", name, recorded, replayed, recorded == replayed ? "" : "  <- differs");
+    };
+    std::printf("Replay: %u records (%u targets, %u stops, %u button edges) over %.3f s\n",
+                static_cast<unsigned>(s_events.size()),
+                static_cast<unsigned>(s_recorded[static_cast<size_t>(bs_trace_event_t::k_target)]),
+                static_cast<unsigned>(s_recorded[static_cast<size_t>(bs_trace_event_t::k_stop)]),
+                static_cast<unsigned>(s_recorded[static_cast<size_t>(bs_trace_event_t::k_button)]),
+                (s_events.back().time_us - s_events.front().time_us) / 1e6);
+    std::printf("  %-16s %9s %9s\n", "", "recorded", "replayed");
+    row("hard stops", s_recorded[static_cast<size_t>(bs_trace_event_t::k_hard_stop)], stops.count - s_stops_before);
+    row("position reports", s_recorded[static_cast<size_t>(bs_trace_event_t::k_report)],
+        matter.position_updates - s_reports_before);
+    if (s_recorded_has_position) {
+        row("final position", s_recorded_final_position, matter.last_position);
+    }
+}
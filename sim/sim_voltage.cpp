@@ -0,0 +1,106 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Plays a recorded battery voltage trace into the ADC model on the virtual clock, so
+// the undervoltage cutoff sees the same sags and dips the recording had.
+//
+// One reading per line, `<ms> <mV>`, the time from the start of playback (fractions
+// allowed); blank lines and `#` comments are skipped. The voltage holds between
+// readings and after the last one.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "sim.h"
+
+namespace {
+struct voltage_point_t {
+    uint64_t offset_us;
+    uint32_t mv;
+};
+
+std::vector<voltage_point_t> s_points;
+} // namespace
+
+bool sim_voltage_load(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        std::fprintf(stderr, "voltage trace: cannot open %s\n", path);
+        return false;
+    }
+    s_points.clear();
+    char line[256];
+    unsigned line_no = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_no++;
+        char *cursor = line;
+        while (*cursor == ' ' || *cursor == '\t') {
+            cursor++;
+        }
+        if (*cursor == '#' || *cursor == '\n' || *cursor == '\r' || *cursor == '\0') {
+            continue;
+        }
+        char *end = nullptr;
+        double ms = strtod(cursor, &end);
+        char *mv_end = nullptr;
+        long mv = strtol(end, &mv_end, 10);
+        if (end == cursor || mv_end == end || ms < 0 || mv < 0) {
+            std::fprintf(stderr, "voltage trace: %s:%u is not `<ms> <mV>`\n", path, line_no);
+            fclose(file);
+            return false;
+        }
+        voltage_point_t point = {static_cast<uint64_t>(ms * 1000.0 + 0.5), static_cast<uint32_t>(mv)};
+        if (!s_points.empty() && point.offset_us < s_points.back().offset_us) {
+            std::fprintf(stderr, "voltage trace: %s is not in time order\n", path);
+            fclose(file);
+            return false;
+        }
+        s_points.push_back(point);
+    }
+    fclose(file);
+    if (s_points.empty()) {
+        std::fprintf(stderr, "voltage trace: no readings in %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+uint64_t sim_voltage_schedule()
+{
+    uint64_t start_us = sim_now_us();
+    sim_hw_set_battery_mv(s_points.front().mv);
+    for (const voltage_point_t &point : s_points) {
+        uint32_t mv = point.mv;
+        sim_at(start_us + point.offset_us, [mv] { sim_hw_set_battery_mv(mv); });
+    }
+    return start_us + s_points.back().offset_us;
+}
+
+int64_t sim_voltage_crossing_us(uint32_t mv)
+{
+    int64_t crossing_us = -1;
+    for (const voltage_point_t &point : s_points) {
+        if (point.mv >= mv) {
+            crossing_us = -1;
+        } else if (crossing_us < 0) {
+            crossing_us = static_cast<int64_t>(point.offset_us);
+        }
+    }
+    return crossing_us;
+}
+
+uint32_t sim_voltage_min_mv()
+{
+    uint32_t min_mv = UINT32_MAX;
+    for (const voltage_point_t &point : s_points) {
+        min_mv = point.mv < min_mv ? point.mv : min_mv;
+    }
+    return min_mv;
+}
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+"""Decode post-mortem records (main/include/bs_postmortem.h) from a dump of the
+"postmortem" partition, newest first.
+
+    parttool.py read_partition --partition-name postmortem --output postmortem.bin
+    postmortem_decode.py postmortem.bin
+    postmortem_decode.py postmortem.bin --trace > last.trace   # blindshade_sim --replay last.trace
+
+A whole-flash dump works too with --offset 0x3E6000.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+MAGIC = 0x4D505342
+VERSION = 1
+SLOT_BYTES = 4096
+TASKS = 16
+TRACE_RECORDS = 256
+
+HEADER = struct.Struct("<IHHIIIIIHBBI")
+MOTOR = struct.Struct("<IHHHHHHbBH")
+TASK = struct.Struct("<16sHHI")
+TRACE = struct.Struct("<IBBH")
+CRC_START = 12
+RECORD_BYTES = HEADER.size + MOTOR.size + TASKS * TASK.size + TRACE_RECORDS * TRACE.size
+
+RESET_NAMES = ["unknown", "power-on", "external", "software", "panic", "interrupt watchdog", "task watchdog",
+               "watchdog", "deep sleep", "brownout", "SDIO", "USB", "JTAG", "eFuse", "power glitch", "CPU lockup"]
+TRACE_EVENTS = ["command", "target", "stop", "button", "motion_start", "motion_stop", "hard_stop", "report"]
+MOTOR_TORN = 0x01
+TASKS_TORN = 0x02
+MOVING = 0x01
+STOPPED_EARLY = 0x02
+CALIBRATING = 0x04
+
+
+def decode_slot(data):
+    """Record dict for one slot, or None if it holds no valid record."""
+    (magic, version, size, crc, sequence, reset_reason, uptime_ms, trace_written, trace_count, task_count, flags,
+     task_window_ms) = HEADER.unpack_from(data, 0)
+    if magic != MAGIC or version != VERSION or size != RECORD_BYTES or size > len(data):
+        return None
+    if trace_count > TRACE_RECORDS or task_count > TASKS or zlib.crc32(data[CRC_START:size]) != crc:
+        return None
+    motor = dict(zip(("uptime_ms", "current", "target", "current_steps", "target_steps", "travel_steps",
+                      "battery_mv", "dir", "flags"), MOTOR.unpack_from(data, HEADER.size)[:9]))
+    tasks = []
+    offset = HEADER.size + MOTOR.size
+    for i in range(task_count):
+        name, cpu_permille, stack_hwm, run_time = TASK.unpack_from(data, offset + i * TASK.size)
+        tasks.append((name.split(b"\0", 1)[0].decode(errors="replace"), cpu_permille, stack_hwm, run_time))
+    trace = []
+    offset += TASKS * TASK.size
+    for i in range(trace_count):
+        trace.append(TRACE.unpack_from(data, offset + i * TRACE.size))
+    return {"sequence": sequence, "reset_reason": reset_reason, "uptime_ms": uptime_ms, "trace_written": trace_written,
+            "flags": flags, "task_window_ms": task_window_ms, "motor": motor, "tasks": tasks, "trace": trace}
+
+
+def trace_lines(trace):
+    """BSTRACE lines as `matter trace dump` prints them, 32-bit timestamps unwrapped."""
+    lines = []
+    time_us = None
+    for stamp, event, detail, value in trace:
+        time_us = stamp if time_us is None else time_us + ((stamp - time_us) & 0xFFFFFFFF)
+        name = TRACE_EVENTS[event] if event < len(TRACE_EVENTS) else "?"
+        lines.append("BSTRACE %d %s %d %d" % (time_us, name, value, detail))
+    return lines
+
+
+def percent(value):
+    return "%d.%02d%%" % (value // 100, value % 100)
+
+
+def print_record(record):
+    reason = record["reset_reason"]
+    torn = " (snapshot torn)" if record["flags"] & (MOTOR_TORN | TASKS_TORN) else ""
+    print("Post-mortem #%d: %s reset after %.3f s uptime%s" % (
+        record["sequence"], RESET_NAMES[reason] if reason < len(RESET_NAMES) else "?", record["uptime_ms"] / 1000.0,
+        torn))
+    motor = record["motor"]
+    if motor["flags"] & MOVING:
+        state = "moving down" if motor["dir"] > 0 else "moving up"
+    else:
+        state = "idle"
+    if motor["flags"] & STOPPED_EARLY:
+        state += ", last move stopped early"
+    if motor["flags"] & CALIBRATING:
+        state += ", calibrating"
+    print("  motor at %.3f s: %s (%d / %d steps), target %s (%d steps), %s, battery %d mV" % (
+        motor["uptime_ms"] / 1000.0, percent(motor["current"]), motor["current_steps"], motor["travel_steps"],
+        percent(motor["target"]), motor["target_steps"], state, motor["battery_mv"]))
+    if record["tasks"]:
+        print("  %-16s %7s %10s %11s   (last %d ms)" % ("task", "CPU", "run time", "stack free",
+                                                        record["task_window_ms"]))
+        for name, cpu_permille, stack_hwm, run_time in record["tasks"]:
+            print("  %-16s %5d.%d%% %10d %9d B" % (name, cpu_permille // 10, cpu_permille % 10, run_time, stack_hwm))
+    print("  trace: newest %d of %d records" % (len(record["trace"]), record["trace_written"]))
+    for line in trace_lines(record["trace"]):
+        print("    " + line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dump", help="postmortem partition dump")
+    parser.add_argument("--offset", type=lambda text: int(text, 0), default=0,
+                        help="partition offset within the dump (whole-flash dumps)")
+    parser.add_argument("--trace", action="store_true", help="only the newest record's trace, as BSTRACE lines")
+    parser.add_argument("--all", action="store_true", help="every record held, not just the newest")
+    args = parser.parse_args()
+
+    with open(args.dump, "rb") as dump:
+        dump.seek(args.offset)
+        data = dump.read()
+    records = []
+    for base in range(0, len(data) - RECORD_BYTES + 1, SLOT_BYTES):
+        record = decode_slot(data[base:base + SLOT_BYTES])
+        if record:
+            records.append(record)
+    if not records:
+        print("No post-mortem record in %s" % args.dump, file=sys.stderr)
+        return 1
+    records.sort(key=lambda record: record["sequence"], reverse=True)
+
+    if args.trace:
+        print("\n".join(trace_lines(records[0]["trace"])))
+        return 0
+    for index, record in enumerate(records if args.all else records[:1]):
+        if index:
+            print()
+        print_record(record)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+"""Per-source-file flash/IRAM/DRAM breakdown from a GNU ld map file, checked
+against a JSON budget. Exits non-zero when any budget is exceeded.
+
+    size_budget.py --map build/blindshade_window_covering.map --budget tools/size_budget_default.json --target esp32c6
+
+Totals come from the budget's "totals", overridden per IDF target by "targets".
+--update rewrites the budget from the map instead: every libmain.a object and the
+target's totals get the measured size plus UPDATE_HEADROOM_PCT. The per-file limits
+are shared by all targets of a profile, so update from the target with the largest
+objects last.
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+from collections import defaultdict
+
+MEMORY_TYPES = ("flash", "iram", "dram")
+UPDATE_HEADROOM_PCT = 10
+FILE_ROUNDING = 64
+TOTAL_ROUNDING = 1024
+
+OUTPUT_SECTION_RE = re.compile(r"^(\.\S+)")
+INPUT_FULL_RE = re.compile(r"^ (\.\S+|COMMON)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+INPUT_NAME_RE = re.compile(r"^ (\.\S+|COMMON)\s*$")
+INPUT_CONT_RE = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+
+
+def classify(output_section):
+    if output_section.startswith(".flash"):
+        return "flash"
+    if output_section.startswith(".iram0"):
+        return "iram"
+    if output_section.startswith(".dram0") or output_section.startswith(".noinit"):
+        return "dram"
+    return None
+
+
+def short_name(path):
+    # "esp-idf/main/libmain.a(app_driver.cpp.obj)" -> "libmain.a(app_driver.cpp.obj)"
+    return os.path.basename(path.strip())
+
+
+def parse_map(path):
+    usage = defaultdict(lambda: dict.fromkeys(MEMORY_TYPES, 0))
+    in_memory_map = False
+    memory_type = None
+    pending_input = False
+
+    with open(path, "r", errors="replace") as map_file:
+        for line in map_file:
+            line = line.rstrip("\n")
+            if not in_memory_map:
+                in_memory_map = line.startswith("Linker script and memory map")
+                continue
+
+            match = OUTPUT_SECTION_RE.match(line)
+            if match:
+                memory_type = classify(match.group(1))
+                pending_input = False
+                continue
+
+            if memory_type is None:
+                continue
+
+            match = INPUT_FULL_RE.match(line)
+            if match:
+                size = int(match.group(3), 16)
+                if size:
+                    usage[short_name(match.group(4))][memory_type] += size
+                pending_input = False
+                continue
+
+            if INPUT_NAME_RE.match(line):
+                pending_input = True
+                continue
+
+            if pending_input:
+                match = INPUT_CONT_RE.match(line)
+                if match:
+                    size = int(match.group(2), 16)
+                    if size:
+                        usage[short_name(match.group(3))][memory_type] += size
+                pending_input = False
+
+    return usage
+
+
+def with_headroom(size, rounding):
+    size = size * (100 + UPDATE_HEADROOM_PCT) // 100
+    return -(-size // rounding) * rounding
+
+
+def write_budget(path, budget):
+    # One object per line, as the budget files are laid out by hand.
+    lines = ["{"]
+    for key in ("_comment", "_provisional"):
+        if key in budget:
+            lines.append("    %s: %s," % (json.dumps(key), json.dumps(budget[key])))
+    if "totals" in budget:
+        lines.append("    \"totals\": %s," % json.dumps(budget["totals"]))
+    targets = sorted(budget.get("targets", {}).items())
+    if not targets:
+        lines.append("    \"targets\": {},")
+    else:
+        lines.append("    \"targets\": {")
+        for index, (target, limits) in enumerate(targets):
+            lines.append("        %s: %s%s" % (json.dumps(target), json.dumps(limits), "," if index + 1 < len(targets) else ""))
+        lines.append("    },")
+    lines.append("    \"files\": {")
+    files = list(budget.get("files", {}).items())
+    for index, (name, limits) in enumerate(files):
+        lines.append("        %s: %s%s" % (json.dumps(name), json.dumps(limits), "," if index + 1 < len(files) else ""))
+    lines.append("    }")
+    lines.append("}")
+    with open(path, "w") as budget_file:
+        budget_file.write("\n".join(lines) + "\n")
+
+
+def update_budget(path, target, usage, totals):
+    with open(path, "r") as budget_file:
+        budget = json.load(budget_file)
+    files = budget.setdefault("files", {})
+    for name in sorted(usage):
+        if name.startswith("libmain.a(") and name not in files:
+            files[name] = {}
+    for name in files:
+        # An object the map does not show (not linked on this target) keeps its limits.
+        if name in usage:
+            files[name] = {
+                memory_type: with_headroom(usage[name][memory_type], FILE_ROUNDING) for memory_type in MEMORY_TYPES
+            }
+    budget.setdefault("targets", {})[target] = {
+        memory_type: with_headroom(totals[memory_type], TOTAL_ROUNDING) for memory_type in MEMORY_TYPES
+    }
+    budget.pop("_provisional", None)
+    write_budget(path, budget)
+    print("\nBudget %s rewritten for %s with %d%% headroom" % (path, target, UPDATE_HEADROOM_PCT))
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--map", required=True, help="linker map file")
+    parser.add_argument("--budget", help="JSON budget file; omit to only print the report")
+    parser.add_argument("--target", help="IDF target, selects the budget's per-target totals")
+    parser.add_argument("--update", action="store_true", help="rewrite the budget from the map instead of checking")
+    parser.add_argument("--top", type=int, default=30, help="rows to print (0 = all)")
+    args = parser.parse_args()
+    if args.update and not (args.budget and args.target):
+        parser.error("--update needs --budget and --target")
+
+    usage = parse_map(args.map)
+    totals = dict.fromkeys(MEMORY_TYPES, 0)
+    for sizes in usage.values():
+        for memory_type in MEMORY_TYPES:
+            totals[memory_type] += sizes[memory_type]
+
+    rows = sorted(usage.items(), key=lambda item: sum(item[1].values()), reverse=True)
+    if args.top > 0:
+        rows = rows[: args.top]
+
+    print("%-56s %10s %8s %8s" % ("object", "flash", "iram", "dram"))
+    for name, sizes in rows:
+        print("%-56s %10d %8d %8d" % (name[:56], sizes["flash"], sizes["iram"], sizes["dram"]))
+    print("%-56s %10d %8d %8d" % ("TOTAL", totals["flash"], totals["iram"], totals["dram"]))
+
+    if not args.budget:
+        return 0
+    if args.update:
+        return update_budget(args.budget, args.target, usage, totals)
+
+    with open(args.budget, "r") as budget_file:
+        budget = json.load(budget_file)
+
+    total_limits = dict(budget.get("totals", {}))
+    total_limits.update(budget.get("targets", {}).get(args.target, {}))
+
+    failures = []
+    for memory_type, limit in total_limits.items():
+        if totals.get(memory_type, 0) > limit:
+            failures.append("TOTAL %s: %d > %d" % (memory_type, totals[memory_type], limit))
+    for name, limits in budget.get("files", {}).items():
+        sizes = usage.get(name)
+        if sizes is None:
+            continue
+        for memory_type, limit in limits.items():
+            if sizes.get(memory_type, 0) > limit:
+                failures.append("%s %s: %d > %d" % (name, memory_type, sizes[memory_type], limit))
+
+    if failures:
+        print("\nSize budget exceeded:")
+        for failure in failures:
+            print("  " + failure)
+        return 1
+
+    print("\nSize budget OK")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())